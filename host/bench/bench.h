@@ -0,0 +1,107 @@
+/*
+  Knob Box - microbenchmark runner for the firmware hot paths
+
+  Each benchmark is a body called once per iteration with the iteration number, so it can
+  walk a table of inputs. The runner grows the batch until it takes --batch-ms, then times
+  --repeats batches and keeps the fastest and the median per call. Alongside the host time
+  it records the cycles the mock core charged per call over one pass of CYCLE_PASS
+  iterations (digitalRead, analogRead, LCD and so on, see host/README.md). That figure does
+  not depend on the host and changes only when the code path does.
+*/
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace kb {
+namespace bench {
+
+// Keeps a value alive without costing more than a register spill
+template <class T>
+inline void keep(const T &v) {
+  asm volatile("" : : "g"(&v) : "memory");
+}
+
+struct Result {
+  int ps_id = 0;
+  std::string supply;
+  std::string name;
+  double ns_min = 0.0;            // per call, fastest batch
+  double ns_median = 0.0;         // per call, median batch
+  double mock_cycles = 0.0;       // per call, charged by the mock core
+  uint64_t iterations = 0;        // per batch
+};
+
+class Runner {
+ public:
+  // Bodies that walk an input table should repeat within this many iterations
+  static constexpr uint64_t CYCLE_PASS = 1024;
+
+  Runner(double batchMs, int repeats, std::string filter)
+      : batchNs_(batchMs * 1e6), repeats_(repeats < 1 ? 1 : repeats), filter_(std::move(filter)) {}
+
+  // `clock` returns the mock core's cycle counter for the image under test
+  template <class Clock, class Body>
+  void run(int ps_id, const char *supply, const char *name, Clock clock, Body body) {
+    if (!filter_.empty() && std::string(name).find(filter_) == std::string::npos) return;
+
+    // Mock cycles over one fixed pass, so they do not depend on how fast the host is
+    const uint64_t c0 = clock();
+    for (uint64_t i = 0; i < CYCLE_PASS; i++) body(i);
+    const double cyclesPerCall = (double)(clock() - c0) / (double)CYCLE_PASS;
+
+    uint64_t n = 64;
+    for (;;) {
+      const double ns = batch(n, body);
+      if (ns >= batchNs_ || n >= (1ull << 32)) break;
+      n = ns > 0.0 ? std::max(n * 2, (uint64_t)((double)n * batchNs_ / ns * 1.1)) : n * 16;
+    }
+    std::vector<double> perCall;
+    for (int r = 0; r < repeats_; r++) perCall.push_back(batch(n, body) / (double)n);
+    std::sort(perCall.begin(), perCall.end());
+
+    Result res;
+    res.ps_id = ps_id;
+    res.supply = supply;
+    res.name = name;
+    res.ns_min = perCall.front();
+    res.ns_median = perCall[perCall.size() / 2];
+    res.mock_cycles = cyclesPerCall;
+    res.iterations = n;
+    results_.push_back(res);
+  }
+
+  const std::vector<Result> &results() const { return results_; }
+
+ private:
+  static double now_ns() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec * 1e9 + (double)t.tv_nsec;
+  }
+
+  template <class Body>
+  static double batch(uint64_t n, Body &body) {
+    const double t0 = now_ns();
+    for (uint64_t i = 0; i < n; i++) body(i);
+    return now_ns() - t0;
+  }
+
+  double batchNs_;
+  int repeats_;
+  std::string filter_;
+  std::vector<Result> results_;
+};
+
+}  // namespace bench
+}  // namespace kb
+
+// One per monitor image, in monitor_bench.cpp built with -DSELECTED_PS_ID=1..4
+void kb_monitor_bench_1(kb::bench::Runner &runner);
+void kb_monitor_bench_2(kb::bench::Runner &runner);
+void kb_monitor_bench_3(kb::bench::Runner &runner);
+void kb_monitor_bench_4(kb::bench::Runner &runner);
@@ -0,0 +1,107 @@
+/*
+  Knob Box - monitor firmware microbenchmarks, one supply per build
+
+  Build once per supply with -DSELECTED_PS_ID=1..4, like the monitor image this includes.
+  The image is powered on so setup() has filled in the ratings and pin modes, then each
+  hot path is called on its own over a fixed table of inputs: the register rounding and
+  clamping helpers, the ADS1115 conversion from read_value(), the Matsusada reset-state
+  check, the +3kV reset counter, the latched-flag word and the LCD formatting.
+*/
+#include "bench.h"
+
+#include "../board/monitor_image.cpp"
+
+namespace {
+
+static constexpr size_t INPUTS = kb::bench::Runner::CYCLE_PASS;     // indexed with i & (INPUTS - 1)
+
+struct Inputs {
+  float clampIn[INPUTS];        // round_clamp_u16: -100 .. 70000
+  float adsIn[INPUTS];          // clamp_i16_positive: -1000 .. 40000
+  int16_t counts[INPUTS][3];    // ADS1115 imon / vmon / vset, including negative readings
+  float volts[INPUTS];          // measured volts, straddling RESET_ENTER_V / RESET_EXIT_V
+  float milliamps[INPUTS];      // measured current, straddling RESET_ENTER_I / RESET_EXIT_I
+  uint8_t events[INPUTS];       // bit 0 Nom Op, bit 1 timer event
+};
+
+const Inputs &inputs() {
+  static Inputs in;
+  static bool filled = false;
+  if (filled) return in;
+  uint32_t x = 12345;
+  auto next = [&x](uint32_t range) {
+    x = x * 1664525u + 1013904223u;
+    return (x >> 8) % range;
+  };
+  for (size_t i = 0; i < INPUTS; i++) {
+    in.clampIn[i] = (float)next(70100) - 100.0f + 0.25f * (float)(i & 3);
+    in.adsIn[i] = (float)next(41000) - 1000.0f;
+    for (int c = 0; c < 3; c++) in.counts[i][c] = (int16_t)((int)next(34000) - 600);
+    in.volts[i] = 0.5f * (float)next(8);
+    in.milliamps[i] = 0.25f * (float)next(6);
+    in.events[i] = (uint8_t)next(4);
+  }
+  filled = true;
+  return in;
+}
+
+}  // namespace
+
+#define KB_MONITOR_BENCH_(id) kb_monitor_bench_##id
+#define KB_MONITOR_BENCH(id) KB_MONITOR_BENCH_(id)
+
+void KB_MONITOR_BENCH(SELECTED_PS_ID)(kb::bench::Runner &runner) {
+  using namespace kb_monitor_fw;
+  static const char *const SUPPLIES[] = {"", "+1kV", "-1kV", "+20kV", "+3kV"};
+  const char *supply = SUPPLIES[ps_id];
+  const Inputs &in = inputs();
+  const size_t MASK = INPUTS - 1;
+
+  kb::Board &board = KB_MONITOR_FACTORY(SELECTED_PS_ID)();
+  board.powerOn(0);
+  auto clock = [] { return host::mcu.now; };
+
+  runner.run(ps_id, supply, "round_clamp_u16", clock, [&](uint64_t i) {
+    kb::bench::keep(round_clamp_u16(in.clampIn[i & MASK]));
+  });
+
+  runner.run(ps_id, supply, "clamp_i16_positive", clock, [&](uint64_t i) {
+    kb::bench::keep(clamp_i16_positive(in.adsIn[i & MASK]));
+  });
+
+  runner.run(ps_id, supply, "convertAdcReadings", clock, [&](uint64_t i) {
+    const int16_t *c = in.counts[i & MASK];
+    convertAdcReadings(c[0], c[1], c[2]);
+  });
+
+  // HV enable on and a set voltage above 1 V, so the Matsusada check runs both transitions
+  board.setPinInput(HV_ENABLE_SWITCH_PIN, 0);
+  programmedHV_V = 500.0f;
+  runner.run(ps_id, supply, "checkMatsusadaResetState", clock, [&](uint64_t i) {
+    measuredHV_V = in.volts[i & MASK];
+    measuredI_mA = in.milliamps[i & MASK];
+    kb::bench::keep(checkMatsusadaResetState());
+  });
+
+  runner.run(ps_id, supply, "update3KVResetCounter", clock, [&](uint64_t i) {
+    const uint8_t e = in.events[i & MASK];
+    update3KVResetCounter(e & 1, e & 2);
+  });
+
+  // Every other flag input high
+  static const uint8_t FLAG_PINS[] = {FLAG_3KV_TIMER_PIN, FLAG_ARMBEAMS_PIN,     FLAG_CCSPOWER_PIN,
+                                      FLAG_ARM80KV_PIN,   FLAG_1K_VCOMP_PIN,     FLAG_1K_ICOMP_PIN,
+                                      FLAG_NEG_1K_VCOMP_PIN, FLAG_NEG_1K_ICOMP_PIN, FLAG_20K_VCOMP_PIN,
+                                      FLAG_20K_ICOMP_PIN, FLAG_3K_VCOMP_PIN,     FLAG_3K_ICOMP_PIN};
+  for (size_t p = 0; p < sizeof(FLAG_PINS); p++) board.setPinInput(FLAG_PINS[p], (int)(p & 1));
+  runner.run(ps_id, supply, "readFlagsWord", clock, [&](uint64_t) { kb::bench::keep(readFlagsWord()); });
+
+  // The four lines for readings anywhere in the supply's range
+  runner.run(ps_id, supply, "display_value", clock, [&](uint64_t i) {
+    const int16_t *c = in.counts[i & MASK];
+    programmedHV_V = (float)c[0] * ratedHV_V / 32767.0f;
+    measuredHV_V = (float)c[1] * ratedHV_V / 32767.0f;
+    measuredI_mA = (float)c[2] * ratedI_mA / 32767.0f;
+    kb::bench::keep(display_value());
+  });
+}
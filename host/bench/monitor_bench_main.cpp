@@ -0,0 +1,154 @@
+/*
+  Knob Box - monitor_bench
+
+  Runs the monitor hot-path microbenchmarks for every supply and prints ns per call and
+  the mock core's cycles per call. --csv writes the same table for a later --baseline run,
+  which reports every benchmark that got slower than the tolerance, or whose mock cycles
+  changed at all, and exits 1 if there is one.
+
+  Usage:
+    monitor_bench [--ids LIST] [--filter TEXT] [--batch-ms MS] [--repeats N]
+                  [--csv FILE] [--baseline FILE] [--tolerance PCT]
+*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include "bench.h"
+
+using kb::bench::Result;
+
+namespace {
+
+const char CSV_HEADER[] = "ps_id,supply,benchmark,ns_min,ns_median,mock_cycles,iterations";
+
+bool write_csv(const char *path, const std::vector<Result> &results) {
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    fprintf(stderr, "monitor_bench: cannot write %s\n", path);
+    return false;
+  }
+  fprintf(f, "%s\n", CSV_HEADER);
+  for (const Result &r : results) {
+    fprintf(f, "%d,%s,%s,%.3f,%.3f,%.1f,%llu\n", r.ps_id, r.supply.c_str(), r.name.c_str(), r.ns_min, r.ns_median,
+            r.mock_cycles, (unsigned long long)r.iterations);
+  }
+  fclose(f);
+  return true;
+}
+
+bool read_csv(const char *path, std::vector<Result> &results) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    fprintf(stderr, "monitor_bench: cannot read %s\n", path);
+    return false;
+  }
+  char line[256];
+  if (!fgets(line, sizeof(line), f) || std::string(line).compare(0, sizeof(CSV_HEADER) - 1, CSV_HEADER) != 0) {
+    fprintf(stderr, "monitor_bench: %s is not a monitor_bench CSV\n", path);
+    fclose(f);
+    return false;
+  }
+  while (fgets(line, sizeof(line), f)) {
+    Result r;
+    char supply[32], name[64];
+    unsigned long long it;
+    if (sscanf(line, "%d,%31[^,],%63[^,],%lf,%lf,%lf,%llu", &r.ps_id, supply, name, &r.ns_min, &r.ns_median,
+               &r.mock_cycles, &it) != 7) {
+      continue;
+    }
+    r.supply = supply;
+    r.name = name;
+    r.iterations = it;
+    results.push_back(r);
+  }
+  fclose(f);
+  return true;
+}
+
+// Number of regressions against `base`
+int compare(const std::vector<Result> &now, const std::vector<Result> &base, double tolerancePct) {
+  int regressions = 0;
+  for (const Result &r : now) {
+    const Result *b = nullptr;
+    for (const Result &x : base) {
+      if (x.ps_id == r.ps_id && x.name == r.name) b = &x;
+    }
+    if (!b) continue;
+    const double change = b->ns_min > 0.0 ? (r.ns_min / b->ns_min - 1.0) * 100.0 : 0.0;
+    const bool slower = change > tolerancePct;
+    const bool cycles = fabs(r.mock_cycles - b->mock_cycles) >= 0.05;
+    if (!slower && !cycles) continue;
+    if (regressions++ == 0) printf("\nagainst the baseline:\n");
+    printf("  %-5s %-26s", r.supply.c_str(), r.name.c_str());
+    if (slower) printf("  %.2f -> %.2f ns (%+.0f %%)", b->ns_min, r.ns_min, change);
+    if (cycles) printf("  mock cycles %.1f -> %.1f", b->mock_cycles, r.mock_cycles);
+    printf("\n");
+  }
+  if (regressions == 0) printf("\nno regressions against the baseline (tolerance %.0f %%)\n", tolerancePct);
+  return regressions;
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: monitor_bench [options]\n"
+          "  --ids LIST        supplies to run (default 1,2,3,4)\n"
+          "  --filter TEXT     only benchmarks whose name contains TEXT\n"
+          "  --batch-ms MS     length of one timed batch (default 20)\n"
+          "  --repeats N       timed batches per benchmark (default 7)\n"
+          "  --csv FILE        write the results\n"
+          "  --baseline FILE   compare with a --csv file from an earlier run\n"
+          "  --tolerance PCT   slowdown of the fastest batch allowed against the baseline (default 25)\n");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  std::string ids = "1,2,3,4", filter;
+  double batchMs = 20.0, tolerance = 25.0;
+  int repeats = 7;
+  const char *csv = nullptr, *baseline = nullptr;
+  for (int i = 1; i < argc; i++) {
+    const std::string a = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (a == "--ids" && hasValue) {
+      ids = argv[++i];
+    } else if (a == "--filter" && hasValue) {
+      filter = argv[++i];
+    } else if (a == "--batch-ms" && hasValue) {
+      batchMs = atof(argv[++i]);
+    } else if (a == "--repeats" && hasValue) {
+      repeats = atoi(argv[++i]);
+    } else if (a == "--csv" && hasValue) {
+      csv = argv[++i];
+    } else if (a == "--baseline" && hasValue) {
+      baseline = argv[++i];
+    } else if (a == "--tolerance" && hasValue) {
+      tolerance = atof(argv[++i]);
+    } else {
+      usage();
+      return 2;
+    }
+  }
+
+  std::vector<Result> base;
+  if (baseline && !read_csv(baseline, base)) return 2;
+
+  static void (*const BENCHES[])(kb::bench::Runner &) = {nullptr, kb_monitor_bench_1, kb_monitor_bench_2,
+                                                          kb_monitor_bench_3, kb_monitor_bench_4};
+  kb::bench::Runner runner(batchMs, repeats, filter);
+  for (char c : ids) {
+    if (c >= '1' && c <= '4') BENCHES[c - '0'](runner);
+  }
+
+  printf("%-5s %-26s %10s %10s %12s\n", "", "", "ns min", "ns median", "mock cycles");
+  for (const Result &r : runner.results()) {
+    printf("%-5s %-26s %10.2f %10.2f %12.1f\n", r.supply.c_str(), r.name.c_str(), r.ns_min, r.ns_median,
+           r.mock_cycles);
+  }
+  if (csv && !write_csv(csv, runner.results())) return 2;
+  return (baseline && compare(runner.results(), base, tolerance) > 0) ? 1 : 0;
+}
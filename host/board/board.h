@@ -0,0 +1,72 @@
+/*
+  Knob Box - one simulated Arduino Mega running a firmware image
+
+  Each image (logic_image.cpp, monitor_image.cpp per SELECTED_PS_ID) is its own translation
+  unit with its own MCU model, and is reached only through this interface. Pins use the
+  Arduino digital pin numbers from the READMEs; time is in 16 MHz cycles.
+*/
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+
+namespace kb {
+
+static constexpr uint64_t CYCLES_PER_US = 16;
+static constexpr uint64_t CYCLES_PER_MS = 16000;
+
+enum class PinDrive : uint8_t {
+  FLOATING,    // input, no pull-up
+  PULLED_UP,   // input with pull-up (weak high)
+  DRIVEN_LOW,  // output low
+  DRIVEN_HIGH  // output high
+};
+
+class Board {
+ public:
+  virtual ~Board() = default;
+
+  virtual const char *name() const = 0;
+
+  // Power-on reset: registers cleared, MCUSR = PORF, the .init3 hook, then setup()
+  virtual void powerOn(uint64_t atCycle) = 0;
+  // One loop() pass, then every interrupt that became pending during it
+  virtual void step() = 0;
+  virtual uint64_t now() const = 0;
+  // Lets an idle board's clock jump forward (only ever moves forward)
+  virtual void advanceTo(uint64_t cycle) = 0;
+  // Set once the watchdog timed out; the board then stops running loop()
+  virtual bool watchdogTripped() const = 0;
+
+  // Pins
+  virtual PinDrive pinDrive(uint8_t pin) const = 0;
+  virtual int pinLevel(uint8_t pin) const = 0;
+  virtual void setPinInput(uint8_t pin, int level) = 0;    // 0 / 1, or -1 to float
+  virtual uint8_t portOutput(char port) const = 0;         // PORTx as last written
+  // Called after any PORTx/DDRx write that changed it
+  virtual void onPinsChanged(std::function<void()> fn) = 0;
+  // Called for every PORTx write that changed it: (port letter, new value, cycle)
+  virtual void onPortWrite(std::function<void(char, uint8_t, uint64_t)> fn) = 0;
+
+  // Analog front end
+  virtual void setAnalog(uint8_t channel, uint16_t counts) = 0;   // analogRead(A<channel>)
+  virtual void setAdsCounts(uint8_t channel, int16_t counts) = 0; // ADS1115 single-ended
+  virtual const char *lcdLine(uint8_t row) const = 0;
+
+  // USARTs: bytes leave TXn through the sink, stamped with their stop-bit cycle
+  virtual void uartInject(uint8_t n, uint8_t byte, uint64_t arrivalCycle) = 0;
+  virtual void onUartTx(uint8_t n, std::function<void(uint8_t, uint64_t)> fn) = 0;
+  virtual uint64_t uartCharCycles(uint8_t n) const = 0;
+
+  // Modbus register array, for boards that have one
+  virtual bool inputRegister(uint16_t addr, uint16_t &value) const = 0;
+};
+
+}  // namespace kb
+
+// Factories, one per image translation unit
+kb::Board &kb_logic_board();
+kb::Board &kb_monitor_board_1();   // PS_POS1KV
+kb::Board &kb_monitor_board_2();   // PS_NEG1KV
+kb::Board &kb_monitor_board_3();   // PS_20KV
+kb::Board &kb_monitor_board_4();   // PS_3KV
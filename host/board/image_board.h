@@ -0,0 +1,142 @@
+/*
+  Knob Box - kb::Board implementation for the firmware image in this translation unit
+
+  Include after the firmware, with a traits type naming its entry points:
+    struct Fw {
+      static void early_init();              // the .init3 hook
+      static void setup();
+      static void loop();
+      static uint16_t *regs();               // Modbus register array, or nullptr
+      static uint16_t reg_count();
+    };
+*/
+#pragma once
+
+#include "board.h"
+#include <Arduino.h>
+
+namespace {
+
+template <class Fw>
+class ImageBoard final : public kb::Board {
+ public:
+  ImageBoard(const char *name, uint64_t loopCycles) : name_(name), loopCycles_(loopCycles) {}
+
+  const char *name() const override { return name_; }
+
+  void powerOn(uint64_t atCycle) override {
+    host::Mcu &m = host::mcu;
+    if (atCycle > m.now) m.now = atCycle;
+    m.powerOnReset(_BV(PORF));
+    Fw::early_init();
+    m.SREG_.v |= 0x80;                  // init() enables interrupts before setup()
+    Fw::setup();
+    host::service_interrupts(m.now);
+  }
+
+  void step() override {
+    host::Mcu &m = host::mcu;
+    if (m.wdtTripped) {
+      m.now += loopCycles_;
+      return;
+    }
+    Fw::loop();
+    host::spend(loopCycles_);
+    host::service_interrupts(m.now);
+    host::watchdog_expired();
+  }
+
+  uint64_t now() const override { return host::mcu.now; }
+  void advanceTo(uint64_t cycle) override {
+    if (cycle > host::mcu.now) host::mcu.now = cycle;
+  }
+  bool watchdogTripped() const override { return host::mcu.wdtTripped; }
+
+  kb::PinDrive pinDrive(uint8_t pin) const override {
+    if (pin >= 70) return kb::PinDrive::FLOATING;
+    const host::Gpio &g = host::mcu.gpio[host::PIN_PORT[pin]];
+    const uint8_t bit = (uint8_t)_BV(host::PIN_BIT[pin]);
+    if (g.ddr.v & bit) return (g.port.v & bit) ? kb::PinDrive::DRIVEN_HIGH : kb::PinDrive::DRIVEN_LOW;
+    return (g.port.v & bit) ? kb::PinDrive::PULLED_UP : kb::PinDrive::FLOATING;
+  }
+
+  int pinLevel(uint8_t pin) const override {
+    if (pin >= 70) return 0;
+    return (host::gpio_levels(host::mcu.gpio[host::PIN_PORT[pin]]) >> host::PIN_BIT[pin]) & 1;
+  }
+
+  void setPinInput(uint8_t pin, int level) override {
+    if (pin >= 70) return;
+    const uint8_t p = host::PIN_PORT[pin];
+    const uint8_t bit = (uint8_t)_BV(host::PIN_BIT[pin]);
+    const host::Gpio &g = host::mcu.gpio[p];
+    uint8_t driven = g.extDriven, levelBits = g.extLevel;
+    if (level < 0) {
+      driven &= (uint8_t)~bit;
+    } else {
+      driven |= bit;
+      levelBits = level ? (uint8_t)(levelBits | bit) : (uint8_t)(levelBits & ~bit);
+    }
+    if (driven != g.extDriven || (levelBits & driven) != g.extLevel) {
+      host::drive_port(p, driven, levelBits);
+    }
+  }
+
+  uint8_t portOutput(char port) const override {
+    const int p = port_index(port);
+    return (p < 0) ? 0 : host::mcu.gpio[p].port.v;
+  }
+
+  void onPinsChanged(std::function<void()> fn) override {
+    host::mcu.onPinsChanged = fn ? [fn](uint8_t) { fn(); } : std::function<void(uint8_t)>();
+  }
+
+  void onPortWrite(std::function<void(char, uint8_t, uint64_t)> fn) override {
+    host::mcu.onPortWrite = fn ? [fn](uint8_t p, uint8_t v) { fn(PORT_LETTERS[p], v, host::mcu.now); }
+                               : std::function<void(uint8_t, uint8_t)>();
+  }
+
+  void setAnalog(uint8_t channel, uint16_t counts) override {
+    if (channel < 16) host::mcu.analog[channel] = counts;
+  }
+  void setAdsCounts(uint8_t channel, int16_t counts) override {
+    if (channel < 4) host::mcu.adsCounts[channel] = counts;
+  }
+  const char *lcdLine(uint8_t row) const override { return host::mcu.lcdText[row & 3]; }
+
+  void uartInject(uint8_t n, uint8_t byte, uint64_t arrivalCycle) override {
+    if (n >= 4) return;
+    host::Usart &u = host::mcu.usart[n];
+    u.rxPending.emplace_back(arrivalCycle, byte);
+    const uint64_t chr = host::usart_char_cycles(u);
+    u.rxEdges.push_back(arrivalCycle > chr ? arrivalCycle - chr : 0);
+  }
+  void onUartTx(uint8_t n, std::function<void(uint8_t, uint64_t)> fn) override {
+    if (n < 4) host::mcu.usart[n].sink = fn;
+  }
+  uint64_t uartCharCycles(uint8_t n) const override {
+    return (n < 4) ? host::usart_char_cycles(host::mcu.usart[n]) : 0;
+  }
+
+  bool inputRegister(uint16_t addr, uint16_t &value) const override {
+    uint16_t *regs = Fw::regs();
+    if (!regs || addr >= Fw::reg_count()) return false;
+    value = regs[addr];
+    return true;
+  }
+
+ private:
+  static constexpr char PORT_LETTERS[host::PORT_COUNT + 1] = "ABCDEFGHJKL";
+
+  static int port_index(char port) {
+    for (int p = 0; p < host::PORT_COUNT; p++) {
+      if (PORT_LETTERS[p] == port) return p;
+    }
+    return -1;
+  }
+
+  const char *name_;
+  uint64_t loopCycles_;
+};
+
+}  // namespace
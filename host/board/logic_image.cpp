@@ -0,0 +1,38 @@
+/*
+  Knob Box - Logic Arduino firmware image for the host
+
+  logic_arduino.cpp is compiled unchanged inside its own namespace, against the host
+  Arduino core in host/mock.
+*/
+#include <Arduino.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/wdt.h>
+#include <util/crc16.h>
+
+namespace {      // internal linkage: every image TU carries its own copy of the firmware globals
+namespace kb_logic_fw {
+#include "../../logic-arduino/logic_arduino.cpp"
+}  // namespace kb_logic_fw
+}  // namespace
+
+#include "image_board.h"
+
+#ifndef KB_LOGIC_LOOP_US
+#define KB_LOGIC_LOOP_US 25     // one step() pass on the Mega, including wdt_reset()
+#endif
+
+namespace {
+struct LogicFw {
+  static void early_init() { kb_logic_fw::watchdog_early_init(); }
+  static void setup() { kb_logic_fw::setup(); }
+  static void loop() { kb_logic_fw::loop(); }
+  static uint16_t *regs() { return nullptr; }
+  static uint16_t reg_count() { return 0; }
+};
+}  // namespace
+
+kb::Board &kb_logic_board() {
+  static ImageBoard<LogicFw> board("logic", KB_LOGIC_LOOP_US * kb::CYCLES_PER_US);
+  return board;
+}
@@ -0,0 +1,51 @@
+/*
+  Knob Box - monitor firmware image for the host
+
+  Build once per supply with -DSELECTED_PS_ID=PS_POS1KV / PS_NEG1KV / PS_20KV / PS_3KV.
+  monitor_firmware.cpp is compiled unchanged inside its own namespace, against the host
+  Arduino core in host/mock; the factory is kb_monitor_board_<ps_id>().
+*/
+#include <Arduino.h>
+#include <arduino-timer.h>
+#include <Wire.h>
+#include <avr/wdt.h>
+#include <util/crc16.h>
+#include <util/atomic.h>
+#include <LiquidCrystal_I2C.h>
+#include <Adafruit_ADS1X15.h>
+#include <ModbusRtu.h>
+
+#ifndef SELECTED_PS_ID
+#error "Build the monitor image with -DSELECTED_PS_ID=PS_..."
+#endif
+
+namespace {      // internal linkage: every image TU carries its own copy of the firmware globals
+namespace kb_monitor_fw {
+#include "../../monitor-arduino/monitor_firmware.cpp"
+}  // namespace kb_monitor_fw
+}  // namespace
+
+#include "image_board.h"
+
+#ifndef KB_MONITOR_LOOP_US
+#define KB_MONITOR_LOOP_US 20   // one idle loop(): wdt_reset, slave.poll, timer.tick
+#endif
+
+namespace {
+struct MonitorFw {
+  static void early_init() { kb_monitor_fw::watchdog_early_init(); }
+  static void setup() { kb_monitor_fw::setup(); }
+  static void loop() { kb_monitor_fw::loop(); }
+  static uint16_t *regs() { return kb_monitor_fw::modbus_bank[kb_monitor_fw::modbus_live]; }   // the published bank
+  static uint16_t reg_count() { return TOTAL_REG_COUNT; }
+};
+}  // namespace
+
+#define KB_MONITOR_FACTORY_(id) kb_monitor_board_##id
+#define KB_MONITOR_FACTORY(id) KB_MONITOR_FACTORY_(id)
+
+kb::Board &KB_MONITOR_FACTORY(SELECTED_PS_ID)() {
+  static const char *const NAMES[] = {"", "monitor+1kV", "monitor-1kV", "monitor+20kV", "monitor+3kV"};
+  static ImageBoard<MonitorFw> board(NAMES[kb_monitor_fw::ps_id], KB_MONITOR_LOOP_US * kb::CYCLES_PER_US);
+  return board;
+}
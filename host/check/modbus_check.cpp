@@ -0,0 +1,298 @@
+/*
+  Knob Box - Modbus request checks against the monitor images
+
+  Sends each monitor image a fixed set of requests, one at a time on an otherwise quiet bus,
+  and checks that each gets the reply it is owed: a normal reply of the right length, or the
+  right exception. The set covers the requests the firmware must refuse before they reach
+  ModbusRtu: reads its 64-byte frame buffer cannot hold, and writes outside the holding
+  registers 47-49. It then checks that only a read of all of 50-56 restarts the window, that
+  a snapshot broadcast publishes the age of its pair, and on the +3kV monitor that
+  only a read that carried the latched flags clears them.
+
+  Each failed check prints the request and what came back, and gives exit status 1.
+
+  Usage:
+    modbus_check [--ids 1,2,3,4] [-v]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "../board/board.h"
+#include "../client/kb_register_map.h"
+#include "../common/modbus_frame.h"
+
+using namespace kb;
+using namespace kb::client;
+
+namespace {
+
+static constexpr uint8_t MONITOR_MODBUS_UART = 1;
+static constexpr uint8_t SLAVE_COUNT = 4;           // PS_POS1KV .. PS_3KV
+static constexpr uint64_t GAP_MS = 60;              // as kb_bus_poller leaves between requests
+static constexpr uint64_t TIMEOUT_MS = 200;
+
+struct Check {
+  const char *name;
+  uint8_t fc;
+  std::vector<uint8_t> data;   // after the function code, before the CRC
+  uint8_t exception;           // 0: a normal reply is owed
+  std::vector<uint16_t> values = {};   // registers a read must return; empty: any
+};
+
+std::vector<uint8_t> words(uint16_t a, uint16_t b) {
+  return {(uint8_t)(a >> 8), (uint8_t)a, (uint8_t)(b >> 8), (uint8_t)b};
+}
+
+// Write Multiple Registers data: start, quantity, byte count, values
+std::vector<uint8_t> writes(uint16_t start, uint16_t count, std::vector<uint16_t> values) {
+  std::vector<uint8_t> d = words(start, count);
+  d.push_back((uint8_t)(2 * values.size()));
+  for (uint16_t v : values) {
+    d.push_back((uint8_t)(v >> 8));
+    d.push_back((uint8_t)v);
+  }
+  return d;
+}
+
+const std::vector<Check> &checks() {
+  static const std::vector<Check> c = {
+      {"read 0+6", 4, words(0, 6), 0},
+      {"read 0+29, the longest that fits", 4, words(0, 29), 0},
+      {"holding read 29+29", 3, words(29, 29), 0},
+      {"read 0+30", 4, words(0, 30), 3},
+      {"read 0+57", 4, words(0, 57), 3},
+      {"holding read 0+57", 3, words(0, 57), 3},
+      {"read 0+0", 4, words(0, 0), 3},
+      {"read 50+10, past the last register", 4, words(50, 10), 2},
+      {"write 48", 6, words(DEADBAND_V_READ, 7), 0},
+      {"write 47+3", 16, writes(DEADBAND_V_SET, 3, {2, 7, 9}), 0},
+      {"write 0, an input register", 6, words(V_SET, 1234), 2},
+      {"write 50, past the holding registers", 6, words(WINDOW_V_MIN, 1), 2},
+      {"write 46+2, across the first holding register", 16, writes(CHANGE_MAP, 2, {1, 1}), 2},
+      {"write 47+4", 16, writes(DEADBAND_V_SET, 4, {1, 1, 1, 1}), 3},
+      {"write 47+0", 16, writes(DEADBAND_V_SET, 0, {}), 3},
+      {"deadbands kept the accepted writes only", 3, words(DEADBAND_V_SET, 3), 0, {2, 7, 9}},
+      {"write coil 0", 5, words(0, 0xFF00), 1},
+      {"read coils 0+16", 1, words(0, 16), 1},
+  };
+  return c;
+}
+
+std::string hex(const std::vector<uint8_t> &v) {
+  std::string s;
+  char b[4];
+  for (uint8_t x : v) {
+    snprintf(b, sizeof(b), "%02x", x);
+    s += b;
+  }
+  return s.empty() ? "nothing" : s;
+}
+
+class Monitor {
+ public:
+  Monitor(Board &b, uint8_t id) : b_(b), id_(id) {
+    b_.powerOn(0);
+    chr_ = b_.uartCharCycles(MONITOR_MODBUS_UART);
+    b_.onUartTx(MONITOR_MODBUS_UART, [this](uint8_t byte, uint64_t at) {
+      reply_.push_back(byte);
+      lastTx_ = at;
+    });
+  }
+
+  // Puts `req` on the bus after GAP_MS of silence and returns what came back before the
+  // reply went quiet or the timeout ran out
+  std::vector<uint8_t> transact(const std::vector<uint8_t> &req) {
+    reply_.clear();
+    const uint64_t start = b_.now() + GAP_MS * CYCLES_PER_MS;
+    const uint64_t end = start + req.size() * chr_;
+    // Queued ahead, so the board takes each start bit's edge at its own time
+    for (size_t i = 0; i < req.size(); i++) b_.uartInject(MONITOR_MODBUS_UART, req[i], start + (i + 1) * chr_);
+    for (;;) {
+      const uint64_t t = b_.now();
+      if (reply_.empty() && t > end + TIMEOUT_MS * CYCLES_PER_MS) break;
+      if (!reply_.empty() && t > lastTx_ + 4 * chr_) break;
+      b_.step();
+    }
+    return reply_;
+  }
+
+  // Runs the board for `ms` with the bus quiet
+  void idle(uint64_t ms) {
+    const uint64_t until = b_.now() + ms * CYCLES_PER_MS;
+    while (b_.now() < until) b_.step();
+  }
+
+  uint8_t id() const { return id_; }
+  Board &board() { return b_; }
+
+ private:
+  Board &b_;
+  uint8_t id_;
+  uint64_t chr_ = 0;
+  uint64_t lastTx_ = 0;
+  std::vector<uint8_t> reply_;
+};
+
+std::vector<uint8_t> frame(uint8_t id, uint8_t fc, const std::vector<uint8_t> &data) {
+  std::vector<uint8_t> f(2 + data.size());
+  f[0] = id;
+  f[1] = fc;
+  std::copy(data.begin(), data.end(), f.begin() + 2);
+  const uint16_t crc = modbus_crc16(f.data(), f.size());
+  f.push_back((uint8_t)crc);
+  f.push_back((uint8_t)(crc >> 8));
+  return f;
+}
+
+// Empty when `reply` is what `c` is owed, else what was wrong with it
+std::string judge(const Check &c, const std::vector<uint8_t> &req, const std::vector<uint8_t> &reply) {
+  if (reply.empty()) return "no reply";
+  if (!modbus_crc_ok(reply.data(), reply.size())) return "bad CRC";
+  if (reply[0] != req[0] || (reply[1] & 0x7F) != c.fc) return "reply to another request";
+  if (c.exception != 0) {
+    if (!(reply[1] & 0x80)) return "normal reply where an exception was owed";
+    if (reply.size() != MODBUS_EXCEPTION_BYTES || reply[2] != c.exception) return "wrong exception";
+    return "";
+  }
+  if (reply[1] & 0x80) return "exception where a normal reply was owed";
+  if (reply.size() != modbus_reply_bytes(req.data(), req.size())) return "wrong reply length";
+  for (size_t i = 0; i < c.values.size(); i++) {
+    if ((uint16_t)((reply[3 + 2 * i] << 8) | reply[4 + 2 * i]) != c.values[i]) return "wrong register value";
+  }
+  return "";
+}
+
+struct Tally {
+  unsigned run = 0, failed = 0;
+  bool verbose = false;
+
+  void check(Monitor &m, const Check &c) {
+    const std::vector<uint8_t> req = frame(m.id(), c.fc, c.data);
+    const std::vector<uint8_t> reply = m.transact(req);
+    note(m, c.name, hex(req) + " -> " + hex(reply), judge(c, req, reply));
+  }
+
+  // Counts a check that failed if `why` is not empty, and prints it with `detail`
+  void note(Monitor &m, const char *name, const std::string &detail, const std::string &why) {
+    run++;
+    if (!why.empty()) failed++;
+    if (!why.empty() || verbose) {
+      printf("%s  %-10s %s: %s%s%s\n", why.empty() ? "ok  " : "FAIL", m.board().name(), name, detail.c_str(),
+             why.empty() ? "" : "  ", why.c_str());
+    }
+  }
+};
+
+// The +3kV monitor clears its latched flags on the sample after a read that carried them, and
+// only then. Latch D27 for one sample, read only the change map, then read register 5 twice a
+// sample apart: the first read must still see the flag, and the second must not.
+void check_latch_clears(Monitor &m, Tally &t) {
+  static constexpr uint8_t FLAG_FIRST_PIN = 26, FLAG_LAST_PIN = 37, ARMBEAMS_FLAG_PIN = 27;
+  static constexpr uint64_t SAMPLE_MS = 200;   // past one 150 ms read_value() sample
+  Board &b = m.board();
+  for (uint8_t pin = FLAG_FIRST_PIN; pin <= FLAG_LAST_PIN; pin++) b.setPinInput(pin, 0);
+  m.idle(SAMPLE_MS);
+  t.check(m, {"read 5 with no flag up", 4, words(LATCHED_FLAGS, 1), 0});
+  m.idle(SAMPLE_MS);
+  b.setPinInput(ARMBEAMS_FLAG_PIN, 1);
+  m.idle(SAMPLE_MS);
+  b.setPinInput(ARMBEAMS_FLAG_PIN, 0);
+  m.idle(SAMPLE_MS);
+  t.check(m, {"read 46 alone", 4, words(CHANGE_MAP, 1), 0});
+  m.idle(SAMPLE_MS);
+  t.check(m, {"read 5 after a read of 46 alone keeps D27", 4, words(LATCHED_FLAGS, 1), 0, {Latched::ARMBEAMS_SWITCH}});
+  m.idle(SAMPLE_MS);
+  t.check(m, {"read 5 after a read of 5 sees it cleared", 4, words(LATCHED_FLAGS, 1), 0, {0}});
+}
+
+// The window restarts on the sample after a read that carried all of 50-56. Read the block,
+// let a few samples go by, read 49-55 (all but the count), then read the block twice a
+// sample apart. The first of those must still count the readings since the first read, so
+// it must hold well over the one sample's worth in the second.
+void check_window_restart(Monitor &m, Tally &t) {
+  static constexpr uint64_t SAMPLE_MS = 200;
+  const std::vector<uint8_t> block = frame(m.id(), 4, words(WINDOW_V_MIN, 7));
+  const size_t n = modbus_reply_bytes(block.data(), block.size());
+  m.transact(block);
+  m.idle(3 * SAMPLE_MS);
+  const std::vector<uint8_t> partial = m.transact(frame(m.id(), 4, words(WINDOW_V_MIN - 1, 7)));
+  m.idle(SAMPLE_MS);
+  const std::vector<uint8_t> kept = m.transact(block);
+  m.idle(SAMPLE_MS);
+  const std::vector<uint8_t> restarted = m.transact(block);
+
+  std::string why;
+  if (partial.size() != n || kept.size() != n || restarted.size() != n) {
+    why = "a read got no normal reply";
+  } else {
+    const auto count = [](const std::vector<uint8_t> &r) { return (uint16_t)((r[15] << 8) | r[16]); };
+    if (count(kept) <= 2 * count(restarted)) why = "a read of 49-55 restarted the window";
+  }
+  t.note(m, "a read of 49-55 keeps the window", hex(kept) + ", then " + hex(restarted), why);
+}
+
+// A snapshot broadcast gets no reply. The monitor publishes the Vmon/Imon pair that was newest
+// when the frame arrived and the pair's age then in register 58; the sampler never waits longer
+// than the longest loop() pass for a pair.
+void check_snapshot_delay(Monitor &m, Tally &t) {
+  static constexpr uint32_t LONGEST_PASS_US = 65000;
+  const uint16_t tag = (uint16_t)(0x5A00 | m.id());
+  const std::vector<uint8_t> none = m.transact(frame(BROADCAST_ID, 6, words(SNAPSHOT_TAG, tag)));
+  t.note(m, "snapshot broadcast", "-> " + hex(none), none.empty() ? "" : "a broadcast got a reply");
+  t.check(m, {"read 40 after the broadcast", 4, words(SNAPSHOT_TAG, 1), 0, {tag}});
+
+  const std::vector<uint8_t> req = frame(m.id(), 4, words(SNAPSHOT_DELAY, 1));
+  const std::vector<uint8_t> reply = m.transact(req);
+  std::string why;
+  if (!judge({"", 4, {}, 0}, req, reply).empty()) {
+    why = "no normal reply";
+  } else {
+    const uint16_t delay = (uint16_t)((reply[3] << 8) | reply[4]);
+    if (delay > LONGEST_PASS_US) why = "pair older than the longest pass";
+  }
+  t.note(m, "read 58, the snapshot pair's age", hex(req) + " -> " + hex(reply), why);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  bool selected[SLAVE_COUNT + 1] = {false, true, true, true, true};
+  Tally t;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--ids") && i + 1 < argc) {
+      memset(selected, 0, sizeof(selected));
+      for (char *p = argv[++i]; *p;) {
+        const long id = strtol(p, &p, 10);
+        if (id < 1 || id > SLAVE_COUNT) {
+          fprintf(stderr, "modbus_check: --ids takes slave ids 1-%u\n", SLAVE_COUNT);
+          return 2;
+        }
+        selected[id] = true;
+        if (*p == ',') p++;
+      }
+    } else if (!strcmp(argv[i], "-v")) {
+      t.verbose = true;
+    } else {
+      fprintf(stderr, "usage: modbus_check [--ids 1,2,3,4] [-v]\n");
+      return 2;
+    }
+  }
+
+  Board *boards[SLAVE_COUNT] = {&kb_monitor_board_1(), &kb_monitor_board_2(), &kb_monitor_board_3(),
+                                &kb_monitor_board_4()};
+  for (uint8_t id = 1; id <= SLAVE_COUNT; id++) {
+    if (!selected[id]) continue;
+    Monitor m(*boards[id - 1], id);
+    for (const Check &c : checks()) t.check(m, c);
+    check_window_restart(m, t);
+    check_snapshot_delay(m, t);
+    if ((Slave)id == Slave::HV3KV) check_latch_clears(m, t);
+  }
+  printf("%u checks, %u failed\n", t.run, t.failed);
+  return t.failed ? 1 : 0;
+}
@@ -0,0 +1,324 @@
+/*
+  Knob Box client - polling the four monitors on one RS-485 bus
+
+  BusPoller keeps a fixed table of periodic reads, builds every request frame when the
+  read is added and sends them back to back from a non-blocking descriptor. The caller
+  owns the loop: wait on fd() for at most next_timeout_ms(), then call service(). Replies
+  are checked (slave, function, byte count, CRC) and handed to the handler as a Reply
+  that points into the poller's receive buffer; nothing is allocated after construction.
+
+    struct Handler {
+      void on_reply(int read, const kb::client::Reply &r, double latency_ms);
+      void on_failure(int read, kb::client::Failure why);
+    };
+
+  Modbus RTU is half duplex with one request outstanding, so requests cannot overlap on
+  the wire; the time between them is what there is to save. Every monitor hears every
+  frame, and a monitor whose loop() is busy with its LCD or ADS1015 for the whole pause
+  after another slave's reply sees that reply and the next request as one frame and drops
+  the request (host/README.md, modbus_loadgen). The poller therefore keeps a long gap only
+  when it moves to another slave and sends reads for the same slave a short gap apart,
+  preferring a read for the slave it is already talking to that was due when it moved
+  there, so two reads for one slave that keep falling due cannot hold the bus.
+
+  A read added with a period of 0 is sent only when request() asks for it, once per call,
+  for example to fetch a block after the change map shows that it moved.
+
+  A snapshot broadcast (add_snapshot) is scheduled with the reads. It has no reply, so the
+  bus is free once the frame has left, and the next request waits the switch gap like a
+  request to another slave.
+*/
+#pragma once
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "../common/modbus_frame.h"
+#include "kb_register_map.h"
+
+namespace kb {
+namespace client {
+
+enum class Failure : uint8_t {
+  TIMEOUT,      // no complete reply in time
+  EXCEPTION,    // the slave answered with a Modbus exception
+  BAD_FRAME     // wrong slave, function or byte count, or a bad CRC
+};
+
+constexpr const char *failure_name(Failure f) {
+  return f == Failure::TIMEOUT ? "timeout" : f == Failure::EXCEPTION ? "exception" : "bad frame";
+}
+
+struct Timing {
+  unsigned baud = 9600;
+  double switch_gap_ms = 60.0;    // before a request to a different slave than the last one
+  double same_gap_ms = 6.0;       // before another request to the same slave (ModbusRtu T35 is 5 ms)
+  double timeout_ms = 200.0;      // after the request has left the adapter
+};
+
+struct PollerStats {
+  uint64_t sent = 0;
+  uint64_t replies = 0;
+  uint64_t timeouts = 0;
+  uint64_t exceptions = 0;
+  uint64_t bad_frames = 0;
+  uint64_t stray_bytes = 0;       // received with no request outstanding
+  uint64_t write_errors = 0;
+  uint64_t broadcasts = 0;
+};
+
+template <class Handler, size_t MaxReads = 16>
+class BusPoller {
+ public:
+  struct Read {
+    Slave slave;
+    uint16_t first;
+    uint16_t count;
+    double period_ms;
+    uint64_t ok;
+    uint64_t failed;
+    double last_latency_ms;
+  };
+
+  BusPoller(int fd, Handler &handler, const Timing &timing = Timing())
+      : fd_(fd), handler_(handler), timing_(timing), charMs_(10000.0 / timing.baud) {}
+
+  // Returns the read's index, or -1 if the table is full or the range is not a valid read.
+  // The first request goes out as soon as the bus allows, or, with a period of 0, when
+  // request() is called.
+  int add(Slave slave, uint16_t first, uint16_t count, double period_ms, uint8_t function = 4) {
+    if (n_ >= MaxReads || !valid_read(first, count) || (function != 3 && function != 4)) return -1;
+    Entry &e = reads_[n_];
+    e.read = Read{slave, first, count, period_ms, 0, 0, 0.0};
+    e.broadcast = false;
+    e.req[0] = (uint8_t)slave;
+    e.req[1] = function;
+    e.req[2] = (uint8_t)(first >> 8);
+    e.req[3] = (uint8_t)first;
+    e.req[4] = (uint8_t)(count >> 8);
+    e.req[5] = (uint8_t)count;
+    const uint16_t crc = modbus_crc16(e.req, 6);
+    e.req[6] = (uint8_t)crc;
+    e.req[7] = (uint8_t)(crc >> 8);
+    e.replyBytes = 5 + 2u * count;
+    e.due = period_ms > 0.0 ? -1.0 : NOT_DUE;
+    return (int)n_++;
+  }
+
+  template <class B>
+  int add(Slave slave, double period_ms, uint8_t function = 4) {
+    static_assert(B::count <= MAX_READ, "");
+    return add(slave, B::first, B::count, period_ms, function);
+  }
+
+  // Broadcasts a snapshot request every period_ms, each with the next nonzero tag. Returns
+  // the entry's index, or -1 if the table is full or a snapshot is already scheduled.
+  int add_snapshot(double period_ms) {
+    if (n_ >= MaxReads || snapshot_ >= 0) return -1;
+    Entry &e = reads_[n_];
+    e.read = Read{(Slave)BROADCAST_ID, SNAPSHOT_TAG, 1, period_ms, 0, 0, 0.0};
+    e.broadcast = true;
+    e.req[0] = BROADCAST_ID;
+    e.req[1] = 6;
+    e.req[2] = (uint8_t)(SNAPSHOT_TAG >> 8);
+    e.req[3] = (uint8_t)SNAPSHOT_TAG;
+    e.replyBytes = 0;
+    e.due = -1.0;
+    snapshot_ = (int)n_;
+    return (int)n_++;
+  }
+
+  // Sends on-demand read i as soon as the bus allows; a no-op if it is already due
+  void request(int i, double now) {
+    Entry &e = reads_[i];
+    if (e.due > now) e.due = now;
+  }
+
+  // Tag of the last snapshot broadcast, 0 = none sent yet
+  uint16_t snapshot_tag() const { return tag_; }
+
+  int fd() const { return fd_; }
+
+  // Milliseconds until service() has something to do without new input; 0 = now
+  int next_timeout_ms(double now) const {
+    double at;
+    if (current_ >= 0) {
+      at = deadline_;
+    } else {
+      const int next = pick(&at);
+      if (next < 0) return -1;
+    }
+    return at <= now ? 0 : (int)(at - now) + 1;
+  }
+
+  // Reads what has arrived, finishes or times out the outstanding request and sends the next
+  void service(double now) {
+    receive(now);
+    if (current_ >= 0 && now >= deadline_) finish(now, false, Failure::TIMEOUT);
+    if (current_ < 0) {
+      double at;
+      const int next = pick(&at);
+      if (next >= 0 && at <= now) send(next, now);
+    }
+  }
+
+  const Read &read(int i) const { return reads_[i].read; }
+  size_t reads() const { return n_; }
+  const PollerStats &stats() const { return stats_; }
+  bool busy() const { return current_ >= 0; }
+
+ private:
+  static constexpr double NOT_DUE = 1e300;   // on-demand read not requested
+
+  struct Entry {
+    Read read;
+    uint8_t req[8];
+    size_t replyBytes;
+    double due;                   // < 0: never sent
+    bool broadcast;               // snapshot broadcast, no reply
+  };
+
+  // The read to send next and when the bus lets it go: a read for the slave last addressed
+  // that was due when the poller moved to it, if there is one, otherwise the most overdue read
+  int pick(double *at) const {
+    int best = -1, same = -1;
+    for (size_t i = 0; i < n_; i++) {
+      const Entry &e = reads_[i];
+      if (best < 0 || e.due < reads_[best].due) best = (int)i;
+      if (e.read.slave == lastSlave_ && e.due <= switchedAt_ && (same < 0 || e.due < reads_[same].due)) same = (int)i;
+    }
+    if (best < 0 || reads_[best].due >= NOT_DUE) return -1;
+    const int chosen = same >= 0 ? same : best;
+    const Entry &e = reads_[chosen];
+    const bool sameSlave = haveLast_ && e.read.slave == lastSlave_ && !e.broadcast;
+    const double gap = sameSlave ? timing_.same_gap_ms : timing_.switch_gap_ms;
+    const double free = haveLast_ ? busFreeAt_ + gap : 0.0;
+    *at = e.due > free ? e.due : free;
+    return chosen;
+  }
+
+  void send(int i, double now) {
+    Entry &e = reads_[i];
+    if (e.broadcast) {
+      if (++tag_ == 0) tag_ = 1;
+      e.req[4] = (uint8_t)(tag_ >> 8);
+      e.req[5] = (uint8_t)tag_;
+      const uint16_t crc = modbus_crc16(e.req, 6);
+      e.req[6] = (uint8_t)crc;
+      e.req[7] = (uint8_t)(crc >> 8);
+    }
+    const ssize_t w = ::write(fd_, e.req, sizeof(e.req));
+    if (e.read.period_ms > 0.0) {
+      e.due = (e.due < 0.0 ? now : e.due) + e.read.period_ms;
+      if (e.due < now) e.due = now;   // fell behind: do not send a burst to catch up
+    } else {
+      e.due = NOT_DUE;
+    }
+    if (!haveLast_ || e.read.slave != lastSlave_) switchedAt_ = now;
+    lastSlave_ = e.read.slave;
+    haveLast_ = true;
+    if (w != (ssize_t)sizeof(e.req)) {
+      stats_.write_errors++;
+      busFreeAt_ = now;
+      e.read.failed++;
+      handler_.on_failure(i, Failure::BAD_FRAME);
+      return;
+    }
+    if (e.broadcast) {
+      stats_.broadcasts++;
+      e.read.ok++;
+      busFreeAt_ = now + sizeof(e.req) * charMs_;
+      return;
+    }
+    stats_.sent++;
+    current_ = i;
+    got_ = 0;
+    sentAt_ = now;
+    deadline_ = now + sizeof(e.req) * charMs_ + timing_.timeout_ms;
+  }
+
+  void receive(double now) {
+    for (;;) {
+      uint8_t *dst = rx_ + got_;
+      const size_t room = sizeof(rx_) - got_;
+      const ssize_t r = ::read(fd_, room ? dst : scratch_, room ? room : sizeof(scratch_));
+      if (r <= 0) break;
+      if (current_ < 0 || !room) {
+        stats_.stray_bytes += (uint64_t)r;
+        continue;
+      }
+      got_ += (size_t)r;
+      const size_t want = expected();
+      if (got_ >= want) {
+        if (got_ > want) stats_.stray_bytes += got_ - want;
+        Failure why = Failure::BAD_FRAME;
+        finish(now, check(want, &why), why);
+      }
+    }
+  }
+
+  // Bytes the outstanding reply will have, as far as the header shows
+  size_t expected() const {
+    if (got_ >= 2 && (rx_[1] & 0x80)) return MODBUS_EXCEPTION_BYTES;
+    return reads_[current_].replyBytes;
+  }
+
+  bool check(size_t n, Failure *why) const {
+    const Entry &e = reads_[current_];
+    if (rx_[0] != e.req[0] || !modbus_crc_ok(rx_, n)) return false;
+    if (rx_[1] == (e.req[1] | 0x80)) {
+      *why = Failure::EXCEPTION;
+      return false;
+    }
+    return rx_[1] == e.req[1] && rx_[2] == 2 * e.read.count;
+  }
+
+  void finish(double now, bool ok, Failure result) {
+    const int i = current_;
+    Entry &e = reads_[i];
+    current_ = -1;
+    busFreeAt_ = now;
+    if (ok) {
+      stats_.replies++;
+      e.read.ok++;
+      e.read.last_latency_ms = now - sentAt_;
+      const Reply r{e.read.slave, e.read.first, e.read.count, rx_ + 3};
+      handler_.on_reply(i, r, e.read.last_latency_ms);
+      return;
+    }
+    if (result == Failure::TIMEOUT) stats_.timeouts++;
+    if (result == Failure::EXCEPTION) stats_.exceptions++;
+    if (result == Failure::BAD_FRAME) stats_.bad_frames++;
+    e.read.failed++;
+    handler_.on_failure(i, result);
+  }
+
+  int fd_;
+  Handler &handler_;
+  Timing timing_;
+  double charMs_;
+
+  Entry reads_[MaxReads];
+  size_t n_ = 0;
+
+  int current_ = -1;
+  double sentAt_ = 0.0;
+  double deadline_ = 0.0;
+  double busFreeAt_ = 0.0;
+  Slave lastSlave_ = Slave::POS1KV;
+  bool haveLast_ = false;
+  double switchedAt_ = 0.0;       // when the poller moved to lastSlave_
+  int snapshot_ = -1;
+  uint16_t tag_ = 0;
+
+  uint8_t rx_[5 + 2 * MAX_READ];
+  uint8_t scratch_[64];
+  size_t got_ = 0;
+
+  PollerStats stats_;
+};
+
+}  // namespace client
+}  // namespace kb
@@ -0,0 +1,371 @@
+/*
+  Knob Box client - kb_poll
+
+  A small dashboard on the client library: polls the 0-5 telemetry block and the 37-56
+  sample block from every monitor and the 5-33 Logic link block from the +3kV monitor, and
+  prints one line per monitor each second. Latched flags are kept until printed, so a flag
+  latched between two lines is not missed. The sample sequence number tells new samples
+  from repeats, and with the sample time gives the monitor's own sampling rate. The window
+  registers are folded together the same way, so each line shows the Vmon and Imon
+  extremes since the last one.
+
+  With --snapshot, a snapshot broadcast goes out every MS; the 37-56 reads carry each
+  monitor's latest snapshot back, and once every polled monitor holds the same one, it is
+  printed as a single line.
+
+  With --on-change, only the change map (register 46) is polled every period, and the 0-5
+  and 37-56 blocks are fetched when it shows that something moved. The +3kV monitor's
+  latched flags still come with its Logic link reads. --deadband-v and --deadband-i set the
+  monitors' deadbands first.
+
+  Usage:
+    kb_poll -p DEVICE [-b baud] [--ids LIST] [--period MS] [--link-period MS] [-d SECONDS]
+            [--snapshot MS] [--on-change] [--deadband-v V] [--deadband-i UA]
+            [--switch-gap MS] [--same-gap MS] [--timeout MS]
+*/
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+
+#include "../common/serial_port.h"
+#include "kb_bus_poller.h"
+
+using namespace kb::client;
+
+namespace {
+
+struct Dashboard {
+  struct Monitor {
+    bool seen = false;
+    bool stamped = false;       // a 37-56 reply has arrived
+    uint16_t v_set = 0, v_read = 0, i_read = 0, resets = 0;
+    Unlatched signals{0};
+    uint16_t latched = 0;       // ORed until printed
+    uint16_t seq = 0;
+    uint32_t sampleMs = 0;
+    uint16_t lineSeq = 0;       // at the previous line
+    uint32_t lineMs = 0;
+    unsigned fresh = 0, repeats = 0;   // since the previous line
+    uint16_t snapTag = 0, snapVSet = 0, snapVRead = 0, snapIRead = 0;
+    bool wantFetch = false;     // the change map showed a move
+    uint16_t windowSeq = 0;     // sample whose window registers were last folded in
+    bool windowSeen = false;
+    uint32_t windowCount = 0;   // readings per channel since the previous line, 0 = none
+    uint16_t vMin = 0, vMax = 0, iMin = 0, iMax = 0;
+    double vSum = 0.0, iSum = 0.0;
+    double latency_ms = 0.0;
+    uint64_t failures = 0;
+  };
+  Monitor mon[5];
+  bool haveLink = false;
+  uint16_t loopHz = 0, loopMinHz = 0;
+  LinkStatus link{0};
+  FirstOut firstOut{0};
+  uint16_t timerMs = 0, goodFrames = 0, badFrames = 0;
+  uint16_t printedTag = 0;        // last snapshot printed
+
+  void on_reply(int, const Reply &r, double latency_ms) {
+    Monitor &m = mon[(int)r.slave];
+    m.latency_ms = latency_ms;
+    if (Telemetry t = Telemetry::from(r)) {
+      m.v_set = t.get<V_SET>();
+      m.v_read = t.get<V_READ>();
+      m.i_read = t.get<I_READ>();
+      m.resets = t.get<RESET_COUNT_3KV>();
+      m.signals = t.get<UNLATCHED_SIGNALS>();
+      m.seen = true;
+    }
+    if (SampleStats st = SampleStats::from(r)) {
+      const uint16_t seq = st.get<SAMPLE_SEQ>();
+      if (m.stamped && seq == m.seq) {
+        m.repeats++;
+      } else {
+        m.fresh++;
+      }
+      if (!m.stamped) {
+        m.lineSeq = seq;
+        m.lineMs = st.sample_time_ms();
+      }
+      m.stamped = true;
+      m.seq = seq;
+      m.sampleMs = st.sample_time_ms();
+    }
+    if (Changes c = Changes::from(r)) {
+      if (!SampleStats::from(r) && c.get<CHANGE_MAP>().any()) m.wantFetch = true;
+    }
+    // Each reply restarts the window, so windows from different samples never overlap;
+    // a repeat of the same sample carries the same window and is skipped.
+    if (Window w = Window::from(r)) {
+      if (r.covers(SAMPLE_SEQ) && (!m.windowSeen || r.reg(SAMPLE_SEQ) != m.windowSeq)) {
+        const uint16_t n = w.get<WINDOW_COUNT>();
+        if (m.windowCount == 0) {
+          m.vMin = w.get<WINDOW_V_MIN>();
+          m.vMax = w.get<WINDOW_V_MAX>();
+          m.iMin = w.get<WINDOW_I_MIN>();
+          m.iMax = w.get<WINDOW_I_MAX>();
+        }
+        m.vMin = std::min(m.vMin, w.get<WINDOW_V_MIN>());
+        m.vMax = std::max(m.vMax, w.get<WINDOW_V_MAX>());
+        m.iMin = std::min(m.iMin, w.get<WINDOW_I_MIN>());
+        m.iMax = std::max(m.iMax, w.get<WINDOW_I_MAX>());
+        m.vSum += (double)w.get<WINDOW_V_MEAN>() * n;
+        m.iSum += (double)w.get<WINDOW_I_MEAN>() * n;
+        m.windowCount += n;
+        m.windowSeen = true;
+        m.windowSeq = r.reg(SAMPLE_SEQ);
+      }
+    }
+    if (Snapshot n = Snapshot::from(r)) {
+      m.snapTag = n.get<SNAPSHOT_TAG>();
+      m.snapVSet = n.get<SNAPSHOT_V_SET>();
+      m.snapVRead = n.get<SNAPSHOT_V_READ>();
+      m.snapIRead = n.get<SNAPSHOT_I_READ>();
+    }
+    if (r.covers(LATCHED_FLAGS)) m.latched |= r.reg(LATCHED_FLAGS);
+    if (LogicLink l = LogicLink::from(r)) {
+      haveLink = true;
+      loopHz = l.get<LOGIC_LOOP_HZ>();
+      loopMinHz = l.get<LOGIC_LOOP_MIN_HZ>();
+      link = l.get<LINK_STATUS>();
+      firstOut = l.get<FIRST_OUT>();
+      timerMs = l.get<LINK_TIMER_REMAINING>();
+      goodFrames = l.get<LINK_GOOD_FRAMES>();
+      badFrames = l.get<LINK_BAD_FRAMES>();
+    }
+  }
+
+  void on_failure(int, Failure) { failuresSinceLine++; }
+
+  uint64_t failuresSinceLine = 0;
+
+  void print(double t_s) {
+    for (Slave s : ALL_SLAVES) {
+      Monitor &m = mon[(int)s];
+      if (!m.seen) continue;
+      const Latched l{m.latched};
+      printf("%8.1f %-5s set %5u V  read %5u V  %5u uA  %s%s%s%s latched %04X  %4.0f ms", t_s, slave_name(s), m.v_set,
+             m.v_read, m.i_read, m.signals.hv_enable() ? "HV " : "", m.signals.nom_op() ? "NOMOP " : "",
+             m.signals.matsusada_in_reset() ? "RESET " : "", m.signals.logic_alive() ? "ALIVE " : "", l.raw,
+             m.latency_ms);
+      if (s == Slave::HV3KV) printf("  resets %u", m.resets);
+      const uint16_t samples = (uint16_t)(m.seq - m.lineSeq);
+      const uint32_t span = m.sampleMs - m.lineMs;
+      printf("  %u new %u repeat", m.fresh, m.repeats);
+      if (samples && span) printf("  sampling %.1f Hz", samples * 1000.0 / span);
+      if (m.windowCount) {
+        printf("  V %u-%u mean %.0f  I %u-%u uA mean %.0f  (%lu readings)", m.vMin, m.vMax, m.vSum / m.windowCount,
+               m.iMin, m.iMax, m.iSum / m.windowCount, (unsigned long)m.windowCount);
+      }
+      printf("\n");
+      m.latched = 0;
+      m.windowCount = 0;
+      m.vSum = m.iSum = 0.0;
+      m.fresh = m.repeats = 0;
+      m.lineSeq = m.seq;
+      m.lineMs = m.sampleMs;
+    }
+    printSnapshot(t_s);
+    if (haveLink) {
+      printf("%8.1f logic %s%s  loop %u Hz (min %u)  timer %u ms  frames %u/%u bad", t_s,
+             logic_state_name(link.state()), link.fresh() ? "" : " (stale)", loopHz, loopMinHz, timerMs, goodFrames,
+             badFrames);
+      if (firstOut.first().raw) printf("  first out %02X", firstOut.first().raw);
+      printf("\n");
+    }
+    if (failuresSinceLine) printf("%8.1f %llu failed reads\n", t_s, (unsigned long long)failuresSinceLine);
+    failuresSinceLine = 0;
+    fflush(stdout);
+  }
+
+  // The snapshot every seen monitor holds, once per snapshot
+  void printSnapshot(double t_s) {
+    uint16_t tag = 0;
+    for (Slave s : ALL_SLAVES) {
+      const Monitor &m = mon[(int)s];
+      if (!m.seen) continue;
+      if (m.snapTag == 0 || (tag && m.snapTag != tag)) return;
+      tag = m.snapTag;
+    }
+    if (tag == 0 || tag == printedTag) return;
+    printedTag = tag;
+    printf("%8.1f snap  #%u", t_s, tag);
+    for (Slave s : ALL_SLAVES) {
+      const Monitor &m = mon[(int)s];
+      if (m.seen) printf("  %s %u/%u V %u uA", slave_name(s), m.snapVRead, m.snapVSet, m.snapIRead);
+    }
+    printf("\n");
+  }
+};
+
+// One Write Single Register transaction, sent before the poller starts; true on a good echo
+bool write_register(int fd, Slave slave, uint16_t addr, uint16_t value, const Timing &timing) {
+  uint8_t req[8] = {(uint8_t)slave, 6, (uint8_t)(addr >> 8), (uint8_t)addr, (uint8_t)(value >> 8), (uint8_t)value};
+  const uint16_t crc = kb::modbus_crc16(req, 6);
+  req[6] = (uint8_t)crc;
+  req[7] = (uint8_t)(crc >> 8);
+  if (::write(fd, req, sizeof(req)) != (ssize_t)sizeof(req)) return false;
+  uint8_t rx[sizeof(req)];
+  size_t got = 0;
+  const double deadline = kb::now_ms() + sizeof(req) * 10000.0 / timing.baud + timing.timeout_ms;
+  while (got < sizeof(rx)) {
+    const double left = deadline - kb::now_ms();
+    if (left <= 0.0) break;
+    struct pollfd p = {fd, POLLIN, 0};
+    poll(&p, 1, (int)left + 1);
+    const ssize_t n = ::read(fd, rx + got, sizeof(rx) - got);
+    if (n > 0) got += (size_t)n;
+  }
+  usleep((useconds_t)(timing.switch_gap_ms * 1000.0));
+  return got == sizeof(rx) && memcmp(rx, req, sizeof(req)) == 0;
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: kb_poll -p DEVICE [options]\n"
+          "  -p DEVICE          serial port or knob_box_sim pty\n"
+          "  -b BAUD            line rate (default 9600)\n"
+          "  --ids LIST         monitors to poll (default 1,2,3,4)\n"
+          "  --period MS        telemetry period per monitor (default 500)\n"
+          "  --link-period MS   +3kV Logic link period, 0 = off (default 1000)\n"
+          "  --snapshot MS      synchronized snapshot broadcast period, 0 = off (default 0)\n"
+          "  --on-change        poll the change map and fetch telemetry only when it moved\n"
+          "  --deadband-v V     set the monitors' voltage deadbands first (firmware default 1)\n"
+          "  --deadband-i UA    set the monitors' current deadband first (firmware default 5)\n"
+          "  --switch-gap MS    gap before addressing another monitor (default 60)\n"
+          "  --same-gap MS      gap before addressing the same monitor again (default 6)\n"
+          "  --timeout MS       reply timeout (default 200)\n"
+          "  -d SECONDS         stop after this long (default: run until interrupted)\n");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const char *device = nullptr;
+  std::string ids = "1,2,3,4";
+  double period = 500.0, linkPeriod = 1000.0, snapshotPeriod = 0.0, duration = 0.0;
+  bool onChange = false;
+  int deadbandV = -1, deadbandI = -1;
+  Timing timing;
+  for (int i = 1; i < argc; i++) {
+    const std::string a = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (a == "-p" && hasValue) {
+      device = argv[++i];
+    } else if (a == "-b" && hasValue) {
+      timing.baud = (unsigned)atoi(argv[++i]);
+    } else if (a == "--ids" && hasValue) {
+      ids = argv[++i];
+    } else if (a == "--period" && hasValue) {
+      period = atof(argv[++i]);
+    } else if (a == "--link-period" && hasValue) {
+      linkPeriod = atof(argv[++i]);
+    } else if (a == "--snapshot" && hasValue) {
+      snapshotPeriod = atof(argv[++i]);
+    } else if (a == "--on-change") {
+      onChange = true;
+    } else if (a == "--deadband-v" && hasValue) {
+      deadbandV = atoi(argv[++i]);
+    } else if (a == "--deadband-i" && hasValue) {
+      deadbandI = atoi(argv[++i]);
+    } else if (a == "--switch-gap" && hasValue) {
+      timing.switch_gap_ms = atof(argv[++i]);
+    } else if (a == "--same-gap" && hasValue) {
+      timing.same_gap_ms = atof(argv[++i]);
+    } else if (a == "--timeout" && hasValue) {
+      timing.timeout_ms = atof(argv[++i]);
+    } else if (a == "-d" && hasValue) {
+      duration = atof(argv[++i]);
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  if (!device) {
+    usage();
+    return 2;
+  }
+  if (onChange && snapshotPeriod > 0.0) {
+    fprintf(stderr, "kb_poll: --on-change and --snapshot do not combine\n");
+    return 2;
+  }
+
+  const int fd = kb::open_serial("kb_poll", device, timing.baud);
+  if (fd < 0) return 1;
+
+  Dashboard dash;
+  BusPoller<Dashboard> poller(fd, dash, timing);
+  int fetch[5][2] = {{-1, -1}, {-1, -1}, {-1, -1}, {-1, -1}, {-1, -1}};
+  for (size_t at = 0; at < ids.size();) {
+    const int id = atoi(ids.c_str() + at);
+    if (id < 1 || id > 4) {
+      fprintf(stderr, "kb_poll: monitor ids are 1..4\n");
+      return 2;
+    }
+    const Slave slave = (Slave)id;
+    if (deadbandV >= 0 && !(write_register(fd, slave, DEADBAND_V_SET, (uint16_t)deadbandV, timing) &&
+                            write_register(fd, slave, DEADBAND_V_READ, (uint16_t)deadbandV, timing))) {
+      fprintf(stderr, "kb_poll: %s did not take the voltage deadband\n", slave_name(slave));
+    }
+    if (deadbandI >= 0 && !write_register(fd, slave, DEADBAND_I_READ, (uint16_t)deadbandI, timing)) {
+      fprintf(stderr, "kb_poll: %s did not take the current deadband\n", slave_name(slave));
+    }
+    if (onChange) {
+      poller.add<Changes>(slave, period);
+      fetch[id][0] = poller.add<Telemetry>(slave, 0.0);
+      fetch[id][1] = poller.add<SampleStats>(slave, 0.0);
+      for (int f : fetch[id]) poller.request(f, kb::now_ms());
+    } else {
+      poller.add<Telemetry>(slave, period);
+      poller.add<SampleStats>(slave, period);
+    }
+    if (id == (int)Slave::HV3KV && linkPeriod > 0.0) poller.add<LogicLink>(Slave::HV3KV, linkPeriod);
+    const size_t comma = ids.find(',', at);
+    at = comma == std::string::npos ? ids.size() : comma + 1;
+  }
+  if (snapshotPeriod > 0.0) poller.add_snapshot(snapshotPeriod);
+
+  const double t0 = kb::now_ms();
+  double nextLine = t0 + 1000.0;
+  for (;;) {
+    const double now = kb::now_ms();
+    if (duration > 0.0 && now - t0 >= duration * 1000.0) break;
+    if (now >= nextLine) {
+      dash.print((now - t0) / 1000.0);
+      nextLine += 1000.0;
+    }
+    int wait = poller.next_timeout_ms(now);
+    const int toLine = (int)(nextLine - now) + 1;
+    if (wait < 0 || wait > toLine) wait = toLine;
+    struct pollfd p = {poller.fd(), POLLIN, 0};
+    poll(&p, 1, wait);
+    poller.service(kb::now_ms());
+    for (Slave s : ALL_SLAVES) {
+      Dashboard::Monitor &m = dash.mon[(int)s];
+      if (m.wantFetch && fetch[(int)s][0] >= 0) {
+        for (int f : fetch[(int)s]) poller.request(f, kb::now_ms());
+      }
+      m.wantFetch = false;
+    }
+  }
+
+  uint64_t busBytes = 0;
+  for (size_t i = 0; i < poller.reads(); i++) {
+    const auto &rd = poller.read(i);
+    if ((uint8_t)rd.slave == BROADCAST_ID) continue;
+    busBytes += (rd.ok + rd.failed) * 8 + rd.ok * (5 + 2u * rd.count);
+  }
+  const PollerStats &st = poller.stats();
+  busBytes += st.broadcasts * 8;
+  printf("sent %llu  replies %llu  timeouts %llu  exceptions %llu  bad frames %llu  stray bytes %llu  broadcasts %llu\n",
+         (unsigned long long)st.sent, (unsigned long long)st.replies, (unsigned long long)st.timeouts,
+         (unsigned long long)st.exceptions, (unsigned long long)st.bad_frames, (unsigned long long)st.stray_bytes,
+         (unsigned long long)st.broadcasts);
+  printf("%llu bytes on the bus\n", (unsigned long long)busBytes);
+  close(fd);
+  return st.timeouts + st.bad_frames ? 1 : 0;
+}
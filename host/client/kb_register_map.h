@@ -0,0 +1,334 @@
+/*
+  Knob Box client - the monitor Modbus register map
+
+  The input registers of monitor_firmware.cpp as compile-time constants, with typed
+  decoders for the packed words and views over received replies. A view reads the
+  registers straight out of the reply buffer, so decoding allocates nothing and copies
+  nothing. Asking a view for a register outside the block it was declared for fails to
+  compile:
+
+    using Telemetry = kb::client::Block<kb::client::V_SET, 6>;     // the 0-5 block
+    if (Telemetry t = Telemetry::from(reply)) {
+      uint16_t volts = t.get<kb::client::V_READ>();
+      kb::client::Unlatched sig = t.get<kb::client::UNLATCHED_SIGNALS>();
+      if (sig.hv_enable()) ...
+    }
+
+  Keep in step with the map at the top of monitor_firmware.cpp and the tables in
+  monitor-arduino/README.md. Each register keeps the address it was added at, and later
+  firmware only appends, so none of these move. Registers that belong together are not
+  always adjacent: the stamp of the 0-5 sample is in 37-39, and two reads may straddle a
+  publish.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace kb {
+namespace client {
+
+// ========================= Slaves =========================
+enum class Slave : uint8_t {
+  POS1KV = 1,   // +1kV Matsusada
+  NEG1KV = 2,   // -1kV Matsusada
+  HV20KV = 3,   // +20kV Bertan
+  HV3KV = 4     // +3kV Bertan, also wired to the Logic Arduino
+};
+
+static constexpr Slave ALL_SLAVES[] = {Slave::POS1KV, Slave::NEG1KV, Slave::HV20KV, Slave::HV3KV};
+
+constexpr const char *slave_name(Slave s) {
+  return s == Slave::POS1KV ? "+1kV" : s == Slave::NEG1KV ? "-1kV" : s == Slave::HV20KV ? "+20kV" : "+3kV";
+}
+
+// ========================= Addresses =========================
+static constexpr uint16_t V_SET = 0;                      // integer volts
+static constexpr uint16_t V_READ = 1;                     // integer volts
+static constexpr uint16_t I_READ = 2;                     // integer microamps
+static constexpr uint16_t RESET_COUNT_3KV = 3;            // +3kV timer/reset events
+static constexpr uint16_t UNLATCHED_SIGNALS = 4;          // DINPUT_UNLATCHED_SIGNALS_ADDR
+static constexpr uint16_t LATCHED_FLAGS = 5;              // DINPUT_LATCHED_FLAGS_ADDR
+static constexpr uint16_t LOGIC_LOOP_HZ = 6;              // +3kV only, 6-36
+static constexpr uint16_t LOGIC_LOOP_MIN_HZ = 7;
+static constexpr uint16_t LINK_STATUS = 8;
+static constexpr uint16_t LINK_COMPARATORS = 9;
+static constexpr uint16_t LINK_INPUTS = 10;
+static constexpr uint16_t LINK_FLAGS = 11;
+static constexpr uint16_t LINK_TIMER_REMAINING = 12;      // ms
+static constexpr uint16_t LINK_STEP_COUNT = 13;
+static constexpr uint16_t LINK_GOOD_FRAMES = 14;
+static constexpr uint16_t LINK_BAD_FRAMES = 15;
+static constexpr uint16_t FIRST_OUT = 16;
+static constexpr uint16_t FIRST_OUT_RECORD = 17;
+static constexpr uint16_t FIRST_OUT_TIME_HI = 18;
+static constexpr uint16_t FIRST_OUT_TIME_LO = 19;
+static constexpr uint16_t FIRST_OUT_OFFSET = 20;          // 20-27, PL0..PL7
+static constexpr uint16_t FIRST_OUT_HISTORY = 28;         // 28-35
+static constexpr uint16_t LINK_LOOP_OVERRUNS = 36;
+static constexpr uint16_t SAMPLE_SEQ = 37;                // read_value() sample count (wraps)
+static constexpr uint16_t SAMPLE_TIME_HI = 38;            // monitor millis() at the sample
+static constexpr uint16_t SAMPLE_TIME_LO = 39;
+static constexpr uint16_t SNAPSHOT_TAG = 40;              // broadcast value that took the snapshot, 0 = none
+static constexpr uint16_t SNAPSHOT_V_SET = 41;            // integer volts
+static constexpr uint16_t SNAPSHOT_V_READ = 42;           // integer volts
+static constexpr uint16_t SNAPSHOT_I_READ = 43;           // integer microamps
+static constexpr uint16_t SNAPSHOT_TIME_HI = 44;          // monitor millis() at the snapshot
+static constexpr uint16_t SNAPSHOT_TIME_LO = 45;
+static constexpr uint16_t CHANGE_MAP = 46;                // bit n: register n (0-5) moved past its deadband
+static constexpr uint16_t DEADBAND_V_SET = 47;            // holding, volts
+static constexpr uint16_t DEADBAND_V_READ = 48;           // holding, volts
+static constexpr uint16_t DEADBAND_I_READ = 49;           // holding, microamps
+static constexpr uint16_t WINDOW_V_MIN = 50;              // integer volts, since the sample after the last read of 50-56
+static constexpr uint16_t WINDOW_V_MAX = 51;
+static constexpr uint16_t WINDOW_V_MEAN = 52;
+static constexpr uint16_t WINDOW_I_MIN = 53;              // integer microamps
+static constexpr uint16_t WINDOW_I_MAX = 54;
+static constexpr uint16_t WINDOW_I_MEAN = 55;
+static constexpr uint16_t WINDOW_COUNT = 56;              // readings per channel, saturates at 65535
+static constexpr uint16_t LINK_RX_OVERRUNS = 57;          // +3kV link bytes dropped on a full receive ring
+static constexpr uint16_t SNAPSHOT_DELAY = 58;            // age of the snapshot pair at the broadcast, us, saturates
+static constexpr uint16_t REGISTER_COUNT = 59;            // TOTAL_REG_COUNT
+
+// Slave ID 0 addresses every monitor; a Write Single Register (function 6) of a nonzero tag
+// to SNAPSHOT_TAG makes each one keep the Vmon/Imon pair it had when the frame arrived. The
+// four pairs are not simultaneous; SNAPSHOT_DELAY gives each one's age. Broadcasts get no reply.
+static constexpr uint8_t BROADCAST_ID = 0;
+
+// A served read restarts each sticky block it carried on the monitor's next read_value() pass:
+// LATCHED_FLAGS, CHANGE_MAP, the window registers and LOGIC_LOOP_MIN_HZ. A block left out of a
+// read keeps accumulating until a read carries it, and writes restart nothing.
+
+// ModbusRtu frames into a 64-byte buffer: a reply of 5 + 2 * 29 bytes is the longest that fits, and the
+// monitors answer a longer read with exception 03
+static constexpr uint16_t MAX_READ = 29;
+
+constexpr bool valid_read(uint16_t first, uint16_t count) {
+  return count >= 1 && count <= MAX_READ && first + count <= REGISTER_COUNT;
+}
+
+// ========================= Packed words =========================
+struct Unlatched {
+  uint16_t raw;
+
+  static constexpr uint16_t HVENABLE = 1u << 0;            // D7
+  static constexpr uint16_t RESET_STATE_1KV = 1u << 1;     // Matsusada reset state
+  static constexpr uint16_t ARM80KV_ENABLE = 1u << 2;      // D8
+  static constexpr uint16_t CCSPOWER_ENABLE = 1u << 3;     // D22
+  static constexpr uint16_t ARMBEAMS_ENABLE = 1u << 4;     // D23
+  static constexpr uint16_t ENABLE_3KV = 1u << 5;          // D24
+  static constexpr uint16_t NOMOP = 1u << 6;               // D25
+  static constexpr uint16_t LOGIC_ALIVE = 1u << 7;         // D9 edge seen
+
+  constexpr bool hv_enable() const { return raw & HVENABLE; }
+  constexpr bool matsusada_in_reset() const { return raw & RESET_STATE_1KV; }
+  constexpr bool arm_80kv() const { return raw & ARM80KV_ENABLE; }
+  constexpr bool ccs_power() const { return raw & CCSPOWER_ENABLE; }
+  constexpr bool arm_beams() const { return raw & ARMBEAMS_ENABLE; }
+  constexpr bool enable_3kv() const { return raw & ENABLE_3KV; }
+  constexpr bool nom_op() const { return raw & NOMOP; }
+  constexpr bool logic_alive() const { return raw & LOGIC_ALIVE; }
+};
+
+struct Latched {
+  uint16_t raw;
+
+  static constexpr uint16_t TIMER_3KV = 1u << 4;           // D26
+  static constexpr uint16_t ARMBEAMS_SWITCH = 1u << 5;     // D27
+  static constexpr uint16_t CCSPOWER_ALLOW = 1u << 6;      // D28
+  static constexpr uint16_t ARM80KV_SWITCH = 1u << 7;      // D29
+  static constexpr uint16_t POS1K_VCOMP = 1u << 8;         // D30
+  static constexpr uint16_t POS1K_ICOMP = 1u << 9;         // D31
+  static constexpr uint16_t NEG1K_VCOMP = 1u << 10;        // D32
+  static constexpr uint16_t NEG1K_ICOMP = 1u << 11;        // D33
+  static constexpr uint16_t HV20K_VCOMP = 1u << 12;        // D34
+  static constexpr uint16_t HV20K_ICOMP = 1u << 13;        // D35
+  static constexpr uint16_t HV3K_VCOMP = 1u << 14;         // D36
+  static constexpr uint16_t HV3K_ICOMP = 1u << 15;         // D37
+  static constexpr uint16_t COMPARATORS = 0xFF00;
+
+  constexpr bool any() const { return raw != 0; }
+  constexpr bool timer_3kv() const { return raw & TIMER_3KV; }
+  constexpr bool comparator_tripped() const { return raw & COMPARATORS; }
+  constexpr bool has(uint16_t mask) const { return (raw & mask) == mask; }
+};
+
+// Registers 0-5 that moved past their deadbands since the sample after the last reply
+struct ChangeMap {
+  uint16_t raw;
+
+  constexpr bool any() const { return (raw & 0x3F) != 0; }
+  constexpr bool moved(uint16_t addr) const { return addr < 6 && (raw & (1u << addr)); }
+};
+
+enum class LogicState : uint8_t { INTERLOCK = 0, NOM_OP = 1, TIMER_3KV = 2, QUENCH = 3 };
+
+constexpr const char *logic_state_name(LogicState s) {
+  return s == LogicState::INTERLOCK ? "interlock"
+         : s == LogicState::NOM_OP  ? "nom op"
+         : s == LogicState::TIMER_3KV ? "3kV timer"
+                                      : "quench";
+}
+
+// Comparator bits in PINL order, as in LINK_COMPARATORS and FIRST_OUT
+struct Comparators {
+  uint8_t raw;
+
+  static constexpr uint8_t HV3K_I = 1u << 0;
+  static constexpr uint8_t HV3K_V = 1u << 1;
+  static constexpr uint8_t HV20K_I = 1u << 2;
+  static constexpr uint8_t HV20K_V = 1u << 3;
+  static constexpr uint8_t NEG1K_I = 1u << 4;
+  static constexpr uint8_t NEG1K_V = 1u << 5;
+  static constexpr uint8_t POS1K_I = 1u << 6;
+  static constexpr uint8_t POS1K_V = 1u << 7;
+
+  constexpr bool faulted(uint8_t mask) const { return raw & mask; }
+};
+
+struct LinkStatus {
+  uint16_t raw;
+
+  constexpr bool fresh() const { return raw & 0x8000; }
+  constexpr LogicState state() const { return (LogicState)(raw & 0xFF); }
+};
+
+struct LinkComparators {
+  uint16_t raw;
+
+  constexpr Comparators pins() const { return {(uint8_t)raw}; }           // raw PINL
+  constexpr Comparators used() const { return {(uint8_t)(raw >> 8)}; }    // after filtering
+};
+
+struct LinkInputs {
+  uint16_t raw;
+
+  static constexpr uint8_t RESET = 1u << 0;
+  static constexpr uint8_t ACK = 1u << 1;              // raw byte only
+  static constexpr uint8_t SW_3KV = 1u << 4;
+  static constexpr uint8_t SW_ARM_BEAMS = 1u << 5;
+  static constexpr uint8_t SW_CCS_ALLOW = 1u << 6;
+  static constexpr uint8_t SW_ARM_80KV = 1u << 7;
+
+  constexpr uint8_t raw_inputs() const { return (uint8_t)raw; }
+  constexpr uint8_t debounced() const { return (uint8_t)(raw >> 8); }
+};
+
+struct FirstOut {
+  uint16_t raw;
+
+  constexpr Comparators first() const { return {(uint8_t)raw}; }
+  constexpr LogicState state_before() const { return (LogicState)(raw >> 8); }
+};
+
+// Latch offset from the first fault, us
+struct LatchOffset {
+  uint16_t raw;
+
+  static constexpr uint16_t NOT_LATCHED = 0xFFFF;
+  static constexpr uint16_t SATURATED = 0xFFFE;
+
+  constexpr bool latched() const { return raw != NOT_LATCHED; }
+};
+
+// ========================= Register types =========================
+// Register<A>::type is what Block::get<A>() returns
+template <uint16_t A>
+struct Register {
+  using type = uint16_t;
+};
+template <> struct Register<UNLATCHED_SIGNALS> { using type = Unlatched; };
+template <> struct Register<LATCHED_FLAGS> { using type = Latched; };
+template <> struct Register<CHANGE_MAP> { using type = ChangeMap; };
+template <> struct Register<LINK_STATUS> { using type = LinkStatus; };
+template <> struct Register<LINK_COMPARATORS> { using type = LinkComparators; };
+template <> struct Register<LINK_INPUTS> { using type = LinkInputs; };
+template <> struct Register<FIRST_OUT> { using type = FirstOut; };
+
+// ========================= Replies =========================
+// The register payload of one validated read reply. Points into the receive buffer and is
+// only valid until the next reply arrives.
+struct Reply {
+  Slave slave;
+  uint16_t first;
+  uint16_t count;
+  const uint8_t *data;            // count big-endian registers
+
+  constexpr uint16_t reg(uint16_t addr) const {
+    return (uint16_t)((data[2 * (addr - first)] << 8) | data[2 * (addr - first) + 1]);
+  }
+  constexpr bool covers(uint16_t addr) const { return addr >= first && addr < first + count; }
+};
+
+// Typed view of registers [First, First + Count) inside a reply
+template <uint16_t First, uint16_t Count>
+class Block {
+  static_assert(Count >= 1 && First + Count <= REGISTER_COUNT, "block runs past the register map");
+  static_assert(Count <= MAX_READ, "block is longer than the monitor's 64-byte frame buffer allows");
+
+ public:
+  static constexpr uint16_t first = First;
+  static constexpr uint16_t count = Count;
+
+  // Empty unless the reply holds the whole block
+  static constexpr Block from(const Reply &r) {
+    return (r.first <= First && r.first + r.count >= First + Count) ? Block(r.data + 2 * (First - r.first))
+                                                                       : Block(nullptr);
+  }
+
+  constexpr explicit operator bool() const { return p_ != nullptr; }
+
+  template <uint16_t A>
+  constexpr auto get() const {
+    static_assert(A >= First && A < First + Count, "register is not in this block");
+    using T = typename Register<A>::type;
+    return T{raw<A>()};
+  }
+
+  template <uint16_t A>
+  constexpr uint16_t raw() const {
+    static_assert(A >= First && A < First + Count, "register is not in this block");
+    return (uint16_t)((p_[2 * (A - First)] << 8) | p_[2 * (A - First) + 1]);
+  }
+
+  // Latch offset for comparator PLn
+  template <uint8_t N>
+  constexpr LatchOffset offset() const {
+    static_assert(N < 8, "PL0..PL7");
+    return LatchOffset{raw<FIRST_OUT_OFFSET + N>()};
+  }
+
+  // PINL history sample i (0 = oldest of 16)
+  constexpr uint8_t history(uint8_t i) const {
+    static_assert(First <= FIRST_OUT_HISTORY && First + Count >= FIRST_OUT_HISTORY + 8, "history is not in this block");
+    const uint8_t *w = p_ + 2 * (FIRST_OUT_HISTORY - First + i / 2);
+    return (i & 1) ? w[0] : w[1];   // low byte holds the older sample
+  }
+
+  constexpr uint32_t sample_time_ms() const {
+    return ((uint32_t)raw<SAMPLE_TIME_HI>() << 16) | raw<SAMPLE_TIME_LO>();
+  }
+
+  constexpr uint32_t snapshot_time_ms() const {
+    return ((uint32_t)raw<SNAPSHOT_TIME_HI>() << 16) | raw<SNAPSHOT_TIME_LO>();
+  }
+
+  constexpr uint32_t first_out_time_us() const {
+    return ((uint32_t)raw<FIRST_OUT_TIME_HI>() << 16) | raw<FIRST_OUT_TIME_LO>();
+  }
+
+ private:
+  constexpr explicit Block(const uint8_t *p) : p_(p) {}
+  const uint8_t *p_;
+};
+
+// Blocks the dashboard reads
+using Telemetry = Block<V_SET, 6>;                      // every monitor, 0-5: the sample
+using LogicLink = Block<LATCHED_FLAGS, MAX_READ>;       // +3kV, 5-33: the latched flags, the link and most of the first out
+using Snapshot = Block<SNAPSHOT_TAG, 6>;                // every monitor, 40-45: the last broadcast snapshot
+using Changes = Block<CHANGE_MAP, 1>;                   // every monitor, 46: what moved
+using Window = Block<WINDOW_V_MIN, 7>;                  // every monitor, 50-56: extremes since the last read of 50-56
+using SampleStats = Block<SAMPLE_SEQ, 20>;              // every monitor, 37-56: stamp, snapshot, what moved, extremes
+
+}  // namespace client
+}  // namespace kb
@@ -0,0 +1,51 @@
+/*
+  Knob Box host tools - Modbus RTU frame helpers
+
+  CRC-16/Modbus and the reply length a slave owes for a request, for the tools that build,
+  capture or check frames on the monitors' bus.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace kb {
+
+inline uint16_t modbus_crc16(const uint8_t *p, size_t n) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < n; i++) {
+    crc ^= p[i];
+    for (int b = 0; b < 8; b++) crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0xA001) : (uint16_t)(crc >> 1);
+  }
+  return crc;
+}
+
+// CRC in the last two bytes, low byte first
+inline bool modbus_crc_ok(const uint8_t *f, size_t n) {
+  return n >= 4 && modbus_crc16(f, n - 2) == (uint16_t)(f[n - 2] | (f[n - 1] << 8));
+}
+
+static constexpr size_t MODBUS_EXCEPTION_BYTES = 5;
+
+// Length of a normal reply to `req`, or 0 for a request this helper does not know
+inline size_t modbus_reply_bytes(const uint8_t *req, size_t n) {
+  if (n < 8) return 0;
+  const uint16_t count = (uint16_t)((req[4] << 8) | req[5]);
+  switch (req[1]) {
+    case 1:
+    case 2:
+      return 5 + (count + 7u) / 8u;
+    case 3:
+    case 4:
+      return 5 + 2u * count;
+    case 5:
+    case 6:
+    case 15:
+    case 16:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+}  // namespace kb
@@ -0,0 +1,74 @@
+/*
+  Knob Box host tools - raw 8N1 serial ports
+
+  Opens a USB-RS485 adapter or a pty for the host tools that sit on the Modbus bus, with
+  no line discipline, non-blocking reads and the given baud. Errors go to stderr with the
+  calling tool's name.
+*/
+#pragma once
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace kb {
+
+inline double now_ms() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (double)t.tv_sec * 1000.0 + (double)t.tv_nsec * 1e-6;
+}
+
+inline bool baud_constant(unsigned baud, speed_t &s) {
+  static const struct { unsigned baud; speed_t s; } TABLE[] = {
+      {1200, B1200},     {2400, B2400},     {4800, B4800},     {9600, B9600},
+      {19200, B19200},   {38400, B38400},   {57600, B57600},   {115200, B115200},
+      {230400, B230400}, {460800, B460800}, {500000, B500000}, {1000000, B1000000}};
+  for (const auto &e : TABLE) {
+    if (e.baud == baud) {
+      s = e.s;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Returns the descriptor, or -1 after printing why
+inline int open_serial(const char *who, const char *path, unsigned baud) {
+  speed_t s;
+  if (!baud_constant(baud, s)) {
+    fprintf(stderr, "%s: unsupported baud %u\n", who, baud);
+    return -1;
+  }
+  const int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (fd < 0) {
+    fprintf(stderr, "%s: cannot open %s: %s\n", who, path, strerror(errno));
+    return -1;
+  }
+  struct termios t;
+  if (tcgetattr(fd, &t) != 0) {
+    fprintf(stderr, "%s: %s is not a serial port: %s\n", who, path, strerror(errno));
+    close(fd);
+    return -1;
+  }
+  cfmakeraw(&t);
+  t.c_cflag |= CLOCAL | CREAD;
+  t.c_cflag &= ~(CSTOPB | PARENB | CRTSCTS);
+  t.c_cc[VMIN] = 0;
+  t.c_cc[VTIME] = 0;
+  cfsetispeed(&t, s);
+  cfsetospeed(&t, s);
+  if (tcsetattr(fd, TCSANOW, &t) != 0) {
+    fprintf(stderr, "%s: cannot configure %s: %s\n", who, path, strerror(errno));
+    close(fd);
+    return -1;
+  }
+  tcflush(fd, TCIOFLUSH);
+  return fd;
+}
+
+}  // namespace kb
@@ -0,0 +1,506 @@
+/*
+  Knob Box - exhaustive state-space explorer for the Logic Arduino step()
+
+  Builds logic_arduino.cpp against the host core and explores every input combination
+  breadth-first from power-up: the 8 comparator bits, the 4 switches, the reset button and
+  the ACK line (2^14 vectors). One move holds a vector for either a single step() or long
+  enough to debounce (HOLD_STEPS), so armed and tripped states are reached in a few moves.
+  The two Timer1 interrupts the state machine depends on are environment moves as well:
+  the quench lockout may expire, and the loop deadline may fire, between any two moves.
+
+  Firmware state that can influence a later decision is captured after every move and
+  deduplicated; the latched flag images, journal, status link and first-out record only
+  feed outputs and are not part of the state.
+
+  Checked after every step() (5 also right after a missed deadline):
+    1. CCS and Beam enables are off outside NOM_OP
+    2. the 3kV enable is off during the 3kV lockout, and on during a +-1kV / 20kV lockout
+       only while the 3kV switch is asserted
+    3. NOM_OP is entered only on a debounced reset edge with every comparator safe and
+       Arm 80kV / 3kV asserted, or by a configured automatic re-arm
+    4. a comparator fault held from NOM_OP drops CCS and Beams within HOLD_STEPS, and a
+       3kV quench trip drops the 3kV enable within HOLD_STEPS
+    5. the D22-D24 flag mirrors never show an enable that is off on PORTF
+
+  Reports the worst-case number of step() passes from a fault to the outputs going off.
+  Each level is split across forked workers, one per CPU by default.
+
+  Usage: logic_explorer [-d depth] [-j workers] [--max-cex N]
+  -d        moves from power-up (default 2; 3 takes about 45 CPU-minutes, so use many workers)
+  -j        worker processes (default: one per online CPU)
+  --max-cex counterexample traces printed per violated check (default 1)
+*/
+#include <Arduino.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/wdt.h>
+#include <util/crc16.h>
+
+namespace {
+namespace kb_logic_fw {
+#include "../../logic-arduino/logic_arduino.cpp"
+}  // namespace kb_logic_fw
+}  // namespace
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace kb_logic_fw;
+
+namespace {
+
+// ========================= Moves =========================
+// Input vector bits
+static constexpr uint16_t IN_COMPARATORS = 0x00FF;     // PL0-PL7, 1 = fault
+static constexpr uint16_t IN_SW_3KV      = 0x0100;     // switches, 1 = asserted
+static constexpr uint16_t IN_SW_BEAMS    = 0x0200;
+static constexpr uint16_t IN_SW_CCS      = 0x0400;
+static constexpr uint16_t IN_SW_80KV     = 0x0800;
+static constexpr uint16_t IN_RESET       = 0x1000;     // 1 = pressed
+static constexpr uint16_t IN_ACK         = 0x2000;     // D14 level
+static constexpr uint32_t INPUT_VECTORS  = 0x4000;
+
+static constexpr uint8_t max3(uint8_t a, uint8_t b, uint8_t c) {
+  return (a > b) ? ((a > c) ? a : c) : ((b > c) ? b : c);
+}
+// Long enough for the debouncers and the widest comparator filter to settle
+static constexpr uint8_t HOLD_STEPS = (uint8_t)(max3(DEBOUNCE_BITS, COMP_FILTER_SAMPLES, COMP_FILTER_SAMPLES_3KV) + 1);
+
+enum Event : uint8_t { EV_NONE, EV_LOCKOUT_EXPIRES, EV_DEADLINE_MISSED, EV_COUNT };
+const char *const EVENT_NAMES[EV_COUNT] = {"", "lockout expires", "deadline missed"};
+
+struct Move {
+  uint16_t in;
+  uint8_t hold;
+  uint8_t event;
+};
+
+// Each step() is taken one loop period and, with a filter configured, one filter sample apart
+static constexpr uint64_t STEP_CYCLES =
+    (COMP_FILTER_SAMPLE_US > 25 ? COMP_FILTER_SAMPLE_US : 25) * ::host::CYCLES_PER_US;
+static constexpr uint64_t ORIGIN_CYCLES = 16000000ULL;   // every state is replayed from t = 1 s
+
+// ========================= Firmware state =========================
+struct Snap {
+  uint32_t switchHist[4];
+  uint32_t resetHist;
+  uint8_t state, activeQuench, quenchFromNomOp, otherTrips;
+  uint8_t lockoutExpired, deadlineOverrun, autoRearmUsed, bits;   // bits: see capture()
+  uint8_t portF, prevPortF, prevPortH, filterQualified;
+  uint8_t filterCount[4];
+
+  bool operator==(const Snap &o) const { return memcmp(this, &o, sizeof(Snap)) == 0; }
+};
+static_assert(sizeof(Snap) == 36, "Snap must not contain padding");
+
+struct SnapHash {
+  size_t operator()(const Snap &s) const {
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(&s);
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < sizeof(Snap); i++) h = (h ^ p[i]) * 1099511628211ULL;
+    return (size_t)h;
+  }
+};
+
+Snap capture() {
+  Snap s;
+  memset(&s, 0, sizeof(s));
+  for (int i = 0; i < 4; i++) {
+    s.switchHist[i] = switchHist[i] & MASK_DEBOUNCE;
+    s.bits |= (uint8_t)(switchStable[i] << i);
+  }
+  s.resetHist = resetButtonHist & MASK_DEBOUNCE;
+  s.bits |= (uint8_t)((resetButtonStable << 4) | (prevResetButtonDb << 5) | (ackEchoState << 6) | (prevAckLevel << 7));
+  s.state = (uint8_t)currentState;
+  if (quench_state(currentState)) {
+    s.activeQuench = activeQuench;
+    s.quenchFromNomOp = quenchFromNomOp;
+    s.otherTrips = (uint8_t)(quenchOtherTrips & -quenchOtherTrips);   // only "any" matters
+  }
+  s.lockoutExpired = lockoutExpired;
+  s.deadlineOverrun = deadlineOverrun;
+  s.autoRearmUsed = autoRearmUsed;
+  s.portF = PORTF;
+  s.prevPortF = prevPORTF;
+  s.prevPortH = prevPORTH;
+  if (comparator_filter_enabled()) {
+    s.filterQualified = filterQualified;
+    memcpy(s.filterCount, filterCount, sizeof(filterCount));
+  }
+  return s;
+}
+
+void restore(const Snap &s) {
+  ::host::mcu.now = ORIGIN_CYCLES;
+  for (int i = 0; i < 4; i++) {
+    switchHist[i] = s.switchHist[i];
+    switchStable[i] = (s.bits >> i) & 1;
+  }
+  resetButtonHist = s.resetHist;
+  resetButtonStable = (s.bits >> 4) & 1;
+  prevResetButtonDb = (s.bits >> 5) & 1;
+  ackEchoState = (s.bits >> 6) & 1;
+  prevAckLevel = (s.bits >> 7) & 1;
+  currentState = (State)s.state;
+  activeQuench = s.activeQuench;
+  quenchFromNomOp = s.quenchFromNomOp;
+  quenchOtherTrips = s.otherTrips;
+  lockoutExpired = s.lockoutExpired;
+  lockoutWraps = 0;
+  deadlineOverrun = s.deadlineOverrun;
+  autoRearmUsed = s.autoRearmUsed;
+  autoRearmNext = AUTO_REARM_MAX ? (uint8_t)(s.autoRearmUsed % AUTO_REARM_MAX) : 0;
+  for (uint32_t &ms : autoRearmMs) ms = (uint32_t)(ORIGIN_CYCLES / 16000ULL);   // all inside the window
+  PORTF = s.portF;
+  prevPORTF = s.prevPortF;
+  prevPORTH = s.prevPortH;
+  filterQualified = s.filterQualified;
+  memcpy(filterCount, s.filterCount, sizeof(filterCount));
+  latchedComparatorFlags = 0;
+  latchedSwitchFlags = 0;
+  latched3kVTimerFlag = false;
+}
+
+void drive_inputs(uint16_t in) {
+  const uint8_t sw = (uint8_t)((in >> 8) & 0x0F);
+  ::host::drive_port(::host::PB_, MASK_SWITCHES_PORTB, (uint8_t)~(sw << 4));             // asserted = LOW
+  ::host::drive_port(::host::PL_, 0xFF, (uint8_t)(in & IN_COMPARATORS));                  // fault = HIGH
+  ::host::drive_port(::host::PJ_, MASK_ACK | MASK_RESET_BTN,
+                     (uint8_t)(((in & IN_ACK) ? MASK_ACK : 0) | ((in & IN_RESET) ? 0 : MASK_RESET_BTN)));
+}
+
+void power_up() {
+  ::host::mcu.powerOnReset(_BV(PORF));
+  drive_inputs(0);
+  watchdog_early_init();
+  ::host::mcu.SREG_.v |= 0x80;
+  setup();
+}
+
+// ========================= Checks =========================
+enum Violation : uint8_t {
+  V_ENABLES_OUTSIDE_NOMOP,
+  V_3KV_DURING_LOCKOUT,
+  V_NOMOP_WITHOUT_RESET_EDGE,
+  V_NOMOP_NOT_ARMED,
+  V_FAULT_NOT_CLEARED,
+  V_3KV_TRIP_NOT_CLEARED,
+  V_MIRROR_STALE,
+  V_COUNT
+};
+const char *const VIOLATION_NAMES[V_COUNT] = {
+  "CCS or Beam enable on outside NOM_OP",
+  "3kV enable on in the 3kV lockout, or switch off in a +-1kV / 20kV lockout",
+  "NOM_OP entered without a reset edge or automatic re-arm",
+  "NOM_OP entered with a comparator faulted or Arm 80kV / 3kV not asserted",
+  "comparator fault held in NOM_OP did not drop CCS / Beams within the hold",
+  "3kV quench trip did not drop the 3kV enable within the hold",
+  "D22-D24 mirror shows an enable that PORTF has off",
+};
+
+static constexpr uint8_t ENABLES = MASK_OUT_CCS | MASK_OUT_BEAM;
+
+// PA0-PA2 mirror PF0-PF2 bit for bit
+static_assert(MASK_PA_CCS == MASK_OUT_CCS && MASK_PA_BEAMS == MASK_OUT_BEAM && MASK_PA_3KVEN == MASK_OUT_3KV,
+              "the PORTA mirror check assumes the PORTF bit positions");
+static inline bool mirror_stale() {
+  return (PORTA & (uint8_t)~PORTF & (MASK_PA_CCS | MASK_PA_BEAMS | MASK_PA_3KVEN)) != 0;
+}
+
+struct Finding {
+  uint32_t node;
+  Move move;
+  uint8_t atStep;
+  uint8_t kind;
+};
+
+struct Stats {
+  uint64_t moves = 0;
+  uint64_t steps = 0;
+  uint64_t faultProbes = 0;      // moves that presented a fault to live CCS / Beam enables
+  uint64_t tripProbes = 0;       // moves that presented a 3kV quench trip to a live 3kV enable
+  uint32_t worstFaultSteps = 0;
+  uint32_t worst3kVSteps = 0;
+  uint32_t violations[V_COUNT] = {};
+  Finding worstFault = {};
+  Finding worst3kV = {};
+};
+
+// Runs one move from `from`; the successor state is left in the firmware globals
+void run_move(uint32_t node, const Snap &from, const Move &m, Stats &st, std::vector<Finding> &found) {
+  restore(from);
+  if (m.event == EV_LOCKOUT_EXPIRES) {
+    ::host::run_isr(::host::VEC_TIMER1_COMPA_vect, ::host::mcu.now);
+  } else if (m.event == EV_DEADLINE_MISSED) {
+    ::host::run_isr(::host::VEC_TIMER1_COMPC_vect, ::host::mcu.now);
+    if (mirror_stale() && (st.violations[V_MIRROR_STALE]++ == 0 || found.size() < 64)) {
+      found.push_back({node, m, 0, (uint8_t)V_MIRROR_STALE});
+    }
+  }
+  drive_inputs(m.in);
+
+  const uint8_t comps = (uint8_t)(m.in & IN_COMPARATORS);
+  const State startState = currentState;
+  const uint8_t startF = PORTF;
+  // A fault reaching live CCS / Beam enables in NOM_OP, or a 3kV quench trip reaching a live 3kV enable
+  const bool faultProbe = startState == State::STATE_NOM_OP && comps && (startF & ENABLES);
+  const bool tripProbe = (startState == State::STATE_NOM_OP || startState == State::STATE_INTERLOCK) &&
+                         (startF & MASK_OUT_3KV) &&
+                         quench_channel_for(comps, startState == State::STATE_NOM_OP) == QUENCH_CH_3KV;
+  uint8_t faultCleared = 0, tripCleared = 0;
+
+  for (uint8_t k = 1; k <= m.hold; k++) {
+    const State before = currentState;
+    const bool dbBefore = prevResetButtonDb;
+    ::host::mcu.now += STEP_CYCLES;
+    if (comparator_filter_enabled()) filterLastTick = (uint16_t)(TCNT1 - FILTER_SAMPLE_TICKS);
+    step();
+    st.steps++;
+
+    const uint8_t f = PORTF;
+    auto flag = [&](Violation v) {
+      if (st.violations[v]++ == 0 || found.size() < 64) found.push_back({node, m, k, (uint8_t)v});
+    };
+    if ((f & ENABLES) && currentState != State::STATE_NOM_OP) flag(V_ENABLES_OUTSIDE_NOMOP);
+    if (mirror_stale()) flag(V_MIRROR_STALE);
+    if ((f & MASK_OUT_3KV) && (currentState == State::STATE_3KV_TIMER ||
+                               (currentState == State::STATE_QUENCH && !switchStable[0]))) {
+      flag(V_3KV_DURING_LOCKOUT);
+    }
+    if (currentState == State::STATE_NOM_OP && before != State::STATE_NOM_OP) {
+      const bool resetEdge = prevResetButtonDb && !dbBefore;
+      const bool autoRearm = quench_state(before) && QUENCH_CHANNELS[activeQuench].autoRearm;
+      if (!(before == State::STATE_INTERLOCK ? resetEdge : autoRearm)) flag(V_NOMOP_WITHOUT_RESET_EDGE);
+      if (comps || !switchStable[0] || !switchStable[3]) flag(V_NOMOP_NOT_ARMED);
+    }
+    if (faultProbe && !faultCleared && !(f & ENABLES)) faultCleared = k;
+    if (tripProbe && !tripCleared && !(f & MASK_OUT_3KV)) tripCleared = k;
+  }
+
+  if (m.hold == HOLD_STEPS) {
+    if (faultProbe) {
+      st.faultProbes++;
+      if (!faultCleared) {
+        st.violations[V_FAULT_NOT_CLEARED]++;
+        found.push_back({node, m, m.hold, V_FAULT_NOT_CLEARED});
+      } else if (faultCleared > st.worstFaultSteps) {
+        st.worstFaultSteps = faultCleared;
+        st.worstFault = {node, m, faultCleared, 0};
+      }
+    }
+    if (tripProbe) {
+      st.tripProbes++;
+      if (!tripCleared) {
+        st.violations[V_3KV_TRIP_NOT_CLEARED]++;
+        found.push_back({node, m, m.hold, V_3KV_TRIP_NOT_CLEARED});
+      } else if (tripCleared > st.worst3kVSteps) {
+        st.worst3kVSteps = tripCleared;
+        st.worst3kV = {node, m, tripCleared, 0};
+      }
+    }
+  }
+  st.moves++;
+}
+
+// ========================= Search =========================
+struct Node {
+  Snap snap;
+  uint32_t parent;
+  Move move;
+};
+
+struct Successor {
+  uint32_t parent;
+  Move move;
+  Snap snap;
+};
+
+// Expands nodes[first + i*stride] and writes the distinct successors, findings and stats to `out`
+void expand_slice(const std::vector<Node> &nodes, size_t first, size_t last, size_t offset, size_t stride, FILE *out) {
+  Stats st;
+  std::vector<Finding> found;
+  std::unordered_map<Snap, Successor, SnapHash> next;
+
+  for (size_t i = first + offset; i < last; i += stride) {
+    const Snap &from = nodes[i].snap;
+    for (uint8_t ev = EV_NONE; ev < EV_COUNT; ev++) {
+      if (ev == EV_LOCKOUT_EXPIRES && from.lockoutExpired) continue;
+      if (ev == EV_DEADLINE_MISSED && (!loop_deadline_enabled() || from.deadlineOverrun)) continue;
+      for (uint32_t in = 0; in < INPUT_VECTORS; in++) {
+        for (uint8_t hold : {(uint8_t)1, HOLD_STEPS}) {
+          const Move m = {(uint16_t)in, hold, ev};
+          run_move((uint32_t)i, from, m, st, found);
+          const Snap s = capture();
+          next.emplace(s, Successor{(uint32_t)i, m, s});
+        }
+      }
+    }
+  }
+
+  const uint64_t nSucc = next.size(), nFound = found.size();
+  fwrite(&st, sizeof(st), 1, out);
+  fwrite(&nFound, sizeof(nFound), 1, out);
+  fwrite(found.data(), sizeof(Finding), found.size(), out);
+  fwrite(&nSucc, sizeof(nSucc), 1, out);
+  for (const auto &kv : next) fwrite(&kv.second, sizeof(Successor), 1, out);
+  fflush(out);
+}
+
+std::string describe(const Move &m) {
+  static const char *const SW[4] = {"3kV", "Beams", "CCS", "80kV"};
+  char buf[160];
+  std::string sw;
+  for (int i = 0; i < 4; i++) {
+    if (m.in & (IN_SW_3KV << i)) sw += (sw.empty() ? "" : "+") + std::string(SW[i]);
+  }
+  snprintf(buf, sizeof(buf), "%s%shold %u: comparators=0x%02X switches=%s reset=%s ack=%d",
+           EVENT_NAMES[m.event], m.event ? ", then " : "", m.hold, m.in & IN_COMPARATORS,
+           sw.empty() ? "none" : sw.c_str(), (m.in & IN_RESET) ? "pressed" : "released", (m.in & IN_ACK) ? 1 : 0);
+  return buf;
+}
+
+void print_trace(const std::vector<Node> &nodes, const Finding &f, const char *what) {
+  std::vector<Move> path;
+  for (uint32_t n = f.node; n != 0; n = nodes[n].parent) path.push_back(nodes[n].move);
+  if (*what) printf("  %s\n", what);
+  printf("    power-up\n");
+  for (auto it = path.rbegin(); it != path.rend(); ++it) printf("    %s\n", describe(*it).c_str());
+  printf("    %s  <- step %u of this move\n", describe(f.move).c_str(), f.atStep);
+}
+
+void usage() {
+  fprintf(stderr, "usage: logic_explorer [-d depth] [-j workers] [--max-cex N]\n");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned depth = 2;
+  long workers = sysconf(_SC_NPROCESSORS_ONLN);
+  unsigned maxCex = 1;
+  for (int i = 1; i < argc; i++) {
+    const std::string a = argv[i];
+    if (a == "-d" && i + 1 < argc) depth = (unsigned)atoi(argv[++i]);
+    else if (a == "-j" && i + 1 < argc) workers = atol(argv[++i]);
+    else if (a == "--max-cex" && i + 1 < argc) maxCex = (unsigned)atoi(argv[++i]);
+    else { usage(); return 2; }
+  }
+  if (workers < 1) workers = 1;
+  (void)&loop;                          // the explorer drives step() itself
+  (void)&::host::service_interrupts;    // and takes the Timer1 interrupts as explicit moves
+
+  printf("logic_explorer: depth %u, %ld worker%s, %u input vectors, holds of 1 and %u steps\n",
+         depth, workers, workers == 1 ? "" : "s", INPUT_VECTORS, HOLD_STEPS);
+  fflush(stdout);
+
+  power_up();
+  std::vector<Node> nodes;
+  nodes.push_back({capture(), 0, {0, 0, 0}});
+  std::unordered_map<Snap, uint32_t, SnapHash> seen;
+  seen.emplace(nodes[0].snap, 0);
+
+  Stats total;
+  std::vector<Finding> findings;
+  size_t levelStart = 0;
+
+  for (unsigned level = 1; level <= depth && levelStart < nodes.size(); level++) {
+    const size_t levelEnd = nodes.size();
+    std::vector<FILE *> parts;
+    std::vector<pid_t> pids;
+    for (long w = 0; w < workers; w++) {
+      FILE *tmp = tmpfile();
+      if (!tmp) { perror("tmpfile"); return 1; }
+      const pid_t pid = fork();
+      if (pid < 0) { perror("fork"); return 1; }
+      if (pid == 0) {
+        expand_slice(nodes, levelStart, levelEnd, (size_t)w, (size_t)workers, tmp);
+        _exit(0);
+      }
+      parts.push_back(tmp);
+      pids.push_back(pid);
+    }
+
+    size_t added = 0;
+    for (size_t w = 0; w < parts.size(); w++) {
+      int status = 0;
+      waitpid(pids[w], &status, 0);
+      if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "logic_explorer: worker %zu failed\n", w);
+        return 1;
+      }
+      FILE *in = parts[w];
+      rewind(in);
+      Stats st;
+      uint64_t n = 0;
+      if (fread(&st, sizeof(st), 1, in) != 1 || fread(&n, sizeof(n), 1, in) != 1) return 1;
+      std::vector<Finding> f(n);
+      if (n && fread(f.data(), sizeof(Finding), n, in) != n) return 1;
+      findings.insert(findings.end(), f.begin(), f.end());
+      if (fread(&n, sizeof(n), 1, in) != 1) return 1;
+      for (uint64_t k = 0; k < n; k++) {
+        Successor s;
+        if (fread(&s, sizeof(s), 1, in) != 1) return 1;
+        if (seen.emplace(s.snap, (uint32_t)nodes.size()).second) {
+          nodes.push_back({s.snap, s.parent, s.move});
+          added++;
+        }
+      }
+      fclose(in);
+
+      total.moves += st.moves;
+      total.steps += st.steps;
+      total.faultProbes += st.faultProbes;
+      total.tripProbes += st.tripProbes;
+      for (int v = 0; v < V_COUNT; v++) total.violations[v] += st.violations[v];
+      if (st.worstFaultSteps > total.worstFaultSteps) {
+        total.worstFaultSteps = st.worstFaultSteps;
+        total.worstFault = st.worstFault;
+      }
+      if (st.worst3kVSteps > total.worst3kVSteps) {
+        total.worst3kVSteps = st.worst3kVSteps;
+        total.worst3kV = st.worst3kV;
+      }
+    }
+    printf("level %u: %zu states expanded, %zu new states, %llu moves, %llu step() calls so far\n", level,
+           levelEnd - levelStart, added, (unsigned long long)total.moves, (unsigned long long)total.steps);
+    fflush(stdout);
+    levelStart = levelEnd;
+  }
+
+  printf("\n%zu distinct states reached\n", nodes.size());
+  unsigned failed = 0;
+  for (int v = 0; v < V_COUNT; v++) {
+    printf("  %-74s %s", VIOLATION_NAMES[v], total.violations[v] ? "FAIL" : "ok");
+    if (total.violations[v]) printf(" (%u)", total.violations[v]);
+    printf("\n");
+    failed += total.violations[v] ? 1 : 0;
+  }
+
+  printf("\nworst case, fault in NOM_OP to CCS / Beam enables off: ");
+  if (total.faultProbes) printf("%u step()%s over %llu probes\n", total.worstFaultSteps,
+                                total.worstFaultSteps == 1 ? "" : "s", (unsigned long long)total.faultProbes);
+  else printf("not reached (increase -d)\n");
+  printf("worst case, 3kV quench trip to 3kV enable off:         ");
+  if (total.tripProbes) printf("%u step()%s over %llu probes\n", total.worst3kVSteps,
+                               total.worst3kVSteps == 1 ? "" : "s", (unsigned long long)total.tripProbes);
+  else printf("not reached (increase -d)\n");
+  if (total.faultProbes) print_trace(nodes, total.worstFault, "worst fault path:");
+
+  for (int v = 0; v < V_COUNT; v++) {
+    unsigned shown = 0;
+    for (const Finding &f : findings) {
+      if (f.kind != v || shown >= maxCex) continue;
+      if (shown++ == 0) printf("\ncounterexample, %s:\n", VIOLATION_NAMES[v]);
+      print_trace(nodes, f, "");
+      printf("\n");
+    }
+  }
+  return failed ? 1 : 0;
+}
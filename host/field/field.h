@@ -0,0 +1,47 @@
+/*
+  Knob Box - field-data replay of the monitor acquisition pipeline
+
+  Logged Vmon / Imon / Vset series for one supply, and the pieces of the monitor image the
+  replay runs them through. field_image.cpp includes the image and is built once per
+  SELECTED_PS_ID, like monitor_bench; only the +/-1kV supplies (1 and 2) have a Matsusada
+  reset check.
+*/
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+namespace kb {
+namespace field {
+
+struct Series {
+  int ps_id = 0;
+  std::vector<double> t;                            // seconds
+  std::vector<int16_t> imon, vmon, vset;            // ADS1115 counts
+  std::vector<uint8_t> hv;                          // HV enable switch on
+};
+
+// What convertAdcReadings() left in measuredI_mA, measuredHV_V and programmedHV_V
+struct Converted {
+  std::vector<float> mA, V, setV;
+};
+
+// RESET_ENTER_V / RESET_ENTER_I / RESET_EXIT_V / RESET_EXIT_I as the firmware compares them
+struct Thresholds {
+  double enterV, enterI, exitV, exitI;
+};
+
+}  // namespace field
+}  // namespace kb
+
+// One per monitor image, in field_image.cpp built with -DSELECTED_PS_ID=1..2
+#define KB_FIELD_IMAGE_API(id)                                                                         \
+  void kb_field_convert_##id(const kb::field::Series &in, kb::field::Converted &out);                  \
+  void kb_field_counts_##id(double vset_V, double vmon_V, double imon_uA, int16_t counts[3]);          \
+  void kb_field_firmware_states_##id(const kb::field::Series &in, const kb::field::Converted &conv,    \
+                                     double gapS, std::vector<uint8_t> &state);                        \
+  kb::field::Thresholds kb_field_firmware_thresholds_##id();
+
+KB_FIELD_IMAGE_API(1)
+KB_FIELD_IMAGE_API(2)
@@ -0,0 +1,77 @@
+/*
+  Knob Box - the monitor image's conversion and Matsusada reset check, for matsusada_replay
+
+  Build once per supply with -DSELECTED_PS_ID=1 or 2. The image is powered on so setup()
+  has set the ratings, then every logged sample goes through convertAdcReadings() and
+  checkMatsusadaResetState() themselves, with the HV enable switch driven from the log.
+*/
+#include "field.h"
+
+#include "../board/monitor_image.cpp"
+
+namespace {
+
+kb::Board &image() {
+  static kb::Board &board = [] () -> kb::Board & {
+    kb::Board &b = KB_MONITOR_FACTORY(SELECTED_PS_ID)();
+    b.powerOn(0);
+    return b;
+  }();
+  return board;
+}
+
+}  // namespace
+
+#define KB_FIELD_(name, id) kb_field_##name##_##id
+#define KB_FIELD(name, id) KB_FIELD_(name, id)
+
+void KB_FIELD(convert, SELECTED_PS_ID)(const kb::field::Series &in, kb::field::Converted &out) {
+  using namespace kb_monitor_fw;
+  image();
+  const size_t n = in.t.size();
+  out.mA.resize(n);
+  out.V.resize(n);
+  out.setV.resize(n);
+  for (size_t i = 0; i < n; i++) {
+    convertAdcReadings(in.imon[i], in.vmon[i], in.vset[i]);
+    out.mA[i] = measuredI_mA;
+    out.V[i] = measuredHV_V;
+    out.setV[i] = programmedHV_V;
+  }
+}
+
+// Nearest ADS1115 counts for register values (V set and V read in volts, I read in uA)
+void KB_FIELD(counts, SELECTED_PS_ID)(double vset_V, double vmon_V, double imon_uA, int16_t counts[3]) {
+  using namespace kb_monitor_fw;
+  image();
+  auto toCounts = [](double value, double rated) {
+    const double c = value / rated * 5.0 / (double)(VOLTS_PER_COUNT);
+    return (int16_t)(c < 0.0 ? 0.0 : c > 32767.0 ? 32767.0 : c + 0.5);
+  };
+  counts[0] = toCounts(imon_uA / 1000.0, ratedI_mA);
+  counts[1] = toCounts(vmon_V, ratedHV_V);
+  counts[2] = toCounts(vset_V, ratedHV_V);
+}
+
+// The firmware's reset state after each sample; a gap longer than gapS restarts it, as a
+// power cycle of the monitor would
+void KB_FIELD(firmware_states, SELECTED_PS_ID)(const kb::field::Series &in, const kb::field::Converted &conv,
+                                               double gapS, std::vector<uint8_t> &state) {
+  using namespace kb_monitor_fw;
+  kb::Board &b = image();
+  const size_t n = in.t.size();
+  state.resize(n);
+  resetState1kV = false;
+  for (size_t i = 0; i < n; i++) {
+    if (i > 0 && in.t[i] - in.t[i - 1] > gapS) resetState1kV = false;
+    b.setPinInput(HV_ENABLE_SWITCH_PIN, in.hv[i] ? 0 : 1);
+    measuredI_mA = conv.mA[i];
+    measuredHV_V = conv.V[i];
+    programmedHV_V = conv.setV[i];
+    state[i] = checkMatsusadaResetState() ? 1 : 0;
+  }
+}
+
+kb::field::Thresholds KB_FIELD(firmware_thresholds, SELECTED_PS_ID)() {
+  return {(double)(RESET_ENTER_V), (double)(RESET_ENTER_I), (double)(RESET_EXIT_V), (double)(RESET_EXIT_I)};
+}
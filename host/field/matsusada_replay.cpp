@@ -0,0 +1,577 @@
+/*
+  Knob Box - matsusada_replay
+
+  Pushes logged +/-1kV monitor data through the monitor image's convertAdcReadings() and
+  scores grids of Matsusada reset thresholds against a list of known reset events: how
+  soon each set flags a reset, how many it misses, and how often it flags one that did
+  not happen.
+
+  The log is CSV with a header row naming its columns, in any order:
+    time        seconds (any epoch)
+    ps          1 / 2, or +1kv / -1kv; other supplies are skipped
+    imon,vmon,vset                ADS1115 counts, replayed exactly, or
+    i_read_ua,v_read,v_set        the register values, taken back to the nearest counts
+    hv_enable   optional, 1 = HV enable switch on (default 1)
+  The events file has one "PS START END" line per reset, in the log's seconds: when the
+  supply dropped into its reset state and when it was reset from the front panel.
+
+  Each threshold set runs the firmware's state machine with its own RESET_ENTER_V / _I and
+  RESET_EXIT_V / _I, and optionally needs the enter condition on several log samples in a
+  row. The sets are evaluated four at a time in vector lanes, and spread across forked
+  workers. The set matching the firmware's thresholds is always included, and its
+  decisions are checked sample by sample against checkMatsusadaResetState() itself.
+
+  Runs of samples where no set can change state are folded into one before the sweep:
+  HV off (nothing enters or leaves), and readings above every exit threshold (every set
+  leaves). That usually removes almost all of a long log.
+
+  Usage:
+    matsusada_replay LOG.csv [-e EVENTS] [--enter-v R] [--enter-i R] [--exit-v R]
+                     [--exit-i R] [--samples R] [--gap S] [--grace S] [--no-fold] [-j N]
+                     [--top N] [--csv FILE]
+  A range R is FROM:TO:STEP or a comma-separated list.
+*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "field.h"
+
+using kb::field::Converted;
+using kb::field::Series;
+using kb::field::Thresholds;
+
+namespace {
+
+// ========================= Input =========================
+std::vector<std::string> split_csv(const char *line) {
+  std::vector<std::string> out;
+  std::string cur;
+  for (const char *p = line; *p && *p != '\n' && *p != '\r'; p++) {
+    if (*p == ',') {
+      out.push_back(cur);
+      cur.clear();
+    } else if (*p != ' ' && *p != '"') {
+      cur += *p;
+    }
+  }
+  out.push_back(cur);
+  return out;
+}
+
+int parse_ps(const std::string &s) {
+  if (s == "1" || s == "+1kv" || s == "+1kV") return 1;
+  if (s == "2" || s == "-1kv" || s == "-1kV") return 2;
+  return 0;
+}
+
+bool load_log(const char *path, Series series[3]) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    fprintf(stderr, "matsusada_replay: cannot open %s\n", path);
+    return false;
+  }
+  char line[1024];
+  if (!fgets(line, sizeof(line), f)) {
+    fclose(f);
+    return false;
+  }
+  std::map<std::string, size_t> col;
+  const std::vector<std::string> head = split_csv(line);
+  for (size_t i = 0; i < head.size(); i++) col[head[i]] = i;
+  const bool counts = col.count("imon") && col.count("vmon") && col.count("vset");
+  const bool regs = col.count("i_read_ua") && col.count("v_read") && col.count("v_set");
+  if (!col.count("time") || !col.count("ps") || (!counts && !regs)) {
+    fprintf(stderr,
+            "matsusada_replay: %s needs time, ps, and imon,vmon,vset or i_read_ua,v_read,v_set columns\n", path);
+    fclose(f);
+    return false;
+  }
+  const bool hasHv = col.count("hv_enable") != 0;
+  int n = 1;
+  while (fgets(line, sizeof(line), f)) {
+    n++;
+    const std::vector<std::string> v = split_csv(line);
+    if (v.size() < head.size()) continue;
+    const int ps = parse_ps(v[col["ps"]]);
+    if (!ps) continue;
+    Series &s = series[ps];
+    s.ps_id = ps;
+    const double t = atof(v[col["time"]].c_str());
+    if (!s.t.empty() && t < s.t.back()) {
+      fprintf(stderr, "matsusada_replay: %s:%d: time goes backwards\n", path, n);
+      fclose(f);
+      return false;
+    }
+    int16_t c[3];
+    if (counts) {
+      c[0] = (int16_t)atoi(v[col["imon"]].c_str());
+      c[1] = (int16_t)atoi(v[col["vmon"]].c_str());
+      c[2] = (int16_t)atoi(v[col["vset"]].c_str());
+    } else {
+      const double vs = atof(v[col["v_set"]].c_str()), vr = atof(v[col["v_read"]].c_str());
+      const double ir = atof(v[col["i_read_ua"]].c_str());
+      if (ps == 1) kb_field_counts_1(vs, vr, ir, c);
+      else kb_field_counts_2(vs, vr, ir, c);
+    }
+    s.t.push_back(t);
+    s.imon.push_back(c[0]);
+    s.vmon.push_back(c[1]);
+    s.vset.push_back(c[2]);
+    s.hv.push_back(hasHv ? (uint8_t)(atoi(v[col["hv_enable"]].c_str()) != 0) : 1);
+  }
+  fclose(f);
+  return true;
+}
+
+struct Event {
+  int ps;
+  double start, end;
+};
+
+bool load_events(const char *path, std::vector<Event> &events) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    fprintf(stderr, "matsusada_replay: cannot open %s\n", path);
+    return false;
+  }
+  char line[256], ps[16];
+  Event e;
+  while (fgets(line, sizeof(line), f)) {
+    if (line[0] == '#') continue;
+    if (sscanf(line, "%15s %lf %lf", ps, &e.start, &e.end) == 3 && (e.ps = parse_ps(ps)) != 0) events.push_back(e);
+  }
+  fclose(f);
+  std::sort(events.begin(), events.end(), [](const Event &a, const Event &b) { return a.start < b.start; });
+  return true;
+}
+
+bool parse_range(const char *s, std::vector<double> &out) {
+  out.clear();
+  double a, b, step;
+  if (sscanf(s, "%lf:%lf:%lf", &a, &b, &step) == 3) {
+    if (step <= 0.0 || b < a) return false;
+    for (int i = 0; a + i * step <= b + step * 1e-6; i++) out.push_back(round((a + i * step) * 1e6) / 1e6);
+    return true;
+  }
+  for (const std::string &x : split_csv(s)) {
+    if (!x.empty()) out.push_back(atof(x.c_str()));
+  }
+  return !out.empty();
+}
+
+// ========================= Folded series =========================
+// One entry per step of the sweep: a logged sample, or a folded run
+enum Kind : uint8_t { SAMPLE, HOLD, LEAVE };
+
+struct Step {
+  double t;
+  double V, mA;                   // as the firmware compares them (float promoted to double)
+  uint8_t kind;
+  uint8_t setHigh;                // programmedHV_V > 1.0
+  uint8_t hv;
+  uint8_t restart;                // after a gap: state and filters start over
+};
+
+// With collapse false, one step per sample, for checking against the image
+std::vector<Step> fold(const Series &s, const Converted &c, double gapS, double maxEnterV, double maxEnterI,
+                       double maxExitV, double maxExitI, bool collapse) {
+  std::vector<Step> out;
+  for (size_t i = 0; i < s.t.size(); i++) {
+    Step st;
+    st.t = s.t[i];
+    st.V = c.V[i];
+    st.mA = c.mA[i];
+    st.setHigh = c.setV[i] > 1.0;
+    st.hv = s.hv[i];
+    st.restart = i == 0 || s.t[i] - s.t[i - 1] > gapS;
+    const bool canEnter = st.hv && st.setHigh && st.V < maxEnterV && st.mA < maxEnterI;
+    st.kind = !st.hv ? HOLD : (collapse && !canEnter && (st.V > maxExitV || st.mA > maxExitI)) ? LEAVE : SAMPLE;
+    if (!collapse) {
+      out.push_back(st);
+      continue;
+    }
+    if (st.kind != SAMPLE && !st.restart && !out.empty() && out.back().kind == st.kind) continue;
+    out.push_back(st);
+  }
+  return out;
+}
+
+// ========================= Sweep =========================
+struct Set {
+  Thresholds th;
+  int samples;                    // enter condition needed on this many samples in a row
+};
+
+struct Score {
+  uint32_t set = 0;
+  uint32_t detected = 0, missed = 0, falseAlarms = 0;
+  uint32_t mismatches = 0;        // firmware set only: decisions that differ from the image
+  float meanLatency = 0.0f, medianLatency = 0.0f, maxLatency = 0.0f;
+};
+
+typedef double v4d __attribute__((vector_size(32)));
+typedef int64_t v4i __attribute__((vector_size(32)));
+static constexpr int LANES = 4;
+
+// The firmware's checkMatsusadaResetState(), for LANES threshold sets at once
+struct Lanes {
+  v4d enV, enI, exV, exI;
+  v4i need;
+  v4i state = {0, 0, 0, 0}, run = {0, 0, 0, 0};
+
+  Lanes(const std::vector<Set> &sets, size_t first, size_t count) {
+    for (int l = 0; l < LANES; l++) {
+      const Set &s = sets[first + std::min((size_t)l, count - 1)];
+      enV[l] = s.th.enterV;
+      enI[l] = s.th.enterI;
+      exV[l] = s.th.exitV;
+      exI[l] = s.th.exitI;
+      need[l] = s.samples;
+    }
+  }
+
+  // `fire` gets the lanes that entered the reset state on this step
+  void step(const Step &st, v4i &fire) {
+    const v4i zero = {0, 0, 0, 0};
+    fire = zero;
+    if (st.restart) state = run = zero;
+    if (st.kind == HOLD) {
+      run = zero;
+      return;
+    }
+    if (st.kind == LEAVE) {
+      state = run = zero;
+      return;
+    }
+    const v4d V = (v4d){0, 0, 0, 0} + st.V, I = (v4d){0, 0, 0, 0} + st.mA;
+    const v4i enterCond = st.setHigh ? ((V < enV) & (I < enI)) : zero;
+    const v4i exitCond = (V > exV) | (I > exI);
+    run = (run + 1) & enterCond;
+    fire = ~state & (run >= need);
+    state = fire | (state & ~exitCond);
+  }
+};
+
+struct Sweep {
+  const std::vector<Step> *steps[3] = {nullptr, nullptr, nullptr};
+  const std::vector<Event> *events = nullptr;
+  double grace = 0.0;
+};
+
+// Sets [first, first + count) over every supply's folded series
+void score_sets(const Sweep &sw, const std::vector<Set> &sets, size_t first, size_t count, std::vector<Score> &out) {
+  const std::vector<Event> &events = *sw.events;
+  // First detection of each event per set; < 0 none
+  std::vector<double> detect(count * events.size(), -1.0);
+  std::vector<uint32_t> falseAlarms(count, 0);
+
+  for (size_t base = 0; base < count; base += LANES) {
+    for (int ps = 1; ps <= 2; ps++) {
+      if (!sw.steps[ps]) continue;
+      Lanes lanes(sets, first + base, count - base);
+      size_t ev = 0;                                    // first event that may still be open
+      for (const Step &st : *sw.steps[ps]) {
+        v4i fire;
+        lanes.step(st, fire);
+        if (!(fire[0] | fire[1] | fire[2] | fire[3])) continue;
+        while (ev < events.size() && events[ev].end + sw.grace < st.t) ev++;
+        for (int l = 0; l < LANES && base + l < count; l++) {
+          if (!fire[l]) continue;
+          bool matched = false;
+          for (size_t e = ev; e < events.size() && events[e].start <= st.t; e++) {
+            if (events[e].ps != ps || st.t > events[e].end + sw.grace) continue;
+            double &d = detect[(base + l) * events.size() + e];
+            if (d < 0.0) d = st.t - events[e].start;
+            matched = true;
+          }
+          if (!matched) falseAlarms[base + l]++;
+        }
+      }
+    }
+  }
+
+  for (size_t k = 0; k < count; k++) {
+    Score sc;
+    sc.set = (uint32_t)(first + k);
+    sc.falseAlarms = falseAlarms[k];
+    std::vector<double> lat;
+    for (size_t e = 0; e < events.size(); e++) {
+      const double d = detect[k * events.size() + e];
+      if (d >= 0.0) lat.push_back(d);
+      else sc.missed++;
+    }
+    sc.detected = (uint32_t)lat.size();
+    if (!lat.empty()) {
+      std::sort(lat.begin(), lat.end());
+      double sum = 0.0;
+      for (double d : lat) sum += d;
+      sc.meanLatency = (float)(sum / lat.size());
+      sc.medianLatency = (float)lat[lat.size() / 2];
+      sc.maxLatency = (float)lat.back();
+    }
+    out.push_back(sc);
+  }
+}
+
+// Decisions of the vector path with the firmware's thresholds, unfolded, against the
+// image's own checkMatsusadaResetState()
+uint32_t check_against_image(const std::vector<Step> &unfolded, const std::vector<uint8_t> &image,
+                             const std::vector<Set> &sets) {
+  uint32_t mismatches = 0;
+  Lanes lanes(sets, 0, 1);
+  v4i fire;
+  for (size_t i = 0; i < unfolded.size(); i++) {
+    lanes.step(unfolded[i], fire);
+    if ((lanes.state[0] != 0) != (image[i] != 0)) mismatches++;
+  }
+  return mismatches;
+}
+
+// Splits the sets across forked workers, LANES-aligned
+std::vector<Score> run_workers(const Sweep &sw, const std::vector<Set> &sets, int workers) {
+  const size_t per = ((sets.size() + workers - 1) / workers + LANES - 1) / LANES * LANES;
+  struct Child {
+    pid_t pid;
+    int fd;
+  };
+  std::vector<Child> children;
+  for (size_t first = 0; first < sets.size(); first += per) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+      perror("matsusada_replay: pipe");
+      exit(2);
+    }
+    fflush(stdout);
+    const pid_t pid = fork();
+    if (pid == 0) {
+      close(fds[0]);
+      std::vector<Score> out;
+      score_sets(sw, sets, first, std::min(per, sets.size() - first), out);
+      const char *p = reinterpret_cast<const char *>(out.data());
+      size_t left = out.size() * sizeof(Score);
+      while (left) {
+        const ssize_t n = write(fds[1], p, left);
+        if (n <= 0) _exit(3);
+        p += n;
+        left -= (size_t)n;
+      }
+      _exit(0);
+    }
+    close(fds[1]);
+    children.push_back({pid, fds[0]});
+  }
+  std::vector<Score> all;
+  for (const Child &c : children) {
+    Score sc;
+    size_t got = 0;
+    char *p = reinterpret_cast<char *>(&sc);
+    ssize_t n;
+    while ((n = read(c.fd, p + got, sizeof(Score) - got)) > 0) {
+      got += (size_t)n;
+      if (got == sizeof(Score)) {
+        all.push_back(sc);
+        got = 0;
+      }
+    }
+    close(c.fd);
+    int status = 0;
+    waitpid(c.pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      fprintf(stderr, "matsusada_replay: a worker failed\n");
+      exit(2);
+    }
+  }
+  return all;
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: matsusada_replay LOG.csv [options]\n"
+          "  -e FILE          known resets, one \"PS START END\" line each (seconds)\n"
+          "  --enter-v R      RESET_ENTER_V values (default 0.5:5:0.5)\n"
+          "  --enter-i R      RESET_ENTER_I values, mA (default 0.1:1:0.1)\n"
+          "  --exit-v R       RESET_EXIT_V values (default 1:6:0.5)\n"
+          "  --exit-i R       RESET_EXIT_I values, mA (default 0.5:2:0.25)\n"
+          "  --samples R      log samples in a row needed to enter (default 1)\n"
+          "  --gap S          a longer gap in the log restarts the state (default 60)\n"
+          "  --grace S        a detection this long after an event's end still counts (default 0)\n"
+          "  --no-fold        sweep every sample, for checking the folding\n"
+          "  -j N             worker processes (default: one per online CPU)\n"
+          "  --top N          sets listed (default 20)\n"
+          "  --csv FILE       write every set's score\n"
+          "  R is FROM:TO:STEP or a comma-separated list\n");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const char *logPath = nullptr, *eventsPath = nullptr, *csv = nullptr;
+  std::vector<double> enterV, enterI, exitV, exitI, samples;
+  parse_range("0.5:5:0.5", enterV);
+  parse_range("0.1:1:0.1", enterI);
+  parse_range("1:6:0.5", exitV);
+  parse_range("0.5:2:0.25", exitI);
+  parse_range("1", samples);
+  double gapS = 60.0, grace = 0.0;
+  bool noFold = false;
+  long workers = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t top = 20;
+  for (int i = 1; i < argc; i++) {
+    const std::string a = argv[i];
+    const bool hasValue = i + 1 < argc;
+    bool ok = true;
+    if (a == "-e" && hasValue) {
+      eventsPath = argv[++i];
+    } else if (a == "--enter-v" && hasValue) {
+      ok = parse_range(argv[++i], enterV);
+    } else if (a == "--enter-i" && hasValue) {
+      ok = parse_range(argv[++i], enterI);
+    } else if (a == "--exit-v" && hasValue) {
+      ok = parse_range(argv[++i], exitV);
+    } else if (a == "--exit-i" && hasValue) {
+      ok = parse_range(argv[++i], exitI);
+    } else if (a == "--samples" && hasValue) {
+      ok = parse_range(argv[++i], samples);
+    } else if (a == "--gap" && hasValue) {
+      gapS = atof(argv[++i]);
+    } else if (a == "--grace" && hasValue) {
+      grace = atof(argv[++i]);
+    } else if (a == "--no-fold") {
+      noFold = true;
+    } else if (a == "-j" && hasValue) {
+      workers = atol(argv[++i]);
+    } else if (a == "--top" && hasValue) {
+      top = (size_t)atol(argv[++i]);
+    } else if (a == "--csv" && hasValue) {
+      csv = argv[++i];
+    } else if (a[0] != '-' && !logPath) {
+      logPath = argv[i];
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      usage();
+      return 2;
+    }
+  }
+  if (!logPath) {
+    usage();
+    return 2;
+  }
+  if (workers < 1) workers = 1;
+
+  Series series[3];
+  std::vector<Event> events;
+  if (!load_log(logPath, series) || (eventsPath && !load_events(eventsPath, events))) return 2;
+
+  // The firmware's own set first, then the grid; exit thresholds below enter ones are skipped
+  std::vector<Set> sets;
+  const Thresholds fw = kb_field_firmware_thresholds_1();
+  sets.push_back({fw, 1});
+  for (double ev : enterV)
+    for (double ei : enterI)
+      for (double xv : exitV)
+        for (double xi : exitI)
+          for (double n : samples) {
+            if (xv < ev || xi < ei || n < 1) continue;
+            if (ev == fw.enterV && ei == fw.enterI && xv == fw.exitV && xi == fw.exitI && n == 1) continue;
+            sets.push_back({{ev, ei, xv, xi}, (int)n});
+          }
+  double maxEnterV = 0, maxEnterI = 0, maxExitV = 0, maxExitI = 0;
+  for (const Set &s : sets) {
+    maxEnterV = std::max(maxEnterV, s.th.enterV);
+    maxEnterI = std::max(maxEnterI, s.th.enterI);
+    maxExitV = std::max(maxExitV, s.th.exitV);
+    maxExitI = std::max(maxExitI, s.th.exitI);
+  }
+
+  Converted conv[3];
+  std::vector<Step> steps[3];
+  Sweep sw;
+  sw.events = &events;
+  sw.grace = grace;
+  size_t logged = 0, folded = 0;
+  uint32_t mismatches = 0;
+  for (int ps = 1; ps <= 2; ps++) {
+    const Series &s = series[ps];
+    if (s.t.empty()) continue;
+    std::vector<uint8_t> image;
+    if (ps == 1) {
+      kb_field_convert_1(s, conv[ps]);
+      kb_field_firmware_states_1(s, conv[ps], gapS, image);
+    } else {
+      kb_field_convert_2(s, conv[ps]);
+      kb_field_firmware_states_2(s, conv[ps], gapS, image);
+    }
+    mismatches += check_against_image(fold(s, conv[ps], gapS, 0, 0, 0, 0, false), image, sets);
+    steps[ps] = fold(s, conv[ps], gapS, maxEnterV, maxEnterI, maxExitV, maxExitI, !noFold);
+    sw.steps[ps] = &steps[ps];
+    logged += s.t.size();
+    folded += steps[ps].size();
+  }
+  if (!logged) {
+    fprintf(stderr, "matsusada_replay: no +1kV or -1kV samples in %s\n", logPath);
+    return 2;
+  }
+
+  std::vector<Score> scores = run_workers(sw, sets, (int)std::min<long>(workers, (long)(sets.size() + LANES - 1) / LANES));
+  scores[0].mismatches = mismatches;
+
+  printf("%zu samples (%zu after folding), %zu known resets, %zu threshold sets\n", logged, folded, events.size(),
+         sets.size());
+  if (mismatches) printf("the replay DIFFERS from checkMatsusadaResetState() on %u samples\n", mismatches);
+  else printf("the replay matches checkMatsusadaResetState() on every sample\n");
+
+  std::vector<size_t> order(scores.size());
+  for (size_t i = 0; i < order.size(); i++) order[i] = i;
+  std::sort(order.begin(), order.end(), [&scores](size_t a, size_t b) {
+    const Score &x = scores[a], &y = scores[b];
+    if (x.missed != y.missed) return x.missed < y.missed;
+    if (x.falseAlarms != y.falseAlarms) return x.falseAlarms < y.falseAlarms;
+    if (x.meanLatency != y.meanLatency) return x.meanLatency < y.meanLatency;
+    return x.set < y.set;
+  });
+
+  printf("\n  %7s %7s %7s %7s %3s  %8s %6s %6s  %9s %9s %9s\n", "enterV", "enterI", "exitV", "exitI", "n", "detected",
+         "missed", "false", "mean s", "median s", "max s");
+  auto row = [&](const Score &sc) {
+    const Set &s = sets[sc.set];
+    printf("%c %7.3g %7.3g %7.3g %7.3g %3d  %8u %6u %6u  %9.2f %9.2f %9.2f\n", sc.set == 0 ? '*' : ' ', s.th.enterV,
+           s.th.enterI, s.th.exitV, s.th.exitI, s.samples, sc.detected, sc.missed, sc.falseAlarms, sc.meanLatency,
+           sc.medianLatency, sc.maxLatency);
+  };
+  bool fwShown = false;
+  for (size_t i = 0; i < std::min(top, order.size()); i++) {
+    row(scores[order[i]]);
+    fwShown |= order[i] == 0;
+  }
+  if (!fwShown) {
+    printf("  ...\n");
+    row(scores[0]);
+  }
+  printf("* the firmware's RESET_ENTER_V / _I and RESET_EXIT_V / _I\n");
+
+  if (csv) {
+    FILE *f = fopen(csv, "w");
+    if (!f) {
+      fprintf(stderr, "matsusada_replay: cannot write %s\n", csv);
+      return 2;
+    }
+    fprintf(f, "enter_v,enter_i,exit_v,exit_i,samples,detected,missed,false_alarms,mean_s,median_s,max_s\n");
+    for (const Score &sc : scores) {
+      const Set &s = sets[sc.set];
+      fprintf(f, "%g,%g,%g,%g,%d,%u,%u,%u,%.3f,%.3f,%.3f\n", s.th.enterV, s.th.enterI, s.th.exitV, s.th.exitI,
+              s.samples, sc.detected, sc.missed, sc.falseAlarms, sc.meanLatency, sc.medianLatency, sc.maxLatency);
+    }
+    fclose(f);
+  }
+  return mismatches ? 1 : 0;
+}
@@ -0,0 +1,640 @@
+/*
+  Knob Box - Modbus stress and fuzz run against the monitor images
+
+  Puts the selected monitors on one simulated RS-485 bus, as on the rack, and drives them
+  as the dashboard does: a read to each slave in turn, waiting for the reply or a timeout
+  and then leaving --gap of silence. Bus noise is mixed in at each level of a sweep:
+
+    malformed   a request to a monitor on the bus with one bit flipped (bad CRC)
+    wrong       a well-formed request to an address that is not on the bus
+    truncated   a request to a monitor on the bus missing its last 1-5 bytes
+    bursts      line noise: runs of random bytes at random times, unaware of the traffic
+
+  At a level of L %, L % of the bus slots carry one of the bad frames instead of a read, and
+  bursts arrive at L % of --bursts per second. Each level runs in its own forked process on
+  fresh images, since the firmware's globals are only initialized once per process.
+
+  For each level the run reports the reads that got a good reply, the ones whose reply was
+  hit by a burst, exceptions, and the ones that got no reply. A lost read is "merged" when
+  foreign bytes reached the bus between the end of the slot before it and the monitor's
+  first chance to frame it: T35 (5 ms) after it, plus the monitor's longest loop() pass.
+  ModbusRtu then takes them as part of the request. Any other loss is "other". Reply
+  latency runs from the end of a request to the end of its reply. "quiet" is the longest
+  stretch any one monitor went without a good reply. "pass" is the longest loop() pass,
+  which is the longest time between two wdt_reset() calls; it must stay well under the
+  8 s watchdog. A tripped watchdog, or a pass longer than --max-pass, gives exit status 1.
+
+  Usage:
+    modbus_fuzz [--ids 1,2,3,4] [--levels 0,5,10,20,40,80] [--mix malformed,wrong,truncated]
+                [--bursts PER_S] [--burst-len N] [--duration S] [--read A+N] [--fc 3|4]
+                [--gap MS] [--timeout MS] [--seed S] [--max-pass MS] [--csv FILE]
+*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "../board/board.h"
+#include "../common/modbus_frame.h"
+#include "../replay/capture.h"
+
+using namespace kb;
+
+namespace {
+
+// ========================= Options =========================
+enum Kind : uint8_t { MALFORMED, WRONG, TRUNCATED, KIND_COUNT };
+
+struct Options {
+  bool selected[5] = {false, true, true, true, true};   // by slave id
+  std::vector<double> levels = {0, 5, 10, 20, 40, 80};  // % of bus slots carrying a bad frame
+  bool kinds[KIND_COUNT] = {true, true, true};
+  double bursts_per_s = 20.0;    // at a level of 100 %
+  unsigned burstLen = 16;        // longest burst, bytes
+  double duration_s = 60.0;      // virtual time per level
+  uint16_t readAddr = 0;
+  uint16_t readCount = 6;        // the block the dashboard polls
+  uint8_t fc = 4;
+  double gap_ms = 60.0;          // as kb_bus_poller leaves between monitors
+  double timeout_ms = 200.0;
+  uint32_t seed = 1;
+  double maxPass_ms = -1.0;      // < 0: only a tripped watchdog fails the run
+  const char *csv = nullptr;
+};
+
+static constexpr uint8_t MONITOR_MODBUS_UART = 1;
+static constexpr uint8_t SLAVE_COUNT = 4;           // PS_POS1KV .. PS_3KV
+static constexpr double T35_MS = 5.0;               // ModbusRtu.h
+static constexpr double WATCHDOG_MS = 8192.0;       // WDTO_8S, as the mock times it
+static const char *const KIND_NAMES[KIND_COUNT] = {"malformed", "wrong", "truncated"};
+
+// ========================= Results =========================
+// One level's totals; written through a pipe by the child that ran it
+struct LevelResult {
+  double level = 0.0;
+  uint32_t reads = 0;          // reads to a monitor on the bus
+  uint32_t good = 0;
+  uint32_t corrupted = 0;      // replied, but a burst overlapped the reply
+  uint32_t exceptions = 0;
+  uint32_t merged = 0;         // no reply, foreign bytes on the bus since the previous slot
+  uint32_t other = 0;          // no reply otherwise
+  uint32_t badFrames[KIND_COUNT] = {};
+  uint32_t bursts = 0;
+  uint32_t stray = 0;          // replies that answered nothing the run was waiting on
+  double p50_ms = 0.0, p99_ms = 0.0, max_ms = 0.0;
+  double quiet_s = 0.0;
+  uint8_t quietId = 0;
+  double maxPass_ms = 0.0;
+  uint8_t maxPassId = 0;
+  uint8_t tripped = 0;         // bit per slave id
+};
+
+// ========================= Bus =========================
+struct Rng {
+  uint64_t x;
+  explicit Rng(uint64_t seed) : x(seed ^ 0x9E3779B97F4A7C15ULL) {
+    if (x == 0) x = 1;
+  }
+  uint32_t next(uint32_t range) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return (uint32_t)(x % range);
+  }
+  double uniform() { return (double)(next(1u << 30) + 0.5) / (double)(1u << 30); }
+};
+
+// Bytes still to reach one board, earliest first. ImageBoard's receive queue has to be fed
+// in arrival order, and noise, requests and the other monitors' replies interleave.
+class Inbox {
+ public:
+  void push(uint64_t at, uint8_t byte) { q_.push({at, seq_++, byte}); }
+
+  // Hands the board every byte arriving before `until`
+  void deliver(Board *b, uint64_t until) {
+    while (!q_.empty() && q_.top().at < until) {
+      b->uartInject(MONITOR_MODBUS_UART, q_.top().byte, q_.top().at);
+      q_.pop();
+    }
+  }
+
+ private:
+  struct Item {
+    uint64_t at;
+    uint64_t seq;
+    uint8_t byte;
+    bool operator>(const Item &o) const { return at != o.at ? at > o.at : seq > o.seq; }
+  };
+  std::priority_queue<Item, std::vector<Item>, std::greater<Item>> q_;
+  uint64_t seq_ = 0;
+};
+
+struct Read {
+  uint8_t id;
+  uint64_t since;              // end of the slot before it
+  uint64_t start, end;         // request on the bus, cycles
+  bool haveReply = false;
+  Frame reply;
+  uint64_t replyEnd = 0;
+};
+
+bool is_reply_to(const std::vector<uint8_t> &req, const Frame &f) {
+  const size_t n = f.bytes.size();
+  if (n < MODBUS_EXCEPTION_BYTES || !modbus_crc_ok(f.bytes.data(), n)) return false;
+  if (f.bytes[0] != req[0] || (f.bytes[1] & 0x7F) != req[1]) return false;
+  if (f.bytes[1] & 0x80) return n == MODBUS_EXCEPTION_BYTES;
+  return n == modbus_reply_bytes(req.data(), req.size());
+}
+
+// ========================= One level =========================
+class Level {
+ public:
+  Level(const Options &o, double level)
+      : opt_(o), level_(level), rng_(((uint64_t)o.seed << 32) ^ (uint64_t)(level * 1000.0)),
+        mon_{&kb_monitor_board_1(), &kb_monitor_board_2(), &kb_monitor_board_3(), &kb_monitor_board_4()} {
+    res_.level = level;
+  }
+
+  LevelResult run() {
+    for (uint8_t s = 0; s < SLAVE_COUNT; s++) {
+      if (!opt_.selected[s + 1]) continue;
+      boards_.push_back(mon_[s]);
+      ids_.push_back((uint8_t)(s + 1));
+      mon_[s]->powerOn(0);
+    }
+    uint64_t booted = 0;
+    for (Board *b : boards_) booted = std::max(booted, b->now());
+    chr_ = boards_[0]->uartCharCycles(MONITOR_MODBUS_UART);
+    t35_ = ms(T35_MS);
+    origin_ = (booted / CYCLES_PER_MS + 100) * CYCLES_PER_MS;
+    end_ = origin_ + ms(opt_.duration_s * 1000.0);
+    inbox_.resize(boards_.size());
+    lastGood_.assign(boards_.size(), origin_);
+    longest_.assign(boards_.size(), 0);
+    make_bursts();
+    wire();
+
+    nextAt_ = slotEnd_ = origin_;
+    std::vector<double> latency;
+    for (;;) {
+      size_t e = earliest();
+      Board *b = boards_[e];
+      const uint64_t t = b->now();
+      if (!bus(t, latency) && t > end_ + ms(opt_.timeout_ms)) break;
+      for (auto &sp : splitter_) sp->idle(t);
+      // Anything produced from here on arrives at least a character after `t`
+      inbox_[e].deliver(b, t + chr_);
+      b->step();
+      longest_[e] = std::max(longest_[e], b->now() - t);
+      const double pass = (double)(b->now() - t) / (double)CYCLES_PER_MS;
+      if (pass > res_.maxPass_ms) {
+        res_.maxPass_ms = pass;
+        res_.maxPassId = ids_[e];
+      }
+    }
+    for (auto &sp : splitter_) sp->finish();
+
+    for (size_t i = 0; i < boards_.size(); i++) {
+      if (boards_[i]->watchdogTripped()) res_.tripped |= (uint8_t)(1u << ids_[i]);
+      const double quiet = (double)(end_ - std::min(lastGood_[i], end_)) / (CYCLES_PER_MS * 1000.0);
+      note_quiet(i, quiet);
+    }
+    if (!latency.empty()) {
+      std::sort(latency.begin(), latency.end());
+      res_.p50_ms = latency[latency.size() / 2];
+      res_.p99_ms = latency[std::min(latency.size() - 1, latency.size() * 99 / 100)];
+      res_.max_ms = latency.back();
+    }
+    return res_;
+  }
+
+ private:
+  uint64_t ms(double v) const { return (uint64_t)(v * (double)CYCLES_PER_MS); }
+
+  size_t earliest() const {
+    size_t e = 0;
+    for (size_t i = 1; i < boards_.size(); i++) {
+      if (boards_[i]->now() < boards_[e]->now()) e = i;
+    }
+    return e;
+  }
+
+  void to_all(uint64_t at, uint8_t byte, size_t except = SIZE_MAX) {
+    for (size_t i = 0; i < inbox_.size(); i++) {
+      if (i != except) inbox_[i].push(at, byte);
+    }
+  }
+
+  // Line noise for the whole run, laid down up front: a Poisson stream of bursts, each a run
+  // of random bytes with up to a character of idle line between them
+  void make_bursts() {
+    const double rate = opt_.bursts_per_s * level_ / 100.0;
+    if (rate <= 0.0 || opt_.burstLen == 0) return;
+    double t_s = 0.0;
+    for (;;) {
+      t_s += -log(rng_.uniform()) / rate;
+      uint64_t at = origin_ + ms(t_s * 1000.0);
+      if (at >= end_) break;
+      res_.bursts++;
+      const unsigned n = 1 + rng_.next(opt_.burstLen);
+      for (unsigned k = 0; k < n; k++) {
+        at += chr_ + rng_.next((uint32_t)chr_);
+        to_all(at, (uint8_t)rng_.next(256));
+        noise_.push_back(at);
+      }
+    }
+  }
+
+  void wire() {
+    for (size_t i = 0; i < boards_.size(); i++) {
+      const uint8_t id = ids_[i];
+      splitter_.emplace_back(new FrameSplitter(chr_, chr_ * 7 / 2, [this, id](const Frame &fr) { on_reply(id, fr); }));
+      FrameSplitter *sp = splitter_.back().get();
+      // Every monitor on the bus hears the others' replies
+      boards_[i]->onUartTx(MONITOR_MODBUS_UART, [this, i, sp](uint8_t byte, uint64_t at) {
+        sp->push(byte, at);
+        to_all(at, byte, i);
+      });
+    }
+  }
+
+  void on_reply(uint8_t id, const Frame &fr) {
+    if (!awaiting_ || reads_.back().id != id || reads_.back().haveReply || fr.start < reads_.back().end) {
+      res_.stray++;
+      return;
+    }
+    Read &r = reads_.back();
+    r.haveReply = true;
+    r.reply = fr;
+    r.replyEnd = fr.start + fr.bytes.size() * chr_;
+  }
+
+  // Bytes that were not part of the dashboard's own traffic between `from` and `to`
+  bool foreign(uint64_t from, uint64_t to) const {
+    for (const std::vector<uint64_t> *v : {&noise_, &badBytes_}) {
+      auto it = std::lower_bound(v->begin(), v->end(), from);
+      if (it != v->end() && *it <= to) return true;
+    }
+    return false;
+  }
+
+  void note_quiet(size_t board, double quiet_s) {
+    if (quiet_s > res_.quiet_s) {
+      res_.quiet_s = quiet_s;
+      res_.quietId = ids_[board];
+    }
+  }
+
+  void settle(std::vector<double> &latency) {
+    const Read &r = reads_.back();
+    const std::vector<uint8_t> &req = request_;
+    if (!r.haveReply) {
+      // The monitor frames the request on its first poll() T35 after it, which a long pass
+      // can put off; bytes that land before then join the frame
+      uint64_t framed = r.end + t35_;
+      for (size_t i = 0; i < ids_.size(); i++) {
+        if (ids_[i] == r.id) framed += longest_[i];
+      }
+      if (foreign(r.since, framed)) res_.merged++;
+      else res_.other++;
+      return;
+    }
+    // The dashboard hears the bus, so a burst during the reply spoils it
+    if (foreign(r.reply.start, r.replyEnd)) {
+      res_.corrupted++;
+    } else if (!is_reply_to(req, r.reply) || (r.reply.bytes[1] & 0x80)) {
+      res_.exceptions++;
+    } else {
+      res_.good++;
+      latency.push_back((double)(r.replyEnd - r.end) / (double)CYCLES_PER_MS);
+      for (size_t i = 0; i < ids_.size(); i++) {
+        if (ids_[i] != r.id) continue;
+        note_quiet(i, (double)(r.replyEnd - lastGood_[i]) / (CYCLES_PER_MS * 1000.0));
+        lastGood_[i] = r.replyEnd;
+      }
+    }
+  }
+
+  std::vector<uint8_t> read_frame(uint8_t id) const {
+    std::vector<uint8_t> f = {id, opt_.fc, (uint8_t)(opt_.readAddr >> 8), (uint8_t)opt_.readAddr,
+                              (uint8_t)(opt_.readCount >> 8), (uint8_t)opt_.readCount};
+    const uint16_t crc = modbus_crc16(f.data(), f.size());
+    f.push_back((uint8_t)crc);
+    f.push_back((uint8_t)(crc >> 8));
+    return f;
+  }
+
+  std::vector<uint8_t> bad_frame(Kind k) {
+    const uint8_t live = ids_[rng_.next((uint32_t)ids_.size())];
+    std::vector<uint8_t> f;
+    switch (k) {
+      case MALFORMED:
+        f = read_frame(live);
+        f[rng_.next((uint32_t)f.size())] ^= (uint8_t)(1u << rng_.next(8));
+        break;
+      case WRONG: {
+        uint8_t id;
+        do {
+          id = (uint8_t)(1 + rng_.next(247));
+        } while (id <= SLAVE_COUNT && opt_.selected[id]);
+        f = read_frame(id);
+        break;
+      }
+      default:
+        f = read_frame(live);
+        f.resize(f.size() - 1 - rng_.next(5));
+        break;
+    }
+    return f;
+  }
+
+  // Puts the next slot on the bus once the previous one is over; false once the run is done
+  bool bus(uint64_t t, std::vector<double> &latency) {
+    if (awaiting_) {
+      const Read &r = reads_.back();
+      const uint64_t done = r.haveReply ? r.replyEnd : r.end + ms(opt_.timeout_ms);
+      if (!r.haveReply && t < done) return true;
+      awaiting_ = false;
+      settle(latency);
+      slotEnd_ = done;
+      nextAt_ = done + ms(opt_.gap_ms);
+    }
+    if (nextAt_ >= end_) return false;
+    if (t < nextAt_) return true;
+
+    std::vector<Kind> enabled;
+    for (uint8_t k = 0; k < KIND_COUNT; k++) {
+      if (opt_.kinds[k]) enabled.push_back((Kind)k);
+    }
+    const bool bad = !enabled.empty() && rng_.uniform() * 100.0 < level_;
+    std::vector<uint8_t> f;
+    if (bad) {
+      const Kind k = enabled[rng_.next((uint32_t)enabled.size())];
+      f = bad_frame(k);
+      res_.badFrames[k]++;
+    } else {
+      f = request_ = read_frame(ids_[nextSlave_]);
+      nextSlave_ = (nextSlave_ + 1) % ids_.size();
+    }
+    const uint64_t start = t;
+    for (size_t k = 0; k < f.size(); k++) {
+      const uint64_t at = start + (k + 1) * chr_;
+      to_all(at, f[k]);
+      if (bad) badBytes_.push_back(at);
+    }
+    const uint64_t end = start + f.size() * chr_;
+    if (bad) {
+      slotEnd_ = end;
+      nextAt_ = end + ms(opt_.gap_ms);
+    } else {
+      Read r;
+      r.id = f[0];
+      r.since = std::min(slotEnd_, start > t35_ ? start - t35_ : 0);
+      r.start = start;
+      r.end = end;
+      reads_.push_back(r);
+      res_.reads++;
+      awaiting_ = true;
+    }
+    return true;
+  }
+
+  const Options &opt_;
+  double level_;
+  Rng rng_;
+  Board *mon_[SLAVE_COUNT];
+  std::vector<Board *> boards_;
+  std::vector<uint8_t> ids_;
+  std::vector<Inbox> inbox_;
+  std::vector<std::unique_ptr<FrameSplitter>> splitter_;
+  std::vector<uint64_t> noise_;        // burst byte arrivals, in order
+  std::vector<uint64_t> badBytes_;     // bad frame byte arrivals, in order
+  std::vector<Read> reads_;
+  std::vector<uint8_t> request_;       // the read being waited on
+  std::vector<uint64_t> lastGood_;
+  std::vector<uint64_t> longest_;      // longest loop() pass so far, per board
+  uint64_t chr_ = 0, t35_ = 0, origin_ = 0, end_ = 0, nextAt_ = 0, slotEnd_ = 0;
+  size_t nextSlave_ = 0;
+  bool awaiting_ = false;
+  LevelResult res_;
+};
+
+// ========================= Workers =========================
+// Every level in its own forked child, all at once
+std::vector<LevelResult> run_levels(const Options &opt) {
+  struct Child {
+    pid_t pid;
+    int fd;
+  };
+  std::vector<Child> children;
+  for (double level : opt.levels) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+      perror("modbus_fuzz: pipe");
+      exit(2);
+    }
+    fflush(stdout);
+    const pid_t pid = fork();
+    if (pid == 0) {
+      close(fds[0]);
+      static Level run(opt, level);
+      const LevelResult r = run.run();
+      const char *p = reinterpret_cast<const char *>(&r);
+      size_t left = sizeof(r);
+      while (left) {
+        const ssize_t n = write(fds[1], p, left);
+        if (n <= 0) _exit(3);
+        p += n;
+        left -= (size_t)n;
+      }
+      _exit(0);
+    }
+    close(fds[1]);
+    children.push_back({pid, fds[0]});
+  }
+  std::vector<LevelResult> all;
+  for (const Child &c : children) {
+    LevelResult r;
+    size_t got = 0;
+    ssize_t n;
+    while (got < sizeof(r) && (n = read(c.fd, reinterpret_cast<char *>(&r) + got, sizeof(r) - got)) > 0) {
+      got += (size_t)n;
+    }
+    close(c.fd);
+    int status = 0;
+    waitpid(c.pid, &status, 0);
+    if (got != sizeof(r) || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      fprintf(stderr, "modbus_fuzz: a worker failed\n");
+      exit(2);
+    }
+    all.push_back(r);
+  }
+  return all;
+}
+
+// ========================= Report =========================
+double pct(uint32_t n, uint32_t of) { return of ? 100.0 * n / of : 0.0; }
+
+int report(const Options &opt, const std::vector<LevelResult> &res) {
+  printf("%6s %6s %6s %7s %6s %6s %6s %6s %6s %5s %7s %7s %7s %7s %7s\n", "level", "bad/s", "burst/s", "reads",
+         "good%", "corr", "exc", "merged", "other", "stray", "p50 ms", "p99 ms", "max ms", "quiet s", "pass ms");
+  int failed = 0;
+  for (const LevelResult &r : res) {
+    uint32_t bad = 0;
+    for (uint32_t n : r.badFrames) bad += n;
+    printf("%5.0f%% %6.1f %7.1f %7u %5.1f%% %6u %6u %6u %6u %5u %7.1f %7.1f %7.1f %4.1f@%u %6.1f@%u", r.level,
+           bad / opt.duration_s, r.bursts / opt.duration_s, r.reads, pct(r.good, r.reads), r.corrupted,
+           r.exceptions, r.merged, r.other, r.stray, r.p50_ms, r.p99_ms, r.max_ms, r.quiet_s, r.quietId,
+           r.maxPass_ms, r.maxPassId);
+    if (r.tripped) {
+      printf("  watchdog tripped:");
+      for (uint8_t id = 1; id <= SLAVE_COUNT; id++) {
+        if (r.tripped & (1u << id)) printf(" %u", id);
+      }
+      failed++;
+    } else if (opt.maxPass_ms >= 0.0 && r.maxPass_ms > opt.maxPass_ms) {
+      printf("  pass over %.0f ms", opt.maxPass_ms);
+      failed++;
+    }
+    printf("\n");
+  }
+  double worst = 0.0;
+  for (const LevelResult &r : res) worst = std::max(worst, r.maxPass_ms);
+  printf("\nlongest loop() pass %.1f ms, %.1f %% of the %.0f ms watchdog\n", worst, 100.0 * worst / WATCHDOG_MS,
+         WATCHDOG_MS);
+
+  if (opt.csv) {
+    FILE *f = fopen(opt.csv, "w");
+    if (!f) {
+      fprintf(stderr, "modbus_fuzz: cannot write %s\n", opt.csv);
+      return 2;
+    }
+    fprintf(f, "level,malformed,wrong,truncated,bursts,reads,good,corrupted,exceptions,merged,other,stray,"
+               "p50_ms,p99_ms,max_ms,quiet_s,max_pass_ms,tripped\n");
+    for (const LevelResult &r : res) {
+      fprintf(f, "%g,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%.3f,%.3f,%.3f,%.3f,%.3f,%u\n", r.level, r.badFrames[MALFORMED],
+              r.badFrames[WRONG], r.badFrames[TRUNCATED], r.bursts, r.reads, r.good, r.corrupted, r.exceptions,
+              r.merged, r.other, r.stray, r.p50_ms, r.p99_ms, r.max_ms, r.quiet_s, r.maxPass_ms, r.tripped);
+    }
+    fclose(f);
+  }
+  printf("\n%s\n", failed ? "FAIL" : "ok");
+  return failed ? 1 : 0;
+}
+
+bool parse_levels(const char *s, std::vector<double> &out) {
+  out.clear();
+  for (const char *p = s; *p;) {
+    char *e;
+    const double v = strtod(p, &e);
+    if (e == p || v < 0.0 || v > 100.0) return false;
+    out.push_back(v);
+    p = (*e == ',') ? e + 1 : e;
+    if (*e && *e != ',') return false;
+  }
+  return !out.empty();
+}
+
+bool parse_mix(const char *s, bool kinds[KIND_COUNT]) {
+  for (uint8_t k = 0; k < KIND_COUNT; k++) kinds[k] = false;
+  std::string text(s);
+  size_t pos = 0;
+  while (pos <= text.size()) {
+    const size_t comma = std::min(text.find(',', pos), text.size());
+    const std::string name = text.substr(pos, comma - pos);
+    bool found = false;
+    for (uint8_t k = 0; k < KIND_COUNT; k++) {
+      if (name == KIND_NAMES[k]) kinds[k] = found = true;
+    }
+    if (!found && name != "none") return false;
+    pos = comma + 1;
+  }
+  return true;
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: modbus_fuzz [options]\n"
+          "  --ids LIST       monitors on the bus (default 1,2,3,4)\n"
+          "  --levels LIST    noise levels, %% of bus slots with a bad frame (default 0,5,10,20,40,80)\n"
+          "  --mix LIST       bad frames: malformed, wrong, truncated, or none (default all three)\n"
+          "  --bursts PER_S   line-noise bursts per second at 100 %% (default 20)\n"
+          "  --burst-len N    longest burst in bytes, 0 for none (default 16)\n"
+          "  --duration S     virtual seconds per level (default 60)\n"
+          "  --read A+N       the dashboard's read (default 0+6)\n"
+          "  --fc 3|4         its function code (default 4)\n"
+          "  --gap MS         silence after each transaction (default 60)\n"
+          "  --timeout MS     wait this long for a reply (default 200)\n"
+          "  --seed S         noise seed (default 1)\n"
+          "  --max-pass MS    fail when a loop() pass is longer\n"
+          "  --csv FILE       write one row per level\n");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options opt;
+  for (int i = 1; i < argc; i++) {
+    const std::string a = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (a == "--ids" && hasValue) {
+      memset(opt.selected, 0, sizeof(opt.selected));
+      for (const char *p = argv[++i]; *p; p++) {
+        if (*p >= '1' && *p <= '0' + SLAVE_COUNT) opt.selected[*p - '0'] = true;
+        else if (*p != ',') { usage(); return 2; }
+      }
+    } else if (a == "--levels" && hasValue) {
+      if (!parse_levels(argv[++i], opt.levels)) { usage(); return 2; }
+    } else if (a == "--mix" && hasValue) {
+      if (!parse_mix(argv[++i], opt.kinds)) { usage(); return 2; }
+    } else if (a == "--bursts" && hasValue) {
+      opt.bursts_per_s = atof(argv[++i]);
+    } else if (a == "--burst-len" && hasValue) {
+      opt.burstLen = (unsigned)atoi(argv[++i]);
+    } else if (a == "--duration" && hasValue) {
+      opt.duration_s = atof(argv[++i]);
+    } else if (a == "--read" && hasValue) {
+      unsigned addr, count;
+      if (sscanf(argv[++i], "%u+%u", &addr, &count) != 2 || count == 0) { usage(); return 2; }
+      opt.readAddr = (uint16_t)addr;
+      opt.readCount = (uint16_t)count;
+    } else if (a == "--fc" && hasValue) {
+      opt.fc = (uint8_t)atoi(argv[++i]);
+      if (opt.fc != 3 && opt.fc != 4) { usage(); return 2; }
+    } else if (a == "--gap" && hasValue) {
+      opt.gap_ms = atof(argv[++i]);
+    } else if (a == "--timeout" && hasValue) {
+      opt.timeout_ms = atof(argv[++i]);
+    } else if (a == "--seed" && hasValue) {
+      opt.seed = (uint32_t)atol(argv[++i]);
+    } else if (a == "--max-pass" && hasValue) {
+      opt.maxPass_ms = atof(argv[++i]);
+    } else if (a == "--csv" && hasValue) {
+      opt.csv = argv[++i];
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  bool any = false;
+  for (uint8_t id = 1; id <= SLAVE_COUNT; id++) any |= opt.selected[id];
+  if (!any || opt.duration_s <= 0.0) {
+    usage();
+    return 2;
+  }
+
+  printf("%.0f s per level, read %u+%u FC%u to each of", opt.duration_s, opt.readAddr, opt.readCount, opt.fc);
+  for (uint8_t id = 1; id <= SLAVE_COUNT; id++) {
+    if (opt.selected[id]) printf(" %u", id);
+  }
+  printf(", %.0f ms gap, %.0f ms timeout\n\n", opt.gap_ms, opt.timeout_ms);
+  return report(opt, run_levels(opt));
+}
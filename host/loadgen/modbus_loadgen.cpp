@@ -0,0 +1,439 @@
+/*
+  Knob Box - Modbus RTU load generator and latency benchmark
+
+  Acts as the dashboard master on a serial port: a USB-RS485 adapter on the real bus, or
+  one of the ptys knob_box_sim --pty opens (a single monitor, or the shared bus). Each
+  sweep polls every selected slave with the chosen read pattern. The sweep rate is stepped
+  through a list, and each step reports:
+
+    - the achieved sweep rate
+    - the reply latency percentiles, from the request write() to the last reply byte
+    - timeouts, CRC failures, exceptions and malformed or mismatched replies
+    - stray bytes that arrived between transactions, i.e. late replies
+
+  The highest step that keeps up with its target without losing replies is the maximum
+  sustainable sweep rate at that baud. A line-rate bound from the frame sizes alone is
+  printed next to it; the difference is the monitors' turnaround.
+
+  Patterns (comma separated, one request each):
+    block     registers 0-5 in one read, the block the dashboard polls today
+    single    registers 0-5 as six one-register reads
+    ext       the registers after the block, 6-58, as 6+29 and 35+24
+    full      all 59 registers, as 0+29, 29+29 and 58+1
+    A+N       N registers from address A
+
+  The ModbusRtu library frames into a 64-byte buffer, so the monitors answer a read of more
+  than 29 registers with exception 03 instead of a reply. Such reads are sent, with a warning.
+
+  Usage:
+    modbus_loadgen -p DEVICE [-b baud] [--ids 1,2,3,4] [--pattern block] [--fc 4]
+                   [--rates 1,2,5,10,20,max] [--duration 10] [--timeout 200]
+                   [--gap MS] [--max-loss PCT] [--csv FILE]
+*/
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "../common/modbus_frame.h"
+#include "../common/serial_port.h"
+
+using kb::now_ms;
+
+namespace {
+
+// ========================= Options =========================
+struct Read {
+  uint16_t addr;
+  uint16_t count;
+};
+
+struct Options {
+  const char *device = nullptr;
+  unsigned baud = 9600;
+  std::vector<uint8_t> ids = {1, 2, 3, 4};
+  std::string patternText = "block";
+  std::vector<Read> pattern;
+  uint8_t fc = 4;
+  std::vector<double> rates = {1, 2, 5, 10, 20, 0};   // sweeps/s, 0 = back to back
+  double duration_s = 10.0;                            // per rate step
+  double timeout_ms = 200.0;
+  double gap_ms = -1.0;                                // < 0: 3.5 characters, at least 1.75 ms
+  double maxLoss_pct = 0.0;
+  const char *csv = nullptr;
+};
+
+static constexpr uint16_t TOTAL_REG_COUNT = 59;     // monitor_firmware.cpp
+static constexpr uint16_t MAX_READ_IN_BUFFER = 29;  // 5 + 2 * 29 bytes fits the library's 64-byte buffer
+static constexpr double BITS_PER_CHAR = 10.0;       // 8N1
+static constexpr double SUSTAINED_FRACTION = 0.95;  // achieved / target for a step to count as kept up
+
+bool parse_list(const char *s, std::vector<double> &out) {
+  out.clear();
+  std::string text(s);
+  size_t pos = 0;
+  while (pos <= text.size()) {
+    const size_t comma = std::min(text.find(',', pos), text.size());
+    const std::string tok = text.substr(pos, comma - pos);
+    if (tok == "max") {
+      out.push_back(0.0);
+    } else {
+      char *end = nullptr;
+      const double v = strtod(tok.c_str(), &end);
+      if (end == tok.c_str() || *end != '\0' || v <= 0.0) return false;
+      out.push_back(v);
+    }
+    pos = comma + 1;
+  }
+  return !out.empty();
+}
+
+bool parse_pattern(const std::string &text, std::vector<Read> &out) {
+  out.clear();
+  size_t pos = 0;
+  while (pos <= text.size()) {
+    const size_t comma = std::min(text.find(',', pos), text.size());
+    const std::string tok = text.substr(pos, comma - pos);
+    if (tok == "block") {
+      out.push_back({0, 6});
+    } else if (tok == "single") {
+      for (uint16_t a = 0; a < 6; a++) out.push_back({a, 1});
+    } else if (tok == "ext") {
+      out.push_back({6, 29});
+      out.push_back({35, 24});
+    } else if (tok == "full") {
+      out.push_back({0, 29});
+      out.push_back({29, 29});
+      out.push_back({58, 1});
+    } else {
+      unsigned a, n;
+      char extra;
+      if (sscanf(tok.c_str(), "%u+%u%c", &a, &n, &extra) != 2 || n == 0 || n > 125 || a > 0xFFFF) return false;
+      out.push_back({(uint16_t)a, (uint16_t)n});
+    }
+    pos = comma + 1;
+  }
+  return !out.empty();
+}
+
+// ========================= Frames =========================
+size_t build_read(uint8_t *f, uint8_t id, uint8_t fc, const Read &r) {
+  f[0] = id;
+  f[1] = fc;
+  f[2] = (uint8_t)(r.addr >> 8);
+  f[3] = (uint8_t)r.addr;
+  f[4] = (uint8_t)(r.count >> 8);
+  f[5] = (uint8_t)r.count;
+  const uint16_t crc = kb::modbus_crc16(f, 6);
+  f[6] = (uint8_t)crc;
+  f[7] = (uint8_t)(crc >> 8);
+  return 8;
+}
+
+size_t reply_bytes(const Read &r) { return 5 + 2 * (size_t)r.count; }
+
+// ========================= Statistics =========================
+struct Step {
+  double target = 0.0;          // sweeps/s, 0 = back to back
+  double achieved = 0.0;
+  unsigned sweeps = 0;
+  unsigned requests = 0;
+  unsigned ok = 0;
+  unsigned timeouts = 0;        // no reply, or a reply cut short
+  unsigned crcErrors = 0;
+  unsigned exceptions = 0;      // well-formed exception replies
+  unsigned malformed = 0;       // wrong slave, function code or byte count
+  unsigned strayBytes = 0;      // bytes seen outside a transaction
+  std::vector<unsigned> timeoutsBySlave;   // indexed like Options::ids
+  std::vector<float> latency_ms;
+
+  unsigned lost() const { return timeouts + crcErrors + malformed; }
+  double loss_pct() const { return requests ? 100.0 * lost() / requests : 0.0; }
+  bool keptUp() const { return target <= 0.0 || achieved >= target * SUSTAINED_FRACTION; }
+
+  float percentile(double p) {
+    if (latency_ms.empty()) return 0.0f;
+    const size_t i = std::min(latency_ms.size() - 1, (size_t)(p / 100.0 * (double)latency_ms.size()));
+    std::nth_element(latency_ms.begin(), latency_ms.begin() + (long)i, latency_ms.end());
+    return latency_ms[i];
+  }
+};
+
+// ========================= Master =========================
+class Master {
+ public:
+  Master(int fd, const Options &o) : fd_(fd), opt_(o) {
+    charMs_ = BITS_PER_CHAR * 1000.0 / o.baud;
+    gapMs_ = o.gap_ms >= 0.0 ? o.gap_ms : std::max(3.5 * charMs_, 1.75);
+  }
+
+  double gap_ms() const { return gapMs_; }
+
+  // Time on the wire for one sweep: request and reply frames plus the silent intervals
+  double line_sweep_ms() const {
+    double ms = 0.0;
+    for (size_t i = 0; i < opt_.ids.size(); i++) {
+      for (const Read &r : opt_.pattern) ms += (8.0 + (double)reply_bytes(r)) * charMs_ + gapMs_;
+    }
+    return ms;
+  }
+
+  void run_step(Step &st) {
+    st.timeoutsBySlave.assign(opt_.ids.size(), 0);
+    const double t0 = now_ms();
+    const double end = t0 + opt_.duration_s * 1000.0;
+    double next = t0;
+    while (now_ms() < end) {
+      if (st.target > 0.0) {
+        wait_until(next, st);
+        next += 1000.0 / st.target;
+        // Behind schedule: start the next sweep now rather than bursting to catch up
+        if (next < now_ms()) next = now_ms();
+      }
+      for (size_t s = 0; s < opt_.ids.size(); s++) {
+        for (const Read &r : opt_.pattern) {
+          if (!transact(opt_.ids[s], r, st)) st.timeoutsBySlave[s]++;
+        }
+      }
+      st.sweeps++;
+    }
+    st.achieved = st.sweeps / ((now_ms() - t0) / 1000.0);
+  }
+
+ private:
+  // Idles until `t`, counting anything the bus delivers meanwhile as stray
+  void wait_until(double t, Step &st) {
+    for (;;) {
+      drain(st);
+      const double left = t - now_ms();
+      if (left <= 0.0) return;
+      struct pollfd p = {fd_, POLLIN, 0};
+      poll(&p, 1, (int)(left + 0.999));
+    }
+  }
+
+  void drain(Step &st) {
+    uint8_t buf[256];
+    ssize_t n;
+    while ((n = ::read(fd_, buf, sizeof(buf))) > 0) st.strayBytes += (unsigned)n;
+  }
+
+  // Returns false on a timeout
+  bool transact(uint8_t id, const Read &r, Step &st) {
+    uint8_t req[8];
+    const size_t reqLen = build_read(req, id, opt_.fc, r);
+    drain(st);
+    st.requests++;
+
+    const double sent = now_ms();
+    if (::write(fd_, req, reqLen) != (ssize_t)reqLen) {
+      fprintf(stderr, "loadgen: write: %s\n", strerror(errno));
+      exit(1);
+    }
+
+    // Read until the frame is complete: 5 + 2N bytes, or 5 for an exception
+    uint8_t rep[5 + 2 * 125];
+    size_t got = 0, want = reply_bytes(r);
+    const double deadline = sent + opt_.timeout_ms;
+    while (got < want) {
+      const double left = deadline - now_ms();
+      if (left <= 0.0) break;
+      struct pollfd p = {fd_, POLLIN, 0};
+      if (poll(&p, 1, (int)(left + 0.999)) <= 0) continue;
+      const ssize_t n = ::read(fd_, rep + got, want - got);
+      if (n <= 0) continue;
+      got += (size_t)n;
+      if (got >= 2 && (rep[1] & 0x80)) want = kb::MODBUS_EXCEPTION_BYTES;
+    }
+    const double done = now_ms();
+
+    if (got < want) {
+      st.timeouts++;
+    } else if (!kb::modbus_crc_ok(rep, want)) {
+      st.crcErrors++;
+    } else if (rep[0] != id || (rep[1] & 0x7F) != opt_.fc) {
+      st.malformed++;
+    } else if (rep[1] & 0x80) {
+      st.exceptions++;
+      st.latency_ms.push_back((float)(done - sent));
+    } else if (rep[2] != 2 * r.count) {
+      st.malformed++;
+    } else {
+      st.ok++;
+      st.latency_ms.push_back((float)(done - sent));
+    }
+
+    // Silent interval before the next request
+    const double quiet = done + gapMs_;
+    while (now_ms() < quiet) {
+      struct pollfd p = {fd_, POLLIN, 0};
+      if (poll(&p, 1, (int)(quiet - now_ms() + 0.999)) > 0) drain(st);
+    }
+    return got >= want;
+  }
+
+  int fd_;
+  const Options &opt_;
+  double charMs_;
+  double gapMs_;
+};
+
+// ========================= Report =========================
+std::string ids_text(const Options &o) {
+  std::string s;
+  for (uint8_t id : o.ids) s += (s.empty() ? "" : ",") + std::to_string(id);
+  return s;
+}
+
+void print_header() {
+  printf("%8s %9s %7s %7s %6s %5s %5s %5s %5s %7s %7s %7s %7s\n", "target", "achieved", "req", "ok",
+         "tmout", "crc", "exc", "bad", "stray", "p50", "p90", "p99", "max");
+}
+
+void print_step(const Options &opt, Step &st) {
+  char target[16];
+  if (st.target > 0.0) snprintf(target, sizeof(target), "%.1f", st.target);
+  else snprintf(target, sizeof(target), "max");
+  printf("%8s %9.2f %7u %7u %6u %5u %5u %5u %5u %7.1f %7.1f %7.1f %7.1f%s\n", target, st.achieved,
+         st.requests, st.ok, st.timeouts, st.crcErrors, st.exceptions, st.malformed, st.strayBytes,
+         st.percentile(50), st.percentile(90), st.percentile(99), st.percentile(100),
+         st.keptUp() ? "" : "  (behind)");
+  if (st.timeouts) {
+    printf("%8s timeouts by slave:", "");
+    for (size_t s = 0; s < opt.ids.size(); s++) printf(" %u:%u", opt.ids[s], st.timeoutsBySlave[s]);
+    printf("\n");
+  }
+  fflush(stdout);
+}
+
+void write_csv(const Options &o, std::vector<Step> &steps) {
+  FILE *f = fopen(o.csv, "a");
+  if (!f) {
+    fprintf(stderr, "loadgen: cannot open %s: %s\n", o.csv, strerror(errno));
+    return;
+  }
+  if (ftell(f) == 0) {
+    fprintf(f, "baud,ids,pattern,target,achieved,requests,ok,timeouts,crc,exceptions,malformed,stray,"
+               "p50_ms,p90_ms,p99_ms,max_ms\n");
+  }
+  for (Step &st : steps) {
+    fprintf(f, "%u,\"%s\",\"%s\",%.3f,%.3f,%u,%u,%u,%u,%u,%u,%u,%.2f,%.2f,%.2f,%.2f\n", o.baud,
+            ids_text(o).c_str(), o.patternText.c_str(), st.target, st.achieved, st.requests, st.ok,
+            st.timeouts, st.crcErrors, st.exceptions, st.malformed, st.strayBytes, st.percentile(50),
+            st.percentile(90), st.percentile(99), st.percentile(100));
+  }
+  fclose(f);
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: modbus_loadgen -p DEVICE [options]\n"
+          "  -p DEVICE        serial port or pty (e.g. /dev/ttyUSB0, a knob_box_sim --pty path)\n"
+          "  -b BAUD          line rate (default 9600)\n"
+          "  --ids LIST       slave addresses polled per sweep (default 1,2,3,4)\n"
+          "  --pattern LIST   block | single | ext | full | A+N, comma separated (default block)\n"
+          "  --fc 3|4         read holding or input registers (default 4)\n"
+          "  --rates LIST     sweeps/s per step, \"max\" = back to back (default 1,2,5,10,20,max)\n"
+          "  --duration S     seconds per step (default 10)\n"
+          "  --timeout MS     reply timeout (default 200)\n"
+          "  --gap MS         silence after each transaction (default 3.5 characters, >= 1.75 ms)\n"
+          "  --max-loss PCT   lost replies a sustainable step may have (default 0)\n"
+          "  --csv FILE       append one row per step\n");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options opt;
+  for (int i = 1; i < argc; i++) {
+    const std::string a = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (a == "-p" && hasValue) {
+      opt.device = argv[++i];
+    } else if (a == "-b" && hasValue) {
+      opt.baud = (unsigned)atoi(argv[++i]);
+    } else if (a == "--ids" && hasValue) {
+      std::vector<double> v;
+      if (!parse_list(argv[++i], v)) { usage(); return 2; }
+      opt.ids.clear();
+      for (double d : v) {
+        if (d < 1 || d > 247) { usage(); return 2; }
+        opt.ids.push_back((uint8_t)d);
+      }
+    } else if (a == "--pattern" && hasValue) {
+      opt.patternText = argv[++i];
+    } else if (a == "--fc" && hasValue) {
+      opt.fc = (uint8_t)atoi(argv[++i]);
+      if (opt.fc != 3 && opt.fc != 4) { usage(); return 2; }
+    } else if (a == "--rates" && hasValue) {
+      if (!parse_list(argv[++i], opt.rates)) { usage(); return 2; }
+    } else if (a == "--duration" && hasValue) {
+      opt.duration_s = atof(argv[++i]);
+    } else if (a == "--timeout" && hasValue) {
+      opt.timeout_ms = atof(argv[++i]);
+    } else if (a == "--gap" && hasValue) {
+      opt.gap_ms = atof(argv[++i]);
+    } else if (a == "--max-loss" && hasValue) {
+      opt.maxLoss_pct = atof(argv[++i]);
+    } else if (a == "--csv" && hasValue) {
+      opt.csv = argv[++i];
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  if (!opt.device || opt.duration_s <= 0.0 || opt.timeout_ms <= 0.0) {
+    usage();
+    return 2;
+  }
+  if (!parse_pattern(opt.patternText, opt.pattern)) {
+    fprintf(stderr, "loadgen: bad pattern \"%s\"\n", opt.patternText.c_str());
+    return 2;
+  }
+  for (const Read &r : opt.pattern) {
+    if (r.count > MAX_READ_IN_BUFFER) {
+      fprintf(stderr, "loadgen: warning: %u+%u would need a %zu-byte reply, past the ModbusRtu 64-byte buffer, and will be refused\n",
+              r.addr, r.count, reply_bytes(r));
+    }
+    if (r.addr + r.count > TOTAL_REG_COUNT) {
+      fprintf(stderr, "loadgen: warning: %u+%u runs past register %u and will be refused\n", r.addr, r.count,
+              TOTAL_REG_COUNT - 1);
+    }
+  }
+
+  const int fd = kb::open_serial("loadgen", opt.device, opt.baud);
+  if (fd < 0) return 1;
+  Master master(fd, opt);
+
+  const double lineMs = master.line_sweep_ms();
+  printf("%s at %u baud, slaves %s, pattern %s (%zu requests per sweep), FC%u\n", opt.device, opt.baud,
+         ids_text(opt).c_str(), opt.patternText.c_str(), opt.ids.size() * opt.pattern.size(), opt.fc);
+  printf("timeout %.0f ms, gap %.2f ms, %.0f s per step; latency in ms from request to last reply byte\n\n",
+         opt.timeout_ms, master.gap_ms(), opt.duration_s);
+  print_header();
+
+  std::vector<Step> steps;
+  for (double rate : opt.rates) {
+    steps.emplace_back();
+    steps.back().target = rate;
+    master.run_step(steps.back());
+    print_step(opt, steps.back());
+  }
+
+  double best = 0.0;
+  for (const Step &st : steps) {
+    if (st.keptUp() && st.loss_pct() <= opt.maxLoss_pct) best = std::max(best, st.achieved);
+  }
+  printf("\nmax sustainable: %.2f sweeps/s (%.1f requests/s)", best, best * (double)(opt.ids.size() * opt.pattern.size()));
+  printf("; line-rate bound %.2f sweeps/s\n", 1000.0 / lineMs);
+
+  if (opt.csv) write_csv(opt, steps);
+  close(fd);
+  return 0;
+}
@@ -0,0 +1,61 @@
+// Host build of the Adafruit ADS1115 driver: single-ended reads return the counts the
+// board model placed in mcu.adsCounts, and block for one 860 SPS conversion. The
+// non-blocking calls start a conversion and report it complete one conversion time later.
+#pragma once
+
+#include "Arduino.h"
+
+#define RATE_ADS1115_8SPS    (0x0000)
+#define RATE_ADS1115_128SPS  (0x0080)
+#define RATE_ADS1115_860SPS  (0x00E0)
+
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_0  (0x4000)
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_1  (0x5000)
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_2  (0x6000)
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_3  (0x7000)
+
+typedef enum {
+  GAIN_TWOTHIRDS = 0x0000,
+  GAIN_ONE = 0x0200,
+  GAIN_TWO = 0x0400,
+  GAIN_FOUR = 0x0600,
+  GAIN_EIGHT = 0x0800,
+  GAIN_SIXTEEN = 0x0A00
+} adsGain_t;
+
+namespace {
+
+class Adafruit_ADS1115 {
+ public:
+  bool begin(uint8_t = 0x48) { return true; }
+  void setDataRate(uint16_t rate) { rate_ = rate; }
+  void setGain(adsGain_t gain) { gain_ = gain; }
+  adsGain_t getGain() { return gain_; }
+  int16_t readADC_SingleEnded(uint8_t channel) {
+    ::host::spend(::host::COST_ADS_READ);
+    channel_ = channel & 3;
+    readyAt_ = ::host::mcu.now;
+    return (channel < 4) ? ::host::mcu.adsCounts[channel] : 0;
+  }
+  void startADCReading(uint16_t mux, bool /*continuous*/) {
+    ::host::spend(::host::COST_ADS_TRANSFER);
+    channel_ = (uint8_t)((mux >> 12) & 3);
+    readyAt_ = ::host::mcu.now + ::host::COST_ADS_CONVERT;
+  }
+  bool conversionComplete() {
+    ::host::spend(::host::COST_ADS_TRANSFER);
+    return ::host::mcu.now >= readyAt_;
+  }
+  int16_t getLastConversionResults() {
+    ::host::spend(::host::COST_ADS_TRANSFER);
+    return ::host::mcu.adsCounts[channel_];
+  }
+
+ private:
+  uint8_t channel_ = 0;
+  uint64_t readyAt_ = 0;
+  uint16_t rate_ = RATE_ADS1115_128SPS;
+  adsGain_t gain_ = GAIN_TWOTHIRDS;
+};
+
+}  // namespace
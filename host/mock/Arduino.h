@@ -0,0 +1,268 @@
+/*
+  Knob Box - host build of the Arduino core subset used by the firmware
+
+  Same names and signatures as the AVR core, backed by the MCU model in host_mcu.h.
+  Every call charges a rough cost to the virtual clock (see host_mcu.h).
+*/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "host_mcu.h"
+#include "avr/io.h"
+#include "avr/interrupt.h"
+#include "avr/pgmspace.h"
+
+// AVR-only attributes the firmware uses for its .init3 hook
+#define naked used
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define CHANGE  1
+#define FALLING 2
+#define RISING  3
+
+#define INPUT        0x0
+#define OUTPUT       0x1
+#define INPUT_PULLUP 0x2
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define A0 54
+#define A1 55
+#define A2 56
+#define A3 57
+#define A4 58
+#define A5 59
+#define A6 60
+#define A7 61
+
+typedef bool boolean;
+typedef uint8_t byte;
+typedef uint16_t word;
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+
+// ========================= Time =========================
+// millis() and micros() follow the virtual clock; micros() keeps the core's 4 us step.
+// Interrupts are otherwise taken between loop() passes, but an RX1 edge from before the
+// reading would already have run its handler on the board, so micros() takes those first.
+static inline uint32_t millis() {
+  ::host::mcu.clockRead = ::host::mcu.now;
+  return (uint32_t)(::host::mcu.now / (::host::CPU_HZ / 1000u));
+}
+static inline uint32_t micros() {
+  ::host::take_rx1_edges();
+  ::host::mcu.clockRead = ::host::mcu.now;
+  return (uint32_t)((::host::mcu.now / 64u) * 4u);
+}
+static inline void delay(uint32_t ms) { ::host::spend((uint64_t)ms * (::host::CPU_HZ / 1000u)); }
+static inline void delayMicroseconds(uint16_t us) { ::host::spend((uint64_t)us * ::host::CYCLES_PER_US); }
+
+// ========================= Digital / analog IO =========================
+static inline void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin >= 70) return;
+  ::host::Gpio& g = ::host::mcu.gpio[::host::PIN_PORT[pin]];
+  const uint8_t bit = (uint8_t)_BV(::host::PIN_BIT[pin]);
+  if (mode == OUTPUT) {
+    g.ddr |= bit;
+  } else {
+    g.ddr &= (uint8_t)~bit;
+    if (mode == INPUT_PULLUP) g.port |= bit; else g.port &= (uint8_t)~bit;
+  }
+  ::host::spend(::host::COST_DIGITAL_IO);
+}
+
+static inline void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin >= 70) return;
+  ::host::Gpio& g = ::host::mcu.gpio[::host::PIN_PORT[pin]];
+  const uint8_t bit = (uint8_t)_BV(::host::PIN_BIT[pin]);
+  if (val == LOW) g.port &= (uint8_t)~bit; else g.port |= bit;
+  ::host::spend(::host::COST_DIGITAL_IO);
+}
+
+static inline int digitalRead(uint8_t pin) {
+  if (pin >= 70) return LOW;
+  ::host::spend(::host::COST_DIGITAL_IO);
+  return (::host::gpio_levels(::host::mcu.gpio[::host::PIN_PORT[pin]]) >> ::host::PIN_BIT[pin]) & 1;
+}
+
+static inline int analogRead(uint8_t pin) {
+  const uint8_t ch = (pin >= A0) ? (uint8_t)(pin - A0) : pin;
+  ::host::spend(::host::COST_ANALOG_READ);
+  return (ch < 16) ? (::host::mcu.analog[ch] & 0x3FF) : 0;
+}
+
+// ========================= External interrupts =========================
+// Numbered as on the Mega: 0-1 on D2-D3, 2-5 on D21-D18
+#define NOT_AN_INTERRUPT -1
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : ((p) >= 18 && (p) <= 21 ? 23 - (p) : NOT_AN_INTERRUPT)))
+
+static inline void attachInterrupt(uint8_t n, void (*fn)(), int mode) {
+  if (n >= ::host::EXT_INT_COUNT) return;
+  ::host::mcu.extInt[n] = fn;
+  ::host::mcu.extIntMode[n] = (uint8_t)mode;
+  ::host::mcu.extIntSince[n] = ::host::mcu.now;
+}
+
+static inline void detachInterrupt(uint8_t n) {
+  if (n < ::host::EXT_INT_COUNT) ::host::mcu.extInt[n] = nullptr;
+}
+
+// ========================= avr-libc extras =========================
+static inline char *dtostrf(double val, signed char width, unsigned char prec, char *s) {
+  sprintf(s, "%*.*f", (int)width, (int)prec, val);
+  return s;
+}
+
+// ========================= Print / Stream =========================
+// The byte interface of the Arduino core's Print and Stream, for libraries that take a
+// Stream& and for firmware that implements one.
+// Internal linkage, like everything in host_mcu.h: each image TU gets its own copy bound to its own MCU
+namespace {
+
+class Print {
+ public:
+  virtual ~Print() = default;
+  virtual size_t write(uint8_t b) = 0;
+  virtual size_t write(const uint8_t *buf, size_t len) {
+    size_t n = 0;
+    while (len--) n += write(*buf++);
+    return n;
+  }
+  virtual void flush() {}
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
+
+// ========================= HardwareSerial =========================
+// A handle on one of the MCU's USARTs. In core mode the USART behaves like the Arduino
+// driver: 64-byte receive ring filled as bytes arrive, transmit blocking once more than
+// a buffer's worth is queued.
+class HardwareSerial : public Stream {
+ public:
+  explicit HardwareSerial(uint8_t n) : n_(n) {}
+
+  void begin(unsigned long baud, uint8_t = 0) {
+    ::host::Usart& u = usart();
+    const uint32_t setting = (uint32_t)((::host::CPU_HZ / 4 / baud - 1) / 2);   // U2X, as the core
+    u.coreMode = true;
+    u.coreBitCycles = 8 * (setting + 1);
+    u.rxHead = u.rxTail = 0;
+    u.shiftFreeAt = u.udrFreeAt = ::host::mcu.now;
+  }
+  void end() { usart().coreMode = false; }
+
+  int available() override {
+    ::host::Usart& u = usart();
+    ::host::usart_pump_core(u);
+    return (int)((sizeof(u.rxRing) + u.rxHead - u.rxTail) % sizeof(u.rxRing));
+  }
+  int peek() override {
+    ::host::Usart& u = usart();
+    ::host::usart_pump_core(u);
+    return (u.rxHead == u.rxTail) ? -1 : u.rxRing[u.rxTail];
+  }
+  int read() override {
+    ::host::Usart& u = usart();
+    ::host::usart_pump_core(u);
+    if (u.rxHead == u.rxTail) return -1;
+    const uint8_t b = u.rxRing[u.rxTail];
+    u.rxTail = (uint8_t)((u.rxTail + 1) % sizeof(u.rxRing));
+    return b;
+  }
+  int availableForWrite() {
+    ::host::Usart& u = usart();
+    const uint64_t chr = ::host::usart_char_cycles(u);
+    const uint64_t queued = (u.shiftFreeAt > ::host::mcu.now) ? (u.shiftFreeAt - ::host::mcu.now + chr - 1) / chr : 0;
+    return (queued >= 63) ? 0 : (int)(63 - queued);
+  }
+
+  size_t write(uint8_t b) override {
+    ::host::Usart& u = usart();
+    const uint64_t chr = ::host::usart_char_cycles(u);
+    if (u.shiftFreeAt > ::host::mcu.now + 64 * chr) {
+      ::host::mcu.now = u.shiftFreeAt - 64 * chr;          // wait for ring space
+    }
+    ::host::usart_transmit(u, b);
+    return 1;
+  }
+  size_t write(const uint8_t *buf, size_t len) override {
+    for (size_t i = 0; i < len; i++) write(buf[i]);
+    return len;
+  }
+  size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+
+  // Waits until the last byte has left the shift register
+  void flush() override {
+    ::host::Usart& u = usart();
+    if (u.shiftFreeAt > ::host::mcu.now) ::host::mcu.now = u.shiftFreeAt;
+  }
+
+  size_t print(const char *s) { return write(s); }
+  size_t print(const __FlashStringHelper *s) { return write((const char *)s); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t print(int n, int base = DEC) { return print((long)n, base); }
+  size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t print(long n, int base = DEC) {
+    if (base == DEC) return printf_("%ld", n);
+    return print((unsigned long)n, base);
+  }
+  size_t print(unsigned long n, int base = DEC) {
+    char buf[8 * sizeof(long) + 1];
+    char *p = &buf[sizeof(buf) - 1];
+    *p = '\0';
+    if (base < 2) base = 10;
+    do {
+      const unsigned d = (unsigned)(n % (unsigned long)base);
+      *--p = (char)(d < 10 ? '0' + d : 'A' + d - 10);
+      n /= (unsigned long)base;
+    } while (n);
+    return write(p);
+  }
+  size_t print(double n, int digits = 2) { return printf_("%.*f", digits, n); }
+
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(T v) { const size_t n = print(v); return n + println(); }
+  template <typename T> size_t println(T v, int f) { const size_t n = print(v, f); return n + println(); }
+
+  operator bool() const { return true; }
+
+ private:
+  ::host::Usart& usart() const { return ::host::mcu.usart[n_]; }
+
+  template <typename... A>
+  size_t printf_(const char *fmt, A... a) {
+    char buf[40];
+    snprintf(buf, sizeof(buf), fmt, a...);
+    return write(buf);
+  }
+
+  uint8_t n_;
+};
+
+HardwareSerial Serial(0);
+HardwareSerial Serial1(1);
+HardwareSerial Serial2(2);
+HardwareSerial Serial3(3);
+}  // namespace
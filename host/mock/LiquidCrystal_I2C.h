@@ -0,0 +1,46 @@
+// Host build of LiquidCrystal_I2C: text lands in mcu.lcdText, each character costs
+// one I2C transfer on the virtual clock.
+#pragma once
+
+#include "Arduino.h"
+
+namespace {
+
+class LiquidCrystal_I2C {
+ public:
+  LiquidCrystal_I2C(uint8_t, uint8_t cols, uint8_t rows) : cols_(cols), rows_(rows) {}
+  void init() { clear(); }
+  void begin() { clear(); }
+  void backlight() {}
+  void noBacklight() {}
+  void clear() {
+    memset(::host::mcu.lcdText, ' ', sizeof(::host::mcu.lcdText));
+    for (auto& row : ::host::mcu.lcdText) row[20] = '\0';
+    ::host::mcu.lcdCol = ::host::mcu.lcdRow = 0;
+    ::host::spend(::host::COST_LCD_COMMAND);
+  }
+  void setCursor(uint8_t col, uint8_t row) {
+    ::host::mcu.lcdCol = col;
+    ::host::mcu.lcdRow = (row < 4) ? row : 3;
+    ::host::spend(::host::COST_LCD_CHAR);
+  }
+  size_t write(uint8_t c) {
+    uint8_t& col = ::host::mcu.lcdCol;
+    if (col < cols_ && col < 20 && ::host::mcu.lcdRow < rows_) {
+      ::host::mcu.lcdText[::host::mcu.lcdRow][col] = (char)c;
+    }
+    col++;
+    ::host::spend(::host::COST_LCD_CHAR);
+    return 1;
+  }
+  size_t print(const char *s) {
+    size_t n = 0;
+    while (*s) n += write((uint8_t)*s++);
+    return n;
+  }
+
+ private:
+  uint8_t cols_, rows_;
+};
+
+}  // namespace
@@ -0,0 +1,331 @@
+/*
+  Knob Box - host build of the ModbusRtu slave (smarmengol/Modbus-Master-Slave-for-Arduino)
+
+  Slave side only, written to behave like the library the monitors are built with:
+    - poll() waits for T35 (5 ms) of silence after the last received byte, then takes
+      whatever its Stream has available as one frame
+    - returns 0 for no frame or another slave's ID, the frame length (1-6) for a frame
+      shorter than 7 bytes, -1 (NO_REPLY) for a bad CRC, -3 for a ring overflow,
+      1-4 for an exception reply, and the reply length for a served request
+    - the address range check truncates (start + count) to 8 bits, as the library does
+    - sendTxBuffer() drives the DE pin, blocks until the reply has left the UART and
+      then discards everything received meanwhile
+
+  Where the library would run past its 64-byte buffer or the register array, the host
+  build stays in bounds and counts the event in hostBufferOverruns / hostOutOfRange.
+*/
+#pragma once
+
+#include "Arduino.h"
+
+#define T35 5
+#define MAX_BUFFER 64
+
+enum {
+  MB_FC_NONE = 0,
+  MB_FC_READ_COILS = 1,
+  MB_FC_READ_DISCRETE_INPUT = 2,
+  MB_FC_READ_REGISTERS = 3,
+  MB_FC_READ_INPUT_REGISTER = 4,
+  MB_FC_WRITE_COIL = 5,
+  MB_FC_WRITE_REGISTER = 6,
+  MB_FC_WRITE_MULTIPLE_COILS = 15,
+  MB_FC_WRITE_MULTIPLE_REGISTERS = 16
+};
+
+enum {
+  ERR_NOT_MASTER = -1,
+  ERR_POLLING = -2,
+  ERR_BUFF_OVERFLOW = -3,
+  ERR_BAD_CRC = -4,
+  ERR_EXCEPTION = -5
+};
+
+enum {
+  NO_REPLY = 255,
+  EXC_FUNC_CODE = 1,
+  EXC_ADDR_RANGE = 2,
+  EXC_REGS_QUANT = 3,
+  EXC_EXECUTE = 4
+};
+
+namespace {
+
+class Modbus {
+ public:
+  Modbus(uint8_t u8id, Stream& port, uint8_t u8txenpin)
+      : u8id_(u8id), port_(&port), u8txenpin_(u8txenpin) {}
+
+  void start() {
+    if (u8txenpin_ > 1) {
+      pinMode(u8txenpin_, OUTPUT);
+      digitalWrite(u8txenpin_, LOW);
+    }
+    while (port_->read() >= 0) {}
+    u8lastRec_ = 0;
+    u16InCnt_ = u16OutCnt_ = u16errCnt_ = 0;
+  }
+
+  int8_t poll(uint16_t *regs, uint8_t u8size) {
+    regs_ = regs;
+    u8regsize_ = u8size;
+
+    const uint8_t u8current = (uint8_t)port_->available();
+    if (u8current == 0) return 0;
+
+    // wait for T35 of silence after the last byte
+    if (u8current != u8lastRec_) {
+      u8lastRec_ = u8current;
+      u32time_ = millis();
+      return 0;
+    }
+    if ((uint32_t)(millis() - u32time_) < (uint32_t)T35) return 0;
+
+    u8lastRec_ = 0;
+    const int8_t i8state = getRxBuffer();
+    u8lastError_ = (uint8_t)i8state;
+    if (i8state < 7) return i8state;
+
+    if (au8Buffer_[0] != u8id_) return 0;
+
+    const uint8_t u8exception = validateRequest();
+    if (u8exception > 0) {
+      if (u8exception != NO_REPLY) {
+        buildException(u8exception);
+        sendTxBuffer();
+      }
+      u8lastError_ = u8exception;
+      return (int8_t)u8exception;
+    }
+
+    u8lastError_ = 0;
+    switch (au8Buffer_[1]) {
+      case MB_FC_READ_COILS:
+      case MB_FC_READ_DISCRETE_INPUT:
+        return process_FC1();
+      case MB_FC_READ_INPUT_REGISTER:
+      case MB_FC_READ_REGISTERS:
+        return process_FC3();
+      case MB_FC_WRITE_COIL:
+        return process_FC5();
+      case MB_FC_WRITE_REGISTER:
+        return process_FC6();
+      case MB_FC_WRITE_MULTIPLE_COILS:
+        return process_FC15();
+      case MB_FC_WRITE_MULTIPLE_REGISTERS:
+        return process_FC16();
+      default:
+        break;
+    }
+    return i8state;
+  }
+
+  uint8_t getID() const { return u8id_; }
+  void setID(uint8_t id) { if (id != 0 && id <= 247) u8id_ = id; }
+  uint16_t getInCnt() const { return u16InCnt_; }
+  uint16_t getOutCnt() const { return u16OutCnt_; }
+  uint16_t getErrCnt() const { return u16errCnt_; }
+  uint8_t getLastError() const { return u8lastError_; }
+
+  // Host diagnostics: places where the AVR library would leave its buffers
+  uint32_t hostBufferOverruns = 0;
+  uint32_t hostOutOfRange = 0;
+
+ private:
+  static constexpr uint8_t HOST_BUFFER = 255;
+
+  static uint16_t word_(uint8_t h, uint8_t l) { return (uint16_t)((h << 8) | l); }
+
+  uint16_t reg(uint16_t i) {
+    if (i >= u8regsize_) { hostOutOfRange++; return 0; }
+    return regs_[i];
+  }
+  void setReg(uint16_t i, uint16_t v) {
+    if (i >= u8regsize_) { hostOutOfRange++; return; }
+    regs_[i] = v;
+  }
+  void put(uint8_t v) {
+    if (u8BufferSize_ >= MAX_BUFFER) hostBufferOverruns++;
+    if (u8BufferSize_ < HOST_BUFFER) au8Buffer_[u8BufferSize_++] = v;
+  }
+
+  int8_t getRxBuffer() {
+    bool overflow = false;
+    if (u8txenpin_ > 1) digitalWrite(u8txenpin_, LOW);
+    u8BufferSize_ = 0;
+    while (port_->available()) {
+      const uint8_t b = (uint8_t)port_->read();
+      if (u8BufferSize_ < MAX_BUFFER) au8Buffer_[u8BufferSize_] = b; else hostBufferOverruns++;
+      u8BufferSize_++;
+      if (u8BufferSize_ >= MAX_BUFFER) overflow = true;
+    }
+    u16InCnt_++;
+    if (overflow) {
+      u16errCnt_++;
+      return ERR_BUFF_OVERFLOW;
+    }
+    return (int8_t)u8BufferSize_;
+  }
+
+  uint16_t calcCRC(uint8_t len) const {
+    uint16_t crc = 0xFFFF;
+    for (uint8_t i = 0; i < len; i++) {
+      crc ^= au8Buffer_[i];
+      for (uint8_t j = 0; j < 8; j++) crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0xA001) : (uint16_t)(crc >> 1);
+    }
+    return (uint16_t)((crc << 8) | (crc >> 8));           // low byte first on the wire
+  }
+
+  uint8_t validateRequest() {
+    const uint16_t msgCrc = word_(au8Buffer_[u8BufferSize_ - 2], au8Buffer_[u8BufferSize_ - 1]);
+    if (calcCRC((uint8_t)(u8BufferSize_ - 2)) != msgCrc) {
+      u16errCnt_++;
+      return NO_REPLY;
+    }
+
+    const uint8_t fc = au8Buffer_[1];
+    if (fc != 1 && fc != 2 && fc != 3 && fc != 4 && fc != 5 && fc != 6 && fc != 15 && fc != 16) {
+      u16errCnt_++;
+      return EXC_FUNC_CODE;
+    }
+
+    uint16_t u16regs = 0;
+    switch (fc) {
+      case MB_FC_READ_COILS:
+      case MB_FC_READ_DISCRETE_INPUT:
+      case MB_FC_WRITE_MULTIPLE_COILS:
+        u16regs = (uint16_t)(word_(au8Buffer_[2], au8Buffer_[3]) / 16 + word_(au8Buffer_[4], au8Buffer_[5]) / 16);
+        break;
+      case MB_FC_WRITE_COIL:
+        u16regs = (uint16_t)(word_(au8Buffer_[2], au8Buffer_[3]) / 16);
+        break;
+      case MB_FC_WRITE_REGISTER:
+        u16regs = word_(au8Buffer_[2], au8Buffer_[3]);
+        break;
+      default:
+        u16regs = (uint16_t)(word_(au8Buffer_[2], au8Buffer_[3]) + word_(au8Buffer_[4], au8Buffer_[5]));
+        break;
+    }
+    if ((uint8_t)u16regs > u8regsize_) return EXC_ADDR_RANGE;   // 8-bit, as the library
+    return 0;
+  }
+
+  void buildException(uint8_t exc) {
+    const uint8_t fc = au8Buffer_[1];
+    au8Buffer_[0] = u8id_;
+    au8Buffer_[1] = (uint8_t)(fc + 0x80);
+    au8Buffer_[2] = exc;
+    u8BufferSize_ = 3;
+  }
+
+  void sendTxBuffer() {
+    const uint16_t crc = calcCRC(u8BufferSize_);
+    put((uint8_t)(crc >> 8));
+    put((uint8_t)(crc & 0xFF));
+    if (u8txenpin_ > 1) digitalWrite(u8txenpin_, HIGH);
+    port_->write(au8Buffer_, u8BufferSize_);
+    if (u8txenpin_ > 1) {
+      port_->flush();
+      digitalWrite(u8txenpin_, LOW);
+    }
+    while (port_->read() >= 0) {}
+    u16OutCnt_++;
+  }
+
+  int8_t process_FC1() {
+    const uint16_t start = word_(au8Buffer_[2], au8Buffer_[3]);
+    const uint16_t count = word_(au8Buffer_[4], au8Buffer_[5]);
+    const uint8_t bytes = (uint8_t)((count + 7) / 8);
+    au8Buffer_[2] = bytes;
+    u8BufferSize_ = 3;
+    for (uint8_t i = 0; i < bytes; i++) put(0);
+    for (uint16_t n = 0; n < count; n++) {
+      const uint16_t c = (uint16_t)(start + n);
+      if (reg((uint16_t)(c / 16)) & (1u << (c % 16))) {
+        const uint16_t at = (uint16_t)(3 + n / 8);
+        if (at < HOST_BUFFER) au8Buffer_[at] |= (uint8_t)(1u << (n % 8));
+      }
+    }
+    const uint8_t len = (uint8_t)(u8BufferSize_ + 2);
+    sendTxBuffer();
+    return (int8_t)len;
+  }
+
+  int8_t process_FC3() {
+    const uint8_t start = (uint8_t)word_(au8Buffer_[2], au8Buffer_[3]);
+    const uint8_t count = (uint8_t)word_(au8Buffer_[4], au8Buffer_[5]);
+    au8Buffer_[2] = (uint8_t)(count * 2);
+    u8BufferSize_ = 3;
+    for (uint16_t i = start; i < (uint16_t)(start + count); i++) {
+      const uint16_t v = reg(i);
+      put((uint8_t)(v >> 8));
+      put((uint8_t)(v & 0xFF));
+    }
+    const uint8_t len = (uint8_t)(u8BufferSize_ + 2);
+    sendTxBuffer();
+    return (int8_t)len;
+  }
+
+  int8_t process_FC5() {
+    const uint16_t c = word_(au8Buffer_[2], au8Buffer_[3]);
+    const uint16_t mask = (uint16_t)(1u << (c % 16));
+    const uint16_t v = reg((uint16_t)(c / 16));
+    setReg((uint16_t)(c / 16), (au8Buffer_[4] == 0xFF) ? (uint16_t)(v | mask) : (uint16_t)(v & ~mask));
+    u8BufferSize_ = 6;
+    sendTxBuffer();
+    return 8;
+  }
+
+  int8_t process_FC6() {
+    const uint8_t add = (uint8_t)word_(au8Buffer_[2], au8Buffer_[3]);
+    setReg(add, word_(au8Buffer_[4], au8Buffer_[5]));
+    u8BufferSize_ = 6;
+    sendTxBuffer();
+    return 8;
+  }
+
+  int8_t process_FC15() {
+    const uint16_t start = word_(au8Buffer_[2], au8Buffer_[3]);
+    const uint16_t count = word_(au8Buffer_[4], au8Buffer_[5]);
+    for (uint16_t n = 0; n < count; n++) {
+      const uint16_t at = (uint16_t)(7 + n / 8);
+      const bool on = (at < u8BufferSize_) && (au8Buffer_[at] & (1u << (n % 8)));
+      const uint16_t c = (uint16_t)(start + n);
+      const uint16_t mask = (uint16_t)(1u << (c % 16));
+      const uint16_t v = reg((uint16_t)(c / 16));
+      setReg((uint16_t)(c / 16), on ? (uint16_t)(v | mask) : (uint16_t)(v & ~mask));
+    }
+    u8BufferSize_ = 6;
+    sendTxBuffer();
+    return 8;
+  }
+
+  int8_t process_FC16() {
+    const uint8_t start = (uint8_t)word_(au8Buffer_[2], au8Buffer_[3]);
+    const uint8_t count = (uint8_t)word_(au8Buffer_[4], au8Buffer_[5]);
+    for (uint8_t i = 0; i < count; i++) {
+      const uint16_t at = (uint16_t)(7 + i * 2);
+      const uint16_t v = (at + 1 < MAX_BUFFER) ? word_(au8Buffer_[at], au8Buffer_[at + 1]) : 0;
+      setReg((uint16_t)(start + i), v);
+    }
+    au8Buffer_[4] = 0;
+    au8Buffer_[5] = count;
+    u8BufferSize_ = 6;
+    sendTxBuffer();
+    return 8;
+  }
+
+  uint8_t u8id_;
+  Stream *port_;
+  uint8_t u8txenpin_;
+  uint8_t au8Buffer_[HOST_BUFFER] = {};
+  uint8_t u8BufferSize_ = 0;
+  uint8_t u8lastRec_ = 0;
+  uint8_t u8lastError_ = 0;
+  uint32_t u32time_ = 0;
+  uint16_t *regs_ = nullptr;
+  uint8_t u8regsize_ = 0;
+  uint16_t u16InCnt_ = 0, u16OutCnt_ = 0, u16errCnt_ = 0;
+};
+
+}  // namespace
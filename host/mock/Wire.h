@@ -0,0 +1,15 @@
+// Host build of <Wire.h>: the I2C devices are modelled by their own libraries.
+#pragma once
+
+#include "Arduino.h"
+
+namespace {
+
+class TwoWire {
+ public:
+  void begin() {}
+  void setClock(uint32_t) {}
+};
+
+TwoWire Wire;
+}  // namespace
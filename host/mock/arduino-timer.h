@@ -0,0 +1,52 @@
+// Host build of arduino-timer: same expiry rule as Timer::tick() in the library (a task
+// runs once `time_func() - start >= expires`, and repeats from the time it ran).
+#pragma once
+
+#include "Arduino.h"
+
+namespace {
+
+template <size_t max_tasks = 16, uint32_t (*time_func)() = millis>
+class Timer {
+ public:
+  typedef bool (*handler_t)();
+
+  bool every(uint32_t interval, handler_t h) { return add(interval, h, true); }
+  bool in(uint32_t delay, handler_t h) { return add(delay, h, false); }
+
+  void tick() {
+    for (Task& t : tasks_) {
+      if (!t.handler) continue;
+      const uint32_t now = time_func();
+      if ((uint32_t)(now - t.start) >= t.expires) {
+        const bool again = t.handler() && t.repeat;
+        if (again) t.start = now; else t.handler = nullptr;
+      }
+    }
+  }
+
+ private:
+  struct Task {
+    handler_t handler = nullptr;
+    uint32_t start = 0;
+    uint32_t expires = 0;
+    bool repeat = false;
+  };
+
+  bool add(uint32_t expires, handler_t h, bool repeat) {
+    for (Task& t : tasks_) {
+      if (!t.handler) {
+        t.handler = h;
+        t.start = time_func();
+        t.expires = expires;
+        t.repeat = repeat;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  Task tasks_[max_tasks];
+};
+
+}  // namespace
@@ -0,0 +1,7 @@
+// Host build of <avr/interrupt.h>: ISR() is defined with the register model.
+#pragma once
+
+#include "io.h"
+
+static inline void cli() { SREG &= (uint8_t)0x7F; }
+static inline void sei() { SREG |= (uint8_t)0x80; }
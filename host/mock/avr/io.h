@@ -0,0 +1,167 @@
+// Host build of <avr/io.h> for the ATmega2560: bit names plus the register model.
+#pragma once
+
+#include "../host_mcu.h"
+
+#define _BV(bit) (1u << (bit))
+
+#define PA0 0
+#define PA1 1
+#define PA2 2
+#define PA3 3
+#define PA4 4
+#define PA5 5
+#define PA6 6
+#define PA7 7
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+#define PB6 6
+#define PB7 7
+#define PC0 0
+#define PC1 1
+#define PC2 2
+#define PC3 3
+#define PC4 4
+#define PC5 5
+#define PC6 6
+#define PC7 7
+#define PD0 0
+#define PD1 1
+#define PD2 2
+#define PD3 3
+#define PD4 4
+#define PD5 5
+#define PD6 6
+#define PD7 7
+#define PE0 0
+#define PE1 1
+#define PE2 2
+#define PE3 3
+#define PE4 4
+#define PE5 5
+#define PE6 6
+#define PE7 7
+#define PF0 0
+#define PF1 1
+#define PF2 2
+#define PF3 3
+#define PF4 4
+#define PF5 5
+#define PF6 6
+#define PF7 7
+#define PG0 0
+#define PG1 1
+#define PG2 2
+#define PG3 3
+#define PG4 4
+#define PG5 5
+#define PG6 6
+#define PG7 7
+#define PH0 0
+#define PH1 1
+#define PH2 2
+#define PH3 3
+#define PH4 4
+#define PH5 5
+#define PH6 6
+#define PH7 7
+#define PJ0 0
+#define PJ1 1
+#define PJ2 2
+#define PJ3 3
+#define PJ4 4
+#define PJ5 5
+#define PJ6 6
+#define PJ7 7
+#define PK0 0
+#define PK1 1
+#define PK2 2
+#define PK3 3
+#define PK4 4
+#define PK5 5
+#define PK6 6
+#define PK7 7
+#define PL0 0
+#define PL1 1
+#define PL2 2
+#define PL3 3
+#define PL4 4
+#define PL5 5
+#define PL6 6
+#define PL7 7
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define WGM12 3
+#define WGM13 4
+#define OCIE1A 1
+#define OCIE1B 2
+#define OCIE1C 3
+#define TOIE1 0
+#define OCF1A 1
+#define OCF1B 2
+#define OCF1C 3
+#define TOV1 0
+#define CS50 0
+#define CS51 1
+#define CS52 2
+#define TOIE5 0
+#define TOV5 0
+#define RXEN0 4
+#define TXEN0 3
+#define UDRIE0 5
+#define RXCIE0 7
+#define TXCIE0 6
+#define U2X0 1
+#define UDRE0 5
+#define UCSZ00 1
+#define UCSZ01 2
+#define RXC0 7
+#define TXC0 6
+#define FE0 4
+#define DOR0 3
+#define RXEN1 4
+#define TXEN1 3
+#define UDRIE1 5
+#define RXCIE1 7
+#define U2X1 1
+#define UDRE1 5
+#define UCSZ10 1
+#define UCSZ11 2
+#define TXC1 6
+#define RXEN3 4
+#define TXEN3 3
+#define UDRIE3 5
+#define RXCIE3 7
+#define U2X3 1
+#define UDRE3 5
+#define UCSZ30 1
+#define UCSZ31 2
+#define RXC3 7
+#define FE3 4
+#define DOR3 3
+#define UPE3 2
+#define RXEN2 4
+#define TXEN2 3
+#define UDRIE2 5
+#define RXCIE2 7
+#define U2X2 1
+#define UDRE2 5
+#define UCSZ20 1
+#define UCSZ21 2
+#define FE2 4
+#define DOR2 3
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define WGM21 1
+#define OCIE2A 1
+#define OCF2A 1
+#define PORF 0
+#define EXTRF 1
+#define BORF 2
+#define WDRF 3
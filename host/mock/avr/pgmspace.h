@@ -0,0 +1,10 @@
+// Host build of <avr/pgmspace.h>: flash and RAM are the same address space.
+#pragma once
+
+#include <stdint.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
@@ -0,0 +1,580 @@
+/*
+  Knob Box - host model of the ATmega2560 peripherals used by the firmware
+
+  Everything here has internal linkage (unnamed namespace), so every translation unit that
+  includes it gets its own MCU: one firmware image per TU, several images per process.
+
+  Time is a per-MCU cycle count at 16 MHz. It only moves when the firmware spends it:
+  loop() passes, delay(), and the rough costs charged by the mocked Arduino calls below.
+  Interrupts are taken between loop() passes, each at its own timestamp, in time order.
+
+  Modelled:
+    - GPIO ports A-L (PORT/DDR/PIN, PIN write-to-toggle, pull-ups, external drive)
+    - Timer1 free-running count with compare A/B/C flags and interrupts
+    - Timer5 counting external edges on T5 (PL2)
+    - USART0-3 by register (UDR/UDRE/RX interrupts) and through HardwareSerial
+    - attachInterrupt() on D19 (RX1, INT2), fired by the start-bit edge of each byte received
+      on USART1; the other edges inside a byte are not modelled
+    - SREG I-bit, MCUSR, watchdog timeout
+    - ADS1115 channels, analogRead() inputs and the 20x4 LCD text
+*/
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <deque>
+#include <functional>
+#include <utility>
+
+namespace host {
+namespace {
+
+static constexpr uint32_t CPU_HZ = 16000000UL;
+static constexpr uint64_t CYCLES_PER_US = CPU_HZ / 1000000UL;
+
+// Rough costs charged to the virtual clock, in cycles. They only need to be the right
+// order of magnitude: they decide how long a loop() pass with LCD or ADC work blocks
+// Modbus and the status link.
+static constexpr uint64_t COST_DIGITAL_IO   = 4 * CYCLES_PER_US;      // digitalRead/Write, pinMode
+static constexpr uint64_t COST_ANALOG_READ  = 112 * CYCLES_PER_US;    // 13 ADC clocks at 125 kHz
+static constexpr uint64_t COST_ADS_CONVERT  = 1160 * CYCLES_PER_US;   // one 860 SPS conversion
+static constexpr uint64_t COST_ADS_TRANSFER = 170 * CYCLES_PER_US;    // one register write or read over I2C
+static constexpr uint64_t COST_ADS_READ     = COST_ADS_CONVERT + 2 * COST_ADS_TRANSFER;  // single shot, blocking
+static constexpr uint64_t COST_LCD_CHAR     = 450 * CYCLES_PER_US;    // PCF8574 backpack at 100 kHz
+static constexpr uint64_t COST_LCD_COMMAND  = 2000 * CYCLES_PER_US;   // clear / home
+static constexpr uint64_t COST_ISR          = 2 * CYCLES_PER_US;      // entry, body, reti
+
+static constexpr uint8_t EXT_INT_COUNT = 6;     // attachInterrupt() numbers on the Mega
+static constexpr uint8_t RX1_EXT_INT = 4;       // D19 (RX1, INT2)
+static constexpr uint8_t EXT_INT_CHANGE = 1, EXT_INT_FALLING = 2;   // as Arduino.h's CHANGE / FALLING
+
+enum Vector : uint8_t {
+  VEC_TIMER1_COMPA_vect, VEC_TIMER1_COMPB_vect, VEC_TIMER1_COMPC_vect,
+  VEC_USART0_RX_vect, VEC_USART0_UDRE_vect,
+  VEC_USART1_RX_vect, VEC_USART1_UDRE_vect,
+  VEC_USART2_RX_vect, VEC_USART2_UDRE_vect,
+  VEC_USART3_RX_vect, VEC_USART3_UDRE_vect,
+  VEC_COUNT
+};
+
+// ========================= Registers =========================
+// An 8/16-bit register with optional read/write hooks, so PINx, TIFRx, TCNT1 and UDRn
+// can keep their hardware side effects while firmware uses them like plain variables.
+template <typename T>
+struct Reg {
+  T v = 0;
+  T (*rd)(const Reg&) = nullptr;
+  void (*wr)(Reg&, T) = nullptr;
+  uint8_t tag = 0;                       // port or channel index for the hooks
+
+  Reg() = default;
+  Reg(const Reg&) = delete;
+  operator T() const { return rd ? rd(*this) : v; }
+  Reg& operator=(T x) { if (wr) wr(*this, x); else v = x; return *this; }
+  Reg& operator=(const Reg& o) { return *this = (T)o; }
+  Reg& operator|=(T x) { return *this = (T)((T)*this | x); }
+  Reg& operator&=(T x) { return *this = (T)((T)*this & x); }
+  Reg& operator^=(T x) { return *this = (T)((T)*this ^ x); }
+  Reg& operator+=(T x) { return *this = (T)((T)*this + x); }
+};
+using Reg8 = Reg<uint8_t>;
+using Reg16 = Reg<uint16_t>;
+
+enum PortIndex : uint8_t { PA_, PB_, PC_, PD_, PE_, PF_, PG_, PH_, PJ_, PK_, PL_, PORT_COUNT };
+
+struct Gpio {
+  Reg8 pin, ddr, port;
+  uint8_t extLevel = 0;                  // level of the bits driven from outside
+  uint8_t extDriven = 0;                 // bits driven from outside (others float)
+};
+
+struct Usart {
+  Reg8 udr, ucsra, ucsrb, ucsrc;
+  Reg16 ubrr;
+  uint64_t shiftFreeAt = 0;              // transmit shift register idle from this cycle
+  uint64_t udrFreeAt = 0;                // UDR can take the next byte from this cycle
+  uint64_t udrieSince = 0;               // UDRE interrupt enabled at this cycle
+  uint64_t rxcieSince = 0;               // RX complete interrupt enabled at this cycle
+  uint8_t  rxData = 0;
+  std::deque<std::pair<uint64_t, uint8_t>> rxPending;   // (arrival cycle, byte), in order
+  std::deque<uint64_t> rxEdges;          // start-bit cycle of each byte in rxPending, for an edge interrupt on RXn
+  // HardwareSerial (Arduino core) mode
+  bool     coreMode = false;
+  uint32_t coreBitCycles = 0;
+  uint8_t  rxRing[64];                   // SERIAL_RX_BUFFER_SIZE
+  uint8_t  rxHead = 0, rxTail = 0;
+  uint32_t rxDropped = 0;
+  std::function<void(uint8_t, uint64_t)> sink;          // byte leaves TXn, at its stop bit
+};
+
+struct Mcu {
+  uint64_t now = 0;
+
+  Gpio gpio[PORT_COUNT];
+  Reg8 SREG_, MCUSR_;
+  Reg8 TCCR1A_, TCCR1B_, TCCR1C_, TIMSK1_, TIFR1_;
+  Reg16 TCNT1_, OCR1A_, OCR1B_, OCR1C_;
+  Reg8 TCCR5A_, TCCR5B_, TCCR5C_, TIMSK5_, TIFR5_;
+  Reg16 TCNT5_;
+  Usart usart[4];
+
+  // Timer1 time base
+  uint64_t t1Origin = 0;                 // cycle at which the count was t1Base
+  uint64_t t1Base = 0;                   // absolute (unwrapped) tick count at t1Origin
+  uint64_t t1Scan[3] = {0, 0, 0};        // compare A/B/C searched for matches up to here
+
+  // Watchdog
+  bool     wdtOn = false;
+  uint64_t wdtTimeout = 0;
+  uint64_t wdtLast = 0;
+  bool     wdtTripped = false;
+
+  void (*vectors[VEC_COUNT])() = {};
+
+  // attachInterrupt() handlers by interrupt number
+  void (*extInt[EXT_INT_COUNT])() = {};
+  uint8_t  extIntMode[EXT_INT_COUNT] = {};
+  uint64_t extIntSince[EXT_INT_COUNT] = {};
+  uint64_t clockRead = 0;                // now at the firmware's last millis() / micros()
+
+  // Peripherals on I2C / ADC
+  int16_t  adsCounts[4] = {0, 0, 0, 0};
+  uint16_t analog[16] = {};
+  char     lcdText[4][21];
+  uint8_t  lcdCol = 0, lcdRow = 0;
+
+  // Board-side observers
+  std::function<void(uint8_t port)> onPinsChanged;      // PORT/DDR of a port changed
+  std::function<void(uint8_t port, uint8_t value)> onPortWrite;   // PORTx now reads value
+
+  Mcu();
+  void powerOnReset(uint8_t mcusr);
+};
+
+Mcu mcu;
+
+static inline void spend(uint64_t cycles) { mcu.now += cycles; }
+
+// ========================= GPIO =========================
+static inline uint8_t gpio_levels(const Gpio& g) {
+  const uint8_t out = (uint8_t)(g.ddr.v & g.port.v);
+  const uint8_t in  = (uint8_t)(~g.ddr.v & ((g.extDriven & g.extLevel) | (~g.extDriven & g.port.v)));
+  return (uint8_t)(out | in);
+}
+
+static uint8_t pin_read(const Reg8& r) { return gpio_levels(mcu.gpio[r.tag]); }
+
+static void port_write(Reg8& r, uint8_t x) {
+  const uint8_t old = r.v;
+  r.v = x;
+  if (old != x) {
+    if (mcu.onPortWrite) mcu.onPortWrite(r.tag, x);
+    if (mcu.onPinsChanged) mcu.onPinsChanged(r.tag);
+  }
+}
+
+static void ddr_write(Reg8& r, uint8_t x) {
+  const uint8_t old = r.v;
+  r.v = x;
+  if (old != x && mcu.onPinsChanged) mcu.onPinsChanged(r.tag);
+}
+
+// Writing a one to PINx toggles PORTx
+static void pin_write(Reg8& r, uint8_t x) {
+  Reg8& port = mcu.gpio[r.tag].port;
+  port = (uint8_t)(port.v ^ x);
+}
+
+// ========================= Timer1 =========================
+static inline uint32_t timer1_prescale() {
+  switch (mcu.TCCR1B_.v & 0x07) {
+    case 1: return 1;
+    case 2: return 8;
+    case 3: return 64;
+    case 4: return 256;
+    case 5: return 1024;
+    default: return 0;                   // stopped or external clock (not modelled)
+  }
+}
+
+static inline uint64_t timer1_ticks_at(uint64_t cycle) {
+  const uint32_t ps = timer1_prescale();
+  if (ps == 0 || cycle < mcu.t1Origin) return mcu.t1Base;
+  return mcu.t1Base + (cycle - mcu.t1Origin) / ps;
+}
+
+static void timer1_rebase(uint64_t ticks) {
+  mcu.t1Base = ticks;
+  mcu.t1Origin = mcu.now;
+  for (uint64_t& s : mcu.t1Scan) s = mcu.now;
+}
+
+static uint16_t tcnt1_read(const Reg16&) { return (uint16_t)timer1_ticks_at(mcu.now); }
+static void tcnt1_write(Reg16&, uint16_t x) { timer1_rebase(x); }
+static void tccr1b_write(Reg8& r, uint8_t x) {
+  const uint64_t ticks = timer1_ticks_at(mcu.now);
+  r.v = x;
+  timer1_rebase(ticks);
+}
+
+// A new compare value or a re-enabled channel only matches from now on
+static void ocr1_write(Reg16& r, uint16_t x) { r.v = x; mcu.t1Scan[r.tag] = mcu.now; }
+static void timsk1_write(Reg8& r, uint8_t x) {
+  for (uint8_t ch = 0; ch < 3; ch++) {
+    const uint8_t bit = (uint8_t)(1u << (ch + 1));      // OCIE1A..C
+    if ((x & bit) && !(r.v & bit)) mcu.t1Scan[ch] = mcu.now;
+  }
+  r.v = x;
+}
+static void tifr_write(Reg8& r, uint8_t x) { r.v &= (uint8_t)~x; }  // write one to clear
+
+// Cycle of the first match of compare channel ch after the scan position, or UINT64_MAX
+static uint64_t timer1_next_match(uint8_t ch) {
+  const uint32_t ps = timer1_prescale();
+  if (ps == 0) return UINT64_MAX;
+  const Reg16* ocr[3] = {&mcu.OCR1A_, &mcu.OCR1B_, &mcu.OCR1C_};
+  const uint64_t k0 = timer1_ticks_at(mcu.t1Scan[ch]) + 1;
+  const uint64_t k = k0 + (uint16_t)(ocr[ch]->v - (uint16_t)k0);
+  return mcu.t1Origin + (k - mcu.t1Base) * ps;
+}
+
+// ========================= USART =========================
+static inline uint64_t usart_char_cycles(const Usart& u) {
+  const uint64_t bit = u.coreMode ? u.coreBitCycles
+                                  : (uint64_t)((u.ucsra.v & 0x02) ? 8 : 16) * ((uint64_t)u.ubrr.v + 1);
+  return 10 * bit;                       // 8N1
+}
+
+static void usart_transmit(Usart& u, uint8_t b) {
+  const uint64_t start = (mcu.now > u.shiftFreeAt) ? mcu.now : u.shiftFreeAt;
+  u.shiftFreeAt = start + usart_char_cycles(u);
+  u.udrFreeAt = start;
+  if (u.sink) u.sink(b, u.shiftFreeAt);
+}
+
+static void udr_write(Reg8& r, uint8_t x) { usart_transmit(mcu.usart[r.tag], x); }
+static void ucsrb_write(Reg8& r, uint8_t x) {
+  if ((x & 0x20) && !(r.v & 0x20)) mcu.usart[r.tag].udrieSince = mcu.now;   // UDRIE
+  if ((x & 0x80) && !(r.v & 0x80)) mcu.usart[r.tag].rxcieSince = mcu.now;   // RXCIE
+  r.v = x;
+}
+static uint8_t udr_read(const Reg8& r) { return mcu.usart[r.tag].rxData; }
+
+// ========================= Interrupt dispatch =========================
+static inline bool register_isr(Vector v, void (*fn)()) {
+  mcu.vectors[v] = fn;
+  return true;
+}
+
+static inline void run_handler(void (*fn)(), uint64_t at) {
+  mcu.now = at;
+  mcu.SREG_.v &= 0x7F;                   // I cleared on entry
+  if (fn) fn();
+  mcu.SREG_.v |= 0x80;                   // reti
+  mcu.now += COST_ISR;
+}
+
+static inline void run_isr(Vector v, uint64_t at) { run_handler(mcu.vectors[v], at); }
+
+static inline bool rx1_edge_armed() {
+  const uint8_t mode = mcu.extIntMode[RX1_EXT_INT];
+  return mcu.extInt[RX1_EXT_INT] && (mode == EXT_INT_FALLING || mode == EXT_INT_CHANGE);
+}
+
+// An edge injected after the board ran past it cannot interrupt before a clock reading the
+// firmware has already taken, so it runs at that reading instead
+static inline uint64_t rx1_edge_at(uint64_t edge) { return edge < mcu.clockRead ? mcu.clockRead : edge; }
+
+// Runs the RX1 edge handler for start bits seen by now. A byte only reaches the core's
+// ring from its RX ISR, a character after its start bit, so the edge handler runs first.
+static void take_rx1_edges() {
+  std::deque<uint64_t>& edges = mcu.usart[1].rxEdges;
+  while (!edges.empty() && edges.front() < mcu.extIntSince[RX1_EXT_INT]) edges.pop_front();
+  if (!(mcu.SREG_.v & 0x80) || !rx1_edge_armed()) return;
+  const uint64_t resume = mcu.now;
+  uint64_t spent = 0;
+  while (!edges.empty() && edges.front() <= resume) {
+    const uint64_t at = edges.front();
+    edges.pop_front();
+    run_handler(mcu.extInt[RX1_EXT_INT], rx1_edge_at(at));
+    spent += COST_ISR;
+  }
+  mcu.now = resume + spent;
+}
+
+// Moves bytes that have arrived by now into the HardwareSerial ring, as its RX ISR would
+static void usart_pump_core(Usart& u) {
+  if (&u == &mcu.usart[1]) take_rx1_edges();
+  while (!u.rxPending.empty() && u.rxPending.front().first <= mcu.now) {
+    const uint8_t b = u.rxPending.front().second;
+    u.rxPending.pop_front();
+    const uint8_t next = (uint8_t)((u.rxHead + 1) % sizeof(u.rxRing));
+    if (next == u.rxTail) {
+      u.rxDropped++;
+    } else {
+      u.rxRing[u.rxHead] = b;
+      u.rxHead = next;
+    }
+  }
+}
+
+// Takes every interrupt that became pending up to `until`, in time order, each at its
+// own timestamp. The clock then resumes from `until` plus the time spent in them.
+static void service_interrupts(uint64_t until) {
+  if (!(mcu.SREG_.v & 0x80)) return;
+  uint64_t spent = 0;
+  for (uint32_t guard = 0; guard < 1000000; guard++) {
+    uint64_t best = UINT64_MAX;
+    int kind = -1;
+    uint8_t idx = 0;
+
+    for (uint8_t ch = 0; ch < 3; ch++) {
+      if (!(mcu.TIMSK1_.v & (1u << (ch + 1)))) continue;
+      const uint64_t t = timer1_next_match(ch);
+      if (t < best) { best = t; kind = 0; idx = ch; }
+    }
+    for (uint8_t n = 0; n < 4; n++) {
+      Usart& u = mcu.usart[n];
+      // A byte injected after the fact that arrived before the receiver was on is lost
+      while (!u.coreMode && !u.rxPending.empty() && u.rxPending.front().first < u.rxcieSince) u.rxPending.pop_front();
+      const uint64_t udre = (u.udrFreeAt > u.udrieSince) ? u.udrFreeAt : u.udrieSince;
+      if ((u.ucsrb.v & 0x20) && udre < best) { best = udre; kind = 1; idx = n; }                // UDRIE
+      if (!u.coreMode && (u.ucsrb.v & 0x80) && !u.rxPending.empty() &&                         // RXCIE
+          u.rxPending.front().first < best) {
+        best = u.rxPending.front().first; kind = 2; idx = n;
+      }
+    }
+    // A start bit pulls RX low; edges from before attachInterrupt() are not latched
+    std::deque<uint64_t>& edges = mcu.usart[1].rxEdges;
+    while (!edges.empty() && edges.front() < mcu.extIntSince[RX1_EXT_INT]) edges.pop_front();
+    if (rx1_edge_armed() && !edges.empty() && edges.front() < best) {
+      best = edges.front(); kind = 3;
+    }
+    if (kind < 0 || best > until) break;
+
+    const uint64_t resume = mcu.now;
+    if (kind == 0) {
+      mcu.t1Scan[idx] = best;
+      run_isr((Vector)(VEC_TIMER1_COMPA_vect + idx), best);
+    } else if (kind == 1) {
+      run_isr((Vector)(VEC_USART0_UDRE_vect + 2 * idx), best);
+    } else if (kind == 3) {
+      edges.pop_front();
+      run_handler(mcu.extInt[RX1_EXT_INT], rx1_edge_at(best));
+    } else {
+      Usart& u = mcu.usart[idx];
+      u.rxData = u.rxPending.front().second;
+      u.rxPending.pop_front();
+      run_isr((Vector)(VEC_USART0_RX_vect + 2 * idx), best);
+    }
+    spent += COST_ISR;
+    mcu.now = resume;
+  }
+  // Compare channels that are not enabled only need to match from now on
+  for (uint8_t ch = 0; ch < 3; ch++) {
+    if (!(mcu.TIMSK1_.v & (1u << (ch + 1)))) mcu.t1Scan[ch] = until;
+  }
+  if (!rx1_edge_armed()) {
+    std::deque<uint64_t>& edges = mcu.usart[1].rxEdges;
+    while (!edges.empty() && edges.front() <= until) edges.pop_front();
+  }
+  // Bytes nobody listens for are lost, as on hardware
+  for (Usart& u : mcu.usart) {
+    if (!u.coreMode && !(u.ucsrb.v & 0x80)) {
+      while (!u.rxPending.empty() && u.rxPending.front().first <= until) u.rxPending.pop_front();
+    }
+  }
+  mcu.now = until + spent;
+}
+
+// ========================= External drive / T5 =========================
+// Sets the level seen on input pins of a port; `driven` bits not set float (pull-up or 0)
+static void drive_port(uint8_t p, uint8_t driven, uint8_t level) {
+  Gpio& g = mcu.gpio[p];
+  const uint8_t before = gpio_levels(g);
+  g.extDriven = driven;
+  g.extLevel = (uint8_t)(level & driven);
+  const uint8_t after = gpio_levels(g);
+
+  // Timer5 external clock on T5 (PL2): CS5 = 6 falling, 7 rising
+  if (p == PL_ && ((before ^ after) & 0x04)) {
+    const uint8_t cs = mcu.TCCR5B_.v & 0x07;
+    const bool rising = (after & 0x04) != 0;
+    if ((cs == 7 && rising) || (cs == 6 && !rising)) {
+      mcu.TCNT5_.v++;
+    }
+  }
+}
+
+// ========================= Reset =========================
+Mcu::Mcu() {
+  for (uint8_t p = 0; p < PORT_COUNT; p++) {
+    gpio[p].pin.tag = gpio[p].ddr.tag = gpio[p].port.tag = p;
+    gpio[p].pin.rd = pin_read;
+    gpio[p].pin.wr = pin_write;
+    gpio[p].ddr.wr = ddr_write;
+    gpio[p].port.wr = port_write;
+  }
+  TCNT1_.rd = tcnt1_read;
+  TCNT1_.wr = tcnt1_write;
+  TCCR1B_.wr = tccr1b_write;
+  OCR1A_.tag = 0; OCR1B_.tag = 1; OCR1C_.tag = 2;
+  OCR1A_.wr = OCR1B_.wr = OCR1C_.wr = ocr1_write;
+  TIMSK1_.wr = timsk1_write;
+  TIFR1_.wr = tifr_write;
+  TIFR5_.wr = tifr_write;
+  for (uint8_t n = 0; n < 4; n++) {
+    usart[n].udr.tag = usart[n].ucsrb.tag = n;
+    usart[n].ucsrb.wr = ucsrb_write;
+    usart[n].udr.wr = udr_write;
+    usart[n].udr.rd = udr_read;
+  }
+  memset(lcdText, ' ', sizeof(lcdText));
+  for (auto& row : lcdText) row[20] = '\0';
+}
+
+void Mcu::powerOnReset(uint8_t mcusr) {
+  for (Gpio& g : gpio) { g.port.v = 0; g.ddr.v = 0; }
+  SREG_.v = 0;
+  MCUSR_.v = mcusr;
+  TCCR1A_.v = TCCR1B_.v = TCCR1C_.v = TIMSK1_.v = TIFR1_.v = 0;
+  OCR1A_.v = OCR1B_.v = OCR1C_.v = 0;
+  TCCR5A_.v = TCCR5B_.v = TCCR5C_.v = TIMSK5_.v = TIFR5_.v = 0;
+  TCNT5_.v = 0;
+  timer1_rebase(0);
+  for (Usart& u : usart) {
+    u.ucsra.v = 0x20; u.ucsrb.v = 0; u.ucsrc.v = 0x06; u.ubrr.v = 0;
+    u.coreMode = false;
+    u.rxHead = u.rxTail = 0;
+    u.rxPending.clear();
+    u.rxEdges.clear();
+    u.shiftFreeAt = u.udrFreeAt = now;
+  }
+  for (uint8_t n = 0; n < EXT_INT_COUNT; n++) {
+    extInt[n] = nullptr;
+    extIntMode[n] = 0;
+  }
+  wdtOn = false;
+  wdtTripped = false;
+}
+
+// ========================= Watchdog =========================
+static inline void watchdog_enable(uint8_t to) {
+  mcu.wdtOn = true;
+  mcu.wdtTimeout = (uint64_t)(16u << to) * CPU_HZ / 1000u;   // WDTO_n = 16 ms << n (approx.)
+  mcu.wdtLast = mcu.now;
+}
+static inline void watchdog_reset() { mcu.wdtLast = mcu.now; }
+static inline void watchdog_disable() { mcu.wdtOn = false; }
+static inline bool watchdog_expired() {
+  if (mcu.wdtOn && mcu.now - mcu.wdtLast > mcu.wdtTimeout) mcu.wdtTripped = true;
+  return mcu.wdtTripped;
+}
+
+// ========================= Mega 2560 pin map =========================
+// digital pin -> (port, bit), as in the Arduino core's pins_arduino.h for the Mega
+static const uint8_t PIN_PORT[70] = {
+  PE_, PE_, PE_, PE_, PG_, PE_, PH_, PH_, PH_, PH_,      //  0- 9
+  PB_, PB_, PB_, PB_, PJ_, PJ_, PH_, PH_, PD_, PD_,      // 10-19
+  PD_, PD_, PA_, PA_, PA_, PA_, PA_, PA_, PA_, PA_,      // 20-29
+  PC_, PC_, PC_, PC_, PC_, PC_, PC_, PC_, PD_, PG_,      // 30-39
+  PG_, PG_, PL_, PL_, PL_, PL_, PL_, PL_, PL_, PL_,      // 40-49
+  PB_, PB_, PB_, PB_, PF_, PF_, PF_, PF_, PF_, PF_,      // 50-59
+  PF_, PF_, PK_, PK_, PK_, PK_, PK_, PK_, PK_, PK_,      // 60-69
+};
+static const uint8_t PIN_BIT[70] = {
+  0, 1, 4, 5, 5, 3, 3, 4, 5, 6,
+  4, 5, 6, 7, 1, 0, 1, 0, 3, 2,
+  1, 0, 0, 1, 2, 3, 4, 5, 6, 7,
+  7, 6, 5, 4, 3, 2, 1, 0, 7, 2,
+  1, 0, 7, 6, 5, 4, 3, 2, 1, 0,
+  3, 2, 1, 0, 0, 1, 2, 3, 4, 5,
+  6, 7, 0, 1, 2, 3, 4, 5, 6, 7,
+};
+
+}  // namespace
+}  // namespace host
+
+// ========================= Register names =========================
+#define HOST_GPIO(p)  (::host::mcu.gpio[::host::p])
+#define PINA  HOST_GPIO(PA_).pin
+#define DDRA  HOST_GPIO(PA_).ddr
+#define PORTA HOST_GPIO(PA_).port
+#define PINB  HOST_GPIO(PB_).pin
+#define DDRB  HOST_GPIO(PB_).ddr
+#define PORTB HOST_GPIO(PB_).port
+#define PINC  HOST_GPIO(PC_).pin
+#define DDRC  HOST_GPIO(PC_).ddr
+#define PORTC HOST_GPIO(PC_).port
+#define PIND  HOST_GPIO(PD_).pin
+#define DDRD  HOST_GPIO(PD_).ddr
+#define PORTD HOST_GPIO(PD_).port
+#define PINE  HOST_GPIO(PE_).pin
+#define DDRE  HOST_GPIO(PE_).ddr
+#define PORTE HOST_GPIO(PE_).port
+#define PINF  HOST_GPIO(PF_).pin
+#define DDRF  HOST_GPIO(PF_).ddr
+#define PORTF HOST_GPIO(PF_).port
+#define PING  HOST_GPIO(PG_).pin
+#define DDRG  HOST_GPIO(PG_).ddr
+#define PORTG HOST_GPIO(PG_).port
+#define PINH  HOST_GPIO(PH_).pin
+#define DDRH  HOST_GPIO(PH_).ddr
+#define PORTH HOST_GPIO(PH_).port
+#define PINJ  HOST_GPIO(PJ_).pin
+#define DDRJ  HOST_GPIO(PJ_).ddr
+#define PORTJ HOST_GPIO(PJ_).port
+#define PINK  HOST_GPIO(PK_).pin
+#define DDRK  HOST_GPIO(PK_).ddr
+#define PORTK HOST_GPIO(PK_).port
+#define PINL  HOST_GPIO(PL_).pin
+#define DDRL  HOST_GPIO(PL_).ddr
+#define PORTL HOST_GPIO(PL_).port
+
+#define SREG   (::host::mcu.SREG_)
+#define MCUSR  (::host::mcu.MCUSR_)
+#define TCCR1A (::host::mcu.TCCR1A_)
+#define TCCR1B (::host::mcu.TCCR1B_)
+#define TCCR1C (::host::mcu.TCCR1C_)
+#define TIMSK1 (::host::mcu.TIMSK1_)
+#define TIFR1  (::host::mcu.TIFR1_)
+#define TCNT1  (::host::mcu.TCNT1_)
+#define OCR1A  (::host::mcu.OCR1A_)
+#define OCR1B  (::host::mcu.OCR1B_)
+#define OCR1C  (::host::mcu.OCR1C_)
+#define TCCR5A (::host::mcu.TCCR5A_)
+#define TCCR5B (::host::mcu.TCCR5B_)
+#define TCCR5C (::host::mcu.TCCR5C_)
+#define TIMSK5 (::host::mcu.TIMSK5_)
+#define TIFR5  (::host::mcu.TIFR5_)
+#define TCNT5  (::host::mcu.TCNT5_)
+
+#define UDR0   (::host::mcu.usart[0].udr)
+#define UCSR0A (::host::mcu.usart[0].ucsra)
+#define UCSR0B (::host::mcu.usart[0].ucsrb)
+#define UCSR0C (::host::mcu.usart[0].ucsrc)
+#define UBRR0  (::host::mcu.usart[0].ubrr)
+#define UDR1   (::host::mcu.usart[1].udr)
+#define UCSR1A (::host::mcu.usart[1].ucsra)
+#define UCSR1B (::host::mcu.usart[1].ucsrb)
+#define UCSR1C (::host::mcu.usart[1].ucsrc)
+#define UBRR1  (::host::mcu.usart[1].ubrr)
+#define UDR2   (::host::mcu.usart[2].udr)
+#define UCSR2A (::host::mcu.usart[2].ucsra)
+#define UCSR2B (::host::mcu.usart[2].ucsrb)
+#define UCSR2C (::host::mcu.usart[2].ucsrc)
+#define UBRR2  (::host::mcu.usart[2].ubrr)
+#define UDR3   (::host::mcu.usart[3].udr)
+#define UCSR3A (::host::mcu.usart[3].ucsra)
+#define UCSR3B (::host::mcu.usart[3].ucsrb)
+#define UCSR3C (::host::mcu.usart[3].ucsrc)
+#define UBRR3  (::host::mcu.usart[3].ubrr)
+
+// An ISR is an ordinary function registered in the MCU's vector table at static init
+#define ISR(vec) \
+  static void vec(void); \
+  [[maybe_unused]] static const bool vec##_registered = ::host::register_isr(::host::VEC_##vec, &vec); \
+  static void vec(void)
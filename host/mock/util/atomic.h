@@ -0,0 +1,12 @@
+// Host build of <util/atomic.h>
+#pragma once
+
+#include <avr/interrupt.h>
+
+static inline uint8_t host_atomic_enter() { const uint8_t s = SREG; cli(); return s; }
+static inline void host_atomic_restore(const uint8_t* s) { SREG = *s; }
+
+#define ATOMIC_RESTORESTATE
+#define ATOMIC_BLOCK(type) \
+  for (uint8_t host_sreg __attribute__((cleanup(host_atomic_restore))) = host_atomic_enter(), \
+       host_once = 1; host_once; host_once = 0)
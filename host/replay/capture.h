@@ -0,0 +1,196 @@
+/*
+  Knob Box - RS-485 capture files
+
+  A capture is the Modbus bus as a sequence of frames, with no direction attached: a
+  passive tap cannot tell the dashboard from a monitor, so requests and replies are told
+  apart when the capture is replayed.
+
+    header   "KBRS485\0", u32 version, u32 baud, u64 start (Unix time, us)     little-endian
+    frame    varint start (us since the previous frame's start, or since the header's)
+             varint length
+             length bytes
+
+  A frame's start is its first byte's start bit. Each byte ends one character time later
+  than the one before, so the start and the baud give every byte's time.
+
+  FrameSplitter cuts a byte stream into frames on silence. Time can be in any unit, so it
+  works for host microseconds and for simulator cycles alike.
+*/
+#pragma once
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace kb {
+
+struct Frame {
+  uint64_t start = 0;             // first byte's start bit
+  std::vector<uint8_t> bytes;
+};
+
+static constexpr char CAPTURE_MAGIC[8] = {'K', 'B', 'R', 'S', '4', '8', '5', '\0'};
+static constexpr uint32_t CAPTURE_VERSION = 1;
+
+struct CaptureInfo {
+  uint32_t baud = 9600;
+  uint64_t startUnix_us = 0;
+
+  double charUs() const { return 10.0e6 / baud; }   // 8N1
+};
+
+// ========================= Splitting =========================
+class FrameSplitter {
+ public:
+  using Sink = std::function<void(const Frame &)>;
+
+  // `charTime` is one character on the line; a gap of `silence` or more ends a frame
+  FrameSplitter(uint64_t charTime, uint64_t silence, Sink sink)
+      : charTime_(charTime), silence_(silence), sink_(std::move(sink)) {}
+
+  // One byte, stamped with the end of its stop bit
+  void push(uint8_t b, uint64_t end) {
+    if (!cur_.bytes.empty() && end > lastEnd_ + charTime_ && end - charTime_ - lastEnd_ >= silence_) finish();
+    if (cur_.bytes.empty()) cur_.start = end > charTime_ ? end - charTime_ : 0;
+    cur_.bytes.push_back(b);
+    lastEnd_ = end;
+  }
+
+  // Ends the open frame once the line has been quiet long enough
+  void idle(uint64_t now) {
+    if (!cur_.bytes.empty() && now >= lastEnd_ + silence_) finish();
+  }
+
+  void finish() {
+    if (cur_.bytes.empty()) return;
+    sink_(cur_);
+    cur_.bytes.clear();
+  }
+
+ private:
+  uint64_t charTime_;
+  uint64_t silence_;
+  Sink sink_;
+  Frame cur_;
+  uint64_t lastEnd_ = 0;
+};
+
+// ========================= Files =========================
+class CaptureWriter {
+ public:
+  ~CaptureWriter() { close(); }
+
+  bool open(const char *path, const CaptureInfo &info) {
+    f_ = fopen(path, "wb");
+    if (!f_) {
+      fprintf(stderr, "capture: cannot open %s: %s\n", path, strerror(errno));
+      return false;
+    }
+    fwrite(CAPTURE_MAGIC, 1, sizeof(CAPTURE_MAGIC), f_);
+    put_le(CAPTURE_VERSION, 4);
+    put_le(info.baud, 4);
+    put_le(info.startUnix_us, 8);
+    last_ = 0;
+    return true;
+  }
+
+  // Frames must come in start order; `start` in us since the capture began
+  void write(const Frame &fr) {
+    if (!f_) return;
+    const uint64_t start = fr.start < last_ ? last_ : fr.start;
+    put_varint(start - last_);
+    put_varint(fr.bytes.size());
+    fwrite(fr.bytes.data(), 1, fr.bytes.size(), f_);
+    last_ = start;
+    frames_++;
+  }
+
+  void flush() {
+    if (f_) fflush(f_);
+  }
+
+  void close() {
+    if (f_) fclose(f_);
+    f_ = nullptr;
+  }
+
+  uint64_t frames() const { return frames_; }
+
+ private:
+  void put_le(uint64_t v, int n) {
+    for (int i = 0; i < n; i++) fputc((int)((v >> (8 * i)) & 0xFF), f_);
+  }
+  void put_varint(uint64_t v) {
+    do {
+      const uint8_t b = (uint8_t)(v & 0x7F);
+      v >>= 7;
+      fputc(v ? (b | 0x80) : b, f_);
+    } while (v);
+  }
+
+  FILE *f_ = nullptr;
+  uint64_t last_ = 0;
+  uint64_t frames_ = 0;
+};
+
+// Reads a whole capture; frame starts come back in us since the capture began
+inline bool read_capture(const char *path, CaptureInfo &info, std::vector<Frame> &frames) {
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    fprintf(stderr, "capture: cannot open %s: %s\n", path, strerror(errno));
+    return false;
+  }
+  auto get_le = [f](int n, uint64_t &v) {
+    v = 0;
+    for (int i = 0; i < n; i++) {
+      const int c = fgetc(f);
+      if (c == EOF) return false;
+      v |= (uint64_t)c << (8 * i);
+    }
+    return true;
+  };
+  auto get_varint = [f](uint64_t &v) {
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      const int c = fgetc(f);
+      if (c == EOF) return false;
+      v |= (uint64_t)(c & 0x7F) << shift;
+      if (!(c & 0x80)) return true;
+    }
+    return false;
+  };
+
+  char magic[sizeof(CAPTURE_MAGIC)];
+  uint64_t version = 0, baud = 0, start = 0;
+  if (fread(magic, 1, sizeof(magic), f) != sizeof(magic) || memcmp(magic, CAPTURE_MAGIC, sizeof(magic)) != 0 ||
+      !get_le(4, version) || !get_le(4, baud) || !get_le(8, start) || version != CAPTURE_VERSION || baud == 0) {
+    fprintf(stderr, "capture: %s is not a version %u capture\n", path, CAPTURE_VERSION);
+    fclose(f);
+    return false;
+  }
+  info.baud = (uint32_t)baud;
+  info.startUnix_us = start;
+
+  frames.clear();
+  uint64_t t = 0, dt, len;
+  while (get_varint(dt)) {
+    Frame fr;
+    t += dt;
+    fr.start = t;
+    if (!get_varint(len) || len > 4096) break;
+    fr.bytes.resize(len);
+    if (fread(fr.bytes.data(), 1, len, f) != len) break;
+    frames.push_back(std::move(fr));
+  }
+  const bool truncated = !feof(f);
+  fclose(f);
+  if (truncated) fprintf(stderr, "capture: %s: stopped at a damaged frame after %zu frames\n", path, frames.size());
+  return true;
+}
+
+}  // namespace kb
@@ -0,0 +1,140 @@
+/*
+  Knob Box - RS-485 bus recorder
+
+  Listens on a USB-RS485 adapter wired to the monitors' Modbus bus and writes every frame,
+  dashboard and monitors alike, to a capture file (see capture.h) for rs485_replay. It
+  never transmits.
+
+  Frames are cut on a silent interval. A read() can return several bytes that arrived
+  together, so byte times inside a read are spread back from the read's timestamp, one
+  character apart. Set the adapter's latency timer to 1 ms (host/README.md), otherwise the
+  adapter delivers in 16 ms lumps and the recorded timing is only that fine.
+
+  Usage:
+    rs485_record -p DEVICE -o FILE [-b baud] [--silence MS] [-d SECONDS] [-v]
+*/
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+
+#include "../common/modbus_frame.h"
+#include "../common/serial_port.h"
+#include "capture.h"
+
+using namespace kb;
+
+namespace {
+
+volatile sig_atomic_t stopRequested = 0;
+
+void on_signal(int) { stopRequested = 1; }
+
+struct Options {
+  const char *device = nullptr;
+  const char *out = nullptr;
+  unsigned baud = 9600;
+  double silence_ms = -1.0;     // < 0: 3.5 characters, at least 1.75 ms
+  double duration_s = 0.0;      // 0 = until interrupted
+  bool verbose = false;
+};
+
+void print_frame(const Frame &fr) {
+  printf("%12.3f ms %3zu B %s ", (double)fr.start / 1000.0, fr.bytes.size(),
+         modbus_crc_ok(fr.bytes.data(), fr.bytes.size()) ? "   " : "CRC");
+  for (size_t i = 0; i < fr.bytes.size() && i < 24; i++) printf(" %02X", fr.bytes[i]);
+  printf("%s\n", fr.bytes.size() > 24 ? " ..." : "");
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: rs485_record -p DEVICE -o FILE [options]\n"
+          "  -p DEVICE      USB-RS485 adapter on the monitors' bus (or a pty)\n"
+          "  -o FILE        capture file to write\n"
+          "  -b BAUD        line rate (default 9600)\n"
+          "  --silence MS   quiet time that ends a frame (default 3.5 characters, >= 1.75 ms)\n"
+          "  -d SECONDS     stop after this long (default: until Ctrl-C)\n"
+          "  -v             print every frame\n");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options opt;
+  for (int i = 1; i < argc; i++) {
+    const std::string a = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (a == "-p" && hasValue) {
+      opt.device = argv[++i];
+    } else if (a == "-o" && hasValue) {
+      opt.out = argv[++i];
+    } else if (a == "-b" && hasValue) {
+      opt.baud = (unsigned)atoi(argv[++i]);
+    } else if (a == "--silence" && hasValue) {
+      opt.silence_ms = atof(argv[++i]);
+    } else if (a == "-d" && hasValue) {
+      opt.duration_s = atof(argv[++i]);
+    } else if (a == "-v") {
+      opt.verbose = true;
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  if (!opt.device || !opt.out) {
+    usage();
+    return 2;
+  }
+
+  const int fd = open_serial("record", opt.device, opt.baud);
+  if (fd < 0) return 1;
+
+  CaptureInfo info;
+  info.baud = opt.baud;
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  info.startUnix_us = (uint64_t)tv.tv_sec * 1000000u + (uint64_t)tv.tv_usec;
+  CaptureWriter writer;
+  if (!writer.open(opt.out, info)) return 1;
+
+  const double charUs = info.charUs();
+  const double silenceUs = opt.silence_ms >= 0.0 ? opt.silence_ms * 1000.0 : std::max(3.5 * charUs, 1750.0);
+  FrameSplitter splitter((uint64_t)charUs, (uint64_t)silenceUs, [&](const Frame &fr) {
+    writer.write(fr);
+    writer.flush();
+    if (opt.verbose) print_frame(fr);
+  });
+
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+  fprintf(stderr, "record: %s at %u baud -> %s, Ctrl-C to stop\n", opt.device, opt.baud, opt.out);
+
+  const double t0 = now_ms();
+  uint64_t bytes = 0;
+  while (!stopRequested && (opt.duration_s <= 0.0 || now_ms() - t0 < opt.duration_s * 1000.0)) {
+    struct pollfd p = {fd, POLLIN, 0};
+    const int r = poll(&p, 1, 1);
+    const uint64_t now_us = (uint64_t)((now_ms() - t0) * 1000.0);
+    if (r > 0) {
+      uint8_t buf[256];
+      const ssize_t n = ::read(fd, buf, sizeof(buf));
+      for (ssize_t i = 0; i < n; i++) {
+        const uint64_t back = (uint64_t)((double)(n - 1 - i) * charUs);
+        splitter.push(buf[i], now_us > back ? now_us - back : 0);
+      }
+      if (n > 0) bytes += (uint64_t)n;
+    }
+    splitter.idle(now_us);
+  }
+  splitter.finish();
+  writer.close();
+  close(fd);
+  fprintf(stderr, "record: %llu frames, %llu bytes in %.1f s\n", (unsigned long long)writer.frames(),
+          (unsigned long long)bytes, (now_ms() - t0) / 1000.0);
+  return 0;
+}
@@ -0,0 +1,493 @@
+/*
+  Knob Box - deterministic replay of an RS-485 capture against the monitor images
+
+  Reads a capture from rs485_record (or knob_box_sim --capture), works out which frames are
+  dashboard requests and which are replies, and plays the requests into host builds of
+  monitor_firmware.cpp. Each selected monitor answers for itself. Recorded replies from
+  slaves that are not being replayed go back on the bus at their recorded time, so every
+  monitor hears the same traffic as in the field. That matters for ModbusRtu framing: a
+  request that follows another slave's reply too closely is lost.
+
+  Modes:
+    virtual   frames at their recorded times on the virtual clock, as fast as possible
+    wall      the same, held to wall-clock time
+    fast      each request as soon as the previous transaction is done (--gap later)
+
+  For every request to a replayed slave the replay reply is checked against the recorded
+  one: slave, function code, exception code and byte count, and a valid CRC. Register
+  values come from the monitors' inputs, which a capture does not carry, so a payload
+  difference is only counted. A reply that ends more than --slack later, measured from the
+  end of its request, is reported as a timing regression. Any difference, or a regression
+  in the virtual or wall modes, gives exit status 1.
+
+  Usage:
+    rs485_replay CAPTURE [--mode virtual|wall|fast] [--ids 1,2,3,4] [--at SECONDS]
+                 [--slack MS] [--timeout MS] [--gap MS] [--max-report N] [--dump]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../board/board.h"
+#include "../common/modbus_frame.h"
+#include "capture.h"
+
+using namespace kb;
+
+namespace {
+
+// ========================= Options =========================
+enum class Mode { VIRTUAL, WALL, FAST };
+
+struct Options {
+  const char *capture = nullptr;
+  Mode mode = Mode::VIRTUAL;
+  bool selected[5] = {false, true, true, true, true};   // by slave id
+  double at_s = -1.0;           // virtual time of the capture start; < 0: right after setup()
+  double slack_ms = 5.0;
+  double timeout_ms = 200.0;    // fast mode: give up on a reply after this long
+  double gap_ms = 5.0;          // fast mode: silence after each transaction
+  unsigned maxReport = 10;
+  bool dump = false;
+};
+
+static constexpr uint8_t MONITOR_MODBUS_UART = 1;
+static constexpr uint8_t SLAVE_COUNT = 4;        // PS_POS1KV .. PS_3KV
+
+// ========================= Transactions =========================
+struct Transaction {
+  size_t req;                  // frame index of the request
+  int recReply = -1;           // frame index of the recorded reply
+  uint8_t id = 0;
+  bool replayed = false;       // addressed to a slave that is being replayed
+
+  // Replay
+  uint64_t reqEnd = 0;         // cycles
+  bool haveReply = false;
+  Frame reply;                 // start in cycles
+  uint64_t replyEnd = 0;
+};
+
+bool is_reply_to(const Frame &req, const Frame &f) {
+  const size_t n = f.bytes.size();
+  if (n < MODBUS_EXCEPTION_BYTES || !modbus_crc_ok(f.bytes.data(), n)) return false;
+  if (f.bytes[0] != req.bytes[0] || (f.bytes[1] & 0x7F) != req.bytes[1]) return false;
+  if (f.bytes[1] & 0x80) return n == MODBUS_EXCEPTION_BYTES;
+  return n == modbus_reply_bytes(req.bytes.data(), req.bytes.size());
+}
+
+// Pairs every request with the reply that followed it, if any. A frame that is not a
+// reply is a request, a broadcast or line noise; all of those go back on the bus.
+// txOfFrame / replyOfFrame give the transaction a frame opens or answers, else -1.
+void classify(const std::vector<Frame> &frames, std::vector<Transaction> &tx, std::vector<int> &txOfFrame,
+              std::vector<int> &replyOfFrame) {
+  txOfFrame.assign(frames.size(), -1);
+  replyOfFrame.assign(frames.size(), -1);
+  int pending = -1;
+  for (size_t f = 0; f < frames.size(); f++) {
+    if (pending >= 0 && is_reply_to(frames[tx[(size_t)pending].req], frames[f])) {
+      tx[(size_t)pending].recReply = (int)f;
+      replyOfFrame[f] = pending;
+      pending = -1;
+      continue;
+    }
+    Transaction t;
+    t.req = f;
+    const Frame &fr = frames[f];
+    const bool wellFormed = fr.bytes.size() >= 8 && modbus_crc_ok(fr.bytes.data(), fr.bytes.size());
+    t.id = wellFormed ? fr.bytes[0] : 0;
+    txOfFrame[f] = (int)tx.size();
+    tx.push_back(t);
+    pending = (wellFormed && t.id != 0 && modbus_reply_bytes(fr.bytes.data(), fr.bytes.size()) != 0)
+                  ? (int)(tx.size() - 1)
+                  : -1;
+  }
+}
+
+// ========================= Replay =========================
+class Replay {
+ public:
+  Replay(const Options &o, const CaptureInfo &info, const std::vector<Frame> &frames)
+      : opt_(o), info_(info), frames_(frames),
+        mon_{&kb_monitor_board_1(), &kb_monitor_board_2(), &kb_monitor_board_3(), &kb_monitor_board_4()} {}
+
+  void run() {
+    classify(frames_, tx_, txOfFrame_, replyOfFrame_);
+    for (Transaction &t : tx_) t.replayed = t.id >= 1 && t.id <= SLAVE_COUNT && opt_.selected[t.id];
+
+    for (uint8_t s = 0; s < SLAVE_COUNT; s++) {
+      if (!opt_.selected[s + 1]) continue;
+      boards_.push_back(mon_[s]);
+      mon_[s]->powerOn(0);
+    }
+    uint64_t booted = 0;
+    for (Board *b : boards_) booted = std::max(booted, b->now());
+    chr_ = boards_[0]->uartCharCycles(MONITOR_MODBUS_UART);
+    origin_ = opt_.at_s >= 0.0 ? (uint64_t)(opt_.at_s * 1000.0 * CYCLES_PER_MS)
+                               : (booted / CYCLES_PER_MS + 100) * CYCLES_PER_MS;
+    const uint64_t first = frames_.empty() ? 0 : us_to_cycles((double)frames_[0].start);
+    if (origin_ + first < booted) {
+      fprintf(stderr, "replay: the capture would start before the monitors finish setup() at %.3f s; "
+              "starting it then\n", (double)booted / (CYCLES_PER_MS * 1000.0));
+      origin_ = booted - first;
+    }
+    wire();
+
+    struct timespec wall0;
+    clock_gettime(CLOCK_MONOTONIC, &wall0);
+    busFree_ = origin_ + first;
+    nextAt_ = schedule_time(0, busFree_);
+    for (;;) {
+      Board *b = earliest();
+      const uint64_t t = b->now();
+      if (!inject_due(t) && t > quietUntil_) break;
+      if (opt_.mode == Mode::WALL) pace(t, wall0);
+      for (size_t s = 0; s < boards_.size(); s++) splitter_[s]->idle(t);
+      b->step();
+    }
+    for (auto &sp : splitter_) sp->finish();
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    wall_s_ = (double)(now.tv_sec - wall0.tv_sec) + (double)(now.tv_nsec - wall0.tv_nsec) * 1e-9;
+    virt_s_ = (double)(earliest()->now() - origin_) / (CYCLES_PER_MS * 1000.0);
+  }
+
+  int report();
+
+ private:
+  Board *earliest() const {
+    Board *e = boards_[0];
+    for (Board *b : boards_) {
+      if (b->now() < e->now()) e = b;
+    }
+    return e;
+  }
+
+  uint64_t us_to_cycles(double us) const { return (uint64_t)(us * (double)CYCLES_PER_US); }
+  double frame_us(size_t bytes) const { return (double)bytes * info_.charUs(); }
+
+  void wire() {
+    for (size_t s = 0; s < boards_.size(); s++) {
+      Board *b = boards_[s];
+      const uint8_t id = slave_id(b);
+      splitter_.emplace_back(new FrameSplitter(chr_, chr_ * 7 / 2, [this, id](const Frame &fr) { on_reply(id, fr); }));
+      FrameSplitter *sp = splitter_.back().get();
+      b->onUartTx(MONITOR_MODBUS_UART, [this, b, sp](uint8_t byte, uint64_t at) {
+        sp->push(byte, at);
+        // Every monitor on the bus hears the others' replies
+        for (Board *o : boards_) {
+          if (o != b) o->uartInject(MONITOR_MODBUS_UART, byte, at);
+        }
+      });
+    }
+  }
+
+  uint8_t slave_id(const Board *b) const {
+    for (uint8_t s = 0; s < SLAVE_COUNT; s++) {
+      if (mon_[s] == b) return (uint8_t)(s + 1);
+    }
+    return 0;
+  }
+
+  // A replay reply belongs to the latest request to that slave that ended before it began
+  void on_reply(uint8_t id, const Frame &fr) {
+    if (tx_.empty()) return;
+    for (size_t i = lastInjectedTx_ + 1; i-- > 0;) {
+      Transaction &t = tx_[i];
+      if (t.id != id || t.reqEnd == 0 || t.reqEnd > fr.start) continue;
+      if (!t.haveReply) {
+        t.haveReply = true;
+        t.reply = fr;
+        t.replyEnd = fr.start + fr.bytes.size() * chr_;
+      } else {
+        strayReplies_++;
+      }
+      return;
+    }
+    strayReplies_++;
+  }
+
+  // When frame `f` goes on the bus. Recorded modes keep the capture's spacing. Fast mode
+  // starts a request once the previous transaction is finished, and plays a recorded
+  // reply after its request with the recorded turnaround.
+  uint64_t schedule_time(size_t f, uint64_t earliestAt) const {
+    if (f >= frames_.size()) return UINT64_MAX;
+    if (opt_.mode != Mode::FAST) return origin_ + us_to_cycles((double)frames_[f].start);
+    if (txOfFrame_[f] < 0) {
+      const Transaction &req = tx_[(size_t)replyOfFrame_[f]];
+      const double turnaround = (double)frames_[f].start - ((double)frames_[req.req].start +
+                                                            frame_us(frames_[req.req].bytes.size()));
+      return req.reqEnd + us_to_cycles(std::max(0.0, turnaround));
+    }
+    return earliestAt;
+  }
+
+  // Puts every frame that is due on the bus; returns false once the capture is used up
+  bool inject_due(uint64_t t) {
+    for (;;) {
+      if (awaiting_ >= 0) {
+        const Transaction &w = tx_[(size_t)awaiting_];
+        const uint64_t done = w.haveReply ? w.replyEnd : w.reqEnd + us_to_cycles(opt_.timeout_ms * 1000.0);
+        if (!w.haveReply && t < done) return true;
+        awaiting_ = -1;
+        busFree_ = done + us_to_cycles(opt_.gap_ms * 1000.0);
+        nextAt_ = schedule_time(next_, busFree_);
+      }
+      if (next_ >= frames_.size()) return false;
+
+      // A replayed monitor answers for itself
+      const int ti = txOfFrame_[next_];
+      if (ti < 0 && tx_[(size_t)replyOfFrame_[next_]].replayed) {
+        nextAt_ = schedule_time(++next_, busFree_);
+        continue;
+      }
+      if (t < nextAt_) return true;
+
+      const Frame &fr = frames_[next_];
+      for (size_t k = 0; k < fr.bytes.size(); k++) {
+        for (Board *b : boards_) b->uartInject(MONITOR_MODBUS_UART, fr.bytes[k], nextAt_ + (k + 1) * chr_);
+      }
+      const uint64_t end = nextAt_ + fr.bytes.size() * chr_;
+      busFree_ = end + us_to_cycles(opt_.gap_ms * 1000.0);
+      quietUntil_ = std::max(quietUntil_, end + us_to_cycles(opt_.timeout_ms * 1000.0));
+      if (ti >= 0) {
+        Transaction &req = tx_[(size_t)ti];
+        req.reqEnd = end;
+        lastInjectedTx_ = (size_t)ti;
+        if (opt_.mode == Mode::FAST && req.replayed && modbus_reply_bytes(fr.bytes.data(), fr.bytes.size()) != 0) {
+          awaiting_ = ti;
+        }
+      }
+      nextAt_ = schedule_time(++next_, busFree_);
+    }
+  }
+
+  void pace(uint64_t t, const struct timespec &wall0) {
+    const double virt_s = (double)(t - origin_) / (CYCLES_PER_MS * 1000.0);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const double wall_s = (double)(now.tv_sec - wall0.tv_sec) + (double)(now.tv_nsec - wall0.tv_nsec) * 1e-9;
+    if (virt_s - wall_s > 0.0005) usleep((useconds_t)((virt_s - wall_s) * 1e6));
+  }
+
+  const Options &opt_;
+  const CaptureInfo &info_;
+  const std::vector<Frame> &frames_;
+  Board *mon_[SLAVE_COUNT];
+  std::vector<Board *> boards_;
+  std::vector<std::unique_ptr<FrameSplitter>> splitter_;
+  std::vector<Transaction> tx_;
+  std::vector<int> txOfFrame_;
+  std::vector<int> replyOfFrame_;
+  uint64_t chr_ = 0;
+  uint64_t origin_ = 0;
+  size_t next_ = 0;
+  uint64_t nextAt_ = 0;
+  uint64_t busFree_ = 0;        // fast mode: when the next request may start
+  int awaiting_ = -1;
+  size_t lastInjectedTx_ = 0;
+  uint64_t quietUntil_ = 0;
+  unsigned strayReplies_ = 0;
+  double wall_s_ = 0.0, virt_s_ = 0.0;
+};
+
+// ========================= Report =========================
+struct Latencies {
+  std::vector<double> ms;
+
+  double pct(double p) {
+    if (ms.empty()) return 0.0;
+    const size_t i = std::min(ms.size() - 1, (size_t)(p / 100.0 * (double)ms.size()));
+    std::nth_element(ms.begin(), ms.begin() + (long)i, ms.end());
+    return ms[i];
+  }
+};
+
+const char *describe(const Frame *f, char *buf, size_t n) {
+  if (!f) return "no reply";
+  if (f->bytes.size() >= 3 && (f->bytes[1] & 0x80)) {
+    snprintf(buf, n, "exception %u", f->bytes[2]);
+  } else {
+    snprintf(buf, n, "%zu B%s", f->bytes.size(), modbus_crc_ok(f->bytes.data(), f->bytes.size()) ? "" : " bad CRC");
+  }
+  return buf;
+}
+
+int Replay::report() {
+  const char *modeName = opt_.mode == Mode::FAST ? "fast" : (opt_.mode == Mode::WALL ? "wall" : "virtual");
+  size_t recReplies = 0;
+  for (const Transaction &t : tx_) recReplies += t.recReply >= 0;
+  const double span_s = frames_.empty() ? 0.0 : (double)frames_.back().start / 1e6;
+  printf("capture: %zu frames over %.1f s at %u baud, %zu requests, %zu replies\n", frames_.size(), span_s,
+         info_.baud, tx_.size(), recReplies);
+  printf("replay (%s): %.1f s simulated in %.1f s wall\n\n", modeName, virt_s_, wall_s_);
+
+  unsigned match[SLAVE_COUNT + 1] = {}, silent[SLAVE_COUNT + 1] = {}, differ[SLAVE_COUNT + 1] = {},
+           missing[SLAVE_COUNT + 1] = {}, extra[SLAVE_COUNT + 1] = {}, payload[SLAVE_COUNT + 1] = {},
+           slower[SLAVE_COUNT + 1] = {};
+  Latencies rec, rep;
+  unsigned reported = 0;
+  for (size_t i = 0; i < tx_.size(); i++) {
+    const Transaction &t = tx_[i];
+    if (!t.replayed || t.reqEnd == 0) continue;
+    const Frame &req = frames_[t.req];
+    const Frame *r = t.recReply >= 0 ? &frames_[(size_t)t.recReply] : nullptr;
+    const Frame *p = t.haveReply ? &t.reply : nullptr;
+
+    double recMs = 0.0, repMs = 0.0;
+    if (r) {
+      recMs = ((double)r->start + frame_us(r->bytes.size()) - (double)req.start - frame_us(req.bytes.size())) / 1000.0;
+      rec.ms.push_back(recMs);
+    }
+    if (p) {
+      repMs = (double)(t.replyEnd - t.reqEnd) / (double)CYCLES_PER_MS;
+      rep.ms.push_back(repMs);
+    }
+
+    const char *what = nullptr;
+    if (!r && !p) {
+      silent[t.id]++;
+    } else if (r && !p) {
+      missing[t.id]++;
+      what = "missing";
+    } else if (!r && p) {
+      extra[t.id]++;
+      what = "extra";
+    } else {
+      const bool sameShape = r->bytes.size() == p->bytes.size() && modbus_crc_ok(p->bytes.data(), p->bytes.size()) &&
+                             memcmp(r->bytes.data(), p->bytes.data(), 3) == 0;
+      if (!sameShape) {
+        differ[t.id]++;
+        what = "differs";
+      } else {
+        match[t.id]++;
+        if (r->bytes != p->bytes) payload[t.id]++;
+        if (repMs > recMs + opt_.slack_ms) {
+          slower[t.id]++;
+          what = "slower";
+        }
+      }
+    }
+    if (what && reported < opt_.maxReport) {
+      reported++;
+      char a[32], b[32];
+      printf("  frame %zu at %.3f s, slave %u FC%u %u+%u: %s; recorded %s after %.1f ms, replay %s after %.1f ms\n",
+             t.req, (double)req.start / 1e6, t.id, req.bytes[1], (unsigned)(req.bytes[2] << 8 | req.bytes[3]),
+             (unsigned)(req.bytes[4] << 8 | req.bytes[5]), what, describe(r, a, sizeof(a)), recMs,
+             describe(p, b, sizeof(b)), repMs);
+    }
+  }
+  if (reported) printf("\n");
+
+  printf("%6s %7s %7s %7s %7s %7s %8s %8s\n", "slave", "match", "silent", "differ", "missing", "extra", "payload",
+         "slower");
+  unsigned bad = 0;
+  for (uint8_t id = 1; id <= SLAVE_COUNT; id++) {
+    if (!opt_.selected[id]) continue;
+    printf("%6u %7u %7u %7u %7u %7u %8u %8u\n", id, match[id], silent[id], differ[id], missing[id], extra[id],
+           payload[id], slower[id]);
+    bad += differ[id] + missing[id] + extra[id];
+    if (opt_.mode != Mode::FAST) bad += slower[id];   // fast mode moves every request, so only report it
+  }
+  printf("\nlatency ms   %8s %8s %8s\n", "p50", "p99", "max");
+  printf("  recorded   %8.1f %8.1f %8.1f\n", rec.pct(50), rec.pct(99), rec.pct(100));
+  printf("  replay     %8.1f %8.1f %8.1f\n", rep.pct(50), rep.pct(99), rep.pct(100));
+  if (strayReplies_) printf("\n%u replay replies matched no request\n", strayReplies_);
+  printf("\n%s\n", bad ? "FAIL" : "ok");
+  return bad ? 1 : 0;
+}
+
+void dump(const CaptureInfo &info, const std::vector<Frame> &frames) {
+  std::vector<Transaction> tx;
+  std::vector<int> txOfFrame, replyOfFrame;
+  classify(frames, tx, txOfFrame, replyOfFrame);
+  printf("%u baud, %zu frames\n", info.baud, frames.size());
+  for (size_t f = 0; f < frames.size(); f++) {
+    const Frame &fr = frames[f];
+    printf("%12.3f ms %5s %3zu B%s ", (double)fr.start / 1000.0, txOfFrame[f] >= 0 ? "req" : "reply",
+           fr.bytes.size(), modbus_crc_ok(fr.bytes.data(), fr.bytes.size()) ? "    " : " CRC");
+    for (size_t i = 0; i < fr.bytes.size() && i < 24; i++) printf(" %02X", fr.bytes[i]);
+    printf("%s\n", fr.bytes.size() > 24 ? " ..." : "");
+  }
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: rs485_replay CAPTURE [options]\n"
+          "  --mode M        virtual (default): recorded timing on the virtual clock, unthrottled\n"
+          "                  wall: recorded timing in real time\n"
+          "                  fast: each request right after the previous transaction\n"
+          "  --ids LIST      slaves to replay (default 1,2,3,4); recorded replies stand in for the rest\n"
+          "  --at SECONDS    virtual time of the capture start (default: just after setup())\n"
+          "  --slack MS      extra reply time before it counts as a regression (default 5)\n"
+          "  --timeout MS    fast mode: wait this long for a reply (default 200)\n"
+          "  --gap MS        fast mode: silence after each transaction (default 5)\n"
+          "  --max-report N  differences listed individually (default 10)\n"
+          "  --dump          list the capture's frames and exit\n");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options opt;
+  for (int i = 1; i < argc; i++) {
+    const std::string a = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (a == "--mode" && hasValue) {
+      const std::string m = argv[++i];
+      if (m == "virtual") opt.mode = Mode::VIRTUAL;
+      else if (m == "wall") opt.mode = Mode::WALL;
+      else if (m == "fast") opt.mode = Mode::FAST;
+      else { usage(); return 2; }
+    } else if (a == "--ids" && hasValue) {
+      memset(opt.selected, 0, sizeof(opt.selected));
+      for (const char *p = argv[++i]; *p; p++) {
+        if (*p >= '1' && *p <= '0' + SLAVE_COUNT) opt.selected[*p - '0'] = true;
+        else if (*p != ',') { usage(); return 2; }
+      }
+    } else if (a == "--at" && hasValue) {
+      opt.at_s = atof(argv[++i]);
+    } else if (a == "--slack" && hasValue) {
+      opt.slack_ms = atof(argv[++i]);
+    } else if (a == "--timeout" && hasValue) {
+      opt.timeout_ms = atof(argv[++i]);
+    } else if (a == "--gap" && hasValue) {
+      opt.gap_ms = atof(argv[++i]);
+    } else if (a == "--max-report" && hasValue) {
+      opt.maxReport = (unsigned)atoi(argv[++i]);
+    } else if (a == "--dump") {
+      opt.dump = true;
+    } else if (a[0] != '-' && !opt.capture) {
+      opt.capture = argv[i];
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  bool any = false;
+  for (uint8_t id = 1; id <= SLAVE_COUNT; id++) any |= opt.selected[id];
+  if (!opt.capture || !any) {
+    usage();
+    return 2;
+  }
+
+  CaptureInfo info;
+  std::vector<Frame> frames;
+  if (!read_capture(opt.capture, info, frames)) return 1;
+  if (opt.dump) {
+    dump(info, frames);
+    return 0;
+  }
+
+  static Replay replay(opt, info, frames);
+  replay.run();
+  return replay.report();
+}
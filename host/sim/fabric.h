@@ -0,0 +1,91 @@
+/*
+  Knob Box - wiring between simulated boards
+
+  A net joins board pins and, optionally, an external source (a switch, a comparator).
+  The level follows the wired-logic rule of the real harness: any output driving low wins,
+  then any output driving high, then an external source, then any pull-up; otherwise
+  the net floats and every input on it reads its own PORT bit (pull-up or 0).
+*/
+#pragma once
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "../board/board.h"
+
+namespace kb {
+
+// External source on a net
+enum class Source : int8_t {
+  NONE = -1,         // open / Hi-Z
+  LOW_ = 0,          // pulled to ground (asserted switch, safe comparator)
+  HIGH_ = 1          // driven high
+};
+
+struct NetPin {
+  Board *board;
+  uint8_t pin;
+};
+
+struct Net {
+  std::string name;
+  std::vector<NetPin> pins;
+  Source source = Source::NONE;
+  int level = -1;
+  bool conflictReported = false;
+};
+
+class Fabric {
+ public:
+  size_t add(const std::string &name, std::vector<NetPin> pins) {
+    nets_.push_back(Net{name, std::move(pins)});
+    return nets_.size() - 1;
+  }
+
+  Net &net(size_t i) { return nets_[i]; }
+
+  void setSource(size_t i, Source s) {
+    if (nets_[i].source == s) return;
+    nets_[i].source = s;
+    resolve(nets_[i]);
+  }
+
+  // Re-resolves every net touching `b` (after one of its PORT/DDR writes)
+  void boardChanged(const Board *b) {
+    for (Net &n : nets_) {
+      for (const NetPin &p : n.pins) {
+        if (p.board == b) { resolve(n); break; }
+      }
+    }
+  }
+
+  void resolveAll() {
+    for (Net &n : nets_) resolve(n);
+  }
+
+ private:
+  void resolve(Net &n) {
+    bool low = n.source == Source::LOW_, high = n.source == Source::HIGH_, pull = false;
+    for (const NetPin &p : n.pins) {
+      switch (p.board->pinDrive(p.pin)) {
+        case PinDrive::DRIVEN_LOW: low = true; break;
+        case PinDrive::DRIVEN_HIGH: high = true; break;
+        case PinDrive::PULLED_UP: pull = true; break;
+        case PinDrive::FLOATING: break;
+      }
+    }
+    if (low && high && !n.conflictReported) {
+      fprintf(stderr, "fabric: net %s driven high and low at once\n", n.name.c_str());
+      n.conflictReported = true;
+    }
+    n.level = low ? 0 : (high || pull) ? 1 : -1;
+    for (const NetPin &p : n.pins) {
+      p.board->setPinInput(p.pin, n.level);
+    }
+  }
+
+  std::vector<Net> nets_;
+};
+
+}  // namespace kb
@@ -0,0 +1,651 @@
+/*
+  Knob Box - host simulator
+
+  Runs the Logic Arduino and the four monitor images in one process on a shared virtual
+  clock, wired together as the READMEs describe:
+
+    Logic D22-D37  -> +3kV monitor D22-D37        (live outputs, Nom Op, latched flags)
+    +3kV mon D14   -> Logic D14                   (ACK toggle)
+    Logic D9       -> +3kV monitor D9             (ACK echo)
+    Logic D41      -> +3kV monitor D47 (T5)       (loop heartbeat)
+    Logic TX1      -> +3kV monitor RX3            (status link)
+    switches       -> Logic D10-D13 / D15, monitor D7 / D8 / D11 / D12
+    comparators    -> Logic D42-D49 (open-drain, safe = LOW)
+
+  Each monitor's Serial1 (the RS-485 Modbus port) is exposed as its own pty, and a fifth
+  pty joins all four as one shared bus, the way the dashboard sees them.
+
+  With --capture, everything on the Modbus ports (dashboard requests and monitor replies) is
+  written to an RS-485 capture file for rs485_replay, stamped with virtual time.
+
+  Usage:
+    knob_box_sim [-s scenario.txt] [-d duration] [--pty] [--speed X] [--journal FILE]
+                 [--capture FILE] [-v]
+
+  Scenario lines are "<time> <command> [args]", time in us / ms / s (default ms):
+    0      switch 3kv on              3kv | beams | ccs | arm80kv | hv+1kv | hv-1kv | hv20kv
+    10s    press reset [200ms]
+    1s     vset +3kv 2500             supplies: +1kv -1kv +20kv +3kv (volts)
+    1s     load +3kv 1e6              load resistance (ohms)
+    1s     ithresh +3kv 8             current comparator threshold (mA)
+    1s     vthresh +3kv 2800          voltage comparator threshold (V)
+    20s    arc +3kv 5ms               current spike of 1.5x rated
+    30s    matsusada-reset            front panel reset of the +/-1kV supplies
+    40s    print                      outputs, flags and the LCD of every monitor
+    40s    regs +3kv                  Modbus registers of one monitor
+    60s    end
+*/
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../board/board.h"
+#include "../replay/capture.h"
+#include "fabric.h"
+#include "supplies.h"
+
+using namespace kb;
+
+namespace {
+
+// ========================= Options =========================
+struct Options {
+  const char *scenario = nullptr;
+  double duration_s = -1.0;       // < 0: until the scenario ends, or forever with --pty
+  bool pty = false;
+  double speed = 0.0;             // virtual seconds per wall second, 0 = as fast as possible
+  bool speedSet = false;
+  const char *journal = nullptr;
+  const char *capture = nullptr;
+  bool verbose = false;
+};
+
+enum SupplyId { POS1KV, NEG1KV, HV20KV, HV3KV, SUPPLY_COUNT };
+
+const char *const SUPPLY_NAMES[SUPPLY_COUNT] = {"+1kv", "-1kv", "+20kv", "+3kv"};
+
+// Logic comparator pins (V, I) per supply
+const uint8_t COMPARATOR_PINS[SUPPLY_COUNT][2] = {{42, 43}, {44, 45}, {46, 47}, {48, 49}};
+
+static constexpr uint8_t LOGIC_3KV_ENABLE_PIN = 56;   // A2 / PF2
+static constexpr uint8_t MONITOR_MODBUS_UART = 1;
+static constexpr uint8_t MONITOR_LINK_UART = 3;
+static constexpr uint8_t LOGIC_LINK_UART = 1;
+static constexpr uint8_t LOGIC_JOURNAL_UART = 0;
+static constexpr uint64_t SUPPLY_UPDATE_CYCLES = CYCLES_PER_MS;
+static constexpr uint64_t DEFAULT_BUS_CHAR_CYCLES = 16640;   // 9600 8N1 with U2X, before Serial1.begin
+
+// ========================= Scenario =========================
+struct Event {
+  uint64_t at;
+  std::vector<std::string> args;
+  int line;
+};
+
+bool parse_time(const std::string &s, uint64_t &cycles) {
+  char *end = nullptr;
+  const double v = strtod(s.c_str(), &end);
+  if (end == s.c_str() || v < 0.0) return false;
+  const std::string unit(end);
+  double scale = (double)CYCLES_PER_MS;
+  if (unit == "us") scale = (double)CYCLES_PER_US;
+  else if (unit == "s") scale = (double)CYCLES_PER_MS * 1000.0;
+  else if (!unit.empty() && unit != "ms") return false;
+  cycles = (uint64_t)(v * scale + 0.5);
+  return true;
+}
+
+bool load_scenario(const char *path, std::vector<Event> &events) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    fprintf(stderr, "sim: cannot open %s: %s\n", path, strerror(errno));
+    return false;
+  }
+  char line[256];
+  int n = 0;
+  while (fgets(line, sizeof(line), f)) {
+    n++;
+    char *hash = strchr(line, '#');
+    if (hash) *hash = '\0';
+    std::vector<std::string> tok;
+    for (char *t = strtok(line, " \t\r\n"); t; t = strtok(nullptr, " \t\r\n")) tok.emplace_back(t);
+    if (tok.empty()) continue;
+    Event e;
+    if (tok.size() < 2 || !parse_time(tok[0], e.at)) {
+      fprintf(stderr, "sim: %s:%d: expected \"<time> <command>\"\n", path, n);
+      fclose(f);
+      return false;
+    }
+    e.args.assign(tok.begin() + 1, tok.end());
+    e.line = n;
+    events.push_back(std::move(e));
+  }
+  fclose(f);
+  std::stable_sort(events.begin(), events.end(), [](const Event &a, const Event &b) { return a.at < b.at; });
+  return true;
+}
+
+// ========================= Pty =========================
+struct Pty {
+  int master = -1;
+  int slave = -1;                 // held open so the master never sees EIO between clients
+  std::string path;
+
+  bool open_pty() {
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) return false;
+    path = ptsname(master);
+    slave = open(path.c_str(), O_RDWR | O_NOCTTY);
+    if (slave < 0) return false;
+    struct termios t;
+    tcgetattr(slave, &t);
+    cfmakeraw(&t);
+    tcsetattr(slave, TCSANOW, &t);
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+    return true;
+  }
+
+  int read_some(uint8_t *buf, size_t len) {
+    const ssize_t n = ::read(master, buf, len);
+    return (n > 0) ? (int)n : 0;
+  }
+
+  void write_byte(uint8_t b) {
+    if (master >= 0 && ::write(master, &b, 1) < 0 && errno != EAGAIN) {
+      fprintf(stderr, "sim: pty %s: %s\n", path.c_str(), strerror(errno));
+    }
+  }
+};
+
+// ========================= Simulation =========================
+class Sim {
+ public:
+  explicit Sim(const Options &o)
+      : opt_(o),
+        logic_(kb_logic_board()),
+        mon_{&kb_monitor_board_1(), &kb_monitor_board_2(), &kb_monitor_board_3(), &kb_monitor_board_4()},
+        supply_{Supply("+1kV Matsusada", 1000.0, 30.0, true), Supply("-1kV Matsusada", 1000.0, 30.0, true),
+                Supply("+20kV Bertan", 20000.0, 1.0, false), Supply("+3kV Bertan", 3000.0, 10.0, false)} {}
+
+  bool init(const std::vector<Event> &events) {
+    events_ = events;
+    wire();
+    if (opt_.pty && !open_ptys()) return false;
+    if (opt_.journal) {
+      journal_ = fopen(opt_.journal, "wb");
+      if (!journal_) {
+        fprintf(stderr, "sim: cannot open %s: %s\n", opt_.journal, strerror(errno));
+        return false;
+      }
+    }
+
+    // Supplies idle, every comparator safe, then all five boards power up together
+    update_supplies(0);
+    logic_.powerOn(0);
+    for (Board *m : mon_) m->powerOn(0);
+    fabric_.resolveAll();
+    return !opt_.capture || open_capture();
+  }
+
+  int run() {
+    const uint64_t endAt = (opt_.duration_s < 0.0) ? UINT64_MAX
+                                                   : (uint64_t)(opt_.duration_s * 1000.0 * CYCLES_PER_MS);
+    const bool stopAtScenarioEnd = opt_.duration_s < 0.0 && !opt_.pty;
+    struct timespec wall0;
+    clock_gettime(CLOCK_MONOTONIC, &wall0);
+    uint64_t nextSupply = SUPPLY_UPDATE_CYCLES;
+    uint64_t nextPoll = 0;
+
+    while (!quit_) {
+      Board *b = earliest();
+      const uint64_t t = b->now();
+      if (t >= endAt) break;
+
+      while (nextEvent_ < events_.size() && events_[nextEvent_].at <= t) {
+        apply(events_[nextEvent_++]);
+      }
+      if (stopAtScenarioEnd && nextEvent_ >= events_.size()) break;
+
+      if (t >= nextSupply) {
+        update_supplies(t);
+        nextSupply += SUPPLY_UPDATE_CYCLES;
+      }
+      if (t >= nextPoll) {
+        pace(t, wall0);
+        poll_ptys(t);
+        nextPoll = t + SUPPLY_UPDATE_CYCLES;
+      }
+      flush_tx(t);
+      if (busSplitter_) busSplitter_->idle(t);
+
+      b->step();
+    }
+
+    summary(wall0);
+    return 0;
+  }
+
+ private:
+  Board &mon(SupplyId s) const { return *mon_[s]; }
+
+  Board *earliest() const {
+    Board *b = &logic_;
+    for (Board *m : mon_) {
+      if (m->now() < b->now()) b = m;
+    }
+    return b;
+  }
+
+  // ---------- wiring ----------
+  void wire() {
+    Board &m4 = mon(HV3KV);
+    for (uint8_t pin = 22; pin <= 37; pin++) {
+      fabric_.add("D" + std::to_string(pin), {{&logic_, pin}, {&m4, pin}});
+    }
+    fabric_.add("ACK D14", {{&logic_, 14}, {&m4, 14}});
+    fabric_.add("ACK echo D9", {{&logic_, 9}, {&m4, 9}});
+    fabric_.add("heartbeat D41-D47", {{&logic_, 41}, {&m4, 47}});
+
+    switchNet_["3kv"] = fabric_.add("3kV HV switch", {{&logic_, 10}, {&m4, 7}});
+    switchNet_["beams"] = fabric_.add("arm beams switch", {{&logic_, 11}, {&m4, 11}});
+    switchNet_["ccs"] = fabric_.add("CCS power switch", {{&logic_, 12}, {&m4, 12}});
+    switchNet_["arm80kv"] = fabric_.add("arm 80kV switch", {{&logic_, 13}, {&m4, 8}});
+    switchNet_["hv+1kv"] = fabric_.add("+1kV HV switch", {{&mon(POS1KV), 7}});
+    switchNet_["hv-1kv"] = fabric_.add("-1kV HV switch", {{&mon(NEG1KV), 7}});
+    switchNet_["hv20kv"] = fabric_.add("+20kV HV switch", {{&mon(HV20KV), 7}});
+    resetNet_ = fabric_.add("reset button", {{&logic_, 15}});
+    for (int s = 0; s < SUPPLY_COUNT; s++) {
+      for (int k = 0; k < 2; k++) {
+        compNet_[s][k] = fabric_.add(std::string(SUPPLY_NAMES[s]) + (k ? " I comparator" : " V comparator"),
+                                     {{&logic_, COMPARATOR_PINS[s][k]}});
+      }
+    }
+    // The +20kV Bertan HV switch is active-high: open (pulled up) is on, so start it closed
+    fabric_.setSource(switchNet_["hv20kv"], Source::LOW_);
+
+    logic_.onPinsChanged([this] { fabric_.boardChanged(&logic_); });
+    logic_.onPortWrite([this](char port, uint8_t v, uint64_t at) { log_logic_port(port, v, at); });
+    for (Board *m : mon_) m->onPinsChanged([this, m] { fabric_.boardChanged(m); });
+
+    logic_.onUartTx(LOGIC_LINK_UART, [this](uint8_t b, uint64_t at) {
+      mon(HV3KV).uartInject(MONITOR_LINK_UART, b, at);
+    });
+    logic_.onUartTx(LOGIC_JOURNAL_UART, [this](uint8_t b, uint64_t) {
+      if (journal_) fputc(b, journal_);
+    });
+    for (int s = 0; s < SUPPLY_COUNT; s++) {
+      mon_[s]->onUartTx(MONITOR_MODBUS_UART, [this, s](uint8_t b, uint64_t at) {
+        txQueue_.push_back({at, s, b});
+        // Every monitor on the RS-485 bus hears the others' replies
+        for (int o = 0; o < SUPPLY_COUNT; o++) {
+          if (o != s) mon_[o]->uartInject(MONITOR_MODBUS_UART, b, at);
+        }
+      });
+    }
+  }
+
+  // Needs the monitors' line rate, so only after setup() has run
+  bool open_capture() {
+    const uint64_t chr = mon_[0]->uartCharCycles(MONITOR_MODBUS_UART);
+    CaptureInfo info;
+    info.baud = (uint32_t)(CYCLES_PER_MS * 1000 * 10 / chr);
+    if (!capture_.open(opt_.capture, info)) return false;
+    // Frames end after 3.5 quiet characters
+    busSplitter_.reset(new FrameSplitter(chr, chr * 7 / 2, [this](const Frame &fr) {
+      Frame us = fr;
+      us.start = fr.start / CYCLES_PER_US;
+      capture_.write(us);
+    }));
+    return true;
+  }
+
+  bool open_ptys() {
+    for (int s = 0; s <= SUPPLY_COUNT; s++) {
+      if (!pty_[s].open_pty()) {
+        fprintf(stderr, "sim: cannot allocate a pty: %s\n", strerror(errno));
+        return false;
+      }
+      printf("%-13s Modbus on %s\n", s < SUPPLY_COUNT ? mon_[s]->name() : "shared bus", pty_[s].path.c_str());
+    }
+    fflush(stdout);
+    return true;
+  }
+
+  // ---------- supplies and comparators ----------
+  void update_supplies(uint64_t t) {
+    const double dt = (double)SUPPLY_UPDATE_CYCLES / (CYCLES_PER_MS * 1000.0);
+    for (int s = 0; s < SUPPLY_COUNT; s++) {
+      Supply &p = supply_[s];
+      const Net &sw = fabric_.net(switchNet_[HV_SWITCH[s]]);
+      // asserted switches pull low, except the +20kV enable which is on when open
+      p.enabled = (s == HV20KV) ? sw.source != Source::LOW_ : sw.source == Source::LOW_;
+      if (s == HV3KV) p.enabled = p.enabled && logic_.pinLevel(LOGIC_3KV_ENABLE_PIN);
+      p.update(dt, t);
+
+      Board &m = *mon_[s];
+      m.setAdsCounts(0, p.vsetCounts());
+      m.setAdsCounts(1, p.imonCounts());
+      m.setAdsCounts(2, p.vmonCounts());
+      m.setAnalog(0, p.iPotCounts());
+      m.setAnalog(1, p.vPotCounts());
+
+      fabric_.setSource(compNet_[s][0], p.voltageFault() ? Source::NONE : Source::LOW_);
+      fabric_.setSource(compNet_[s][1], p.currentFault() ? Source::NONE : Source::LOW_);
+    }
+  }
+
+  // ---------- serial ----------
+  struct TxByte {
+    uint64_t at;
+    int supply;
+    uint8_t b;
+  };
+
+  void flush_tx(uint64_t t) {
+    while (!txQueue_.empty() && txQueue_.front().at <= t) {
+      const TxByte &x = txQueue_.front();
+      if (busSplitter_) busSplitter_->push(x.b, x.at);
+      if (opt_.pty) {
+        pty_[x.supply].write_byte(x.b);
+        pty_[SUPPLY_COUNT].write_byte(x.b);
+      }
+      txQueue_.pop_front();
+    }
+  }
+
+  void poll_ptys(uint64_t t) {
+    if (!opt_.pty) return;
+    uint8_t buf[256];
+    for (int s = 0; s <= SUPPLY_COUNT; s++) {
+      const int n = pty_[s].read_some(buf, sizeof(buf));
+      for (int i = 0; i < n; i++) {
+        // Bytes from the dashboard arrive back to back at the monitors' line rate
+        uint64_t chr = mon_[0]->uartCharCycles(MONITOR_MODBUS_UART);
+        if (chr == 0) chr = DEFAULT_BUS_CHAR_CYCLES;
+        rxArrival_[s] = std::max(rxArrival_[s], t) + chr;
+        if (busSplitter_) busSplitter_->push(buf[i], rxArrival_[s]);
+        if (s < SUPPLY_COUNT) {
+          mon_[s]->uartInject(MONITOR_MODBUS_UART, buf[i], rxArrival_[s]);
+        } else {
+          for (Board *m : mon_) m->uartInject(MONITOR_MODBUS_UART, buf[i], rxArrival_[s]);
+        }
+      }
+    }
+  }
+
+  // Holds virtual time to `speed` times wall time
+  void pace(uint64_t t, const struct timespec &wall0) {
+    if (opt_.speed <= 0.0) return;
+    const double virt_s = (double)t / (CYCLES_PER_MS * 1000.0);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const double wall_s = (double)(now.tv_sec - wall0.tv_sec) + (double)(now.tv_nsec - wall0.tv_nsec) * 1e-9;
+    const double ahead = virt_s / opt_.speed - wall_s;
+    if (ahead > 0.0005) {
+      if (opt_.pty) {
+        struct pollfd fds[SUPPLY_COUNT + 1];
+        for (int s = 0; s <= SUPPLY_COUNT; s++) fds[s] = {pty_[s].master, POLLIN, 0};
+        poll(fds, SUPPLY_COUNT + 1, (int)(ahead * 1000.0));
+      } else {
+        usleep((useconds_t)(ahead * 1e6));
+      }
+    }
+  }
+
+  // ---------- scenario ----------
+  int supply_arg(const Event &e, size_t i) {
+    if (i < e.args.size()) {
+      for (int s = 0; s < SUPPLY_COUNT; s++) {
+        if (e.args[i] == SUPPLY_NAMES[s]) return s;
+      }
+    }
+    bad(e, "expected a supply: +1kv -1kv +20kv +3kv");
+    return -1;
+  }
+
+  bool number_arg(const Event &e, size_t i, double &v) {
+    char *end = nullptr;
+    if (i < e.args.size()) {
+      v = strtod(e.args[i].c_str(), &end);
+      if (end != e.args[i].c_str() && *end == '\0') return true;
+    }
+    bad(e, "expected a number");
+    return false;
+  }
+
+  void bad(const Event &e, const char *why) {
+    fprintf(stderr, "sim: scenario line %d: %s\n", e.line, why);
+  }
+
+  void apply(const Event &e) {
+    const std::string &cmd = e.args[0];
+    const uint64_t t = e.at;
+    double v = 0.0;
+    if (opt_.verbose) {
+      std::string all;
+      for (const std::string &a : e.args) all += " " + a;
+      stamp(t);
+      printf("scenario%s\n", all.c_str());
+    }
+
+    if (cmd == "switch" && e.args.size() == 3 && switchNet_.count(e.args[1])) {
+      const bool on = e.args[2] == "on";
+      const bool activeHigh = e.args[1] == "hv20kv";
+      fabric_.setSource(switchNet_[e.args[1]], (on != activeHigh) ? Source::LOW_ : Source::NONE);
+    } else if (cmd == "press" && e.args.size() >= 2 && e.args[1] == "reset") {
+      uint64_t hold = 200 * CYCLES_PER_MS;
+      if (e.args.size() >= 3 && !parse_time(e.args[2], hold)) return bad(e, "bad duration");
+      fabric_.setSource(resetNet_, Source::LOW_);
+      insert_event({t + hold, {"release", "reset"}, e.line});
+    } else if (cmd == "release") {
+      fabric_.setSource(resetNet_, Source::NONE);
+    } else if (cmd == "vset" || cmd == "load" || cmd == "ithresh" || cmd == "vthresh") {
+      const int s = supply_arg(e, 1);
+      if (s < 0 || !number_arg(e, 2, v)) return;
+      Supply &p = supply_[s];
+      if (cmd == "vset") p.vset_V = std::min(fabs(v), p.ratedV);
+      else if (cmd == "load") p.loadOhm = std::max(v, 1.0);
+      else if (cmd == "ithresh") p.iThresh_mA = v;
+      else p.vThresh_V = v;
+    } else if (cmd == "arc") {
+      const int s = supply_arg(e, 1);
+      uint64_t len = 0;
+      if (s < 0) return;
+      if (e.args.size() < 3 || !parse_time(e.args[2], len)) return bad(e, "bad duration");
+      supply_[s].arcUntil = t + len;
+    } else if (cmd == "matsusada-reset") {
+      supply_[POS1KV].inReset = supply_[NEG1KV].inReset = false;
+    } else if (cmd == "print" || cmd == "lcd") {
+      print_state(t, cmd == "lcd");
+    } else if (cmd == "regs") {
+      const int s = supply_arg(e, 1);
+      if (s >= 0) print_regs(t, *mon_[s]);
+    } else if (cmd == "end") {
+      quit_ = true;
+    } else {
+      bad(e, "unknown command");
+    }
+  }
+
+  void insert_event(Event e) {
+    auto it = std::upper_bound(events_.begin() + (long)nextEvent_, events_.end(), e,
+                               [](const Event &a, const Event &b) { return a.at < b.at; });
+    events_.insert(it, std::move(e));
+  }
+
+  // ---------- output ----------
+  static void stamp(uint64_t t) {
+    printf("[%10.3f ms] ", (double)t / CYCLES_PER_MS);
+  }
+
+  void log_logic_port(char port, uint8_t v, uint64_t at) {
+    static const char *const F_NAMES[3] = {"CCS enable", "Beam enable", "3kV enable"};
+    if (port == 'F') {
+      for (int i = 0; i < 3; i++) {
+        if (((v ^ lastPortF_) >> i) & 1) {
+          stamp(at);
+          printf("logic %-11s %s\n", F_NAMES[i], ((v >> i) & 1) ? "ON" : "off");
+        }
+      }
+      lastPortF_ = v;
+    } else if (port == 'A') {
+      const uint8_t changed = (uint8_t)(v ^ lastPortA_);
+      if (changed & _BV_(3)) {
+        stamp(at);
+        printf("logic Nom Op      %s\n", (v & _BV_(3)) ? "ENTER" : "exit");
+      }
+      if ((changed & _BV_(4)) && (v & _BV_(4))) {
+        stamp(at);
+        printf("logic 3kV timer event latched (D26)\n");
+      }
+      lastPortA_ = v;
+    } else if (port == 'C' && opt_.verbose && v != lastPortC_) {
+      stamp(at);
+      printf("logic comparator latches D30-D37 = 0x%02X\n", v);
+      lastPortC_ = v;
+    }
+  }
+
+  static constexpr uint8_t _BV_(int b) { return (uint8_t)(1u << b); }
+
+  void print_state(uint64_t t, bool lcdOnly) {
+    stamp(t);
+    printf("state\n");
+    if (!lcdOnly) {
+      printf("  logic  PORTF=0x%02X PORTA=0x%02X PORTC=0x%02X%s\n", logic_.portOutput('F'), logic_.portOutput('A'),
+             logic_.portOutput('C'), logic_.watchdogTripped() ? "  WATCHDOG TIMEOUT" : "");
+      for (int s = 0; s < SUPPLY_COUNT; s++) {
+        const Supply &p = supply_[s];
+        printf("  %-15s %s V=%8.1f V  I=%7.3f mA%s\n", p.name, p.enabled ? "on " : "off", p.vOut_V, p.i_mA,
+               p.inReset ? "  (in reset)" : "");
+      }
+    }
+    for (Board *m : mon_) {
+      printf("  %s%s\n", m->name(), m->watchdogTripped() ? "  WATCHDOG TIMEOUT" : "");
+      for (uint8_t r = 0; r < 4; r++) printf("    |%-20s|\n", m->lcdLine(r));
+    }
+    fflush(stdout);
+  }
+
+  void print_regs(uint64_t t, const Board &m) {
+    stamp(t);
+    printf("%s registers\n", m.name());
+    uint16_t v;
+    for (uint16_t a = 0; m.inputRegister(a, v); a++) {
+      printf("  %3u: %5u (0x%04X)%s", a, v, v, (a % 4 == 3) ? "\n" : "");
+    }
+    printf("\n");
+    fflush(stdout);
+  }
+
+  void summary(const struct timespec &wall0) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const double wall_s = (double)(now.tv_sec - wall0.tv_sec) + (double)(now.tv_nsec - wall0.tv_nsec) * 1e-9;
+    const double virt_s = (double)earliest()->now() / (CYCLES_PER_MS * 1000.0);
+    printf("simulated %.3f s in %.3f s wall (%.1fx)\n", virt_s, wall_s, wall_s > 0.0 ? virt_s / wall_s : 0.0);
+    if (logic_.watchdogTripped()) printf("logic: watchdog timed out\n");
+    for (Board *m : mon_) {
+      if (m->watchdogTripped()) printf("%s: watchdog timed out\n", m->name());
+    }
+    if (journal_) fclose(journal_);
+    if (busSplitter_) {
+      busSplitter_->finish();
+      capture_.close();
+      printf("capture: %llu frames -> %s\n", (unsigned long long)capture_.frames(), opt_.capture);
+    }
+  }
+
+  static constexpr const char *HV_SWITCH[SUPPLY_COUNT] = {"hv+1kv", "hv-1kv", "hv20kv", "3kv"};
+
+  const Options &opt_;
+  Board &logic_;
+  Board *mon_[SUPPLY_COUNT];
+  Supply supply_[SUPPLY_COUNT];
+  Fabric fabric_;
+  std::map<std::string, size_t> switchNet_;
+  size_t resetNet_ = 0;
+  size_t compNet_[SUPPLY_COUNT][2] = {};
+  std::vector<Event> events_;
+  size_t nextEvent_ = 0;
+  bool quit_ = false;
+  Pty pty_[SUPPLY_COUNT + 1];
+  uint64_t rxArrival_[SUPPLY_COUNT + 1] = {};
+  std::deque<TxByte> txQueue_;
+  FILE *journal_ = nullptr;
+  CaptureWriter capture_;
+  std::unique_ptr<FrameSplitter> busSplitter_;   // Modbus port bytes, in cycles
+  uint8_t lastPortF_ = 0, lastPortA_ = 0, lastPortC_ = 0;
+};
+
+void usage() {
+  fprintf(stderr,
+          "usage: knob_box_sim [-s scenario.txt] [-d duration] [--pty] [--speed X] [--journal FILE]\n"
+          "                    [--capture FILE] [-v]\n"
+          "  -s FILE        scenario script (see the header of knob_box_sim.cpp)\n"
+          "  -d DURATION    stop after this much virtual time (e.g. 90s, 2500ms)\n"
+          "  --pty          expose each monitor's Modbus port, and the shared bus, as a pty\n"
+          "  --speed X      virtual seconds per wall second (default: as fast as possible,\n"
+          "                 or 1 with --pty); 0 = unthrottled\n"
+          "  --journal FILE write the Logic Arduino transition journal (USART0) to FILE\n"
+          "  --capture FILE write the Modbus traffic to an RS-485 capture for rs485_replay\n"
+          "  -v             log scenario events and comparator latches\n");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options opt;
+  for (int i = 1; i < argc; i++) {
+    const std::string a = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (a == "-s" && hasValue) {
+      opt.scenario = argv[++i];
+    } else if (a == "-d" && hasValue) {
+      uint64_t c;
+      if (!parse_time(argv[++i], c)) { usage(); return 2; }
+      opt.duration_s = (double)c / (CYCLES_PER_MS * 1000.0);
+    } else if (a == "--pty") {
+      opt.pty = true;
+    } else if (a == "--speed" && hasValue) {
+      opt.speed = atof(argv[++i]);
+      opt.speedSet = true;
+    } else if (a == "--journal" && hasValue) {
+      opt.journal = argv[++i];
+    } else if (a == "--capture" && hasValue) {
+      opt.capture = argv[++i];
+    } else if (a == "-v") {
+      opt.verbose = true;
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  if (opt.pty && !opt.speedSet) opt.speed = 1.0;
+  if (!opt.scenario && !opt.pty && opt.duration_s < 0.0) {
+    usage();
+    return 2;
+  }
+
+  std::vector<Event> events;
+  if (opt.scenario && !load_scenario(opt.scenario, events)) return 1;
+
+  static Sim sim(opt);
+  if (!sim.init(events)) return 1;
+  return sim.run();
+}
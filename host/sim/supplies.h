@@ -0,0 +1,70 @@
+/*
+  Knob Box - stub models of the four HV supplies and their comparators
+
+  Just enough behaviour to exercise the firmware: the output follows Vset with a first-order
+  lag while enabled, the load is a resistor, an arc adds a current spike for a while, and a
+  Matsusada that sees more than its rated current drops into its reset state until the
+  panel reset is pressed. The comparators trip when current or voltage passes the threshold
+  set on the trim pots, which the monitors read on A0 / A1.
+*/
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+namespace kb {
+
+static constexpr double ADS_VOLTS_PER_COUNT = 0.1875e-3;   // GAIN_TWOTHIRDS
+static constexpr double SUPPLY_TAU_S = 0.020;              // output slew time constant
+
+struct Supply {
+  const char *name;
+  double ratedV;
+  double ratedI_mA;
+  bool matsusada;
+
+  // panel / environment
+  double vset_V = 0.0;              // front-panel voltage knob
+  double loadOhm = 100e6;           // external load
+  double iThresh_mA;                // current comparator trim pot
+  double vThresh_V;                 // voltage comparator trim pot
+  uint64_t arcUntil = 0;            // arc current present until this cycle
+
+  // state
+  bool enabled = false;             // HV switch (and the Logic 3kV enable for the 3kV)
+  bool inReset = false;             // Matsusada internal reset latched
+  double vOut_V = 0.0;
+  double i_mA = 0.0;
+
+  Supply(const char *n, double v, double i, bool m)
+      : name(n), ratedV(v), ratedI_mA(i), matsusada(m), iThresh_mA(i), vThresh_V(v) {}
+
+  void update(double dt_s, uint64_t now) {
+    const double target = (enabled && !inReset) ? vset_V : 0.0;
+    vOut_V += (target - vOut_V) * (1.0 - exp(-dt_s / SUPPLY_TAU_S));
+    i_mA = vOut_V / loadOhm * 1000.0;
+    if (now < arcUntil && enabled && !inReset) {
+      i_mA += ratedI_mA * 1.5;
+    }
+    if (matsusada && i_mA > ratedI_mA) {
+      inReset = true;
+      vOut_V = 0.0;
+    }
+  }
+
+  bool currentFault() const { return i_mA > iThresh_mA; }
+  bool voltageFault() const { return vOut_V > vThresh_V; }
+
+  static int16_t ads_counts(double volts) {
+    const double c = volts / ADS_VOLTS_PER_COUNT;
+    return (int16_t)(c > 32767.0 ? 32767.0 : (c < 0.0 ? 0.0 : c));
+  }
+  // 0-5 V monitor signals scaled to the rating
+  int16_t vsetCounts() const { return ads_counts(vset_V / ratedV * 5.0); }
+  int16_t vmonCounts() const { return ads_counts(vOut_V / ratedV * 5.0); }
+  int16_t imonCounts() const { return ads_counts(i_mA / ratedI_mA * 5.0); }
+  uint16_t iPotCounts() const { return (uint16_t)lround(fmin(iThresh_mA / ratedI_mA, 1.0) * 1023.0); }
+  uint16_t vPotCounts() const { return (uint16_t)lround(fmin(vThresh_V / ratedV, 1.0) * 1023.0); }
+};
+
+}  // namespace kb
@@ -0,0 +1,659 @@
+/*
+  Knob Box - cycle-accurate timing report under simavr
+
+  Runs a compiled AVR image (the Arduino build's .elf) of logic_arduino.cpp or
+  monitor_firmware.cpp on simavr's ATmega2560 at 16 MHz, drives its input pins from a
+  stimulus script and timestamps every output edge with the simulator's cycle counter.
+  Unlike the host builds in host/board, the times here are the real instruction timing of
+  the compiled code.
+
+  Script (times are absolute, from reset: 1234, 1234cyc, 50us, 20ms, 6s):
+    latency NAME FROM rise|fall TO rise|fall   each FROM edge, to the next TO edge
+    period NAME PIN                            between edges of PIN
+    TIME set PIN 0|1                           drive an input (PIN = PB4, PL6, ...)
+    TIME modbus ID FC ADDR COUNT               a read request on Serial1 (monitor images)
+    TIME end
+  Without -s a built-in script is used, see --print-script: for the logic image, 32
+  comparator trips from Nom Op at staggered phases of the loop, for the +1kV and +3kV
+  comparators; for a monitor image, 40 FC4 reads of registers 0-5 at staggered phases of
+  its 150 ms / 200 ms timers. Modbus reply latency, from the end of the request's last
+  byte to the first reply byte written to UDR1, is always measured as `modbus_reply`.
+
+  The monitor image needs an ADS1115 and a PCF8574 LCD backpack on I2C; both are
+  emulated, the ADS1115 returning fixed counts per channel (--ads).
+
+  --csv writes metric,samples,min,mean,max (cycles) for a later --baseline run, which
+  lists every metric whose mean or max grew past --tolerance, or that lost a sample.
+
+  Report only: this harness has not yet run under simavr and no baselines are checked in,
+  so a --baseline comparison exits 0 whatever it finds. --gate makes a regression exit 1;
+  use it only against baselines taken from a real run of the same image build.
+
+  Usage:
+    avr_timing ELF [--monitor] [-s SCRIPT] [-b BAUD] [--ads I,V,S] [--csv FILE]
+               [--baseline FILE] [--tolerance PCT] [--gate] [--print-script] [-v]
+*/
+#include <simavr/avr_ioport.h>
+#include <simavr/avr_twi.h>
+#include <simavr/avr_uart.h>
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_irq.h>
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../common/modbus_frame.h"
+
+namespace {
+
+static constexpr uint32_t F_CPU_HZ = 16000000;
+
+// ========================= Script =========================
+struct Pin {
+  char port = 0;                  // 'A'..'L'
+  uint8_t bit = 0;
+};
+
+struct Event {
+  uint64_t at = 0;                // cycle
+  enum Kind { SET, MODBUS, END } kind = SET;
+  Pin pin;
+  int level = 0;
+  uint8_t id = 0, fc = 0;
+  uint16_t addr = 0, count = 0;
+};
+
+struct EdgeProbe {
+  std::string name;
+  bool isPeriod = false;
+  Pin from, to;
+  bool fromRise = true, toRise = false;
+  bool armed = false;
+  uint64_t start = 0;
+  std::vector<uint64_t> samples;
+  uint64_t missed = 0;            // a FROM edge with no TO edge before the next one
+};
+
+bool parse_pin(const std::string &s, Pin &p) {
+  if (s.size() != 3 || s[0] != 'P' || s[1] < 'A' || s[1] > 'L' || s[1] == 'I' || s[2] < '0' || s[2] > '7') return false;
+  p.port = s[1];
+  p.bit = (uint8_t)(s[2] - '0');
+  return true;
+}
+
+bool parse_time(const std::string &s, uint64_t &cycles) {
+  char *end = nullptr;
+  const double v = strtod(s.c_str(), &end);
+  const std::string unit = end ? end : "";
+  if (end == s.c_str() || v < 0.0) return false;
+  double scale;
+  if (unit.empty() || unit == "cyc") {
+    scale = 1.0;
+  } else if (unit == "us") {
+    scale = F_CPU_HZ / 1e6;
+  } else if (unit == "ms") {
+    scale = F_CPU_HZ / 1e3;
+  } else if (unit == "s") {
+    scale = F_CPU_HZ;
+  } else {
+    return false;
+  }
+  cycles = (uint64_t)llround(v * scale);
+  return true;
+}
+
+bool parse_script(const std::string &text, std::vector<Event> &events, std::vector<EdgeProbe> &probes) {
+  std::istringstream in(text);
+  std::string line;
+  int n = 0;
+  while (std::getline(in, line)) {
+    n++;
+    const size_t hash = line.find('#');
+    if (hash != std::string::npos) line.resize(hash);
+    std::istringstream ls(line);
+    std::vector<std::string> w;
+    for (std::string t; ls >> t;) w.push_back(t);
+    if (w.empty()) continue;
+
+    bool ok = false;
+    if (w[0] == "latency" && w.size() == 6) {
+      EdgeProbe p;
+      p.name = w[1];
+      ok = parse_pin(w[2], p.from) && parse_pin(w[4], p.to) && (w[3] == "rise" || w[3] == "fall") &&
+           (w[5] == "rise" || w[5] == "fall");
+      p.fromRise = w[3] == "rise";
+      p.toRise = w[5] == "rise";
+      if (ok) probes.push_back(p);
+    } else if (w[0] == "period" && w.size() == 3) {
+      EdgeProbe p;
+      p.name = w[1];
+      p.isPeriod = true;
+      ok = parse_pin(w[2], p.from);
+      p.to = p.from;
+      if (ok) probes.push_back(p);
+    } else if (w.size() >= 2) {
+      Event e;
+      ok = parse_time(w[0], e.at);
+      if (w[1] == "set" && w.size() == 4) {
+        e.kind = Event::SET;
+        ok = ok && parse_pin(w[2], e.pin) && (w[3] == "0" || w[3] == "1");
+        e.level = w[3] == "1";
+      } else if (w[1] == "modbus" && w.size() == 6) {
+        e.kind = Event::MODBUS;
+        e.id = (uint8_t)atoi(w[2].c_str());
+        e.fc = (uint8_t)atoi(w[3].c_str());
+        e.addr = (uint16_t)atoi(w[4].c_str());
+        e.count = (uint16_t)atoi(w[5].c_str());
+      } else if (w[1] == "end" && w.size() == 2) {
+        e.kind = Event::END;
+      } else {
+        ok = false;
+      }
+      if (ok) events.push_back(e);
+    }
+    if (!ok) {
+      fprintf(stderr, "avr_timing: script line %d: %s\n", n, line.c_str());
+      return false;
+    }
+  }
+  std::stable_sort(events.begin(), events.end(), [](const Event &a, const Event &b) { return a.at < b.at; });
+  return true;
+}
+
+// Nom Op armed with every switch on, then `phases` trips per comparator, each one `step`
+// cycles later in the loop than the one before
+std::string logic_script(int phases, int step) {
+  std::ostringstream s;
+  s << "# Logic Arduino: trip-to-output latency from Nom Op, and the loop period\n"
+       "latency trip_ccs_1kv PL6 rise PF0 fall        # +1kV current comparator -> CCS off\n"
+       "latency trip_beams_1kv PL6 rise PF1 fall      # -> Beams off\n"
+       "latency quench_3kv PL0 rise PF2 fall          # 3kV current comparator -> 3kV enable off\n"
+       "period loop_pass PG0                          # D41 heartbeat, one edge per step()\n"
+       "0 set PL0 0\n0 set PL1 0\n0 set PL2 0\n0 set PL3 0\n0 set PL4 0\n0 set PL5 0\n0 set PL6 0\n0 set PL7 0\n"
+       "0 set PJ0 1                                   # reset button released\n"
+       "0 set PJ1 1                                   # ACK idle\n"
+       "0 set PB4 1\n0 set PB5 1\n0 set PB6 1\n0 set PB7 1\n"
+       "20ms set PB4 0\n20ms set PB5 0\n20ms set PB6 0\n20ms set PB7 0   # every switch on\n";
+  uint64_t t = 50 * 16000;   // cycles
+  const char *comps[] = {"PL6", "PL0"};
+  for (const char *comp : comps) {
+    for (int k = 0; k < phases; k++) {
+      s << t << " set PJ0 0\n" << t + 5 * 16000 << " set PJ0 1\n";               // press reset: Nom Op
+      s << t + 15 * 16000 + (uint64_t)k * step << " set " << comp << " 1\n";    // trip
+      s << t + 25 * 16000 << " set " << comp << " 0\n";
+      t += 150 * 16000;                                                           // past the 100 ms 3kV lockout
+    }
+  }
+  s << t << " end\n";
+  return s.str();
+}
+
+std::string monitor_script(int id, int requests) {
+  std::ostringstream s;
+  s << "# Monitor: Modbus reply latency across the read/display timer phases\n";
+  uint64_t t = 6 * F_CPU_HZ;     // after the 5 s splash screen
+  for (int k = 0; k < requests; k++) {
+    s << t << " modbus " << id << " 4 0 6\n";
+    t += 97 * 16000 + 3 * 16000 / 10;    // 97.3 ms: walks across both timers
+  }
+  s << t + 500 * 16000 << " end\n";
+  return s.str();
+}
+
+// ========================= Simulated board =========================
+struct Harness;
+
+struct PinWatch {
+  Harness *h;
+  Pin pin;
+  int level = -1;
+};
+
+struct Harness {
+  avr_t *avr = nullptr;
+  bool verbose = false;
+  std::vector<EdgeProbe> probes;
+  std::vector<PinWatch *> watches;
+  uint8_t extLevel[12] = {0};
+  uint8_t extMask[12] = {0};
+
+  // Modbus on USART1
+  uint64_t charCycles = 0;
+  bool awaiting = false;
+  uint64_t requestEnd = 0;
+  std::vector<uint8_t> reply;
+  EdgeProbe modbus;
+  uint64_t badReplies = 0;
+
+  // I2C: ADS1115 at 0x48, PCF8574 at 0x27
+  avr_irq_t *twi = nullptr;
+  uint8_t twiSelected = 0;
+  int twiIndex = 0;
+  uint8_t adsPointer = 0;
+  uint16_t adsConfig = 0x8583;
+  uint16_t adsWrite = 0;
+  int16_t adsCounts[4] = {0, 0, 0, 0};
+  int twiReadIndex = 0;
+
+  void edge(const Pin &pin, int level) {
+    const uint64_t now = avr->cycle;
+    for (EdgeProbe &p : probes) {
+      if (p.isPeriod) {
+        if (p.from.port == pin.port && p.from.bit == pin.bit) {
+          if (p.armed) p.samples.push_back(now - p.start);
+          p.armed = true;
+          p.start = now;
+        }
+        continue;
+      }
+      if (p.from.port == pin.port && p.from.bit == pin.bit && level == (p.fromRise ? 1 : 0)) {
+        if (p.armed) p.missed++;
+        p.armed = true;
+        p.start = now;
+      }
+      if (p.to.port == pin.port && p.to.bit == pin.bit && level == (p.toRise ? 1 : 0) && p.armed) {
+        p.samples.push_back(now - p.start);
+        p.armed = false;
+      }
+    }
+  }
+
+  // Outputs: every change the firmware makes to a watched pin
+  static void pin_changed(avr_irq_t *, uint32_t value, void *param) {
+    PinWatch *w = (PinWatch *)param;
+    const int level = value ? 1 : 0;
+    if (level == w->level) return;
+    w->level = level;
+    const int port = w->pin.port - 'A';
+    if (w->h->extMask[port] & (1u << w->pin.bit)) return;    // an input we drive: recorded in drive()
+    if (w->h->verbose) printf("%12llu P%c%u -> %d\n", (unsigned long long)w->h->avr->cycle, w->pin.port, w->pin.bit, level);
+    w->h->edge(w->pin, level);
+  }
+
+  void watch(const Pin &pin) {
+    for (PinWatch *w : watches) {
+      if (w->pin.port == pin.port && w->pin.bit == pin.bit) return;
+    }
+    PinWatch *w = new PinWatch{this, pin, -1};
+    watches.push_back(w);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(pin.port), pin.bit), pin_changed, w);
+  }
+
+  // Inputs are held as external levels, so the firmware's pull-ups do not override them
+  void drive(const Pin &pin, int level) {
+    const int port = pin.port - 'A';
+    const uint8_t bit = (uint8_t)(1u << pin.bit);
+    const bool changed = !(extMask[port] & bit) || ((extLevel[port] & bit) != 0) != (level != 0);
+    extMask[port] |= bit;
+    extLevel[port] = level ? (uint8_t)(extLevel[port] | bit) : (uint8_t)(extLevel[port] & ~bit);
+    avr_ioport_external_t ext;
+    ext.name = pin.port;
+    ext.mask = extMask[port];
+    ext.value = extLevel[port];
+    avr_ioctl(avr, AVR_IOCTL_IOPORT_SET_EXTERNAL(pin.port), &ext);
+    avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(pin.port), pin.bit), level ? 1 : 0);
+    if (changed) {
+      if (verbose) printf("%12llu P%c%u <- %d\n", (unsigned long long)avr->cycle, pin.port, pin.bit, level);
+      edge(pin, level);
+    }
+  }
+
+  // ---- Modbus ----
+  static void uart1_out(avr_irq_t *, uint32_t value, void *param) {
+    Harness *h = (Harness *)param;
+    if (h->awaiting && h->reply.empty()) h->modbus.samples.push_back(h->avr->cycle - h->requestEnd);
+    if (h->awaiting) h->reply.push_back((uint8_t)value);
+  }
+
+  void close_request() {
+    if (!awaiting) return;
+    if (reply.empty()) {
+      modbus.missed++;
+    } else if (!kb::modbus_crc_ok(reply.data(), reply.size())) {
+      badReplies++;
+    }
+    awaiting = false;
+    reply.clear();
+  }
+
+  // ---- I2C ----
+  static void twi_out(avr_irq_t *, uint32_t value, void *param) {
+    Harness *h = (Harness *)param;
+    avr_twi_msg_irq_t v;
+    v.u.v = value;
+    const uint8_t addr7 = (uint8_t)(v.u.twi.addr >> 1);
+    if (v.u.twi.msg & TWI_COND_STOP) h->twiSelected = 0;
+    if (v.u.twi.msg & TWI_COND_ADDR) {
+      h->twiSelected = 0;
+      if (addr7 == 0x48 || addr7 == 0x27) {
+        h->twiSelected = v.u.twi.addr;
+        h->twiIndex = 0;
+        h->twiReadIndex = 0;
+        avr_raise_irq(h->twi + TWI_IRQ_INPUT, avr_twi_irq_msg(TWI_COND_ACK, h->twiSelected, 1));
+      }
+    }
+    if (!h->twiSelected) return;
+    const bool ads = (h->twiSelected >> 1) == 0x48;
+    if (v.u.twi.msg & TWI_COND_WRITE) {
+      avr_raise_irq(h->twi + TWI_IRQ_INPUT, avr_twi_irq_msg(TWI_COND_ACK, h->twiSelected, 1));
+      if (ads) h->ads_write(v.u.twi.data);
+      h->twiIndex++;
+    }
+    if (v.u.twi.msg & TWI_COND_READ) {
+      const uint8_t data = ads ? h->ads_read() : 0xFF;
+      avr_raise_irq(h->twi + TWI_IRQ_INPUT, avr_twi_irq_msg(TWI_COND_READ, h->twiSelected, data));
+    }
+  }
+
+  void ads_write(uint8_t b) {
+    if (twiIndex == 0) {
+      adsPointer = b & 3;
+    } else if (twiIndex == 1) {
+      adsWrite = (uint16_t)(b << 8);
+    } else if (twiIndex == 2 && adsPointer == 1) {
+      adsConfig = (uint16_t)(adsWrite | b) | 0x8000;    // conversions finish at once
+    }
+  }
+
+  uint8_t ads_read() {
+    uint16_t reg = adsConfig;
+    if (adsPointer == 0) {
+      const uint8_t mux = (uint8_t)((adsConfig >> 12) & 7);
+      reg = mux >= 4 ? (uint16_t)adsCounts[mux - 4] : 0;
+    }
+    return (twiReadIndex++ & 1) ? (uint8_t)reg : (uint8_t)(reg >> 8);
+  }
+
+  void attach_i2c() {
+    static const char *NAMES[2] = {"twi.in", "twi.out"};
+    twi = avr_alloc_irq(&avr->irq_pool, 0, 2, NAMES);
+    avr_irq_register_notify(twi + TWI_IRQ_OUTPUT, twi_out, this);
+    avr_connect_irq(twi + TWI_IRQ_INPUT, avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_INPUT));
+    avr_connect_irq(avr_io_getirq(avr, AVR_IOCTL_TWI_GETIRQ(0), TWI_IRQ_OUTPUT), twi + TWI_IRQ_OUTPUT);
+  }
+};
+
+// ========================= Results =========================
+struct Metric {
+  std::string name;
+  uint64_t samples = 0;
+  double min = 0.0, mean = 0.0, max = 0.0;
+};
+
+Metric summarize(const EdgeProbe &p) {
+  Metric m;
+  m.name = p.name;
+  m.samples = p.samples.size();
+  if (p.samples.empty()) return m;
+  double sum = 0.0;
+  m.min = m.max = (double)p.samples[0];
+  for (uint64_t s : p.samples) {
+    sum += (double)s;
+    m.min = std::min(m.min, (double)s);
+    m.max = std::max(m.max, (double)s);
+  }
+  m.mean = sum / (double)p.samples.size();
+  return m;
+}
+
+const char CSV_HEADER[] = "metric,samples,min,mean,max";
+
+bool read_csv(const char *path, std::map<std::string, Metric> &out) {
+  FILE *f = fopen(path, "r");
+  char line[256];
+  if (!f || !fgets(line, sizeof(line), f) || strncmp(line, CSV_HEADER, sizeof(CSV_HEADER) - 1) != 0) {
+    fprintf(stderr, "avr_timing: %s is not an avr_timing CSV\n", path);
+    if (f) fclose(f);
+    return false;
+  }
+  while (fgets(line, sizeof(line), f)) {
+    Metric m;
+    char name[96];
+    unsigned long long n;
+    if (sscanf(line, "%95[^,],%llu,%lf,%lf,%lf", name, &n, &m.min, &m.mean, &m.max) != 5) continue;
+    m.name = name;
+    m.samples = n;
+    out[m.name] = m;
+  }
+  fclose(f);
+  return true;
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: avr_timing ELF [options]\n"
+          "  --monitor          the image is monitor_firmware (default: logic_arduino)\n"
+          "  --ps ID            monitor slave id for the built-in script (default 4)\n"
+          "  -s SCRIPT          stimulus script (default: built in, see --print-script)\n"
+          "  -b BAUD            monitor Modbus baud (default 9600)\n"
+          "  --ads I,V,S        ADS1115 counts for Imon, Vmon, Vset (default 0,0,0)\n"
+          "  --phases N         logic trips per comparator in the built-in script (default 32)\n"
+          "  --phase-step CYC   cycles between trip phases (default 53)\n"
+          "  --csv FILE         write the metrics\n"
+          "  --baseline FILE    compare with an earlier --csv and list regressions\n"
+          "  --tolerance PCT    growth allowed against the baseline (default 0)\n"
+          "  --gate             exit 1 on a regression against --baseline\n"
+          "  --print-script     print the script and exit\n"
+          "  -v                 print every edge\n");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const char *elf = nullptr, *scriptPath = nullptr, *csv = nullptr, *baseline = nullptr;
+  bool monitor = false, printScript = false, verbose = false, gate = false;
+  int ps = 4, phases = 32, phaseStep = 53;
+  unsigned baud = 9600;
+  double tolerance = 0.0;
+  int ads[3] = {0, 0, 0};
+  for (int i = 1; i < argc; i++) {
+    const std::string a = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (a == "--monitor") {
+      monitor = true;
+    } else if (a == "--ps" && hasValue) {
+      ps = atoi(argv[++i]);
+    } else if (a == "-s" && hasValue) {
+      scriptPath = argv[++i];
+    } else if (a == "-b" && hasValue) {
+      baud = (unsigned)atoi(argv[++i]);
+    } else if (a == "--ads" && hasValue) {
+      if (sscanf(argv[++i], "%d,%d,%d", &ads[0], &ads[1], &ads[2]) != 3) {
+        usage();
+        return 2;
+      }
+    } else if (a == "--phases" && hasValue) {
+      phases = atoi(argv[++i]);
+    } else if (a == "--phase-step" && hasValue) {
+      phaseStep = atoi(argv[++i]);
+    } else if (a == "--csv" && hasValue) {
+      csv = argv[++i];
+    } else if (a == "--baseline" && hasValue) {
+      baseline = argv[++i];
+    } else if (a == "--tolerance" && hasValue) {
+      tolerance = atof(argv[++i]);
+    } else if (a == "--gate") {
+      gate = true;
+    } else if (a == "--print-script") {
+      printScript = true;
+    } else if (a == "-v") {
+      verbose = true;
+    } else if (a[0] != '-' && !elf) {
+      elf = argv[i];
+    } else {
+      usage();
+      return 2;
+    }
+  }
+
+  std::string script;
+  if (scriptPath) {
+    FILE *f = fopen(scriptPath, "r");
+    if (!f) {
+      fprintf(stderr, "avr_timing: cannot open %s\n", scriptPath);
+      return 2;
+    }
+    char buf[4096];
+    for (size_t n; (n = fread(buf, 1, sizeof(buf), f)) > 0;) script.append(buf, n);
+    fclose(f);
+  } else {
+    script = monitor ? monitor_script(ps, 40) : logic_script(phases, phaseStep);
+  }
+  if (printScript) {
+    fputs(script.c_str(), stdout);
+    return 0;
+  }
+  if (!elf) {
+    usage();
+    return 2;
+  }
+
+  Harness h;
+  std::vector<Event> events;
+  if (!parse_script(script, events, h.probes)) return 2;
+
+  elf_firmware_t fw;
+  memset(&fw, 0, sizeof(fw));
+  if (elf_read_firmware(elf, &fw) != 0) {
+    fprintf(stderr, "avr_timing: cannot read %s\n", elf);
+    return 2;
+  }
+  if (!fw.mmcu[0]) strcpy(fw.mmcu, "atmega2560");
+  fw.frequency = F_CPU_HZ;
+  h.avr = avr_make_mcu_by_name(fw.mmcu);
+  if (!h.avr) {
+    fprintf(stderr, "avr_timing: simavr has no core for %s\n", fw.mmcu);
+    return 2;
+  }
+  avr_init(h.avr);
+  avr_load_firmware(h.avr, &fw);
+  h.verbose = verbose;
+
+  // Keep the USARTs off stdout; the journal and status link would flood it
+  for (char u = '0'; u <= '3'; u++) {
+    uint32_t flags = 0;
+    avr_ioctl(h.avr, AVR_IOCTL_UART_SET_FLAGS(u), &flags);
+  }
+  for (const EdgeProbe &p : h.probes) {
+    h.watch(p.from);
+    h.watch(p.to);
+  }
+  if (monitor) {
+    h.adsCounts[1] = (int16_t)ads[0];    // CH_IMON
+    h.adsCounts[2] = (int16_t)ads[1];    // CH_VMON
+    h.adsCounts[0] = (int16_t)ads[2];    // CH_VSET
+    h.attach_i2c();
+    h.charCycles = (uint64_t)(10.0 * F_CPU_HZ / baud);
+    h.modbus.name = "modbus_reply";
+    avr_irq_register_notify(avr_io_getirq(h.avr, AVR_IOCTL_UART_GETIRQ('1'), UART_IRQ_OUTPUT), Harness::uart1_out, &h);
+  }
+
+  // Expand Modbus requests into one byte per character time
+  struct Byte {
+    uint64_t at;
+    uint8_t b;
+    bool first, last;
+  };
+  std::vector<Byte> bytes;
+  for (const Event &e : events) {
+    if (e.kind != Event::MODBUS) continue;
+    if (!monitor) {
+      fprintf(stderr, "avr_timing: modbus events need --monitor\n");
+      return 2;
+    }
+    uint8_t req[8] = {e.id, e.fc, (uint8_t)(e.addr >> 8), (uint8_t)e.addr, (uint8_t)(e.count >> 8), (uint8_t)e.count};
+    const uint16_t crc = kb::modbus_crc16(req, 6);
+    req[6] = (uint8_t)crc;
+    req[7] = (uint8_t)(crc >> 8);
+    for (int i = 0; i < 8; i++) bytes.push_back({e.at + (uint64_t)i * h.charCycles, req[i], i == 0, i == 7});
+  }
+  std::stable_sort(bytes.begin(), bytes.end(), [](const Byte &a, const Byte &b) { return a.at < b.at; });
+
+  uint64_t end = events.empty() ? 0 : events.back().at;
+  size_t nextEvent = 0, nextByte = 0;
+  int state = cpu_Running;
+  while (state != cpu_Done && state != cpu_Crashed) {
+    const uint64_t now = h.avr->cycle;
+    if (now >= end) break;
+    while (nextEvent < events.size() && events[nextEvent].at <= now) {
+      const Event &e = events[nextEvent++];
+      if (e.kind == Event::SET) h.drive(e.pin, e.level);
+    }
+    while (nextByte < bytes.size() && bytes[nextByte].at <= now) {
+      const Byte &b = bytes[nextByte++];
+      if (b.first) h.close_request();
+      avr_raise_irq(avr_io_getirq(h.avr, AVR_IOCTL_UART_GETIRQ('1'), UART_IRQ_INPUT), b.b);
+      if (b.last) {
+        h.awaiting = true;
+        h.requestEnd = now + h.charCycles;     // the byte's stop bit, as the UART delivers it
+      }
+    }
+    state = avr_run(h.avr);
+  }
+  h.close_request();
+  if (state == cpu_Crashed) fprintf(stderr, "avr_timing: the image crashed at cycle %llu\n", (unsigned long long)h.avr->cycle);
+
+  std::vector<Metric> metrics;
+  for (const EdgeProbe &p : h.probes) metrics.push_back(summarize(p));
+  if (monitor) metrics.push_back(summarize(h.modbus));
+
+  printf("%-22s %8s %10s %12s %10s %10s\n", "cycles", "samples", "min", "mean", "max", "max us");
+  for (const Metric &m : metrics) {
+    printf("%-22s %8llu %10.0f %12.1f %10.0f %10.2f\n", m.name.c_str(), (unsigned long long)m.samples, m.min, m.mean,
+           m.max, m.max / (F_CPU_HZ / 1e6));
+  }
+  for (const EdgeProbe &p : h.probes) {
+    if (p.missed) printf("%s: %llu FROM edges without a TO edge\n", p.name.c_str(), (unsigned long long)p.missed);
+  }
+  if (monitor && (h.modbus.missed || h.badReplies)) {
+    printf("modbus: %llu requests without a reply, %llu bad replies\n", (unsigned long long)h.modbus.missed,
+           (unsigned long long)h.badReplies);
+  }
+
+  if (csv) {
+    FILE *f = fopen(csv, "w");
+    if (!f) {
+      fprintf(stderr, "avr_timing: cannot write %s\n", csv);
+      return 2;
+    }
+    fprintf(f, "%s\n", CSV_HEADER);
+    for (const Metric &m : metrics) {
+      fprintf(f, "%s,%llu,%.0f,%.2f,%.0f\n", m.name.c_str(), (unsigned long long)m.samples, m.min, m.mean, m.max);
+    }
+    fclose(f);
+  }
+
+  const bool crashed = state == cpu_Crashed;
+  int regressions = 0;
+  if (baseline) {
+    std::map<std::string, Metric> base;
+    if (!read_csv(baseline, base)) return 2;
+    for (const Metric &m : metrics) {
+      auto it = base.find(m.name);
+      if (it == base.end()) continue;
+      const Metric &b = it->second;
+      const double limit = 1.0 + tolerance / 100.0;
+      const bool lost = m.samples < b.samples;
+      const bool slower = m.max > b.max * limit || m.mean > b.mean * limit;
+      if (!lost && !slower) continue;
+      if (regressions++ == 0) printf("\nagainst the baseline:\n");
+      printf("  %-22s", m.name.c_str());
+      if (lost) printf("  samples %llu -> %llu", (unsigned long long)b.samples, (unsigned long long)m.samples);
+      if (slower) printf("  mean %.1f -> %.1f  max %.0f -> %.0f cycles", b.mean, m.mean, b.max, m.max);
+      printf("\n");
+    }
+    if (regressions == 0) printf("\nno regressions against the baseline\n");
+    else if (!gate) printf("(report only, see --gate)\n");
+  }
+  return (crashed || (gate && regressions)) ? 1 : 0;
+}
@@ -0,0 +1,592 @@
+/*
+  Knob Box - golden pin traces of the Logic Arduino
+
+  Runs input timelines against the Logic Arduino image on the virtual clock and records
+  every change of PORTA, PORTC (flags), PORTF (CCS, Beams, 3kV enable) and PORTH (LED, ACK
+  echo) from power-on, stamped in microseconds. Each trace is compared with the golden copy
+  checked in next to its scenario, so a change to the firmware that moves any output edge
+  shows up as a diff. A second set of generated scenarios is compared by trace hash.
+
+  Every scenario runs in its own forked process, since the firmware's globals are only
+  initialized once per process, and the scenarios are spread across workers.
+
+  Scenario lines are "<time> <command> [args]", time in us / ms / s (default ms), or
+  "+<time>" after the previous line:
+    0      switch 3kv on              3kv | beams | ccs | arm80kv
+    +1s    press reset [20ms]         hold defaults to 200 ms
+    +0     release reset
+    +10ms  fault +3kv i               +1kv | -1kv | +20kv | +3kv, v | i; the line goes open
+    +2ms   safe +3kv i                ... or `safe all`; the line is pulled low
+    +20ms  ack                        toggle the ACK line (D14), as the +3kV monitor does
+    +0     pin 42 float               any pin: 0 | 1 | float, for recorded timelines
+    +1s    end                        default: 500 ms after the last line
+  At power-on every comparator is safe, the switches and reset are released and ACK is low.
+
+  Usage:
+    logic_trace [-j N] [--update] [--dir DIR] [SCENARIO ...]
+    logic_trace --print SCENARIO | random:I
+  Scenarios default to every .txt in DIR/scenarios (DIR defaults to trace), with their golden
+  traces in DIR/golden/NAME.trace. The generated set is described by DIR/golden/random.digest;
+  with --update, --random N and --seed S set its size and seed.
+*/
+#include <dirent.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../board/board.h"
+
+using namespace kb;
+
+namespace {
+
+// ========================= Logic Arduino pins =========================
+const std::map<std::string, uint8_t> SWITCH_PINS = {{"3kv", 10}, {"beams", 11}, {"ccs", 12}, {"arm80kv", 13}};
+static constexpr uint8_t ACK_PIN = 14;
+static constexpr uint8_t RESET_PIN = 15;
+
+const char *const SUPPLY_NAMES[4] = {"+1kv", "-1kv", "+20kv", "+3kv"};
+const uint8_t COMPARATOR_PINS[4][2] = {{42, 43}, {44, 45}, {46, 47}, {48, 49}};    // V, I
+
+const char TRACED_PORTS[] = "ACFH";
+
+// ========================= Scenario =========================
+struct Event {
+  uint64_t at;
+  std::vector<std::string> args;
+  int line;
+};
+
+struct Scenario {
+  std::string name;
+  std::vector<Event> events;
+  uint64_t end = 0;
+};
+
+bool parse_time(const std::string &s, uint64_t &cycles) {
+  char *end = nullptr;
+  const double v = strtod(s.c_str(), &end);
+  if (end == s.c_str() || v < 0.0) return false;
+  const std::string unit(end);
+  double scale = (double)CYCLES_PER_MS;
+  if (unit == "us") scale = (double)CYCLES_PER_US;
+  else if (unit == "s") scale = (double)CYCLES_PER_MS * 1000.0;
+  else if (!unit.empty() && unit != "ms") return false;
+  cycles = (uint64_t)(v * scale + 0.5);
+  return true;
+}
+
+// Sorted by time; an explicit `end` sets the length
+void finish_scenario(Scenario &s) {
+  std::stable_sort(s.events.begin(), s.events.end(), [](const Event &a, const Event &b) { return a.at < b.at; });
+  s.end = s.events.empty() ? 0 : s.events.back().at + 500 * CYCLES_PER_MS;
+  for (const Event &e : s.events) {
+    if (e.args[0] == "end") {
+      s.end = e.at;
+      break;
+    }
+  }
+}
+
+bool parse_scenario(const std::string &name, FILE *f, Scenario &s) {
+  s.name = name;
+  char line[256];
+  int n = 0;
+  uint64_t prev = 0;
+  while (fgets(line, sizeof(line), f)) {
+    n++;
+    char *hash = strchr(line, '#');
+    if (hash) *hash = '\0';
+    std::vector<std::string> tok;
+    for (char *t = strtok(line, " \t\r\n"); t; t = strtok(nullptr, " \t\r\n")) tok.emplace_back(t);
+    if (tok.empty()) continue;
+    Event e;
+    const bool relative = tok[0][0] == '+';
+    if (tok.size() < 2 || !parse_time(relative ? tok[0].substr(1) : tok[0], e.at)) {
+      fprintf(stderr, "logic_trace: %s:%d: expected \"<time> <command>\"\n", name.c_str(), n);
+      return false;
+    }
+    if (relative) e.at += prev;
+    prev = e.at;
+    e.args.assign(tok.begin() + 1, tok.end());
+    e.line = n;
+    s.events.push_back(std::move(e));
+  }
+  finish_scenario(s);
+  return true;
+}
+
+bool load_scenario(const std::string &path, Scenario &s) {
+  FILE *f = fopen(path.c_str(), "r");
+  if (!f) {
+    fprintf(stderr, "logic_trace: cannot open %s: %s\n", path.c_str(), strerror(errno));
+    return false;
+  }
+  std::string name = path.substr(path.find_last_of('/') + 1);
+  if (name.size() > 4 && name.compare(name.size() - 4, 4, ".txt") == 0) name.resize(name.size() - 4);
+  const bool ok = parse_scenario(name, f, s);
+  fclose(f);
+  return ok;
+}
+
+// Generated scenario `index`: one to two seconds of switch, reset, ACK and comparator
+// activity, dense enough to cross the debouncers, the quench lockout and re-arming
+Scenario random_scenario(uint32_t seed, uint32_t index) {
+  uint64_t x = ((uint64_t)seed << 32) ^ (index * 0x9E3779B97F4A7C15ULL) ^ 0x5DEECE66DULL;
+  auto next = [&x](uint32_t range) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return (uint32_t)(x % range);
+  };
+  static const char *const SWITCHES[] = {"3kv", "beams", "ccs", "arm80kv"};
+  Scenario s;
+  s.name = "random:" + std::to_string(index);
+  uint64_t t = (uint64_t)next(5) * CYCLES_PER_MS;
+  const uint64_t end = (1000 + (uint64_t)next(1000)) * CYCLES_PER_MS;
+  int line = 0;
+  while (t < end) {
+    Event e;
+    e.at = t;
+    e.line = ++line;
+    const uint32_t kind = next(16);
+    if (kind < 5) {
+      e.args = {"switch", SWITCHES[next(4)], next(3) ? "on" : "off"};
+    } else if (kind < 7) {
+      e.args = {"press", "reset", std::to_string(1 + next(40)) + "ms"};
+    } else if (kind < 9) {
+      e.args = {"ack"};
+    } else if (kind < 12) {
+      e.args = {"fault", SUPPLY_NAMES[next(4)], next(2) ? "i" : "v"};
+    } else {
+      e.args = next(4) ? std::vector<std::string>{"safe", SUPPLY_NAMES[next(4)], next(2) ? "i" : "v"}
+                       : std::vector<std::string>{"safe", "all"};
+    }
+    s.events.push_back(e);
+    // Mostly a few ms apart, sometimes several debounce windows or a whole lockout
+    const uint32_t gap = next(8);
+    t += gap < 4 ? (uint64_t)(50 + next(2000)) * CYCLES_PER_US
+                 : gap < 7 ? (uint64_t)(2 + next(30)) * CYCLES_PER_MS : (uint64_t)(50 + next(200)) * CYCLES_PER_MS;
+  }
+  s.events.push_back({end, {"end"}, ++line});
+  finish_scenario(s);
+  return s;
+}
+
+std::string scenario_text(const Scenario &s) {
+  std::string out;
+  char buf[64];
+  for (const Event &e : s.events) {
+    snprintf(buf, sizeof(buf), "%lluus", (unsigned long long)(e.at / CYCLES_PER_US));
+    out += buf;
+    for (const std::string &a : e.args) out += " " + a;
+    out += "\n";
+  }
+  return out;
+}
+
+// ========================= Run =========================
+class Runner {
+ public:
+  explicit Runner(Board &b) : b_(b) {}
+
+  // The trace, or false with the reason on stderr
+  bool run(Scenario s, std::string &trace) {
+    trace.clear();
+    b_.onPortWrite([this, &trace](char port, uint8_t v, uint64_t at) {
+      if (!strchr(TRACED_PORTS, port)) return;
+      char buf[48];
+      const unsigned frac = (unsigned)(at % CYCLES_PER_US) * 625;
+      if (frac) snprintf(buf, sizeof(buf), "%llu.%04u %c %02X\n", (unsigned long long)(at / CYCLES_PER_US), frac, port, v);
+      else snprintf(buf, sizeof(buf), "%llu %c %02X\n", (unsigned long long)(at / CYCLES_PER_US), port, v);
+      trace += buf;
+    });
+
+    for (const auto &sw : SWITCH_PINS) b_.setPinInput(sw.second, -1);
+    b_.setPinInput(RESET_PIN, -1);
+    b_.setPinInput(ACK_PIN, ackLevel_ = 0);
+    for (const auto &pins : COMPARATOR_PINS) {
+      b_.setPinInput(pins[0], 0);
+      b_.setPinInput(pins[1], 0);
+    }
+    b_.powerOn(0);
+
+    std::vector<Event> &ev = s.events;
+    for (size_t i = 0; i < ev.size(); i++) {
+      if (ev[i].at >= s.end) break;
+      while (b_.now() < ev[i].at) b_.step();
+      if (!apply(s, i)) return false;
+    }
+    while (b_.now() < s.end) b_.step();
+    if (b_.watchdogTripped()) trace += "watchdog reset\n";
+    b_.onPortWrite(nullptr);
+    return true;
+  }
+
+ private:
+  bool bad(const Scenario &s, const Event &e, const char *why) {
+    fprintf(stderr, "logic_trace: %s:%d: %s\n", s.name.c_str(), e.line, why);
+    return false;
+  }
+
+  static int supply_index(const std::string &name) {
+    for (int i = 0; i < 4; i++) {
+      if (name == SUPPLY_NAMES[i]) return i;
+    }
+    return -1;
+  }
+
+  bool apply(Scenario &s, size_t i) {
+    const Event e = s.events[i];
+    const std::vector<std::string> &a = e.args;
+    const std::string &cmd = a[0];
+    if (cmd == "switch" && a.size() == 3 && SWITCH_PINS.count(a[1])) {
+      b_.setPinInput(SWITCH_PINS.at(a[1]), a[2] == "on" ? 0 : -1);
+    } else if (cmd == "press" && a.size() >= 2 && a[1] == "reset") {
+      uint64_t hold = 200 * CYCLES_PER_MS;
+      if (a.size() >= 3 && !parse_time(a[2], hold)) return bad(s, e, "bad duration");
+      b_.setPinInput(RESET_PIN, 0);
+      Event release{e.at + hold, {"release", "reset"}, e.line};
+      auto pos = std::upper_bound(s.events.begin() + (long)i + 1, s.events.end(), release,
+                                  [](const Event &x, const Event &y) { return x.at < y.at; });
+      s.events.insert(pos, release);
+    } else if (cmd == "release" && a.size() == 2 && a[1] == "reset") {
+      b_.setPinInput(RESET_PIN, -1);
+    } else if ((cmd == "fault" || cmd == "safe") && a.size() == 2 && a[1] == "all") {
+      for (const auto &pins : COMPARATOR_PINS) {
+        b_.setPinInput(pins[0], cmd == "fault" ? -1 : 0);
+        b_.setPinInput(pins[1], cmd == "fault" ? -1 : 0);
+      }
+    } else if ((cmd == "fault" || cmd == "safe") && a.size() == 3 && supply_index(a[1]) >= 0 &&
+               (a[2] == "v" || a[2] == "i")) {
+      b_.setPinInput(COMPARATOR_PINS[supply_index(a[1])][a[2] == "i"], cmd == "fault" ? -1 : 0);
+    } else if (cmd == "ack" && a.size() == 1) {
+      ackLevel_ ^= 1;
+      b_.setPinInput(ACK_PIN, ackLevel_);
+    } else if (cmd == "pin" && a.size() == 3) {
+      const int pin = atoi(a[1].c_str());
+      if (pin <= 0 || pin >= 70) return bad(s, e, "bad pin");
+      b_.setPinInput((uint8_t)pin, a[2] == "float" ? -1 : atoi(a[2].c_str()) != 0);
+    } else if (cmd != "end") {
+      return bad(s, e, "unknown command");
+    }
+    return true;
+  }
+
+  Board &b_;
+  int ackLevel_ = 0;
+};
+
+uint64_t fnv1a(const std::string &s) {
+  uint64_t h = 1469598103934665603ULL;
+  for (unsigned char c : s) h = (h ^ c) * 1099511628211ULL;
+  return h;
+}
+
+// ========================= Golden files =========================
+bool read_file(const std::string &path, std::string &out) {
+  FILE *f = fopen(path.c_str(), "r");
+  if (!f) return false;
+  char buf[4096];
+  size_t n;
+  out.clear();
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+  fclose(f);
+  return true;
+}
+
+// Golden traces start with a comment header, which is not compared
+std::string strip_comments(const std::string &text) {
+  std::string out;
+  size_t pos = 0;
+  while (pos < text.size()) {
+    size_t eol = text.find('\n', pos);
+    if (eol == std::string::npos) eol = text.size() - 1;
+    if (text[pos] != '#') out.append(text, pos, eol + 1 - pos);
+    pos = eol + 1;
+  }
+  return out;
+}
+
+std::vector<std::string> split_lines(const std::string &text) {
+  std::vector<std::string> lines;
+  size_t pos = 0;
+  while (pos < text.size()) {
+    size_t eol = text.find('\n', pos);
+    if (eol == std::string::npos) eol = text.size();
+    lines.push_back(text.substr(pos, eol - pos));
+    pos = eol + 1;
+  }
+  return lines;
+}
+
+// The first few differing lines, each with its line number in the trace
+void print_diff(const std::string &name, const std::string &want, const std::string &got) {
+  const std::vector<std::string> a = split_lines(want), b = split_lines(got);
+  printf("%s: trace differs from the golden copy (%zu lines, golden %zu)\n", name.c_str(), b.size(), a.size());
+  int shown = 0;
+  for (size_t i = 0; i < std::max(a.size(), b.size()) && shown < 8; i++) {
+    const std::string *x = i < a.size() ? &a[i] : nullptr, *y = i < b.size() ? &b[i] : nullptr;
+    if (x && y && *x == *y) continue;
+    printf("  %5zu  - %-28s + %s\n", i + 1, x ? x->c_str() : "", y ? y->c_str() : "");
+    shown++;
+  }
+}
+
+struct Digest {
+  uint32_t count = 0, seed = 1;
+  std::vector<uint64_t> hashes;
+};
+
+bool read_digest(const std::string &path, Digest &d) {
+  std::string text;
+  if (!read_file(path, text)) return false;
+  for (const std::string &line : split_lines(text)) {
+    unsigned c, s, idx;
+    unsigned long long h;
+    if (sscanf(line.c_str(), "random %u seed %u", &c, &s) == 2) {
+      d.count = c;
+      d.seed = s;
+      d.hashes.assign(c, 0);
+    } else if (sscanf(line.c_str(), "%u %llx", &idx, &h) == 2 && idx < d.hashes.size()) {
+      d.hashes[idx] = h;
+    }
+  }
+  return true;
+}
+
+// ========================= Workers =========================
+struct Job {
+  Scenario scenario;
+  std::string output;             // trace, from the child
+  bool ok = false;
+};
+
+// Runs every job in a forked child, at most `workers` at a time
+void run_jobs(std::vector<Job> &jobs, int workers) {
+  struct Running {
+    size_t job;
+    pid_t pid;
+    int fd;
+  };
+  std::vector<Running> running;
+  size_t next = 0;
+  while (next < jobs.size() || !running.empty()) {
+    while (next < jobs.size() && (int)running.size() < workers) {
+      int fds[2];
+      if (pipe(fds) != 0) {
+        perror("logic_trace: pipe");
+        exit(2);
+      }
+      fflush(stdout);
+      fflush(stderr);
+      const pid_t pid = fork();
+      if (pid == 0) {
+        close(fds[0]);
+        std::string trace;
+        Runner r(kb_logic_board());
+        if (!r.run(jobs[next].scenario, trace)) _exit(3);
+        size_t off = 0;
+        while (off < trace.size()) {
+          const ssize_t n = write(fds[1], trace.data() + off, trace.size() - off);
+          if (n <= 0) _exit(3);
+          off += (size_t)n;
+        }
+        _exit(0);
+      }
+      close(fds[1]);
+      running.push_back({next++, pid, fds[0]});
+    }
+    std::vector<struct pollfd> pfd;
+    for (const Running &r : running) pfd.push_back({r.fd, POLLIN, 0});
+    poll(pfd.data(), pfd.size(), -1);
+    for (size_t i = running.size(); i-- > 0;) {
+      if (!(pfd[i].revents & (POLLIN | POLLHUP))) continue;
+      char buf[8192];
+      const ssize_t n = read(running[i].fd, buf, sizeof(buf));
+      if (n > 0) {
+        jobs[running[i].job].output.append(buf, (size_t)n);
+        continue;
+      }
+      close(running[i].fd);
+      int status = 0;
+      waitpid(running[i].pid, &status, 0);
+      jobs[running[i].job].ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+      running.erase(running.begin() + (long)i);
+    }
+  }
+}
+
+std::vector<std::string> list_scenarios(const std::string &dir) {
+  std::vector<std::string> out;
+  DIR *d = opendir(dir.c_str());
+  if (!d) return out;
+  while (struct dirent *e = readdir(d)) {
+    const std::string n = e->d_name;
+    if (n.size() > 4 && n.compare(n.size() - 4, 4, ".txt") == 0) out.push_back(dir + "/" + n);
+  }
+  closedir(d);
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: logic_trace [options] [SCENARIO ...]\n"
+          "  -j N              worker processes (default: one per online CPU)\n"
+          "  --dir DIR         scenarios/ and golden/ live here (default trace)\n"
+          "  --update          rewrite the golden traces and random.digest instead of comparing\n"
+          "  --random N        generated scenarios, with --update (default: as in random.digest)\n"
+          "  --seed S          their seed, with --update\n"
+          "  --no-random       skip the generated scenarios\n"
+          "  --print WHAT      print the trace of a scenario file, or of random:I with its script\n");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  std::string dir = "trace", print;
+  bool update = false, noRandom = false;
+  long workers = sysconf(_SC_NPROCESSORS_ONLN);
+  long randomCount = -1, seed = -1;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; i++) {
+    const std::string a = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (a == "-j" && hasValue) {
+      workers = atol(argv[++i]);
+    } else if (a == "--dir" && hasValue) {
+      dir = argv[++i];
+    } else if (a == "--update") {
+      update = true;
+    } else if (a == "--random" && hasValue) {
+      randomCount = atol(argv[++i]);
+    } else if (a == "--seed" && hasValue) {
+      seed = atol(argv[++i]);
+    } else if (a == "--no-random") {
+      noRandom = true;
+    } else if (a == "--print" && hasValue) {
+      print = argv[++i];
+    } else if (a[0] != '-') {
+      paths.push_back(a);
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  if (workers < 1) workers = 1;
+  const std::string digestPath = dir + "/golden/random.digest";
+
+  if (!print.empty()) {
+    Job job;
+    if (print.compare(0, 7, "random:") == 0) {
+      Digest d;
+      read_digest(digestPath, d);
+      job.scenario = random_scenario(seed >= 0 ? (uint32_t)seed : d.seed, (uint32_t)atol(print.c_str() + 7));
+      printf("%s\n", scenario_text(job.scenario).c_str());
+    } else if (!load_scenario(print, job.scenario)) {
+      return 2;
+    }
+    std::vector<Job> one(1, job);
+    run_jobs(one, 1);
+    fputs(one[0].output.c_str(), stdout);
+    return one[0].ok ? 0 : 2;
+  }
+
+  const bool allFiles = paths.empty();
+  if (allFiles) paths = list_scenarios(dir + "/scenarios");
+  std::vector<Job> jobs;
+  for (const std::string &p : paths) {
+    Job job;
+    if (!load_scenario(p, job.scenario)) return 2;
+    jobs.push_back(std::move(job));
+  }
+  const size_t fileJobs = jobs.size();
+
+  Digest digest;
+  const bool haveDigest = read_digest(digestPath, digest);
+  if (update) {
+    if (randomCount >= 0) digest.count = (uint32_t)randomCount;
+    else if (!haveDigest) digest.count = 1000;
+    if (seed >= 0) digest.seed = (uint32_t)seed;
+  }
+  if (allFiles && !noRandom && (update || haveDigest)) {
+    for (uint32_t i = 0; i < digest.count; i++) jobs.push_back({random_scenario(digest.seed, i), "", false});
+  }
+
+  run_jobs(jobs, (int)workers);
+
+  int failed = 0, errors = 0;
+  for (size_t i = 0; i < fileJobs; i++) {
+    const Job &j = jobs[i];
+    const std::string golden = dir + "/golden/" + j.scenario.name + ".trace";
+    if (!j.ok) {
+      printf("%s: did not run\n", j.scenario.name.c_str());
+      errors++;
+      continue;
+    }
+    if (update) {
+      FILE *f = fopen(golden.c_str(), "w");
+      if (!f) {
+        fprintf(stderr, "logic_trace: cannot write %s\n", golden.c_str());
+        return 2;
+      }
+      fprintf(f, "# logic_trace %s: us, port, value after every change of PORTA/C/F/H\n", j.scenario.name.c_str());
+      fputs(j.output.c_str(), f);
+      fclose(f);
+      continue;
+    }
+    std::string want;
+    if (!read_file(golden, want)) {
+      printf("%s: no golden trace %s (run with --update)\n", j.scenario.name.c_str(), golden.c_str());
+      failed++;
+    } else if (strip_comments(want) != j.output) {
+      print_diff(j.scenario.name, strip_comments(want), j.output);
+      failed++;
+    }
+  }
+
+  size_t randomFailed = 0;
+  const size_t randomJobs = jobs.size() - fileJobs;
+  if (randomJobs) {
+    if (update) {
+      FILE *f = fopen(digestPath.c_str(), "w");
+      if (!f) {
+        fprintf(stderr, "logic_trace: cannot write %s\n", digestPath.c_str());
+        return 2;
+      }
+      fprintf(f, "# logic_trace generated scenarios: index, FNV-1a of the trace\nrandom %u seed %u\n", digest.count,
+              digest.seed);
+      for (size_t i = 0; i < randomJobs; i++) fprintf(f, "%zu %016llx\n", i, (unsigned long long)fnv1a(jobs[fileJobs + i].output));
+      fclose(f);
+    } else {
+      for (size_t i = 0; i < randomJobs; i++) {
+        const Job &j = jobs[fileJobs + i];
+        if (!j.ok) {
+          errors++;
+        } else if (fnv1a(j.output) != digest.hashes[i]) {
+          if (randomFailed++ < 8) printf("random:%zu: trace hash differs (logic_trace --print random:%zu)\n", i, i);
+        }
+      }
+    }
+  }
+
+  if (update) {
+    printf("wrote %zu golden traces%s\n", fileJobs,
+           randomJobs ? (" and " + std::to_string(randomJobs) + " generated trace hashes").c_str() : "");
+    return errors ? 2 : 0;
+  }
+  printf("%zu scenarios, %zu generated: %d differ, %zu generated differ, %d did not run\n", fileJobs, randomJobs,
+         failed, randomFailed, errors);
+  if (errors) return 2;
+  return (failed || randomFailed) ? 1 : 0;
+}
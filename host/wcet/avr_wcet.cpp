@@ -0,0 +1,780 @@
+/*
+  Knob Box - static worst-case execution time of the Logic Arduino image
+
+  Reads `avr-objdump -d -l -C` of the AVR build and bounds, in CPU cycles, every path through
+  loop() (step() and everything it inlines), serialEventRun() if present and every
+  interrupt handler. The bounds then give a comparator-to-output latency that no input
+  timing can exceed.
+
+  Cycle counts are the ATmega2560's (3-byte PC): CALL 5, RCALL/ICALL 4, RET/RETI 5,
+  JMP 3, RJMP 2, taken branches 2, skips 2 or 3, LD/ST/PUSH/POP/SBI/CBI/ADIW 2, LD -X 3,
+  LPM/ELPM 3, MUL 2, the rest 1. A call costs the callee's bound. Every path is followed,
+  so a branch never taken in practice still counts.
+
+  Loops need a bound: the most times the loop's back edge can be taken per entry. Each loop
+  in the source carries a marker comment on its `for` or `while` line,
+      for (uint8_t i = 0; i < FIRST_OUT_HISTORY; i++) {  // wcet-loop: first_out_history
+  and the bounds come from a file of lines
+      bound NAME N               the loop marked NAME
+  so edits that move the loop do not touch the bounds. The header instruction's source line
+  is matched to the nearest marker at or above it, since GCC puts the header on either the
+  loop line or the first line of its body. A loop without a marker or a bound stops the
+  analysis, listing every loop with its source line. A loop of N iterations is charged N
+  times its longest iteration plus its longest exit path.
+
+  Latency: a comparator edge just after step() sampled PINL reaches PORTF at the latest
+  at the end of the next pass, so the bound is two loop passes plus every interrupt that
+  can fire in that window, found by iterating R = 2P + sum(ceil(R / T) * C) over the
+  handlers' minimum periods T (--isr).
+
+  Usage:
+    avr_wcet ELF | --disasm FILE  [-B BOUNDS] [--src DIR] [--isr VECTOR=US|once ...]
+             [--csv FILE] [--max-latency-us US] [--objdump PROGRAM] [-v]
+*/
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+static constexpr double F_CPU_MHZ = 16.0;
+static constexpr uint64_t IRQ_ENTRY_CYCLES = 5 + 3;    // response with a 3-byte PC, then the vector's JMP
+
+// ========================= Disassembly =========================
+struct Insn {
+  uint32_t addr = 0;
+  uint8_t size = 2;
+  std::string op, args;
+  int64_t target = -1;            // branch / call / jump target address
+  std::string where;              // FILE:LINE from -l
+};
+
+struct Function {
+  std::string name;
+  std::vector<Insn> insns;
+};
+
+std::string basename_of(const std::string &path) {
+  const size_t slash = path.find_last_of("/\\");
+  return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+bool is_hex(const std::string &s) {
+  return !s.empty() && s.find_first_not_of("0123456789abcdef") == std::string::npos;
+}
+
+// avr-objdump -d -l output: "00000100 <name>:" heads a function, "/path/file.cpp:123" (maybe
+// with a discriminator) sets the source line, " 100:\t0e 94 34 02 \tcall\t0x468\t; 0x468 <foo>"
+// is an instruction
+bool parse_disassembly(FILE *in, std::map<std::string, Function> &functions, std::map<std::string, std::string> &paths) {
+  char buf[1024];
+  Function *cur = nullptr;
+  std::string where;
+  while (fgets(buf, sizeof(buf), in)) {
+    std::string line(buf);
+    while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) line.pop_back();
+    if (line.empty()) continue;
+
+    unsigned long addr;
+    char name[512];
+    if (sscanf(line.c_str(), "%lx <%511[^>]>:", &addr, name) == 2 && line.back() == ':') {
+      cur = &functions[name];
+      cur->name = name;
+      cur->insns.clear();
+      where.clear();
+      continue;
+    }
+
+    const size_t colon = line.find(':');
+    if (line[0] != ' ' && colon != std::string::npos && colon + 1 < line.size() && isdigit((unsigned char)line[colon + 1])) {
+      const std::string path = line.substr(0, colon);
+      paths[basename_of(path)] = path;
+      where = basename_of(path) + ":" + std::to_string(atoi(line.c_str() + colon + 1));
+      continue;
+    }
+    if (!cur || line[0] != ' ') continue;
+
+    // address, raw bytes, mnemonic, operands, comment; tab separated
+    std::vector<std::string> cols;
+    size_t start = 0;
+    for (size_t i = 0; i <= line.size(); i++) {
+      if (i == line.size() || line[i] == '\t') {
+        cols.push_back(line.substr(start, i - start));
+        start = i + 1;
+      }
+    }
+    if (cols.size() < 3) continue;
+    std::string a = cols[0];
+    a.erase(std::remove(a.begin(), a.end(), ' '), a.end());
+    if (a.empty() || a.back() != ':' || !is_hex(a.substr(0, a.size() - 1))) continue;
+
+    Insn in;
+    in.addr = (uint32_t)strtoul(a.c_str(), nullptr, 16);
+    int bytes = 0;
+    for (char c : cols[1]) bytes += isxdigit((unsigned char)c) ? 1 : 0;
+    in.size = (uint8_t)(bytes / 2);
+    in.op = cols[2];
+    in.op.erase(std::remove(in.op.begin(), in.op.end(), ' '), in.op.end());
+    std::string rest;
+    for (size_t i = 3; i < cols.size(); i++) rest += (i > 3 ? "\t" : "") + cols[i];
+    const size_t semi = rest.find(';');
+    in.args = rest.substr(0, semi);
+    const std::string comment = semi == std::string::npos ? "" : rest.substr(semi);
+    const size_t ox = comment.find("0x");
+    if (ox != std::string::npos) {
+      in.target = (int64_t)strtoull(comment.c_str() + ox, nullptr, 16);
+    } else if (in.args.find("0x") != std::string::npos) {
+      in.target = (int64_t)strtoull(in.args.c_str() + in.args.find("0x"), nullptr, 16);
+    }
+    in.where = where;
+    if (in.size == 0 || in.size > 4) continue;
+    cur->insns.push_back(in);
+  }
+  return !functions.empty();
+}
+
+// The function called `base` in demangled output: "step()", "write_outputs(Output const&)",
+// "step() [clone .isra.0]" and "__vector_23" all match their bare names
+const Function *find(const std::map<std::string, Function> &functions, const std::string &base) {
+  for (const auto &kv : functions) {
+    const std::string &n = kv.first;
+    if (n.compare(0, base.size(), base) == 0 && (n.size() == base.size() || n[base.size()] == '(')) return &kv.second;
+  }
+  return nullptr;
+}
+
+// ========================= Instruction timing =========================
+enum class Flow { NEXT, BRANCH, SKIP, JUMP, CALL, RETURN, INDIRECT };
+
+struct Timing {
+  uint64_t cycles = 1;            // not taken / not skipped
+  Flow flow = Flow::NEXT;
+  bool known = true;
+};
+
+Timing timing_of(const Insn &in) {
+  const std::string &op = in.op;
+  Timing t;
+  auto any = [&op](std::initializer_list<const char *> names) {
+    for (const char *n : names) {
+      if (op == n) return true;
+    }
+    return false;
+  };
+  if (op.size() >= 3 && op.compare(0, 2, "br") == 0 && op != "break") {
+    t.flow = Flow::BRANCH;                          // +1 when taken
+  } else if (any({"cpse", "sbrc", "sbrs", "sbic", "sbis"})) {
+    t.flow = Flow::SKIP;                            // +1 or +2 when skipping
+  } else if (op == "rjmp") {
+    t.cycles = 2;
+    t.flow = Flow::JUMP;
+  } else if (op == "jmp") {
+    t.cycles = 3;
+    t.flow = Flow::JUMP;
+  } else if (op == "rcall") {
+    t.cycles = 4;
+    t.flow = Flow::CALL;
+  } else if (op == "call") {
+    t.cycles = 5;
+    t.flow = Flow::CALL;
+  } else if (any({"ret", "reti"})) {
+    t.cycles = 5;
+    t.flow = Flow::RETURN;
+  } else if (any({"icall", "eicall"})) {
+    t.cycles = 4;
+    t.flow = Flow::INDIRECT;
+  } else if (any({"ijmp", "eijmp"})) {
+    t.cycles = 2;
+    t.flow = Flow::INDIRECT;
+  } else if (any({"lpm", "elpm"})) {
+    t.cycles = 3;
+  } else if (op == "ld") {
+    t.cycles = in.args.find('-') != std::string::npos ? 3 : 2;
+  } else if (any({"ldd", "lds", "st", "std", "sts", "push", "pop", "sbi", "cbi", "adiw", "sbiw", "mul", "muls",
+                  "mulsu", "fmul", "fmuls", "fmulsu"})) {
+    t.cycles = 2;
+  } else if (any({"spm", "sleep", "break", ".word", "..."})) {
+    t.known = false;
+  }
+  return t;
+}
+
+// ========================= Loop markers =========================
+// Finds the `// wcet-loop: NAME` marker of the loop whose header is at FILE:LINE
+class LoopMarkers {
+ public:
+  LoopMarkers(const std::map<std::string, std::string> &paths, const std::string &srcDir)
+      : paths_(paths), srcDir_(srcDir) {}
+
+  // The marker at or above the line, up to the loop statement it belongs to; "" for none
+  std::string name_for(const std::string &where) {
+    const size_t colon = where.rfind(':');
+    if (colon == std::string::npos) return "";
+    const std::vector<std::string> &src = source(where.substr(0, colon));
+    const int line = atoi(where.c_str() + colon + 1);
+    for (int l = std::min(line, (int)src.size()); l >= 1 && l > line - MAX_LINES_ABOVE; l--) {
+      const std::string &text = src[l - 1];
+      const size_t m = text.find(MARKER);
+      if (m != std::string::npos) {
+        std::string name = text.substr(m + strlen(MARKER));
+        name.erase(0, name.find_first_not_of(" \t"));
+        name.erase(name.find_last_not_of(" \t\r") + 1);
+        return name;
+      }
+      if (text.find("for (") != std::string::npos || text.find("while (") != std::string::npos) return "";
+    }
+    return "";
+  }
+
+ private:
+  static constexpr const char *MARKER = "// wcet-loop:";
+  static constexpr int MAX_LINES_ABOVE = 8;
+
+  const std::vector<std::string> &source(const std::string &file) {
+    auto it = files_.find(file);
+    if (it != files_.end()) return it->second;
+    std::vector<std::string> &lines = files_[file];
+    auto p = paths_.find(file);
+    std::ifstream in(srcDir_.empty() ? (p == paths_.end() ? file : p->second) : srcDir_ + "/" + file);
+    for (std::string l; std::getline(in, l);) lines.push_back(l);
+    if (lines.empty()) fprintf(stderr, "avr_wcet: cannot read %s for its loop markers; pass --src DIR\n", file.c_str());
+    return lines;
+  }
+
+  const std::map<std::string, std::string> &paths_;
+  std::string srcDir_;
+  std::map<std::string, std::vector<std::string>> files_;
+};
+
+// ========================= Analysis =========================
+struct LoopReport {
+  std::string function, where, marker;
+  uint32_t header = 0;
+  uint64_t bound = 0;             // 0: none given
+  uint64_t iteration = 0, exit = 0;
+};
+
+class Analyzer {
+ public:
+  Analyzer(const std::map<std::string, Function> &fns, const std::map<std::string, uint64_t> &bounds,
+           LoopMarkers &markers, bool verbose)
+      : fns_(fns), bounds_(bounds), markers_(markers), verbose_(verbose) {
+    for (const auto &kv : fns_) {
+      if (!kv.second.insns.empty()) byAddr_[kv.second.insns.front().addr] = &kv.second;
+    }
+  }
+
+  // Cycles from entry to return, or false with the reason in error()
+  bool wcet(const std::string &name, uint64_t &cycles) {
+    const Function *f = find(fns_, name);
+    if (!f) return fail("no function " + name + " in the disassembly");
+    return wcet_of(*f, cycles);
+  }
+
+  const std::string &error() const { return error_; }
+  const std::vector<LoopReport> &loops() const { return loops_; }
+  bool unbounded() const { return unbounded_; }
+
+ private:
+  struct Node {
+    uint64_t cost = 0;
+    std::vector<std::pair<int, uint64_t>> succ;   // node, extra cycles on that edge
+    bool ends = false;                            // may return from the function
+    bool active = true;
+  };
+
+  bool fail(const std::string &why) {
+    if (error_.empty()) error_ = why;
+    return false;
+  }
+
+  bool wcet_of(const Function &f, uint64_t &cycles) {
+    auto memo = memo_.find(f.name);
+    if (memo != memo_.end()) {
+      cycles = memo->second;
+      return true;
+    }
+    if (inProgress_.count(f.name)) return fail("recursion through " + f.name);
+    inProgress_.insert(f.name);
+    const bool ok = analyze(f, cycles);
+    inProgress_.erase(f.name);
+    if (ok) memo_[f.name] = cycles;
+    if (ok && verbose_) fprintf(stderr, "wcet: %-40s %8llu cycles\n", f.name.c_str(), (unsigned long long)cycles);
+    return ok;
+  }
+
+  bool analyze(const Function &f, uint64_t &result) {
+    const std::vector<Insn> &ins = f.insns;
+    if (ins.empty()) return fail(f.name + " is empty");
+    std::map<uint32_t, int> index;
+    for (size_t i = 0; i < ins.size(); i++) index[ins[i].addr] = (int)i;
+
+    std::vector<Node> g(ins.size());
+    for (size_t i = 0; i < ins.size(); i++) {
+      const Insn &in = ins[i];
+      const Timing t = timing_of(in);
+      if (!t.known) return fail(f.name + ": cannot time `" + in.op + "` at " + hex(in.addr));
+      Node &n = g[i];
+      n.cost = t.cycles;
+      const int next = i + 1 < ins.size() ? (int)i + 1 : -1;
+      auto local = [&](int64_t addr) {
+        auto it = index.find((uint32_t)addr);
+        return it == index.end() ? -1 : it->second;
+      };
+      switch (t.flow) {
+        case Flow::NEXT:
+          if (next < 0) return fail(f.name + ": runs off its end at " + hex(in.addr));
+          n.succ.push_back({next, 0});
+          break;
+        case Flow::BRANCH: {
+          const int to = local(in.target);
+          if (to < 0 || next < 0) return fail(f.name + ": branch out of the function at " + hex(in.addr));
+          n.succ.push_back({next, 0});
+          n.succ.push_back({to, 1});
+          break;
+        }
+        case Flow::SKIP: {
+          if (i + 2 > ins.size()) return fail(f.name + ": skip past the end at " + hex(in.addr));
+          n.succ.push_back({next, 0});
+          if (i + 2 < ins.size()) n.succ.push_back({(int)i + 2, ins[i + 1].size == 4 ? 2u : 1u});
+          else n.ends = true;
+          break;
+        }
+        case Flow::JUMP: {
+          const int to = local(in.target);
+          if (to >= 0) {
+            n.succ.push_back({to, 0});
+          } else {
+            uint64_t callee;                    // tail call
+            if (!callee_wcet(f, in, callee)) return false;
+            n.cost += callee;
+            n.ends = true;
+          }
+          break;
+        }
+        case Flow::CALL: {
+          uint64_t callee;
+          if (!callee_wcet(f, in, callee)) return false;
+          n.cost += callee;
+          if (next < 0) return fail(f.name + ": call at its end, " + hex(in.addr));
+          n.succ.push_back({next, 0});
+          break;
+        }
+        case Flow::RETURN:
+          n.ends = true;
+          break;
+        case Flow::INDIRECT:
+          return fail(f.name + ": indirect call or jump at " + hex(in.addr) + " (" + in.where + ")");
+      }
+    }
+
+    if (!collapse_loops(f, g)) return false;
+
+    // Longest path over what is now a DAG
+    std::vector<int64_t> memo(g.size(), -1);
+    std::vector<char> onStack(g.size(), 0);
+    bool cyclic = false;
+    std::function<uint64_t(int)> longest = [&](int n) -> uint64_t {
+      if (memo[n] >= 0) return (uint64_t)memo[n];
+      if (onStack[n]) {
+        cyclic = true;
+        return 0;
+      }
+      onStack[n] = 1;
+      uint64_t best = 0;
+      bool any = g[n].ends;
+      for (const auto &e : g[n].succ) {
+        if (!g[e.first].active) continue;
+        best = std::max(best, e.second + longest(e.first));
+        any = true;
+      }
+      onStack[n] = 0;
+      if (!any) best = 0;
+      memo[n] = (int64_t)(g[n].cost + best);
+      return g[n].cost + best;
+    };
+    int entry = 0;
+    while (!g[entry].active) entry = rep_[entry];
+    result = longest(entry);
+    if (cyclic) return fail(f.name + ": control flow that is not a natural loop");
+    return true;
+  }
+
+  bool callee_wcet(const Function &f, const Insn &in, uint64_t &cycles) {
+    auto it = byAddr_.find((uint32_t)in.target);
+    if (in.target < 0 || it == byAddr_.end()) return fail(f.name + ": call to unknown address " + hex((uint32_t)in.target));
+    return wcet_of(*it->second, cycles);
+  }
+
+  // Replaces each natural loop, innermost first, with one node costing its bound
+  bool collapse_loops(const Function &f, std::vector<Node> &g) {
+    // Back edges by depth-first search from the entry
+    const int n = (int)g.size();
+    std::vector<char> state(n, 0);
+    std::vector<std::pair<int, int>> back;
+    std::function<void(int)> dfs = [&](int u) {
+      state[u] = 1;
+      for (const auto &e : g[u].succ) {
+        if (state[e.first] == 1) back.push_back({u, e.first});
+        else if (state[e.first] == 0) dfs(e.first);
+      }
+      state[u] = 2;
+    };
+    dfs(0);
+
+    // Natural loops, merged per header
+    std::map<int, std::set<int>> body;
+    std::vector<std::vector<int>> pred(n);
+    for (int u = 0; u < n; u++) {
+      for (const auto &e : g[u].succ) pred[e.first].push_back(u);
+    }
+    for (const auto &be : back) {
+      std::set<int> &b = body[be.second];
+      b.insert(be.second);
+      std::vector<int> work = {be.first};
+      while (!work.empty()) {
+        const int x = work.back();
+        work.pop_back();
+        if (!b.insert(x).second && x != be.first) continue;
+        if (x == be.second) continue;
+        for (int p : pred[x]) {
+          if (!b.count(p)) work.push_back(p);
+        }
+      }
+    }
+    std::vector<std::pair<int, std::set<int>>> order(body.begin(), body.end());
+    std::sort(order.begin(), order.end(), [](const auto &a, const auto &b) { return a.second.size() < b.second.size(); });
+
+    rep_.assign(n, -1);
+    auto find = [this](int x) {
+      while (rep_[x] >= 0) x = rep_[x];
+      return x;
+    };
+    for (auto &lp : order) {
+      const int header = lp.first;
+      const Insn &hi = f.insns[header];
+      LoopReport rep;
+      rep.function = f.name;
+      rep.where = hi.where.empty() ? f.name + "+" + hex(hi.addr) : hi.where;
+      rep.header = hi.addr;
+      rep.marker = hi.where.empty() ? "" : markers_.name_for(hi.where);
+      auto b = rep.marker.empty() ? bounds_.end() : bounds_.find(rep.marker);
+      rep.bound = b == bounds_.end() ? 0 : b->second;
+
+      // Current nodes of the loop (inner loops already replaced)
+      std::set<int> nodes;
+      for (int x : lp.second) nodes.insert(find(x));
+      const int h = find(header);
+
+      // Longest path from each node to the back edge, and to leaving the loop
+      std::map<int, int64_t> toBack, toExit;
+      std::function<void(int)> walk = [&](int x) {
+        if (toBack.count(x)) return;
+        toBack[x] = -1;
+        toExit[x] = g[x].ends ? 0 : -1;
+        int64_t bb = -1, be = toExit[x];
+        for (const auto &e : g[x].succ) {
+          const int y = find(e.first);
+          if (y == h) {
+            bb = std::max(bb, (int64_t)e.second);
+          } else if (!nodes.count(y)) {
+            be = std::max(be, (int64_t)e.second);
+          } else {
+            walk(y);
+            if (toBack[y] >= 0) bb = std::max(bb, (int64_t)e.second + toBack[y]);
+            if (toExit[y] >= 0) be = std::max(be, (int64_t)e.second + toExit[y]);
+          }
+        }
+        toBack[x] = bb < 0 ? -1 : bb + (int64_t)g[x].cost;
+        toExit[x] = be < 0 ? -1 : be + (int64_t)g[x].cost;
+      };
+      walk(h);
+      rep.iteration = toBack[h] < 0 ? 0 : (uint64_t)toBack[h];
+      rep.exit = toExit[h] < 0 ? 0 : (uint64_t)toExit[h];
+      const bool seen = std::any_of(loops_.begin(), loops_.end(), [&rep](const LoopReport &l) {
+        return l.function == rep.function && l.header == rep.header;
+      });
+      if (!seen) loops_.push_back(rep);
+      if (!rep.bound) {
+        unbounded_ = true;
+        continue;
+      }
+
+      // The replacement node
+      Node s;
+      s.cost = rep.bound * rep.iteration + rep.exit;
+      std::set<int> exits;
+      for (int x : nodes) {
+        if (g[x].ends) s.ends = true;
+        for (const auto &e : g[x].succ) {
+          const int y = find(e.first);
+          if (!nodes.count(y)) exits.insert(y);
+        }
+      }
+      for (int y : exits) s.succ.push_back({y, 0});
+      const int id = (int)g.size();
+      g.push_back(s);
+      rep_.push_back(-1);
+      for (size_t u = 0; u < g.size(); u++) {
+        if (!g[u].active || nodes.count((int)u)) continue;
+        for (auto &e : g[u].succ) {
+          if (nodes.count(find(e.first))) e.first = id;
+        }
+      }
+      for (int x : nodes) {
+        g[x].active = false;
+        rep_[x] = id;
+      }
+    }
+    if (unbounded_) return fail("loops without a bound");
+    return true;
+  }
+
+  static std::string hex(uint32_t a) {
+    char b[16];
+    snprintf(b, sizeof(b), "0x%x", a);
+    return b;
+  }
+
+  const std::map<std::string, Function> &fns_;
+  const std::map<std::string, uint64_t> &bounds_;
+  LoopMarkers &markers_;
+  bool verbose_;
+  std::map<uint32_t, const Function *> byAddr_;
+  std::map<std::string, uint64_t> memo_;
+  std::set<std::string> inProgress_;
+  std::vector<int> rep_;
+  std::vector<LoopReport> loops_;
+  bool unbounded_ = false;
+  std::string error_;
+};
+
+// ========================= Interrupts =========================
+struct Isr {
+  int vector;
+  const char *name;
+  double period_us;               // minimum time between two runs; 0 = at most once per window
+};
+
+// The Logic Arduino's handlers: millis(), the status link and journal UDRE, the quench
+// lockout and the loop deadline
+std::vector<Isr> default_isrs() {
+  return {{23, "TIMER0_OVF", 1024.0},
+          {37, "USART1_UDRE", 10.0 * 1e6 / 250000.0},
+          {26, "USART0_UDRE", 10.0 * 1e6 / 115200.0},
+          {17, "TIMER1_COMPA", 0.0},
+          {19, "TIMER1_COMPC", 0.0}};
+}
+
+void usage() {
+  fprintf(stderr,
+          "usage: avr_wcet ELF | --disasm FILE [options]\n"
+          "  --disasm FILE          read `avr-objdump -d -l -C` output instead of running it\n"
+          "  --objdump PROGRAM      disassembler (default avr-objdump)\n"
+          "  -B FILE                loop bounds (`bound NAME N` per line, NAME from `// wcet-loop: NAME`)\n"
+          "  --src DIR              read the sources for the loop markers from DIR\n"
+          "  --isr VECTOR=US|once   minimum period of __vector_VECTOR (repeatable)\n"
+          "  --csv FILE             write item,cycles,us\n"
+          "  --max-latency-us US    exit 1 if the latency bound is above US\n"
+          "  -v                     print every function's bound\n");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const char *elf = nullptr, *disasm = nullptr, *boundsPath = nullptr, *csv = nullptr, *srcDir = "";
+  std::string objdump = "avr-objdump";
+  double maxLatency = 0.0;
+  bool verbose = false;
+  std::vector<Isr> isrs = default_isrs();
+  for (int i = 1; i < argc; i++) {
+    const std::string a = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (a == "--disasm" && hasValue) {
+      disasm = argv[++i];
+    } else if (a == "--objdump" && hasValue) {
+      objdump = argv[++i];
+    } else if (a == "-B" && hasValue) {
+      boundsPath = argv[++i];
+    } else if (a == "--src" && hasValue) {
+      srcDir = argv[++i];
+    } else if (a == "--isr" && hasValue) {
+      int v;
+      char per[32];
+      if (sscanf(argv[++i], "%d=%31s", &v, per) != 2) {
+        usage();
+        return 2;
+      }
+      const double p = strcmp(per, "once") == 0 ? 0.0 : atof(per);
+      auto it = std::find_if(isrs.begin(), isrs.end(), [v](const Isr &x) { return x.vector == v; });
+      if (it == isrs.end()) isrs.push_back({v, "", p});
+      else it->period_us = p;
+    } else if (a == "--csv" && hasValue) {
+      csv = argv[++i];
+    } else if (a == "--max-latency-us" && hasValue) {
+      maxLatency = atof(argv[++i]);
+    } else if (a == "-v") {
+      verbose = true;
+    } else if (a[0] != '-' && !elf) {
+      elf = argv[i];
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  if (!elf == !disasm) {
+    usage();
+    return 2;
+  }
+
+  std::map<std::string, uint64_t> bounds;
+  if (boundsPath) {
+    FILE *f = fopen(boundsPath, "r");
+    if (!f) {
+      fprintf(stderr, "avr_wcet: cannot open %s\n", boundsPath);
+      return 2;
+    }
+    char line[512], name[400];
+    unsigned long long n;
+    while (fgets(line, sizeof(line), f)) {
+      if (sscanf(line, " bound %399s %llu", name, &n) == 2) bounds[name] = n;
+    }
+    fclose(f);
+  }
+
+  std::map<std::string, Function> fns;
+  std::map<std::string, std::string> sources;
+  FILE *in = nullptr;
+  if (disasm) {
+    in = fopen(disasm, "r");
+  } else {
+    const std::string cmd = objdump + " -d -l -C '" + elf + "'";
+    in = popen(cmd.c_str(), "r");
+  }
+  if (!in) {
+    fprintf(stderr, "avr_wcet: cannot read the disassembly\n");
+    return 2;
+  }
+  const bool parsed = parse_disassembly(in, fns, sources);
+  if (disasm) fclose(in);
+  else pclose(in);
+  if (!parsed) {
+    fprintf(stderr, "avr_wcet: no functions in the disassembly\n");
+    return 2;
+  }
+
+  LoopMarkers markers(sources, srcDir);
+  Analyzer an(fns, bounds, markers, verbose);
+  struct Row {
+    std::string item;
+    uint64_t cycles;
+  };
+  std::vector<Row> rows;
+  std::vector<std::string> notes;
+  bool ok = true;
+  auto bound = [&](const std::string &fn, const std::string &label) {
+    uint64_t c = 0;
+    if (!an.wcet(fn, c)) {
+      ok = false;
+      return (uint64_t)0;
+    }
+    rows.push_back({label, c});
+    return c;
+  };
+
+  // One loop pass: main() calls loop() and then serialEventRun() when the core links it
+  uint64_t pass = bound("loop", "loop() incl. step()");
+  if (find(fns, "serialEventRun")) pass += bound("serialEventRun", "serialEventRun()");
+  pass += 5 + 2;                                    // main's CALL loop and RJMP back
+
+  // Usually inlined into loop(), and then already part of its bound
+  for (const char *fn : {"step", "debounce_switches", "write_flags", "write_outputs"}) {
+    if (find(fns, fn)) bound(fn, std::string(fn) + "()");
+    else notes.push_back(std::string(fn) + "() is inlined into loop()");
+  }
+
+  struct IsrCost {
+    Isr isr;
+    uint64_t cycles;
+  };
+  std::vector<IsrCost> handlers;
+  for (const auto &kv : fns) {
+    int v;
+    if (sscanf(kv.first.c_str(), "__vector_%d", &v) != 1) continue;
+    auto it = std::find_if(isrs.begin(), isrs.end(), [v](const Isr &x) { return x.vector == v; });
+    const uint64_t c = bound(kv.first, kv.first + (it != isrs.end() && it->name[0] ? std::string(" ") + it->name : ""));
+    if (it == isrs.end()) {
+      fprintf(stderr, "avr_wcet: %s has no period; pass --isr %d=US or --isr %d=once\n", kv.first.c_str(), v, v);
+      ok = false;
+      continue;
+    }
+    handlers.push_back({*it, c + IRQ_ENTRY_CYCLES});
+  }
+
+  for (const LoopReport &l : an.loops()) {
+    if (l.bound) continue;
+    if (l.marker.empty()) {
+      fprintf(stderr, "avr_wcet: loop at %s (%s, header 0x%x) has no `// wcet-loop: NAME` marker: iteration %llu cycles, exit %llu\n",
+              l.where.c_str(), l.function.c_str(), l.header, (unsigned long long)l.iteration, (unsigned long long)l.exit);
+    } else {
+      fprintf(stderr, "avr_wcet: loop %s at %s (%s, header 0x%x) needs `bound %s N`: iteration %llu cycles, exit %llu\n",
+              l.marker.c_str(), l.where.c_str(), l.function.c_str(), l.header, l.marker.c_str(),
+              (unsigned long long)l.iteration, (unsigned long long)l.exit);
+    }
+  }
+  if (!ok) {
+    if (!an.error().empty()) fprintf(stderr, "avr_wcet: %s\n", an.error().c_str());
+    return 2;
+  }
+
+  // Response time of two passes under every handler that can preempt them
+  const double cyclesPerUs = F_CPU_MHZ;
+  double r = 2.0 * (double)pass;
+  for (int iter = 0; iter < 1000; iter++) {
+    double next = 2.0 * (double)pass;
+    for (const IsrCost &h : handlers) {
+      const double n = h.isr.period_us > 0.0 ? ceil(r / (h.isr.period_us * cyclesPerUs)) : 1.0;
+      next += n * (double)h.cycles;
+    }
+    if (next == r) break;
+    r = next;
+  }
+
+  printf("%-48s %10s %10s\n", "", "cycles", "us");
+  for (const Row &row : rows) printf("%-48s %10llu %10.2f\n", row.item.c_str(), (unsigned long long)row.cycles, row.cycles / cyclesPerUs);
+  printf("%-48s %10llu %10.2f\n", "one loop pass", (unsigned long long)pass, pass / cyclesPerUs);
+  for (const LoopReport &l : an.loops()) {
+    printf("  loop %-42s %4llu x %llu + %llu\n", (l.marker + " (" + l.where + ")").c_str(), (unsigned long long)l.bound,
+           (unsigned long long)l.iteration, (unsigned long long)l.exit);
+  }
+  printf("%-48s %10.0f %10.2f\n", "comparator to output, upper bound", r, r / cyclesPerUs);
+  for (const std::string &n : notes) printf("  %s\n", n.c_str());
+
+  if (csv) {
+    FILE *f = fopen(csv, "w");
+    if (!f) {
+      fprintf(stderr, "avr_wcet: cannot write %s\n", csv);
+      return 2;
+    }
+    fprintf(f, "item,cycles,us\n");
+    for (const Row &row : rows) fprintf(f, "%s,%llu,%.3f\n", row.item.c_str(), (unsigned long long)row.cycles, row.cycles / cyclesPerUs);
+    fprintf(f, "loop pass,%llu,%.3f\n", (unsigned long long)pass, pass / cyclesPerUs);
+    fprintf(f, "latency bound,%.0f,%.3f\n", r, r / cyclesPerUs);
+    fclose(f);
+  }
+  if (maxLatency > 0.0 && r / cyclesPerUs > maxLatency) {
+    printf("latency bound %.2f us is above --max-latency-us %.2f\n", r / cyclesPerUs, maxLatency);
+    return 1;
+  }
+  return 0;
+}
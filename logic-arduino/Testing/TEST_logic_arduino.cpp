@@ -50,6 +50,10 @@
     A1 – Beam Enable Signal
     A2 – 3kV HV Enable Signal
     D16 - Interlock LED
+
+  Boot timing (only for the "boot" command):
+    Tester D2  -> Logic RESET header pin (driven LOW to hold the Logic Arduino in reset)
+    Tester D41 -> Logic D41 loop heartbeat (toggles once per step())
 */
 
 #include <Arduino.h>
@@ -73,6 +77,9 @@ static constexpr uint8_t  COMP_IDX_3KV_I = 7; // D49
 // DO NOT CHANGE per user requirement
 static constexpr uint16_t RESET_PULSE_MS_NOMOP = 20;
 
+static constexpr uint16_t BOOT_RESET_HOLD_MS = 5;
+static constexpr uint16_t BOOT_TIMEOUT_MS    = 5000;  // external reset runs the bootloader first
+
 // ========================= Pin Map =========================
 struct PinMap {
   // Logic inputs we DRIVE
@@ -94,6 +101,10 @@ struct PinMap {
   uint8_t outA0;     // Logic A0
   uint8_t outA1;     // Logic A1
   uint8_t outA2;     // Logic A2
+
+  // Boot timing only
+  uint8_t logicReset; // Logic RESET pin (we DRIVE, open-drain)
+  uint8_t heartbeat;  // Logic D41 (we READ)
 };
 
 static const PinMap P = {
@@ -102,7 +113,8 @@ static const PinMap P = {
   16,
   {22, 23, 24, 25, 26, 27, 28, 29},
   {30, 31, 32, 33, 34, 35, 36, 37},
-  A0, A1, A2
+  A0, A1, A2,
+  2, 41
 };
 
 // ========================= PROGMEM name strings (fixes F() global-init issue) =========================
@@ -373,6 +385,9 @@ static void initPins() {
   pinMode(P.outA0, INPUT);
   pinMode(P.outA1, INPUT);
   pinMode(P.outA2, INPUT);
+
+  releaseHiZ(P.logicReset);
+  pinMode(P.heartbeat, INPUT);
 }
 
 static void setAllSafeIdle() {
@@ -1016,6 +1031,107 @@ static void testSuiteOutputMirrorFlags() {
 }
 
 
+// ========================= Boot timing =========================
+// Holds the Logic Arduino in reset, releases it, and times how long its A0-A2 enables take
+// to read LOW (boot-to-safe) and how long until the first D41 heartbeat edge
+// (boot-to-first-step). While measuring, A0-A2 and D41 are pulled up here so an undriven
+// Logic pin reads HIGH; only a driven LOW counts as safe. The pins are polled through
+// PINF/PING directly (A0-A2 = PF0-PF2, D41 = PG0 on this Mega) for ~1 us resolution.
+// An external reset runs the bootloader before .init3, so both times include its delay;
+// the difference between them is the C++ startup + setup() time the early posture covers.
+struct BootTiming {
+  bool     ok;
+  bool     floatedInReset;  // enables read HIGH while held in reset (pull-ups can see Hi-Z)
+  uint32_t safeUs;
+  uint32_t firstStepUs;
+};
+
+static BootTiming measureBootTiming() {
+  BootTiming r = { false, false, 0, 0 };
+
+  pinMode(P.outA0, INPUT_PULLUP);
+  pinMode(P.outA1, INPUT_PULLUP);
+  pinMode(P.outA2, INPUT_PULLUP);
+  pinMode(P.heartbeat, INPUT_PULLUP);
+
+  driveLow(P.logicReset);
+  delay(BOOT_RESET_HOLD_MS);
+  r.floatedInReset = (PINF & 0x07) == 0x07;
+
+  bool safeSeen = false;
+  bool heartbeatLowSeen = false;
+  releaseHiZ(P.logicReset);
+  const uint32_t t0 = micros();
+  while (true) {
+    const uint32_t dt = micros() - t0;
+    const uint8_t enables = PINF & 0x07;
+    const bool heartbeat = (PING & _BV(PG0)) != 0;
+
+    if (!safeSeen && enables == 0) {
+      safeSeen = true;
+      r.safeUs = dt;
+    }
+    // D41 floats HIGH until setup() drives it LOW; the first step() toggles it HIGH
+    if (!heartbeatLowSeen) {
+      heartbeatLowSeen = !heartbeat;
+    } else if (heartbeat) {
+      r.firstStepUs = dt;
+      r.ok = safeSeen;
+      break;
+    }
+    if (dt > (uint32_t)BOOT_TIMEOUT_MS * 1000UL) break;
+  }
+
+  pinMode(P.outA0, INPUT);
+  pinMode(P.outA1, INPUT);
+  pinMode(P.outA2, INPUT);
+  pinMode(P.heartbeat, INPUT);
+  return r;
+}
+
+static void testSuiteBootTiming() {
+  beginSuite(1000, F("BOOT TIMING (tester D2 -> Logic RESET, tester D41 -> Logic D41)"));
+  suiteStart();
+
+  beginCase(1001, F("Enter NOM_OP with all enables ON before the reset"));
+  swOn(P.sw3kv);
+  swOn(P.sw80kv);
+  swOn(P.swCCS);
+  swOn(P.swBeams);
+  resetPulseNomOp();
+  if (!expectNomOp(true)) return;
+  if (!expectOutputs(true,true,true,false)) return;
+
+  beginCase(1002, F("Reset Logic Arduino: enables must be driven LOW before the first step()"));
+  const BootTiming bt = measureBootTiming();
+  const uint16_t safeUsLog  = (bt.safeUs > 65535UL) ? 65535 : (uint16_t)bt.safeUs;
+  const uint16_t firstUsLog = (bt.firstStepUs > 65535UL) ? 65535 : (uint16_t)bt.firstStepUs;
+  logPush(LOG_OBS, TAG4('B','T','S','F'), (uint8_t)bt.ok, (uint8_t)bt.floatedInReset, safeUsLog);
+  logPush(LOG_OBS, TAG4('B','T','S','T'), (uint8_t)bt.ok, 0, firstUsLog);
+
+  Serial.print(F("  boot-to-safe outputs: ")); Serial.print(bt.safeUs); Serial.println(F(" us"));
+  Serial.print(F("  boot-to-first-step:   ")); Serial.print(bt.firstStepUs); Serial.println(F(" us"));
+  if (bt.ok && bt.firstStepUs >= bt.safeUs) {
+    Serial.print(F("  outputs safe ")); Serial.print(bt.firstStepUs - bt.safeUs);
+    Serial.println(F(" us before the first step()"));
+  }
+  if (!bt.floatedInReset) {
+    Serial.println(F("  NOTE: enables did not float HIGH in reset; boot-to-safe is not meaningful with this wiring"));
+  }
+
+  if (!bt.ok || bt.safeUs > bt.firstStepUs) {
+    logPush(LOG_FAIL, TAG4('B','O','O','F'), (uint8_t)bt.ok, 0, safeUsLog);
+    Serial.println(bt.ok ? F("FAIL: enables were not LOW before the first step()")
+                         : F("FAIL: no safe outputs / heartbeat edge seen (check RESET and D41 wiring)"));
+    return;
+  }
+  logPush(LOG_PASS, TAG4('B','O','O','P'), 1, 0, safeUsLog);
+
+  // Logic came back in INTERLOCK; return every input to idle for the next suite
+  delay(50);
+  suiteStart();
+}
+
 static void runAllAutoTests() {
   autoRunning = true;
   gTestCase = 0;
@@ -1050,6 +1166,7 @@ static void printHelp() {
   Serial.println(F("  reset pulse <ms>"));
   Serial.println(F("  glitch sw <3kv|beams|ccs|80kv>"));
   Serial.println(F("  glitch comp <0..7>"));
+  Serial.println(F("  boot                       - reset Logic Arduino, report boot-to-safe / boot-to-first-step"));
 }
 
 static void printMap() {
@@ -1183,6 +1300,7 @@ static void handleCommand(const String& line) {
   if (t[0] == "dump") { logDump(); return; }
   if (t[0] == "idle") { gTestCase = 0; setAllSafeIdle(); Observe o = observeLogic(); printObserveDetailed(o); return; }
   if (t[0] == "auto") { runAllAutoTests(); return; }
+  if (t[0] == "boot") { testSuiteBootTiming(); return; }
 
   if (t[0] == "sw" && n >= 3) { cmdSetSwitch(t[1], t[2]); return; }
   if (t[0] == "comp" && n >= 3) { cmdSetComp(t[1].toInt(), t[2]); return; }
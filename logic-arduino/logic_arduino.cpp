@@ -33,7 +33,7 @@
     3) 3KV_TIMER
        - CCS enable  (A0): OFF
        - Beam enable (A1): OFF
-       - 3kV enable  (A2): forced OFF for 100 ms
+       - 3kV enable  (A2): forced OFF for 100 ms (Timer1 compare A lockout)
        - After 100 ms: return to BI
 
   Flags:
@@ -46,19 +46,48 @@
     - ACK toggle input (D14): any change clears latched interlock faults
     - ACK echo output (D9): toggles on every observed ACK edge so the monitor Arduino can
       prove this firmware is alive and still sampling D14
+    - Loop heartbeat output (D41): toggles once per step() so the +3kV monitor can count
+      edges on its Timer5 input and report the interlock loop rate
+    - Status link (TX1, D18): CRC-protected status frames to the +3kV monitor RX3 (D15),
+      sent from a ring of frame slots by the USART1 data-register-empty interrupt
+    - Transition journal (TX0, USB Serial): one CRC-protected binary record per state change,
+      drained from a RAM ring by the USART0 data-register-empty interrupt
 */
 
 #include <Arduino.h>
 #include <avr/io.h>
+#include <avr/interrupt.h>
 #include <avr/wdt.h>
+#include <util/crc16.h>
 
 struct Sample; // redundant but arduino does cpp weird, and it freaks out if this forward dec isnt here
 struct Output;
 
 // ========================= Constants =========================
-static constexpr uint32_t TIMER_3KV_MS   = 100;
+static constexpr uint32_t TIMER_3KV_US   = 100000;   // 3kV lockout, timed by Timer1 compare A (1 us resolution)
+
+// Arc-quench lockouts for the other supplies (see QUENCH_CHANNELS). 0 = no quench: a trip of
+// that pair drops NOM_OP straight to INTERLOCK, as before. 1 us - 8 s otherwise.
+static constexpr uint32_t QUENCH_P1KV_US = 0;
+static constexpr uint32_t QUENCH_N1KV_US = 0;
+static constexpr uint32_t QUENCH_20KV_US = 0;
+
+// Automatic re-arm budget shared by every channel with autoRearm set: at most
+// AUTO_REARM_MAX automatic returns to NOM_OP within any AUTO_REARM_WINDOW_MS.
+static constexpr uint8_t  AUTO_REARM_MAX       = 3;
+static constexpr uint32_t AUTO_REARM_WINDOW_MS = 600000UL;   // 10 minutes
 static constexpr uint8_t  DEBOUNCE_BITS = 6;    // Can be set from 1 to 31 (do NOT set an illegal number for this, weird stuf could happen)
 
+// Comparator glitch filter: a comparator fault must be present on this many consecutive
+// samples, taken every COMP_FILTER_SAMPLE_US, before the state machine acts on it.
+// 0 = no filtering (default); the raw PINL byte goes straight to the state machine.
+static constexpr uint8_t  COMP_FILTER_SAMPLES     = 0;    // 0-15, +-1kV and 20kV comparators (PL2-PL7)
+static constexpr uint8_t  COMP_FILTER_SAMPLES_3KV = 0;    // 0-15, 3kV V/I comparators (PL0/PL1)
+static constexpr uint16_t COMP_FILTER_SAMPLE_US   = 20;   // 1-16383 us between filter samples
+static constexpr uint8_t  TIMEBASE_TICKS_PER_US   = (uint8_t)(F_CPU / 8UL / 1000000UL);  // Timer1 ticks per us (2 at 16 MHz)
+static_assert(COMP_FILTER_SAMPLES <= 15 && COMP_FILTER_SAMPLES_3KV <= 15, "comparator filter windows are 4-bit counters");
+static_assert(COMP_FILTER_SAMPLE_US >= 1 && COMP_FILTER_SAMPLE_US <= 16383, "filter sample period must fit the Timer1 time base");
+
 enum class Timer3kVStateMode : uint8_t {
   DISABLE = 0,
   ENABLE  = 1
@@ -67,6 +96,42 @@ enum class Timer3kVStateMode : uint8_t {
 // Set to DISABLE to remove all transitions into STATE_3KV_TIMER, or ENABLE to keep transitions.
 static constexpr Timer3kVStateMode TIMER_3KV_STATE_MODE = Timer3kVStateMode::ENABLE;
 
+enum class LoopHeartbeatMode : uint8_t {
+  DISABLE = 0,
+  ENABLE  = 1
+};
+
+// Set to ENABLE to toggle D41 once per step() for the +3kV monitor loop-rate counter.
+static constexpr LoopHeartbeatMode LOOP_HEARTBEAT_MODE = LoopHeartbeatMode::ENABLE;
+
+enum class StatusLinkMode : uint8_t {
+  DISABLE = 0,
+  ENABLE  = 1
+};
+
+// Set to ENABLE to stream status frames to the +3kV monitor on TX1 (D18).
+static constexpr StatusLinkMode STATUS_LINK_MODE = StatusLinkMode::ENABLE;
+static constexpr uint32_t STATUS_LINK_BAUD = 250000;  // exact at 16 MHz with U2X (UBRR = 7); must match the monitor
+static constexpr uint16_t STATUS_LINK_INTERVAL_US = 2000;  // 1-32000 us between frames; sized to the monitor's receive ring
+
+enum class JournalMode : uint8_t {
+  DISABLE = 0,
+  ENABLE  = 1
+};
+
+enum class LoopDeadlineMode : uint8_t {
+  DISABLE = 0,
+  ENABLE  = 1
+};
+
+// Set to ENABLE to force the outputs safe whenever one step() period exceeds LOOP_DEADLINE_US.
+static constexpr LoopDeadlineMode LOOP_DEADLINE_MODE = LoopDeadlineMode::ENABLE;
+static constexpr uint16_t LOOP_DEADLINE_US = 2000;     // step() period budget, 1-32000 us (Timer1 compare C)
+
+// Set to ENABLE to journal every state transition and stream it on the USB Serial port (TX0).
+static constexpr JournalMode JOURNAL_MODE = JournalMode::ENABLE;
+static constexpr uint32_t JOURNAL_BAUD = 115200;      // 2.1% error at 16 MHz with U2X (UBRR = 16), fine for the USB bridge
+
 // ========================= Port mapping =========================
 // Switches D10-13 => PB4-PB7
 // Comparators D42-49 => PL7-PL0 (D49=PL0, D42=PL7)
@@ -74,12 +139,17 @@ static constexpr Timer3kVStateMode TIMER_3KV_STATE_MODE = Timer3kVStateMode::ENA
 // ACK D14 => PJ1, RESET BUTTON D15 => PJ0
 // ACK echo D9 => PH6, LED D16 => PH1
 // Outputs A0/A1/A2 => PF0/PF1/PF2
+// Loop heartbeat D41 => PG0
+// Status link TX1 D18 => PD3 (USART1 transmitter only)
+// Journal TX0 D1 => PE1 (USART0 transmitter only, USB Serial bridge)
+// Timer1 free-runs at F_CPU/8 (0.5 us/tick) as the loop time base; no pins used
 
 // ========================== State Enum ==========================
 enum class State : uint8_t {
   STATE_INTERLOCK  = 0,
   STATE_NOM_OP     = 1,
-  STATE_3KV_TIMER  = 2
+  STATE_3KV_TIMER  = 2,   // 3kV quench lockout (QUENCH_CHANNELS[QUENCH_CH_3KV])
+  STATE_QUENCH     = 3    // +-1kV / 20kV quench lockout (QUENCH_CHANNELS[activeQuench])
 };
 
 static State currentState = State::STATE_INTERLOCK;
@@ -100,6 +170,7 @@ static constexpr uint8_t MASK_OUT_BEAM  = _BV(PF1); // A1
 static constexpr uint8_t MASK_OUT_3KV   = _BV(PF2); // A2
 static constexpr uint8_t MASK_INTERLOCK_LED = _BV(PH1); // D16
 static constexpr uint8_t MASK_ACK_ECHO      = _BV(PH6); // D9
+static constexpr uint8_t MASK_LOOP_HEARTBEAT = _BV(PG0); // D41
 
 // ACK/RESET
 static constexpr uint8_t MASK_ACK       = _BV(PJ1); // D14
@@ -112,12 +183,85 @@ static constexpr uint32_t MASK_DEBOUNCE = (uint32_t)((1u << DEBOUNCE_BITS) - 1u)
 // PL0=D49 3kV I, PL1=D48 3kV V
 static constexpr uint8_t MASK_COMP_3KV      = (uint8_t)(_BV(PL0) | _BV(PL1));
 static constexpr uint8_t MASK_COMP_3KV_I    = _BV(PL0);
+static constexpr uint8_t MASK_COMP_20KV     = (uint8_t)(_BV(PL2) | _BV(PL3));
+static constexpr uint8_t MASK_COMP_N1KV     = (uint8_t)(_BV(PL4) | _BV(PL5));
+static constexpr uint8_t MASK_COMP_P1KV     = (uint8_t)(_BV(PL6) | _BV(PL7));
+
+// ========================= Arc-quench table =========================
+// One row per supply pair, checked in order, so the 3kV row keeps its priority. A trip of
+// nomOpTripMask in NOM_OP (or interlockTripMask in INTERLOCK) forces every output off for
+// lockoutUs; once it has run out and holdMask reads safe, the box returns to INTERLOCK, or
+// straight to NOM_OP if autoRearm is set, the lockout started from NOM_OP, nothing outside
+// the row tripped meanwhile, arming conditions still hold, and the re-arm budget allows.
+// lockoutUs = 0 disables the row. The default table reproduces the original 3kV timer.
+struct QuenchChannel {
+  uint8_t  nomOpTripMask;       // comparators that start the lockout from NOM_OP
+  uint8_t  interlockTripMask;   // comparators that start it from INTERLOCK (0 = never)
+  uint8_t  holdMask;            // comparators that must read safe before the lockout can end
+  uint32_t lockoutUs;           // lockout length, 1 us - 8 s; 0 disables the row
+  bool     autoRearm;           // return to NOM_OP after a clean expiry
+};
+
+static constexpr uint8_t QUENCH_CH_3KV = 0;
+static constexpr uint8_t QUENCH_CHANNEL_COUNT = 4;
+static constexpr QuenchChannel QUENCH_CHANNELS[QUENCH_CHANNEL_COUNT] = {
+  { MASK_COMP_3KV,  MASK_COMP_3KV_I, MASK_COMP_3KV_I,
+    (TIMER_3KV_STATE_MODE == Timer3kVStateMode::ENABLE) ? TIMER_3KV_US : 0, false },
+  { MASK_COMP_P1KV, 0, MASK_COMP_P1KV, QUENCH_P1KV_US, false },
+  { MASK_COMP_N1KV, 0, MASK_COMP_N1KV, QUENCH_N1KV_US, false },
+  { MASK_COMP_20KV, 0, MASK_COMP_20KV, QUENCH_20KV_US, false },
+};
+
+static constexpr bool quench_lockout_valid(uint8_t ch) {
+  return ch >= QUENCH_CHANNEL_COUNT ||
+         ((QUENCH_CHANNELS[ch].lockoutUs <= 8000000UL) && quench_lockout_valid((uint8_t)(ch + 1)));
+}
+static_assert(quench_lockout_valid(0), "quench lockouts must be 0 (off) or 1 us to 8 s");
 
 static inline bool timer_3kv_state_enabled() {
   return TIMER_3KV_STATE_MODE == Timer3kVStateMode::ENABLE;
 }
 
-// Capture reset cause and stop any inherited watchdog before normal startup runs.
+static inline bool loop_heartbeat_enabled() {
+  return LOOP_HEARTBEAT_MODE == LoopHeartbeatMode::ENABLE;
+}
+
+static inline bool status_link_enabled() {
+  return STATUS_LINK_MODE == StatusLinkMode::ENABLE;
+}
+
+static inline bool loop_deadline_enabled() {
+  return LOOP_DEADLINE_MODE == LoopDeadlineMode::ENABLE;
+}
+
+static inline bool journal_enabled() {
+  return JOURNAL_MODE == JournalMode::ENABLE;
+}
+
+// Minimal safe posture: enables driven LOW, ack echo LOW, interlock LED ON, flags LOW, and
+// input pull-ups ON. Register writes only, so it is valid in .init3 before .data/.bss are
+// set up; io_init_registers() applies the same image again (plus the rest) from setup().
+// PORTx is written before DDRx so no enable can glitch HIGH when it becomes an output.
+static inline void io_early_safe_posture() __attribute__((always_inline));
+static inline void io_early_safe_posture() {
+  PORTF &= (uint8_t)~(MASK_OUT_CCS | MASK_OUT_BEAM | MASK_OUT_3KV);
+  DDRF  |= (MASK_OUT_CCS | MASK_OUT_BEAM | MASK_OUT_3KV);
+  PORTH  = (uint8_t)((PORTH & (uint8_t)~MASK_ACK_ECHO) | MASK_INTERLOCK_LED);
+  DDRH  |= (MASK_INTERLOCK_LED | MASK_ACK_ECHO);
+
+  PORTA = 0x00;
+  PORTC = 0x00;
+  DDRA  = 0xFF;
+  DDRC  = 0xFF;
+
+  PORTB |= MASK_SWITCHES_PORTB;
+  PORTL  = 0xFF;
+  PORTJ |= (MASK_ACK | MASK_RESET_BTN);
+}
+
+// Capture reset cause and stop any inherited watchdog before normal startup runs, then
+// drive the safe posture so outputs settle within microseconds of a watchdog reset or
+// brown-out instead of floating through C++ startup and init().
 // This follows the standard avr-libc early-startup watchdog pattern.
 uint8_t resetCauseMirror __attribute__((section(".noinit")));
 void watchdog_early_init(void) __attribute__((naked)) __attribute__((section(".init3"))) __attribute__((used));
@@ -126,6 +270,7 @@ void watchdog_early_init(void) {
   resetCauseMirror = MCUSR;
   MCUSR = 0;
   wdt_disable();
+  io_early_safe_posture();
 }
 
 // ===================== Runtime state globals  =====================
@@ -145,6 +290,15 @@ static uint8_t latchedComparatorFlags = 0;
 static uint8_t latchedSwitchFlags = 0;
 static bool    latched3kVTimerFlag = false;
 static bool    prevAckLevel = false;
+static uint16_t stepCount = 0;
+
+// Quench lockout bookkeeping
+static uint8_t  activeQuench = 0;            // QUENCH_CHANNELS row of the running lockout
+static bool     quenchFromNomOp = false;     // lockout started from NOM_OP (auto re-arm allowed)
+static uint8_t  quenchOtherTrips = 0;        // comparators outside the row seen during the lockout
+static uint32_t autoRearmMs[AUTO_REARM_MAX ? AUTO_REARM_MAX : 1];
+static uint8_t  autoRearmNext = 0;
+static uint8_t  autoRearmUsed = 0;
 
 // ========================= Helpers =========================
 
@@ -184,6 +338,179 @@ static inline bool debounce_reset_button(bool resetButtonAsserted) {
   return debounce_update(resetButtonHist, resetButtonAsserted, resetButtonStable);
 }
 
+// ========================= Comparator glitch filter =========================
+// Bit-sliced down-counters, one 4-bit counter per comparator spread across four bytes
+// (filterCount[0] holds bit 0 of every counter). On each sample a safe input reloads its
+// counter with its window and a faulted input counts down; a fault is qualified once its
+// counter reaches zero. All eight comparators are updated with a handful of byte-wide
+// logic operations, and the separate 3kV window only changes the reload planes.
+// Samples are paced by Timer1, not by the loop, so the window is a fixed time; if a step
+// takes longer than COMP_FILTER_SAMPLE_US, at most one sample is taken per step.
+static constexpr uint8_t filter_reload_plane(uint8_t bit) {
+  return (uint8_t)(((COMP_FILTER_SAMPLES     >> bit) & 1u ? (uint8_t)~MASK_COMP_3KV : 0u) |
+                   ((COMP_FILTER_SAMPLES_3KV >> bit) & 1u ? MASK_COMP_3KV           : 0u));
+}
+
+static constexpr uint8_t FILTER_RELOAD[4] = {
+  filter_reload_plane(0), filter_reload_plane(1), filter_reload_plane(2), filter_reload_plane(3)
+};
+static constexpr uint16_t FILTER_SAMPLE_TICKS = (uint16_t)(COMP_FILTER_SAMPLE_US * TIMEBASE_TICKS_PER_US);
+
+static uint8_t  filterCount[4] = {0, 0, 0, 0};
+static uint8_t  filterQualified = 0;
+static uint16_t filterLastTick = 0;
+
+static inline bool comparator_filter_enabled() {
+  return COMP_FILTER_SAMPLES != 0 || COMP_FILTER_SAMPLES_3KV != 0;
+}
+
+static inline uint8_t filter_comparators(uint8_t raw) {
+  if (!comparator_filter_enabled()) {
+    return raw;
+  }
+
+  const uint16_t now = TCNT1;
+  if ((uint16_t)(now - filterLastTick) < FILTER_SAMPLE_TICKS) {
+    return filterQualified;
+  }
+  // Stay on the sample grid unless the loop fell a whole period behind
+  filterLastTick = ((uint16_t)(now - filterLastTick) < (uint16_t)(2 * FILTER_SAMPLE_TICKS))
+                     ? (uint16_t)(filterLastTick + FILTER_SAMPLE_TICKS) : now;
+
+  // Safe inputs reload their window
+  const uint8_t safe = (uint8_t)~raw;
+  uint8_t c0 = (uint8_t)((filterCount[0] & raw) | (FILTER_RELOAD[0] & safe));
+  uint8_t c1 = (uint8_t)((filterCount[1] & raw) | (FILTER_RELOAD[1] & safe));
+  uint8_t c2 = (uint8_t)((filterCount[2] & raw) | (FILTER_RELOAD[2] & safe));
+  uint8_t c3 = (uint8_t)((filterCount[3] & raw) | (FILTER_RELOAD[3] & safe));
+
+  // Faulted inputs with a nonzero counter count down by one (ripple borrow)
+  uint8_t borrow = (uint8_t)(raw & (c0 | c1 | c2 | c3));
+  c0 ^= borrow; borrow &= c0;
+  c1 ^= borrow; borrow &= c1;
+  c2 ^= borrow; borrow &= c2;
+  c3 ^= borrow;
+
+  filterCount[0] = c0;
+  filterCount[1] = c1;
+  filterCount[2] = c2;
+  filterCount[3] = c3;
+  filterQualified = (uint8_t)(raw & (uint8_t)~(c0 | c1 | c2 | c3));
+  return filterQualified;
+}
+
+// ========================= Quench lockout timer (Timer1 compare A) =========================
+// enter_quench_state() arms compare channel A on the Timer1 time base and the compare
+// interrupt sets lockoutExpired when the channel's lockout has elapsed, so the lockout
+// states only read a flag instead of calling millis() every pass. Lockouts longer than
+// one Timer1 period (32.768 ms) let the compare fire once per period and count down
+// lockoutWraps before expiring. Only one lockout runs at a time.
+static_assert(TIMER_3KV_US >= 1 && TIMER_3KV_US <= 8000000UL, "3kV lockout must be 1 us to 8 s");
+
+static volatile bool    lockoutExpired = true;
+static volatile uint8_t lockoutWraps = 0;      // full Timer1 periods left before the final match
+
+// One compare A match: a full period counted down, or the end of the lockout
+static inline void lockout_match() {
+  if (lockoutWraps != 0) {
+    lockoutWraps--;
+    return;
+  }
+  lockoutExpired = true;
+  TIMSK1 &= (uint8_t)~_BV(OCIE1A);
+}
+
+static inline void lockout_arm(uint32_t lockoutUs) {
+  const uint32_t ticks = lockoutUs * TIMEBASE_TICKS_PER_US;
+  const uint16_t low = (uint16_t)ticks;
+  const uint8_t sreg = SREG;
+  cli();
+  TIFR1 = _BV(OCF1A);       // drop any stale match before arming, so a new one is kept
+  const uint16_t start = TCNT1;
+  OCR1A = (uint16_t)(start + low);
+  lockoutWraps = (uint8_t)((ticks - 1UL) >> 16);
+  lockoutExpired = false;
+  TIMSK1 |= _BV(OCIE1A);
+  // Compare A only fires on equality. If TCNT1 already passed the target before OCR1A
+  // took it, take the match here instead of a full period late.
+  if (low != 0 && (uint16_t)(TCNT1 - start) >= low && !(TIFR1 & _BV(OCF1A))) {
+    lockout_match();
+  }
+  SREG = sreg;
+}
+
+// Time left in the lockout, for the status link only
+static inline uint32_t lockout_remaining_us() {
+  const uint8_t sreg = SREG;
+  cli();
+  uint32_t ticks = 0;
+  if (!lockoutExpired) {
+    // A match still waiting on the interrupt counts as reached
+    const uint16_t toMatch = (TIFR1 & _BV(OCF1A)) ? 0 : (uint16_t)(OCR1A - TCNT1);
+    ticks = ((uint32_t)lockoutWraps << 16) + toMatch;
+  }
+  SREG = sreg;
+  return ticks / TIMEBASE_TICKS_PER_US;
+}
+
+ISR(TIMER1_COMPA_vect) {
+  lockout_match();
+}
+
+// ========================= Loop deadline supervisor (Timer1 compare C) =========================
+// Every step() re-arms compare channel C LOOP_DEADLINE_US ahead on the Timer1 time base.
+// If the next step() does not start in time, the compare interrupt drives the PORTF
+// enables and their PORTA mirrors low itself, counts the overrun and leaves deadlineOverrun
+// set; write_outputs() will not touch PORTF, nor write_flags() the mirrors, until step()
+// has consumed the overrun and dropped NOM_OP. This
+// bounds the time outputs can stay on behind a stalled or slowed loop to the budget,
+// not the 500 ms watchdog.
+static constexpr uint16_t DEADLINE_TICKS = (uint16_t)(LOOP_DEADLINE_US * TIMEBASE_TICKS_PER_US);
+static_assert(LOOP_DEADLINE_US >= 1 && LOOP_DEADLINE_US <= 32000, "loop deadline must fit one Timer1 period");
+
+static volatile bool     deadlineOverrun = false;
+static volatile uint16_t deadlineOverruns = 0;     // overruns since reset (wraps)
+
+// OCR1C shares the 16-bit TEMP register with the TCNT1 reads in the compare interrupts,
+// and TIMSK1 is read-modify-written by both of them
+static inline void deadline_rearm() {
+  const uint8_t sreg = SREG;
+  cli();
+  OCR1C = (uint16_t)(TCNT1 + DEADLINE_TICKS);
+  TIFR1 = _BV(OCF1C);
+  TIMSK1 |= _BV(OCIE1C);
+  SREG = sreg;
+}
+
+// Returns true once per overrun; resyncs the PORTF cache the interrupt bypassed.
+static inline bool deadline_consume_overrun() {
+  if (!deadlineOverrun) {
+    return false;
+  }
+  const uint8_t sreg = SREG;
+  cli();
+  deadlineOverrun = false;
+  prevPORTF = PORTF;
+  SREG = sreg;
+  return true;
+}
+
+static inline uint16_t deadline_overrun_count() {
+  const uint8_t sreg = SREG;
+  cli();
+  const uint16_t n = deadlineOverruns;
+  SREG = sreg;
+  return n;
+}
+
+ISR(TIMER1_COMPC_vect) {
+  PORTF &= (uint8_t)~(MASK_OUT_CCS | MASK_OUT_BEAM | MASK_OUT_3KV);
+  PORTA &= (uint8_t)~(MASK_PA_CCS | MASK_PA_BEAMS | MASK_PA_3KVEN);
+  deadlineOverrun = true;
+  deadlineOverruns++;
+  TIMSK1 &= (uint8_t)~_BV(OCIE1C);
+}
+
 // ========================= Low-level IO (pullups always ON) =========================
 static inline void io_init_registers() {
   // Switch inputs: PB4-PB7 with pullups
@@ -206,6 +533,12 @@ static inline void io_init_registers() {
   DDRF |= (MASK_OUT_CCS | MASK_OUT_BEAM | MASK_OUT_3KV);
   DDRH |= (MASK_INTERLOCK_LED | MASK_ACK_ECHO);
 
+  // Loop heartbeat: D41 (PG0), only driven when the heartbeat is enabled
+  if (loop_heartbeat_enabled()) {
+    DDRG  |= MASK_LOOP_HEARTBEAT;
+    PORTG &= (uint8_t)~MASK_LOOP_HEARTBEAT;
+  }
+
   // Initial Outputs:
   PORTF &= (uint8_t)~(MASK_OUT_CCS | MASK_OUT_BEAM | MASK_OUT_3KV); // OFF
   PORTH &= (uint8_t)~MASK_ACK_ECHO;                                 // ACK echo LOW
@@ -214,6 +547,13 @@ static inline void io_init_registers() {
   // Flags default:
   PORTA = 0x00;
   PORTC = 0x00;
+
+  // Timer1 time base: normal mode, F_CPU/8, no outputs or interrupts. The Arduino core
+  // leaves it in 8-bit PWM mode, which nothing in this firmware uses.
+  TCCR1A = 0;
+  TCCR1B = _BV(CS11);
+  TCCR1C = 0;
+  TIMSK1 = 0;
 }
 
 struct Sample {
@@ -252,11 +592,50 @@ static inline void handle_ack_toggle(bool ackLevel) {
   prevAckLevel = ackLevel;
 }
 
-static inline void enter_3kv_timer_state(uint32_t& timerEnterMs) {
-  currentState = State::STATE_3KV_TIMER;
-  timerEnterMs = millis();
-  // D26 is an event latch, so only set it on timer-state entry.
-  latched3kVTimerFlag = true;
+static inline bool quench_state(State st) {
+  return st == State::STATE_3KV_TIMER || st == State::STATE_QUENCH;
+}
+
+// First enabled row whose trip mask matches, or QUENCH_CHANNEL_COUNT for none
+static inline uint8_t quench_channel_for(uint8_t comparators, bool fromNomOp) {
+  for (uint8_t ch = 0; ch < QUENCH_CHANNEL_COUNT; ch++) {  // wcet-loop: quench_rows
+    const QuenchChannel& q = QUENCH_CHANNELS[ch];
+    const uint8_t tripMask = fromNomOp ? q.nomOpTripMask : q.interlockTripMask;
+    if (q.lockoutUs != 0 && (comparators & tripMask)) {
+      return ch;
+    }
+  }
+  return QUENCH_CHANNEL_COUNT;
+}
+
+static inline void enter_quench_state(uint8_t ch, bool fromNomOp) {
+  const QuenchChannel& q = QUENCH_CHANNELS[ch];
+  currentState = (ch == QUENCH_CH_3KV) ? State::STATE_3KV_TIMER : State::STATE_QUENCH;
+  activeQuench = ch;
+  quenchFromNomOp = fromNomOp;
+  quenchOtherTrips = 0;
+  lockout_arm(q.lockoutUs);
+  // D26 is an event latch, so only set it on 3kV timer-state entry.
+  if (ch == QUENCH_CH_3KV) {
+    latched3kVTimerFlag = true;
+  }
+}
+
+// Takes one automatic re-arm from the budget if fewer than AUTO_REARM_MAX were used in the
+// last AUTO_REARM_WINDOW_MS. Only called on a lockout expiry, so millis() stays off the fast path.
+static inline bool auto_rearm_take() {
+  if (AUTO_REARM_MAX == 0) {
+    return false;
+  }
+  const uint32_t now = millis();
+  if (autoRearmUsed == AUTO_REARM_MAX &&
+      (uint32_t)(now - autoRearmMs[autoRearmNext]) < AUTO_REARM_WINDOW_MS) {
+    return false;
+  }
+  autoRearmMs[autoRearmNext] = now;                  // overwrite the oldest re-arm
+  autoRearmNext = (uint8_t)((autoRearmNext + 1) % AUTO_REARM_MAX);
+  if (autoRearmUsed < AUTO_REARM_MAX) autoRearmUsed++;
+  return true;
 }
 
 static inline void write_flags(const Sample& sample, const Output& out)
@@ -278,8 +657,14 @@ static inline void write_flags(const Sample& sample, const Output& out)
   porta |= latched3kVTimerFlag ? MASK_PA_3KVTMR : 0;
   porta |= (uint8_t)(latchedSwitchFlags & MASK_SWITCH_FLAGS_PORTB);
 
-  // write flags
+  // write flags; a pending loop overrun keeps the D22-D24 mirrors at its forced safe image
+  const uint8_t sreg = SREG;
+  cli();
+  if (deadlineOverrun) {
+    porta &= (uint8_t)~(MASK_PA_CCS | MASK_PA_BEAMS | MASK_PA_3KVEN);
+  }
   PORTA = porta;
+  SREG = sreg;
   PORTC = latchedComparatorFlags;
 }
 
@@ -305,10 +690,15 @@ static inline void write_outputs(const Output& out) {
     porth |= MASK_INTERLOCK_LED;
   }
 
-  // write if there were changes
-  if (portf != prevPORTF) { 
-    PORTF = portf; 
-    prevPORTF = portf; 
+  // write if there were changes; a pending loop overrun keeps PORTF in its forced safe image
+  if (portf != prevPORTF) {
+    const uint8_t sreg = SREG;
+    cli();
+    if (!deadlineOverrun) {
+      PORTF = portf;
+      prevPORTF = portf;
+    }
+    SREG = sreg;
   }
   if (porth != prevPORTH) {
      PORTH = porth; 
@@ -318,14 +708,391 @@ static inline void write_outputs(const Output& out) {
 
 
 
+// ========================= First-out capture =========================
+// The comparator bit(s) that trip first while every comparator is safe and acknowledged are
+// recorded together with the state at that moment and a micros() timestamp; every later
+// bit that trips in the same episode gets its offset from that first fault. The episode
+// ends only once all comparators read safe with nothing latched since the last ACK, so
+// the monitor's periodic ACK does not restart the record during a standing fault.
+// PINL is pushed into a small ring every step and the ring is frozen
+// FIRST_OUT_POST_SAMPLES steps after the first fault, so the record shows the comparator
+// pattern on both sides of the trip. micros() is only read on steps where a new bit
+// trips, so a quiet step pays for one store and a compare.
+static constexpr uint8_t  FIRST_OUT_HISTORY      = 16;   // PINL samples per record (power of two)
+static constexpr uint8_t  FIRST_OUT_HISTORY_MASK = FIRST_OUT_HISTORY - 1;
+static constexpr uint8_t  FIRST_OUT_POST_SAMPLES = 8;    // samples kept after the first-fault sample
+static constexpr uint16_t FIRST_OUT_NOT_LATCHED  = 0xFFFF;
+static constexpr uint16_t FIRST_OUT_OFFSET_MAX   = 0xFFFE;
+
+struct FirstOutRecord {
+  uint8_t  seq;                         // capture number, 1-255 (0 = no capture yet)
+  uint8_t  firstMask;                   // comparator bits that latched on the first-fault step
+  uint8_t  state;                       // currentState going into that step
+  uint32_t firstUs;                     // micros() at the first fault
+  uint16_t latchOffsetUs[8];            // per PLn bit: latch time - firstUs, saturating
+  uint8_t  history[FIRST_OUT_HISTORY];  // PINL samples, oldest first
+};
+
+static FirstOutRecord firstOut;
+static bool    firstOutReady = false;           // history frozen, record can be exported
+static uint8_t firstOutPostRemaining = 0;       // post-trip samples still to collect
+static uint8_t pinlHistory[FIRST_OUT_HISTORY];
+static uint8_t pinlHistoryIdx = 0;
+static uint8_t firstOutLatched = 0;             // comparator bits seen in the current episode
+
+// Must run after handle_ack_toggle() and before write_flags() so latchedComparatorFlags
+// still holds the latch image from the steps since the last ACK. Trips are judged on the
+// filtered comparators; the history ring keeps raw PINL so rejected glitches stay visible.
+static inline void track_first_out(uint8_t rawComparators, uint8_t comparators) {
+  pinlHistory[pinlHistoryIdx & FIRST_OUT_HISTORY_MASK] = rawComparators;
+  pinlHistoryIdx++;
+
+  if (firstOutPostRemaining != 0 && --firstOutPostRemaining == 0) {
+    for (uint8_t i = 0; i < FIRST_OUT_HISTORY; i++) {  // wcet-loop: first_out_history
+      firstOut.history[i] = pinlHistory[(uint8_t)(pinlHistoryIdx + i) & FIRST_OUT_HISTORY_MASK];
+    }
+    firstOutReady = true;
+  }
+
+  // All safe and nothing latched since the last ACK closes the episode.
+  if ((comparators | latchedComparatorFlags) == 0) {
+    firstOutLatched = 0;
+    return;
+  }
+
+  const uint8_t newBits = (uint8_t)(comparators & ~firstOutLatched);
+  if (newBits == 0) {
+    return;
+  }
+
+  const uint32_t nowUs = micros();
+  if (firstOutLatched == 0) {
+    // First fault of a new episode starts a new record
+    firstOut.seq = (firstOut.seq == 0xFF) ? 1 : (uint8_t)(firstOut.seq + 1);
+    firstOut.firstMask = newBits;
+    firstOut.state     = (uint8_t)currentState;
+    firstOut.firstUs   = nowUs;
+    for (uint8_t bit = 0; bit < 8; bit++) {  // wcet-loop: first_out_clear_offsets
+      firstOut.latchOffsetUs[bit] = FIRST_OUT_NOT_LATCHED;
+    }
+    firstOutReady = false;
+    firstOutPostRemaining = FIRST_OUT_POST_SAMPLES;
+  }
+
+  firstOutLatched |= newBits;
+
+  const uint32_t offsetUs = nowUs - firstOut.firstUs;
+  const uint16_t offset16 = (offsetUs > FIRST_OUT_OFFSET_MAX) ? FIRST_OUT_OFFSET_MAX : (uint16_t)offsetUs;
+  for (uint8_t bit = 0; bit < 8; bit++) {  // wcet-loop: first_out_new_offsets
+    if (newBits & _BV(bit)) firstOut.latchOffsetUs[bit] = offset16;
+  }
+}
+
+// ========================= Status link (USART1 TX) =========================
+// Frames are copied into fixed slots by step() and drained byte by byte by the USART1
+// UDRE interrupt, which also appends the CRC, so step() never waits on the UART.
+//
+// Status frame (little-endian, CRC-16/Modbus over bytes 0-15):
+//   [0] sync 0xA5  [1] type 0x01  [2] sequence  [3] state
+//   [4] raw comparators (PINL)  [5] comparators used by the state machine
+//   [6] raw inputs: PB4-PB7 switches asserted, bit1 ACK level, bit0 reset asserted
+//   [7] debounced inputs: PB4-PB7 switches, bit0 reset
+//   [8] PORTA flag image  [9] PORTC latched comparator image
+//   [10-11] 3kV timer remaining (ms)  [12-13] step count
+//   [14-15] loop deadline overruns  [16-17] CRC
+//
+// First-out frame (little-endian, CRC-16/Modbus over bytes 0-41), sent in place of one
+// status frame as soon as a capture completes and then every LINK_FIRST_OUT_REPEAT frames:
+//   [0] sync 0xA5  [1] type 0x02  [2] sequence  [3] record number
+//   [4] first-fault comparator mask  [5] state at the first fault
+//   [6-9] micros() at the first fault
+//   [10-25] latch offset (us) for PL0..PL7, 0xFFFF = not latched
+//   [26-41] PINL history, oldest first  [42-43] CRC
+static constexpr uint8_t LINK_SYNC            = 0xA5;
+static constexpr uint8_t LINK_FRAME_STATUS    = 0x01;
+static constexpr uint8_t LINK_FRAME_FIRST_OUT = 0x02;
+static constexpr uint8_t LINK_STATUS_LEN      = 16;    // bytes before the CRC
+static constexpr uint8_t LINK_FIRST_OUT_LEN   = 26 + FIRST_OUT_HISTORY;
+static constexpr uint8_t LINK_FIRST_OUT_REPEAT = 32;   // status frames between first-out repeats
+static constexpr uint8_t LINK_SLOT_BYTES      = LINK_FIRST_OUT_LEN;
+static constexpr uint8_t LINK_SLOT_COUNT      = 4;     // power of two
+static constexpr uint8_t LINK_SLOT_INDEX_MASK = LINK_SLOT_COUNT - 1;
+static constexpr uint16_t LINK_UBRR = (uint16_t)((F_CPU / (8UL * STATUS_LINK_BAUD)) - 1UL);
+static constexpr uint16_t LINK_INTERVAL_TICKS = (uint16_t)(STATUS_LINK_INTERVAL_US * TIMEBASE_TICKS_PER_US);
+static_assert(STATUS_LINK_INTERVAL_US >= 1 && STATUS_LINK_INTERVAL_US <= 32000, "status link interval must fit one Timer1 period");
+
+struct LinkSlot {
+  uint8_t len;
+  uint8_t data[LINK_SLOT_BYTES];
+};
+
+static LinkSlot linkSlots[LINK_SLOT_COUNT];
+static volatile uint8_t linkHead = 0;   // next slot step() fills; only step() writes it
+static volatile uint8_t linkTail = 0;   // slot the ISR is sending; only the ISR writes it
+static uint8_t linkSeq = 0;
+static uint16_t linkLastTick = 0;          // Timer1 time the last frame was queued
+static uint8_t linkFirstOutSent = 0;        // record number last sent, 0 = none
+static uint8_t linkFirstOutCountdown = 0;   // status frames until the record is repeated
+
+static inline void link_init() {
+  UBRR1  = LINK_UBRR;
+  UCSR1A = _BV(U2X1);
+  UCSR1C = _BV(UCSZ11) | _BV(UCSZ10);   // 8N1
+  UCSR1B = _BV(TXEN1);                  // transmitter only, UDRE interrupt enabled per frame
+}
+
+static inline uint16_t timer_3kv_remaining_ms() {
+  if (!quench_state(currentState)) {
+    return 0;
+  }
+  // Round up so a running lockout never reports 0 ms
+  return (uint16_t)((lockout_remaining_us() + 999UL) / 1000UL);
+}
+
+static inline void link_fill_status(LinkSlot& slot, const Sample& raw, const Sample& qualified, bool resetButtonDb) {
+  const uint16_t remainingMs = timer_3kv_remaining_ms();
+  slot.len      = LINK_STATUS_LEN;
+  slot.data[0]  = LINK_SYNC;
+  slot.data[1]  = LINK_FRAME_STATUS;
+  slot.data[2]  = linkSeq++;
+  slot.data[3]  = (uint8_t)currentState;
+  slot.data[4]  = raw.comparators;
+  slot.data[5]  = qualified.comparators;
+  slot.data[6]  = (uint8_t)(raw.switchesAssertPortB | (raw.ackLevel ? _BV(1) : 0) | (raw.resetAsserted ? _BV(0) : 0));
+  slot.data[7]  = (uint8_t)(qualified.switchesAssertPortB | (resetButtonDb ? _BV(0) : 0));
+  slot.data[8]  = PORTA;
+  slot.data[9]  = PORTC;
+  slot.data[10] = (uint8_t)(remainingMs & 0xFF);
+  slot.data[11] = (uint8_t)(remainingMs >> 8);
+  slot.data[12] = (uint8_t)(stepCount & 0xFF);
+  slot.data[13] = (uint8_t)(stepCount >> 8);
+  const uint16_t overruns = deadline_overrun_count();
+  slot.data[14] = (uint8_t)(overruns & 0xFF);
+  slot.data[15] = (uint8_t)(overruns >> 8);
+}
+
+static inline void link_fill_first_out(LinkSlot& slot) {
+  slot.len     = LINK_FIRST_OUT_LEN;
+  slot.data[0] = LINK_SYNC;
+  slot.data[1] = LINK_FRAME_FIRST_OUT;
+  slot.data[2] = linkSeq++;
+  slot.data[3] = firstOut.seq;
+  slot.data[4] = firstOut.firstMask;
+  slot.data[5] = firstOut.state;
+  slot.data[6] = (uint8_t)(firstOut.firstUs);
+  slot.data[7] = (uint8_t)(firstOut.firstUs >> 8);
+  slot.data[8] = (uint8_t)(firstOut.firstUs >> 16);
+  slot.data[9] = (uint8_t)(firstOut.firstUs >> 24);
+  for (uint8_t bit = 0; bit < 8; bit++) {  // wcet-loop: link_first_out_offsets
+    slot.data[10 + 2 * bit] = (uint8_t)(firstOut.latchOffsetUs[bit] & 0xFF);
+    slot.data[11 + 2 * bit] = (uint8_t)(firstOut.latchOffsetUs[bit] >> 8);
+  }
+  for (uint8_t i = 0; i < FIRST_OUT_HISTORY; i++) {  // wcet-loop: link_first_out_history
+    slot.data[26 + i] = firstOut.history[i];
+  }
+}
+
+static inline void link_queue_frame(const Sample& raw, const Sample& qualified, bool resetButtonDb) {
+  // Frames are paced to one per STATUS_LINK_INTERVAL_US so the monitor's receive ring
+  // outlasts its longest loop() pass; a new first-out record does not wait.
+  const uint16_t now = TCNT1;
+  const bool newRecord = firstOutReady && (firstOut.seq != linkFirstOutSent);
+  if (!newRecord && (uint16_t)(now - linkLastTick) < LINK_INTERVAL_TICKS) {
+    return;
+  }
+
+  // Drop the frame rather than wait when every slot is still queued.
+  const uint8_t head = linkHead;
+  if ((uint8_t)(head - linkTail) >= LINK_SLOT_COUNT) {
+    return;
+  }
+  linkLastTick = now;
+
+  // A completed first-out record goes out at once and is then repeated periodically, so
+  // a frame lost to noise or a monitor reset is recovered without a request channel.
+  // The record is only written by step(), so copying it here cannot tear.
+  LinkSlot& slot = linkSlots[head & LINK_SLOT_INDEX_MASK];
+  if (newRecord || (firstOutReady && linkFirstOutCountdown == 0)) {
+    link_fill_first_out(slot);
+    linkFirstOutSent = firstOut.seq;
+    linkFirstOutCountdown = LINK_FIRST_OUT_REPEAT;
+  } else {
+    link_fill_status(slot, raw, qualified, resetButtonDb);
+    if (linkFirstOutCountdown != 0) linkFirstOutCountdown--;
+  }
+
+  linkHead = (uint8_t)(head + 1);
+  UCSR1B |= _BV(UDRIE1);
+}
+
+ISR(USART1_UDRE_vect) {
+  static uint8_t index = 0;
+  static uint16_t crc = 0xFFFF;
+
+  const LinkSlot& slot = linkSlots[linkTail & LINK_SLOT_INDEX_MASK];
+
+  if (index < slot.len) {
+    const uint8_t b = slot.data[index++];
+    crc = _crc16_update(crc, b);
+    UDR1 = b;
+  } else if (index == slot.len) {
+    UDR1 = (uint8_t)(crc & 0xFF);
+    index++;
+  } else {
+    UDR1 = (uint8_t)(crc >> 8);
+    index = 0;
+    crc = 0xFFFF;
+    const uint8_t tail = (uint8_t)(linkTail + 1);
+    linkTail = tail;
+    if (tail == linkHead) {
+      UCSR1B &= (uint8_t)~_BV(UDRIE1);
+    }
+  }
+}
+
+// ========================= Transition journal (USART0 TX) =========================
+// Every state change is written as a fixed-size record into a RAM ring by step() and
+// drained to the USB Serial bridge by the USART0 UDRE interrupt, one byte per interrupt,
+// with the CRC appended in the interrupt. step() only pays for the record on steps where
+// the state actually changes. If the ring is full the new record is dropped; the record
+// number still advances, so the host sees the gap.
+//
+// Journal record (little-endian, CRC-16/Modbus over bytes 0-11):
+//   [0] sync 0xA5  [1] type 0x03  [2] record number  [3] cause
+//   [4] state before  [5] state after
+//   [6] cause detail: comparator mask, missing switch mask (PB4-PB7), or reset cause (MCUSR)
+//   [7] output image: bit0 CCS, bit1 beams, bit2 3kV, bit3 NomOp
+//   [8-11] micros() at the transition  [12-13] CRC
+static constexpr uint8_t JOURNAL_FRAME_TYPE  = 0x03;
+static constexpr uint8_t JOURNAL_RECORD_LEN  = 12;    // bytes before the CRC
+static constexpr uint8_t JOURNAL_RING_COUNT  = 32;    // power of two
+static constexpr uint8_t JOURNAL_RING_MASK   = JOURNAL_RING_COUNT - 1;
+static constexpr uint16_t JOURNAL_UBRR = (uint16_t)((F_CPU / (8UL * JOURNAL_BAUD)) - 1UL);
+
+enum class JournalCause : uint8_t {
+  BOOT           = 0,   // power-up / reset, detail = MCUSR reset cause
+  COMPARATOR     = 1,   // detail = comparators that forced the transition
+  SWITCH_DROP    = 2,   // detail = required switches (PB4/PB7) no longer asserted
+  RESET_EDGE     = 3,   // reset button edge armed NomOp
+  TIMER_EXPIRED  = 4,   // quench lockout finished, detail = QUENCH_CHANNELS row
+  LOOP_OVERRUN   = 5,   // step() period exceeded LOOP_DEADLINE_US, detail = overrun count (low byte)
+  AUTO_REARM     = 6    // clean quench expiry returned to NomOp, detail = QUENCH_CHANNELS row
+};
+
+struct JournalRecord {
+  uint8_t data[JOURNAL_RECORD_LEN];
+};
+
+static JournalRecord journalRing[JOURNAL_RING_COUNT];
+static volatile uint8_t journalHead = 0;   // next record step() fills; only step() writes it
+static volatile uint8_t journalTail = 0;   // record the ISR is sending; only the ISR writes it
+static uint8_t journalSeq = 0;
+
+static inline void journal_init() {
+  UBRR0  = JOURNAL_UBRR;
+  UCSR0A = _BV(U2X0);
+  UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);   // 8N1
+  UCSR0B = _BV(TXEN0);                  // transmitter only, UDRE interrupt enabled per record
+}
+
+static inline uint8_t journal_output_image(const Output& out) {
+  return (uint8_t)((out.ccsPowerEnable ? _BV(0) : 0) | (out.armBeamsEnable ? _BV(1) : 0) |
+                   (out.enable3kV ? _BV(2) : 0) | (out.nomOp ? _BV(3) : 0));
+}
+
+static inline void journal_append(JournalCause cause, State from, State to, uint8_t detail, const Output& out) {
+  const uint8_t seq = journalSeq++;
+  const uint8_t head = journalHead;
+  if ((uint8_t)(head - journalTail) >= JOURNAL_RING_COUNT) {
+    return;
+  }
+
+  const uint32_t nowUs = micros();
+  JournalRecord& rec = journalRing[head & JOURNAL_RING_MASK];
+  rec.data[0]  = LINK_SYNC;
+  rec.data[1]  = JOURNAL_FRAME_TYPE;
+  rec.data[2]  = seq;
+  rec.data[3]  = (uint8_t)cause;
+  rec.data[4]  = (uint8_t)from;
+  rec.data[5]  = (uint8_t)to;
+  rec.data[6]  = detail;
+  rec.data[7]  = journal_output_image(out);
+  rec.data[8]  = (uint8_t)(nowUs);
+  rec.data[9]  = (uint8_t)(nowUs >> 8);
+  rec.data[10] = (uint8_t)(nowUs >> 16);
+  rec.data[11] = (uint8_t)(nowUs >> 24);
+
+  journalHead = (uint8_t)(head + 1);
+  UCSR0B |= _BV(UDRIE0);
+}
+
+// The cause is reconstructed from the same inputs the state machine just used, in the
+// same priority order, so the journal needs no hooks inside the switch statement.
+static inline void journal_transition(State from, State to, bool overrun, uint8_t comparators, uint8_t switches, const Output& out) {
+  static constexpr uint8_t MASK_REQUIRED_SWITCHES = _BV(PB4) | _BV(PB7);   // 3kV enable, Arm 80kV
+
+  JournalCause cause;
+  uint8_t detail = 0;
+  if (overrun) {
+    cause = JournalCause::LOOP_OVERRUN;
+    detail = (uint8_t)deadline_overrun_count();
+  } else if (quench_state(from)) {
+    cause = (to == State::STATE_NOM_OP) ? JournalCause::AUTO_REARM : JournalCause::TIMER_EXPIRED;
+    detail = activeQuench;
+  } else if (to == State::STATE_NOM_OP) {
+    cause = JournalCause::RESET_EDGE;
+  } else if (comparators != 0) {
+    cause = JournalCause::COMPARATOR;
+    detail = comparators;
+  } else {
+    cause = JournalCause::SWITCH_DROP;
+    detail = (uint8_t)(MASK_REQUIRED_SWITCHES & ~switches);
+  }
+
+  journal_append(cause, from, to, detail, out);
+}
+
+ISR(USART0_UDRE_vect) {
+  static uint8_t index = 0;
+  static uint16_t crc = 0xFFFF;
+
+  const JournalRecord& rec = journalRing[journalTail & JOURNAL_RING_MASK];
+
+  if (index < JOURNAL_RECORD_LEN) {
+    const uint8_t b = rec.data[index++];
+    crc = _crc16_update(crc, b);
+    UDR0 = b;
+  } else if (index == JOURNAL_RECORD_LEN) {
+    UDR0 = (uint8_t)(crc & 0xFF);
+    index++;
+  } else {
+    UDR0 = (uint8_t)(crc >> 8);
+    index = 0;
+    crc = 0xFFFF;
+    const uint8_t tail = (uint8_t)(journalTail + 1);
+    journalTail = tail;
+    if (tail == journalHead) {
+      UCSR0B &= (uint8_t)~_BV(UDRIE0);
+    }
+  }
+}
+
 // ========================= State machine step =========================
 static inline void step() {
-  static uint32_t timerEnterMs = 0;
+  // Start this step's deadline window
+  if (loop_deadline_enabled()) {
+    deadline_rearm();
+  }
 
   // Sample all inputs
   Sample inputSnapshot;
   sample_inputs(inputSnapshot);
   handle_ack_toggle(inputSnapshot.ackLevel);
+  const Sample rawSnapshot = inputSnapshot;
+
+  // Qualify comparator faults (pass-through unless a filter window is configured)
+  inputSnapshot.comparators = filter_comparators(inputSnapshot.comparators);
+  track_first_out(rawSnapshot.comparators, inputSnapshot.comparators);
 
   // Debounce swithces and buttons inputs
   inputSnapshot.switchesAssertPortB = debounce_switches(inputSnapshot.switchesAssertPortB);
@@ -343,21 +1110,30 @@ static inline void step() {
 
   // Outputs, all off by default
   Output outputSnapshot = {false, false, false, false};
+  const State stateBefore = currentState;
+
+  // A missed deadline has already forced PORTF safe; drop NOM_OP so re-arming needs a reset
+  // press. The quench lockout states are already all-off and keep their lockout.
+  bool overrunDrop = false;
+  if (loop_deadline_enabled() && deadline_consume_overrun() && currentState == State::STATE_NOM_OP) {
+    currentState = State::STATE_INTERLOCK;
+    overrunDrop = true;
+  }
 
   // ---- State machine ----
   switch (currentState) {
     case State::STATE_INTERLOCK: {
 
-      // If timer is enabled, check for 3kv overcurrent right away 
-      if (timer_3kv_state_enabled()) {
-        if (inputSnapshot.comparators & MASK_COMP_3KV_I) {
-          enter_3kv_timer_state(timerEnterMs);
-          break;
-        }
+      // Check for quench trips from interlock right away (default table: 3kV overcurrent)
+      const uint8_t ch = quench_channel_for(inputSnapshot.comparators, false);
+      if (ch != QUENCH_CHANNEL_COUNT) {
+        enter_quench_state(ch, false);
+        break;
       }
 
-      // Enter NomOp only on reset button edge and all comparators SAFE and 80k asserted and 3k asserted
-      if (resetButtonEdge && (inputSnapshot.comparators == 0) && sw_arm_80kv && sw_3kv_enable) {
+      // Enter NomOp only on reset button edge and all comparators SAFE and 80k asserted and 3k asserted.
+      // Arming checks the raw comparators too, so the glitch filter can only delay a trip, never allow arming.
+      if (resetButtonEdge && ((inputSnapshot.comparators | rawSnapshot.comparators) == 0) && sw_arm_80kv && sw_3kv_enable) {
         currentState = State::STATE_NOM_OP;
       }
 
@@ -365,12 +1141,11 @@ static inline void step() {
 
     case State::STATE_NOM_OP: {
 
-      if (timer_3kv_state_enabled()) {
-        // Check for 3kv comparator trips right away
-        if (inputSnapshot.comparators & MASK_COMP_3KV) {
-          enter_3kv_timer_state(timerEnterMs);
-          break;
-        }
+      // Check for quench trips right away (default table: 3kV V/I)
+      const uint8_t ch = quench_channel_for(inputSnapshot.comparators, true);
+      if (ch != QUENCH_CHANNEL_COUNT) {
+        enter_quench_state(ch, true);
+        break;
       }
 
       // If required interlock switches drop, or any other comparators trip return to BI
@@ -381,11 +1156,17 @@ static inline void step() {
 
     } break;
 
-    case State::STATE_3KV_TIMER: {
-      // Leave timer state if 3kV I comparator is low, and it's been longer than the timer duration since we entered
-      if (((inputSnapshot.comparators & MASK_COMP_3KV_I) == 0)  && 
-              ((uint32_t)(millis() - timerEnterMs) >= TIMER_3KV_MS)) {
-        currentState = State::STATE_INTERLOCK;
+    case State::STATE_3KV_TIMER:
+    case State::STATE_QUENCH: {
+      const QuenchChannel& q = QUENCH_CHANNELS[activeQuench];
+      quenchOtherTrips |= (uint8_t)(rawSnapshot.comparators & (uint8_t)~q.nomOpTripMask);
+
+      // Leave the lockout once the row's hold comparators are low and the Timer1 lockout has expired
+      if (((inputSnapshot.comparators & q.holdMask) == 0) && lockoutExpired) {
+        const bool clean = quenchFromNomOp && (quenchOtherTrips == 0) &&
+                           ((inputSnapshot.comparators | rawSnapshot.comparators) == 0) &&
+                           sw_arm_80kv && sw_3kv_enable;
+        currentState = (q.autoRearm && clean && auto_rearm_take()) ? State::STATE_NOM_OP : State::STATE_INTERLOCK;
       }
     } break;
   }
@@ -412,16 +1193,44 @@ static inline void step() {
       outputSnapshot.enable3kV       = false;
       outputSnapshot.nomOp           = false;
       break;
+
+    // A +-1kV / 20kV lockout does not involve the 3kV supply, so 3kV follows its switch as in INTERLOCK
+    case State::STATE_QUENCH:
+      outputSnapshot.ccsPowerEnable  = false;
+      outputSnapshot.armBeamsEnable  = false;
+      outputSnapshot.enable3kV       = sw_3kv_enable;
+      outputSnapshot.nomOp           = false;
+      break;
+  }
+
+  // ---- Journal ----
+  if (journal_enabled() && currentState != stateBefore) {
+    journal_transition(stateBefore, currentState, overrunDrop, inputSnapshot.comparators, inputSnapshot.switchesAssertPortB, outputSnapshot);
   }
 
   // ---- Flags  ----
-  write_flags(inputSnapshot, outputSnapshot);
+  // PORTC latches raw PINL, so a fault the filter rejected still shows until the next ACK
+  Sample flagSnapshot = inputSnapshot;
+  flagSnapshot.comparators = rawSnapshot.comparators;
+  write_flags(flagSnapshot, outputSnapshot);
 
   // Flags are updated before outputs so the current-step ACK handling and latch state
   // are reflected together when write_outputs() drives the ack-back bit on PORTH.
 
   // ---- Drive outputs ----
   write_outputs(outputSnapshot);
+
+  // ---- Loop heartbeat ----
+  // Writing 1 to a PINx bit toggles the matching PORTx bit in a single instruction.
+  if (loop_heartbeat_enabled()) {
+    PING = MASK_LOOP_HEARTBEAT;
+  }
+
+  // ---- Status link ----
+  stepCount++;
+  if (status_link_enabled()) {
+    link_queue_frame(rawSnapshot, inputSnapshot, resetButtonDb);
+  }
 }
 
 // ========================= Arduino Hook Functions =========================
@@ -455,6 +1264,17 @@ void setup() {
   // Ensure outputs are in safe posture
   write_outputs(out);
 
+  // Status link is started after the safe posture so a slow UART never delays it
+  if (status_link_enabled()) {
+    link_init();
+  }
+
+  // The journal opens with a boot record carrying the reset cause
+  if (journal_enabled()) {
+    journal_init();
+    journal_append(JournalCause::BOOT, State::STATE_INTERLOCK, State::STATE_INTERLOCK, resetCauseMirror, out);
+  }
+
   // Lightweight watchdog polling loop to reset the board in case of a lockup.  
   // Start watchdog supervision only after the board is already driving its safe defaults.
   wdt_enable(WDTO_500MS);
@@ -6,6 +6,8 @@
 #include <arduino-timer.h>
 #include <Wire.h>
 #include <avr/wdt.h>
+#include <util/crc16.h>
+#include <util/atomic.h>
 #include <LiquidCrystal_I2C.h>
 #include <Adafruit_ADS1X15.h>
 #include <ModbusRtu.h>
@@ -27,7 +29,9 @@
 //////    EDIT BELOW TO SET POWER SUPPLY   //////
 /////////////////////////////////////////////////
 
+#ifndef SELECTED_PS_ID           // host builds pass -DSELECTED_PS_ID=PS_...
 #define SELECTED_PS_ID PS_POS1KV
+#endif
 
 /////////////////////////////////////////////////
 
@@ -38,7 +42,7 @@
 
 // Do Not Edit, edit #define SELECTED_PS_ID above instead
 const uint8_t ps_id = SELECTED_PS_ID;
-const char firmwareVersion[] = "2.2";
+const char firmwareVersion[] = "2.3";
 
 // Capture reset cause and stop any inherited watchdog before normal startup runs.
 // This follows the standard avr-libc early-startup watchdog pattern.
@@ -54,6 +58,12 @@ void watchdog_early_init(void) {
 //============= MODBUS MAP ==================================
 //===========================================================
 /*
+Registers 0-5 are as in firmware 2.2. Every register after them was appended after the
+last one when it was added, never inserted, so a dashboard read keeps returning the same
+registers across releases. Blocks that belong together therefore need not be adjacent:
+the sample stamp (37-39) is a separate read from the 0-5 telemetry it describes.
+*/
+/*
 Input Registers (Function Code 04)
 */
 #define IREG_V_SET_ADDR             0   // integer volts
@@ -70,10 +80,119 @@ The monitor exposes two packed DINPUT registers:
 #define DINPUT_UNLATCHED_SIGNALS_ADDR   4
 #define DINPUT_LATCHED_FLAGS_ADDR       5
 
-// note: when changing this map, update these register counts:
+/*
+Extended Input Registers (Function Code 04). Only the +3kV monitor populates these.
+*/
+#define IREG_LOGIC_LOOP_HZ_ADDR         6   // Logic Arduino step() rate over the last sample window, Hz
+#define IREG_LOGIC_LOOP_MIN_HZ_ADDR     7   // minimum step() rate seen since the last read that carried it, Hz
+#define IREG_LINK_STATUS_ADDR           8   // bit 15 = status link fresh, bits 0-7 = Logic Arduino state
+#define IREG_LINK_COMPARATORS_ADDR      9   // low byte = raw comparators (PINL), high byte = comparators used by the state machine
+#define IREG_LINK_INPUTS_ADDR           10  // low byte = raw switches/ACK/reset, high byte = debounced switches/reset
+#define IREG_LINK_FLAGS_ADDR            11  // low byte = PORTA flag image, high byte = PORTC latched comparator image
+#define IREG_LINK_TIMER_REMAINING_ADDR  12  // 3kV timer remaining, ms
+#define IREG_LINK_STEP_COUNT_ADDR       13  // Logic Arduino step() count (wraps)
+#define IREG_LINK_GOOD_FRAMES_ADDR      14  // status link frames received with a valid CRC (wraps)
+#define IREG_LINK_BAD_FRAMES_ADDR       15  // frames dropped for a bad CRC or unknown type (wraps)
+#define IREG_FIRST_OUT_ADDR             16  // low byte = first-fault comparator mask, high byte = Logic Arduino state at the trip
+#define IREG_FIRST_OUT_RECORD_ADDR      17  // first-out record number, 0 = none received yet
+#define IREG_FIRST_OUT_TIME_HI_ADDR     18  // Logic Arduino micros() at the first fault, high word
+#define IREG_FIRST_OUT_TIME_LO_ADDR     19  // Logic Arduino micros() at the first fault, low word
+#define IREG_FIRST_OUT_OFFSET_ADDR      20  // 20-27: latch offset (us) for PL0..PL7, 0xFFFF = not latched
+#define IREG_FIRST_OUT_HISTORY_ADDR     28  // 28-35: PINL history, oldest first, two samples per register (low byte older)
+#define IREG_LINK_LOOP_OVERRUNS_ADDR    36  // Logic Arduino step() deadline overruns since its last reset (wraps)
+
+/*
+Sample Input Registers (Function Code 04), written by every monitor with each read_value()
+sample and published in the same bank as 0-5. A single read returns one bank, so the stamp
+describes the 0-5 values of the same reply only; a read of 0-5 and a read of 37-39 may
+straddle a publish.
+*/
+#define IREG_SAMPLE_SEQ_ADDR            37  // read_value() sample count (wraps)
+#define IREG_SAMPLE_TIME_HI_ADDR        38  // millis() at the start of the sample, high word
+#define IREG_SAMPLE_TIME_LO_ADDR        39  // millis() at the start of the sample, low word
+
+/*
+Snapshot Input Registers (Function Code 04), written by every monitor when a broadcast
+(slave ID 0) Write Single Register (Function Code 06) to IREG_SNAPSHOT_TAG_ADDR arrives.
+Each monitor publishes the newest Vmon/Imon pair it had when the frame arrived; the pairs
+are not simultaneous, and register 58 gives each one's age at the frame. The written value
+is echoed as the tag; 0 = no snapshot taken yet.
+*/
+#define IREG_SNAPSHOT_TAG_ADDR          40  // value of the broadcast that took this snapshot
+#define IREG_SNAPSHOT_V_SET_ADDR        41  // integer volts
+#define IREG_SNAPSHOT_V_READ_ADDR       42  // integer volts
+#define IREG_SNAPSHOT_I_READ_ADDR       43  // integer microamps
+#define IREG_SNAPSHOT_TIME_HI_ADDR      44  // millis() at the snapshot, high word
+#define IREG_SNAPSHOT_TIME_LO_ADDR      45  // millis() at the snapshot, low word
+
+/*
+Change Input Register (Function Code 04), written by every monitor with each read_value()
+sample: bit n is set once register n (0-5) has moved past its deadband, or for registers 1-2
+once their window extremes have, and stays set until the sample after a read that carried it.
+*/
+#define IREG_CHANGE_MAP_ADDR            46  // bit n = register n moved past its deadband
+
+/*
+Holding Registers (Function Code 03 / 06 / 16), written by the dashboard and kept by every
+monitor until the next reset. Deadbands are in the units of the register they apply to;
+registers 3-5 count any change.
+*/
+#define HREG_DEADBAND_V_SET_ADDR        47  // change-map deadband for register 0, volts
+#define HREG_DEADBAND_V_READ_ADDR       48  // change-map deadband for register 1, volts
+#define HREG_DEADBAND_I_READ_ADDR       49  // change-map deadband for register 2, microamps
+
+/*
+Window Input Registers (Function Code 04), written by every monitor with each read_value()
+sample: Vmon and Imon statistics over every ADS1115 reading since the sample after the last
+read that carried all of them, including the free-running readings taken between read_value() cycles.
+Both channels are read in pairs, so one count covers both.
+*/
+#define IREG_WINDOW_V_MIN_ADDR          50  // integer volts
+#define IREG_WINDOW_V_MAX_ADDR          51  // integer volts
+#define IREG_WINDOW_V_MEAN_ADDR         52  // integer volts
+#define IREG_WINDOW_I_MIN_ADDR          53  // integer microamps
+#define IREG_WINDOW_I_MAX_ADDR          54  // integer microamps
+#define IREG_WINDOW_I_MEAN_ADDR         55  // integer microamps
+#define IREG_WINDOW_COUNT_ADDR          56  // readings per channel in the window, saturates at 65535
+
+/*
+Further Input Registers (Function Code 04).
+*/
+#define IREG_LINK_RX_OVERRUNS_ADDR      57  // status link bytes dropped on a full receive ring (wraps); +3kV only
+#define IREG_SNAPSHOT_DELAY_ADDR        58  // us from the snapshot's Imon reading to the broadcast's last edge on RX1, saturates at 65535
+
+// note: when adding to this map, append after the last register and update these counts:
 #define IREG_COUNT              4
 #define DINPUT_COUNT            2
-#define TOTAL_REG_COUNT         (IREG_COUNT + DINPUT_COUNT)
+#define IREG_EXT_COUNT          31
+#define IREG_SAMPLE_COUNT       3
+#define IREG_SNAPSHOT_COUNT     6
+#define IREG_CHANGE_COUNT       1
+#define HREG_COUNT              3
+#define IREG_WINDOW_COUNT       7
+#define IREG_APPENDED_COUNT     2
+#define TOTAL_REG_COUNT         (IREG_COUNT + DINPUT_COUNT + IREG_EXT_COUNT + IREG_SAMPLE_COUNT + \
+                                 IREG_SNAPSHOT_COUNT + IREG_CHANGE_COUNT + HREG_COUNT + IREG_WINDOW_COUNT + \
+                                 IREG_APPENDED_COUNT)
+
+#define CHANGE_TRACKED_COUNT    6       // registers 0-5 are covered by the change map
+#define DEFAULT_DEADBAND_V      1       // V
+#define DEFAULT_DEADBAND_I      5       // uA
+
+#define MODBUS_BROADCAST_ID     0       // frames to this ID are for every monitor and get no reply
+#define MODBUS_HEADER_LEN       6       // ID, function code, start address, quantity
+#define MODBUS_MAX_READ_COUNT   29      // 5 + 2 * 29 reply bytes fill the library's 64-byte buffer
+#define MODBUS_MIN_REPLY_LEN    7       // poll() returns the reply length when it served a request
+
+// Sticky blocks a served read clears on the next read_value() sample, as bits of clearPending
+#define CLEAR_LATCHED_FLAGS     0x01    // register 5
+#define CLEAR_CHANGE_MAP        0x02    // register 46
+#define CLEAR_WINDOW            0x04    // registers 50-56
+#define CLEAR_LOOP_MIN          0x08    // register 7
+
+#ifndef MODBUS_BAUD             // host builds may pass -DMODBUS_BAUD=... to size the dashboard poll rate
+#define MODBUS_BAUD             9600UL
+#endif
 //============================================================
 //============================================================
 
@@ -85,6 +204,18 @@ The monitor exposes two packed DINPUT registers:
 #define RESET_EXIT_V        2.5                     // V
 #define RESET_EXIT_I        1.0                     // mA
 #define VOLTS_PER_COUNT     0.1875F / 1000.0F       // correct with GAIN_TWO_THIRDS
+#define ADS_CONVERSION_US   1200                    // one 860 SPS conversion; the window sampler polls no sooner
+#define ADS_POLL_US         500                     // then at most this often until the conversion is done
+
+/**
+ * Logic Arduino status link (+3kV monitor only).
+ * Set LOGIC_STATUS_LINK to 0 to ignore the link. The baud rate must match
+ * STATUS_LINK_BAUD in logic_arduino.cpp.
+ */
+#define LOGIC_STATUS_LINK           1
+#define LOGIC_STATUS_LINK_BAUD      250000UL                // exact at 16 MHz with U2X
+#define LOGIC_LINK_TIMEOUT_MS       50                      // link reported stale after this long without a good frame
+#define LOGIC_LINK_RX_BUFFER_SIZE   1024                    // power of two; about 110 ms of the paced link
 
 /**
  * Pin assignments
@@ -97,9 +228,12 @@ The monitor exposes two packed DINPUT registers:
 #define ARM_BEAMS_SWITCH_PIN            11      // Active low
 #define CCS_POWER_ALLOW_SWITCH_PIN      12      // Active Low
 #define RS485_TX_PIN                    18
+#define RS485_RX_PIN                    19      // RX1, also INT2 for the receive-edge timestamp
 #define RS485_DIR_PIN                   17      // low = receive mode
 #define FLAGS_ACK_PIN                   14      // ack pin to Logic Arduino
 #define LOGIC_ACK_ECHO_PIN              9       // ACK-back from Logic Arduino (toggles when Logic observes ACK edge)
+#define LOGIC_LOOP_HEARTBEAT_PIN        47      // T5 input, Logic Arduino D41 toggles once per step()
+#define LOGIC_STATUS_LINK_RX_PIN        15      // RX3, Logic Arduino TX1 (D18); TX3 stays free for the D14 ACK
 
 // (logic arduino outputs / live signals)
 #define OUTPUT_CCSPOWER_PIN             22
@@ -143,6 +277,65 @@ const uint16_t LATCHED_FLAG_MASK_20K_ICOMP            = ((uint16_t)1 << 13);  //
 const uint16_t LATCHED_FLAG_MASK_3K_VCOMP             = ((uint16_t)1 << 14);  // D36
 const uint16_t LATCHED_FLAG_MASK_3K_ICOMP             = ((uint16_t)1 << 15);  // D37
 
+/**
+ * External ADC channel assignments
+ */
+
+#define CH_VSET 0
+#define CH_IMON 1
+#define CH_VMON 2
+
+/**
+ * Running statistics over raw ADS1115 counts, clamped to [0, 32760]. Counts scale linearly to
+ * volts and microamps, so the extremes and the mean are converted only when published.
+ */
+struct AdcWindow {
+    int16_t  vMin, vMax;
+    int16_t  iMin, iMax;
+    uint32_t vSum, iSum;
+    uint16_t count;                                 // readings per channel, saturates
+};
+
+/**
+ * One Vmon/Imon reading pair in raw counts, with micros() when its Imon reading finished.
+ */
+struct AdcPair {
+    int16_t  vmonRaw;
+    int16_t  imonRaw;
+    uint32_t us;
+};
+
+/**
+ * Serial1 as the ModbusRtu library sees it. pollRequestGate() moves received bytes into buf,
+ * and the library is only shown them once they are a request it should serve.
+ */
+#define GATE_COLLECT    0               // frame started, not yet classified
+#define GATE_PASS       1               // request for this monitor, shown to the library
+#define GATE_HOLD       2               // kept from the library until it ends
+
+class RequestGate : public Stream {
+public:
+    uint8_t     buf[MAX_BUFFER];
+    uint8_t     len = 0;                // bytes of the frame received, saturates at 255
+    uint8_t     shown = 0;              // bytes the library may read
+    uint8_t     pos = 0;                // bytes the library has read
+    uint8_t     state = GATE_COLLECT;
+    uint8_t     exception = 0;          // exception owed to a held request, 0 = none
+    uint8_t     function = 0;           // header of the request shown to the library
+    uint16_t    start = 0;
+    uint16_t    count = 0;
+    uint32_t    rxMs = 0;               // millis() when a byte last arrived
+    uint32_t    edgeUs = 0;             // modbusRxEdgeUs when a byte last arrived
+    AdcPair     pair = {0, 0, 0};       // newest Vmon/Imon pair at edgeUs
+    bool        replied = false;        // the library sent a reply for this frame
+
+    int available() override { return shown - pos; }
+    int read() override { return (pos < shown) ? buf[pos++] : -1; }
+    int peek() override { return (pos < shown) ? buf[pos] : -1; }
+    size_t write(uint8_t b) override { return Serial1.write(b); }
+    void flush() override { Serial1.flush(); replied = true; }
+};
+
 /**
  * Other declarations and initializations
  */
@@ -168,21 +361,48 @@ char                measuredI_buf[10];              // ""
 char                thresholdI_buf[10];             // ""
 bool                prevNomOpState = false;         // previous D25 state, used to clear the 3kV timer-event count on Nom Op entry
 int                 resetState3kV = 0;              // count of latched 3kV timer events since the last Nom Op entry
-uint16_t            latchedFlags = 0;               // sticky Modbus copy of D26-D37 until the next successful reply
-bool                clearPending = false;           // defer sticky-flag clear until the next 150 ms sampling boundary
+uint16_t            latchedFlags = 0;               // sticky Modbus copy of D26-D37 until the next read that carries it
+uint8_t             clearPending = 0;               // CLEAR_* blocks a served read covered, cleared on the next 150 ms sampling boundary
+uint16_t            prevLoopEdgeCount = 0;          // Timer5 count of Logic Arduino heartbeat edges at the previous sample
+uint32_t            prevLoopSampleMs = 0;           // millis() at the previous heartbeat sample
+uint16_t            logicLoopHz = 0;                // Logic Arduino step() rate over the last sample window
+uint16_t            logicLoopMinHz = 0xFFFF;        // minimum step() rate since the last read that carried it; the first sample seeds it
+volatile uint8_t    linkRxBuf[LOGIC_LINK_RX_BUFFER_SIZE]; // status link receive ring, filled by the USART3 RX interrupt
+volatile uint16_t   linkRxHead = 0;                 // written only by the USART3 RX interrupt
+volatile uint16_t   linkRxTail = 0;                 // written only by pollLogicLink()
+volatile uint16_t   linkRxOverruns = 0;             // bytes the USART3 RX interrupt dropped on a full ring
+uint16_t            linkRxOverrunsShown = 0;        // linkRxOverruns as last published
+uint8_t             linkFrame[44];                  // status link frame being assembled
+uint8_t             linkFrameLen = 0;               // bytes of linkFrame received so far
+uint32_t            linkLastFrameMs = 0;            // millis() of the last good frame
+uint8_t             linkFrameExpected = 0;          // full length of the frame being assembled, set from its type byte
+uint16_t            linkGoodFrames = 0;             // good status link frames received
+uint16_t            linkBadFrames = 0;              // frames dropped for CRC / type errors
+uint16_t            sampleSeq = 0;                  // read_value() samples published so far (wraps)
+uint16_t            changeMap = 0;                  // sticky change bits for registers 0-5 until the next read that carries them
+uint16_t            changeRef[CHANGE_TRACKED_COUNT];    // value of each tracked register when its change bit was last set
+uint16_t            changeDeadband[CHANGE_TRACKED_COUNT]; // from the holding registers; 0 for registers 3-5
+AdcWindow           windowSegment;                  // Vmon/Imon readings since the last read_value() sample
+AdcWindow           windowTotal;                    // Vmon/Imon readings since the window restarted
+uint8_t             windowChannel = CH_VMON;        // channel of the free-running conversion, when one is in flight
+bool                windowConverting = false;       // a free-running conversion has been started
+uint32_t            windowPollUs = 0;               // micros() when it is next asked whether it is done
+int16_t             windowVmonRaw = 0;              // first half of the pair being read
+volatile int16_t    latestVmonRaw = 0;              // newest Vmon/Imon pair from the sampler or read_value(),
+volatile int16_t    latestImonRaw = 0;              // written only by setLatestPair()
+volatile uint32_t   latestPairUs = 0;               // ""
 Timer<4, millis>    timer;
 Adafruit_ADS1115    ads; 
 LiquidCrystal_I2C   lcd(0x27, 20, 4);
-Modbus slave(ps_id, Serial1, RS485_DIR_PIN);
-uint16_t            modbus_regs[IREG_COUNT+DINPUT_COUNT]; // modbus register storage (input registers followed by discrete inputs)
-
-/**
- * External ADC channel assignments
- */
-
-#define CH_VSET 0
-#define CH_IMON 1
-#define CH_VMON 2
+RequestGate         gate;                           // Serial1 receive path in front of the library
+volatile uint32_t   modbusRxEdgeUs = 0;             // micros() at the last falling edge on RX1, written only by onModbusRxEdge()
+volatile int16_t    modbusRxVmonRaw = 0;            // latest pair as of that edge, written only by onModbusRxEdge()
+volatile int16_t    modbusRxImonRaw = 0;            // ""
+volatile uint32_t   modbusRxPairUs = 0;             // ""
+Modbus slave(ps_id, gate, RS485_DIR_PIN);
+uint16_t            modbus_bank[2][TOTAL_REG_COUNT]; // modbus register storage (input registers, discrete inputs, extended input registers), double-buffered
+volatile uint8_t    modbus_live = 0;                // bank served by slave.poll(); switched by publishRegisters()
+uint16_t            *modbus_regs = modbus_bank[1];  // bank the current read_value() sample is written into
 
 /**
  * Helper to round and clamp values before sending over RS-485.
@@ -327,6 +547,708 @@ void update3KVResetCounter(bool nomop, bool timerEventLatched) {
     prevNomOpState = nomop;
 }
 
+/**
+ * Logic Arduino status link receive path.
+ *
+ * The USART3 receiver is driven directly instead of through Serial3: Serial3.begin() would
+ * also enable TX3 and take over D14, which is the flags ACK line, and its 64-byte buffer
+ * is too small to ride out the LCD refresh at the link baud rate. The interrupt only stores
+ * bytes; frames are assembled and checked in pollLogicLink() from loop().
+ *
+ * The Logic Arduino paces status frames to one per STATUS_LINK_INTERVAL_US (2 ms), about
+ * 9 bytes per ms, so the ring holds about 110 ms of link traffic against a longest loop()
+ * pass of about 60 ms. If the ring does fill, the interrupt drops the new byte and counts
+ * it, so the frames already queued stay intact and the partial frame fails its CRC.
+ *
+ * Frame layouts match link_fill_status() / link_fill_first_out() in logic_arduino.cpp:
+ *   status:    [0] 0xA5 [1] type 0x01 [2] seq [3] state [4] raw comparators [5] used comparators
+ *              [6] raw inputs [7] debounced inputs [8] PORTA [9] PORTC [10-11] timer ms
+ *              [12-13] step count [14-15] loop overruns [16-17] CRC-16/Modbus over bytes 0-15
+ *   first-out: [0] 0xA5 [1] type 0x02 [2] seq [3] record number [4] first-fault mask [5] state
+ *              [6-9] micros() at the first fault [10-25] PL0..PL7 latch offsets (us)
+ *              [26-41] PINL history, oldest first [42-43] CRC-16/Modbus over bytes 0-41
+ */
+#define LINK_SYNC                   0xA5
+#define LINK_FRAME_STATUS           0x01
+#define LINK_FRAME_FIRST_OUT        0x02
+#define LINK_STATUS_FRAME_LEN       18
+#define LINK_FIRST_OUT_FRAME_LEN    44
+
+ISR(USART3_RX_vect)
+{
+    uint8_t b = UDR3;
+    uint16_t head = linkRxHead;
+    if ((uint16_t)(head - linkRxTail) >= LOGIC_LINK_RX_BUFFER_SIZE) {
+        linkRxOverruns++;
+        return;
+    }
+    linkRxBuf[head % LOGIC_LINK_RX_BUFFER_SIZE] = b;
+    linkRxHead = (uint16_t)(head + 1);
+}
+
+static inline void logicLinkInit()
+{
+    uint16_t ubrr = (uint16_t)((F_CPU / (8UL * LOGIC_STATUS_LINK_BAUD)) - 1UL);
+    UBRR3 = ubrr;
+    UCSR3A = _BV(U2X3);
+    UCSR3C = _BV(UCSZ31) | _BV(UCSZ30);    // 8N1
+    UCSR3B = _BV(RXEN3) | _BV(RXCIE3);     // receiver only
+}
+
+/**
+ * The status link registers change per frame rather than per read_value() sample, so they
+ * are written to both banks and stay current whichever bank is live.
+ */
+static inline void setLinkRegister(uint8_t addr, uint16_t value)
+{
+    modbus_bank[0][addr] = value;
+    modbus_bank[1][addr] = value;
+}
+
+static inline uint16_t linkFrameU16(uint8_t offset)
+{
+    return (uint16_t)linkFrame[offset] | ((uint16_t)linkFrame[offset + 1] << 8);
+}
+
+static inline void decodeLogicLinkStatus()
+{
+    setLinkRegister(IREG_LINK_STATUS_ADDR, 0x8000 | linkFrame[3]);
+    setLinkRegister(IREG_LINK_COMPARATORS_ADDR, (uint16_t)linkFrame[4] | ((uint16_t)linkFrame[5] << 8));
+    setLinkRegister(IREG_LINK_INPUTS_ADDR, (uint16_t)linkFrame[6] | ((uint16_t)linkFrame[7] << 8));
+    setLinkRegister(IREG_LINK_FLAGS_ADDR, (uint16_t)linkFrame[8] | ((uint16_t)linkFrame[9] << 8));
+    setLinkRegister(IREG_LINK_TIMER_REMAINING_ADDR, linkFrameU16(10));
+    setLinkRegister(IREG_LINK_STEP_COUNT_ADDR, linkFrameU16(12));
+    setLinkRegister(IREG_LINK_LOOP_OVERRUNS_ADDR, linkFrameU16(14));
+}
+
+/**
+ * The Logic Arduino repeats its latest first-out record every few dozen frames, so every
+ * good copy is simply republished; later copies of the same record may carry more latch
+ * offsets. A new record number means a new fault episode.
+ */
+static inline void decodeLogicLinkFirstOut()
+{
+    setLinkRegister(IREG_FIRST_OUT_ADDR, (uint16_t)linkFrame[4] | ((uint16_t)linkFrame[5] << 8));
+    setLinkRegister(IREG_FIRST_OUT_RECORD_ADDR, linkFrame[3]);
+    setLinkRegister(IREG_FIRST_OUT_TIME_HI_ADDR, linkFrameU16(8));
+    setLinkRegister(IREG_FIRST_OUT_TIME_LO_ADDR, linkFrameU16(6));
+    for (uint8_t i = 0; i < 8; i++) {
+        setLinkRegister(IREG_FIRST_OUT_OFFSET_ADDR + i, linkFrameU16(10 + 2 * i));
+    }
+    for (uint8_t i = 0; i < 8; i++) {
+        setLinkRegister(IREG_FIRST_OUT_HISTORY_ADDR + i, linkFrameU16(26 + 2 * i));
+    }
+}
+
+static inline void decodeLogicLinkFrame()
+{
+    uint16_t crc = 0xFFFF;
+    for (uint8_t i = 0; i < linkFrameExpected - 2; i++) {
+        crc = _crc16_update(crc, linkFrame[i]);
+    }
+
+    if (crc != linkFrameU16(linkFrameExpected - 2)) {
+        linkBadFrames++;
+        setLinkRegister(IREG_LINK_BAD_FRAMES_ADDR, linkBadFrames);
+        return;
+    }
+
+    linkGoodFrames++;
+    linkLastFrameMs = millis();
+    setLinkRegister(IREG_LINK_GOOD_FRAMES_ADDR, linkGoodFrames);
+
+    if (linkFrame[1] == LINK_FRAME_FIRST_OUT) {
+        decodeLogicLinkFirstOut();
+    } else {
+        decodeLogicLinkStatus();
+    }
+}
+
+/**
+ * Drain the status link receive ring and publish every good frame.
+ * Any byte that does not fit the expected frame restarts the search for a sync byte.
+ * The ring indices are 16 bits wide, so they are read and written with interrupts off.
+ */
+static inline void pollLogicLink()
+{
+    uint16_t head, tail, overruns;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        head = linkRxHead;
+        tail = linkRxTail;
+        overruns = linkRxOverruns;
+    }
+    if (overruns != linkRxOverrunsShown) {
+        linkRxOverrunsShown = overruns;
+        setLinkRegister(IREG_LINK_RX_OVERRUNS_ADDR, overruns);
+    }
+
+    while (tail != head) {
+        uint8_t b = linkRxBuf[tail % LOGIC_LINK_RX_BUFFER_SIZE];
+        tail++;
+
+        if (linkFrameLen == 0 && b != LINK_SYNC) {
+            continue;   // hunting for sync
+        }
+
+        if (linkFrameLen == 1) {
+            if (b == LINK_FRAME_STATUS) {
+                linkFrameExpected = LINK_STATUS_FRAME_LEN;
+            } else if (b == LINK_FRAME_FIRST_OUT) {
+                linkFrameExpected = LINK_FIRST_OUT_FRAME_LEN;
+            } else {
+                linkBadFrames++;
+                setLinkRegister(IREG_LINK_BAD_FRAMES_ADDR, linkBadFrames);
+                linkFrameLen = (b == LINK_SYNC) ? 1 : 0;
+                continue;
+            }
+        }
+
+        linkFrame[linkFrameLen++] = b;
+
+        if (linkFrameLen == linkFrameExpected) {
+            decodeLogicLinkFrame();
+            linkFrameLen = 0;
+        }
+    }
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        linkRxTail = tail;
+    }
+}
+
+/**
+ * Helper to measure the Logic Arduino loop rate.
+ *
+ * The Logic Arduino toggles D41 once per step(), and Timer5 counts the rising edges on its
+ * T5 input (D47) in hardware, so one counted edge is two steps. The rate is taken over the
+ * time since the previous 150 ms sample; the minimum restarts on the sample after a read that
+ * carried register 7.
+ */
+void updateLogicLoopRate(bool restartWindow) {
+    uint16_t edgeCount = TCNT5;
+    uint32_t nowMs = millis();
+    uint16_t edges = edgeCount - prevLoopEdgeCount;
+    uint32_t elapsedMs = nowMs - prevLoopSampleMs;
+    prevLoopEdgeCount = edgeCount;
+    prevLoopSampleMs = nowMs;
+
+    if (elapsedMs == 0) {
+        return;
+    }
+
+    uint32_t stepsPerSecond = ((uint32_t)edges * 2000UL) / elapsedMs;
+    logicLoopHz = (stepsPerSecond > 65535UL) ? 65535 : (uint16_t)stepsPerSecond;
+
+    if (restartWindow || logicLoopHz < logicLoopMinHz) {
+        logicLoopMinHz = logicLoopHz;
+    }
+
+    modbus_regs[IREG_LOGIC_LOOP_HZ_ADDR] = logicLoopHz;
+    modbus_regs[IREG_LOGIC_LOOP_MIN_HZ_ADDR] = logicLoopMinHz;
+}
+
+/**
+ * Scale one raw ADS1115 reading to supply units, given the supply's full-scale rating.
+ */
+static inline float scaleAdcReading(int16_t raw, float rated)
+{
+    // Clamp raw readings to be in [0, 32760]
+    raw = clamp_i16_positive(raw);
+    // Convert from raw ADC counts to volts using ±6.144 V full-scale.
+    float volts = raw * VOLTS_PER_COUNT;
+    // Convert to full scale HV (assumed 0-5V input range to ADC)
+    return (volts / 5.0) * rated;
+}
+
+/**
+ * Scale raw ADS1115 counts to supply units and store them in RS-485 input regs.
+ */
+static inline void convertAdcReadings(int16_t imonRaw, int16_t vmonRaw, int16_t vsetRaw)
+{
+    measuredI_mA = scaleAdcReading(imonRaw, ratedI_mA);
+    measuredHV_V = scaleAdcReading(vmonRaw, ratedHV_V);
+    programmedHV_V = scaleAdcReading(vsetRaw, ratedHV_V);
+    // Store in input regs, rounding to the nearest volt and the nearest uA
+    modbus_regs[IREG_V_SET_ADDR] = round_clamp_u16(programmedHV_V);
+    modbus_regs[IREG_V_READ_ADDR] = round_clamp_u16(measuredHV_V);
+    modbus_regs[IREG_I_READ_ADDR] = round_clamp_u16(measuredI_mA * 1000.0f);
+}
+
+/**
+ * Helpers for the Vmon/Imon window registers.
+ *
+ * loop() keeps a single-shot conversion going between read_value() cycles, alternating Vmon
+ * and Imon, and adds each finished pair to the segment; read_value() adds its own readings
+ * as well. Each read_value() sample folds the segment into the window and
+ * publishes it. The window restarts on the sample after a served read that carried all of
+ * registers 50-56, and then holds just the segment: the reply was served from the previous
+ * sample's bank, so readings taken since then have not been reported yet.
+ */
+static inline void addWindowReading(AdcWindow &w, int16_t vmonRaw, int16_t imonRaw)
+{
+    vmonRaw = clamp_i16_positive(vmonRaw);
+    imonRaw = clamp_i16_positive(imonRaw);
+    if (w.count == 0) {
+        w.vMin = w.vMax = vmonRaw;
+        w.iMin = w.iMax = imonRaw;
+        w.vSum = w.iSum = 0;
+    }
+    if (vmonRaw < w.vMin) w.vMin = vmonRaw;
+    if (vmonRaw > w.vMax) w.vMax = vmonRaw;
+    if (imonRaw < w.iMin) w.iMin = imonRaw;
+    if (imonRaw > w.iMax) w.iMax = imonRaw;
+    // Past 65535 readings the mean stops moving; the extremes keep tracking.
+    if (w.count < 65535) {
+        w.vSum += vmonRaw;
+        w.iSum += imonRaw;
+        w.count++;
+    }
+}
+
+static inline void mergeWindow(AdcWindow &into, const AdcWindow &from)
+{
+    if (into.count == 0) {
+        into = from;
+        return;
+    }
+    if (from.count == 0) {
+        return;
+    }
+    if (from.vMin < into.vMin) into.vMin = from.vMin;
+    if (from.vMax > into.vMax) into.vMax = from.vMax;
+    if (from.iMin < into.iMin) into.iMin = from.iMin;
+    if (from.iMax > into.iMax) into.iMax = from.iMax;
+    if ((uint32_t)into.count + from.count <= 65535UL) {
+        into.vSum += from.vSum;
+        into.iSum += from.iSum;
+        into.count += from.count;
+    }
+}
+
+/**
+ * Record the newest Vmon/Imon pair for onModbusRxEdge() to freeze. The pair is written with
+ * interrupts off so the edge interrupt never sees half of one.
+ */
+static inline void setLatestPair(int16_t vmonRaw, int16_t imonRaw)
+{
+    uint32_t now = micros();
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        latestVmonRaw = vmonRaw;
+        latestImonRaw = imonRaw;
+        latestPairUs = now;
+    }
+}
+
+/**
+ * Advance the free-running Vmon/Imon conversion from loop(). The ADS1115 is only asked
+ * whether a conversion is done once one has had time to finish, and then every ADS_POLL_US
+ * while its oscillator runs slow, so a loop() pass that finds nothing due stays off the I2C
+ * bus.
+ */
+static void pollWindowSampler()
+{
+    if (!windowConverting) {
+        ads.startADCReading(windowChannel == CH_VMON ? ADS1X15_REG_CONFIG_MUX_SINGLE_2
+                                                     : ADS1X15_REG_CONFIG_MUX_SINGLE_1, false);
+        windowPollUs = micros() + ADS_CONVERSION_US;
+        windowConverting = true;
+        return;
+    }
+    if ((int32_t)(micros() - windowPollUs) < 0) {
+        return;
+    }
+    if (!ads.conversionComplete()) {
+        windowPollUs = micros() + ADS_POLL_US;
+        return;
+    }
+
+    int16_t raw = ads.getLastConversionResults();
+    windowConverting = false;
+    if (windowChannel == CH_VMON) {
+        windowVmonRaw = raw;
+        windowChannel = CH_IMON;
+    } else {
+        addWindowReading(windowSegment, windowVmonRaw, raw);
+        setLatestPair(windowVmonRaw, raw);
+        windowChannel = CH_VMON;
+    }
+}
+
+/**
+ * A blocking read reprograms the ADS1115 under the free-running conversion, so drop the
+ * pair in progress and start over from Vmon.
+ */
+static inline void restartWindowSampler()
+{
+    windowConverting = false;
+    windowChannel = CH_VMON;
+}
+
+static inline void updateWindowRegisters(bool restartWindow)
+{
+    if (restartWindow) {
+        windowTotal = windowSegment;
+    } else {
+        mergeWindow(windowTotal, windowSegment);
+    }
+    windowSegment.count = 0;
+
+    const AdcWindow &w = windowTotal;
+    modbus_regs[IREG_WINDOW_V_MIN_ADDR] = round_clamp_u16(scaleAdcReading(w.vMin, ratedHV_V));
+    modbus_regs[IREG_WINDOW_V_MAX_ADDR] = round_clamp_u16(scaleAdcReading(w.vMax, ratedHV_V));
+    modbus_regs[IREG_WINDOW_V_MEAN_ADDR] = round_clamp_u16(scaleAdcReading((int16_t)(w.vSum / w.count), ratedHV_V));
+    modbus_regs[IREG_WINDOW_I_MIN_ADDR] = round_clamp_u16(scaleAdcReading(w.iMin, ratedI_mA) * 1000.0f);
+    modbus_regs[IREG_WINDOW_I_MAX_ADDR] = round_clamp_u16(scaleAdcReading(w.iMax, ratedI_mA) * 1000.0f);
+    modbus_regs[IREG_WINDOW_I_MEAN_ADDR] = round_clamp_u16(scaleAdcReading((int16_t)(w.iSum / w.count), ratedI_mA) * 1000.0f);
+    modbus_regs[IREG_WINDOW_COUNT_ADDR] = w.count;
+}
+
+/**
+ * Publish the sample read_value() just wrote.
+ *
+ * slave.poll() serves the live bank while read_value() writes the other one, so a reply never
+ * mixes registers from two samples. Switching banks is a one-byte store, atomic on the AVR,
+ * and nothing is copied: every per-sample register is rewritten on each read_value() cycle,
+ * so the bank that becomes the write target needs no catching up.
+ */
+static inline void publishRegisters()
+{
+    uint8_t next = modbus_live ^ 1;
+    modbus_live = next;
+    modbus_regs = modbus_bank[next ^ 1];
+}
+
+/**
+ * The snapshot registers change per broadcast rather than per read_value() sample, so like
+ * the status link registers they are written to both banks.
+ */
+static inline void setSnapshotRegister(uint8_t addr, uint16_t value)
+{
+    modbus_bank[0][addr] = value;
+    modbus_bank[1][addr] = value;
+}
+
+/**
+ * INT2 on RX1: stamp every falling edge the RS-485 receiver passes on, and freeze the newest
+ * Vmon/Imon pair with it. The last edge of a frame falls inside its last byte, so it marks
+ * the frame's arrival to within one character (about 1 ms at 9600 baud) however long loop()
+ * takes to get to the frame, and the pair frozen there is the newest one at that moment.
+ */
+static void onModbusRxEdge()
+{
+    modbusRxEdgeUs = micros();
+    modbusRxVmonRaw = latestVmonRaw;
+    modbusRxImonRaw = latestImonRaw;
+    modbusRxPairUs = latestPairUs;
+}
+
+/**
+ * Take a snapshot: publish the Vmon/Imon pair that was newest when the broadcast arrived,
+ * with the broadcast's tag. No ADS1115 read is made here, so the display, the read_value()
+ * sample and the window registers are left alone.
+ *
+ * The snapshot is not simultaneous across monitors. Each one publishes its own latest pair,
+ * read before the frame by however long its sampler last waited: a pair period (about
+ * 2.5 ms) when loop() is idle, up to the longest pass when an LCD refresh or a read_value()
+ * cycle held the sampler up. That age is published with the snapshot. V_SET is the
+ * programmed voltage from the last read_value() sample.
+ */
+static void takeSnapshot(uint16_t tag, uint32_t arrivalUs, const AdcPair &pair)
+{
+    uint32_t ageUs = arrivalUs - pair.us;
+    uint32_t pairMs = millis() - (micros() - pair.us) / 1000UL;
+
+    setSnapshotRegister(IREG_SNAPSHOT_V_SET_ADDR, round_clamp_u16(programmedHV_V));
+    setSnapshotRegister(IREG_SNAPSHOT_V_READ_ADDR, round_clamp_u16(scaleAdcReading(pair.vmonRaw, ratedHV_V)));
+    setSnapshotRegister(IREG_SNAPSHOT_I_READ_ADDR, round_clamp_u16(scaleAdcReading(pair.imonRaw, ratedI_mA) * 1000.0f));
+    setSnapshotRegister(IREG_SNAPSHOT_TIME_HI_ADDR, (uint16_t)(pairMs >> 16));
+    setSnapshotRegister(IREG_SNAPSHOT_TIME_LO_ADDR, (uint16_t)pairMs);
+    setSnapshotRegister(IREG_SNAPSHOT_DELAY_ADDR, (ageUs > 65535UL) ? 65535 : (uint16_t)ageUs);
+    setSnapshotRegister(IREG_SNAPSHOT_TAG_ADDR, tag);
+}
+
+/**
+ * Holding registers are written by slave.poll() into the live bank only. Each served write
+ * is followed by a copy into the working deadbands and into the other bank, so a write
+ * survives the next bank swap.
+ */
+static inline void setHoldingRegister(uint8_t addr, uint16_t value)
+{
+    modbus_bank[0][addr] = value;
+    modbus_bank[1][addr] = value;
+}
+
+static void syncHoldingRegisters()
+{
+    const uint16_t *live = modbus_bank[modbus_live];
+    for (uint8_t addr = HREG_DEADBAND_V_SET_ADDR; addr <= HREG_DEADBAND_I_READ_ADDR; addr++) {
+        setHoldingRegister(addr, live[addr]);
+    }
+    changeDeadband[IREG_V_SET_ADDR] = live[HREG_DEADBAND_V_SET_ADDR];
+    changeDeadband[IREG_V_READ_ADDR] = live[HREG_DEADBAND_V_READ_ADDR];
+    changeDeadband[IREG_I_READ_ADDR] = live[HREG_DEADBAND_I_READ_ADDR];
+}
+
+/**
+ * Modbus request gate.
+ *
+ * The ModbusRtu library frames into a 64-byte buffer and checks a request only against the
+ * size of the register array, so a read of more than MODBUS_MAX_READ_COUNT registers would
+ * build its reply past the end of that buffer. It also drops every frame that is not
+ * addressed to its own ID, broadcasts included. loop() therefore reads Serial1 here first:
+ *   - a frame for this monitor is shown to the library once its header passes
+ *     checkRequest(). Later bytes are passed on as they arrive, so the library still
+ *     times T35 from the last one.
+ *   - a request that fails checkRequest() is held back and answered here with the
+ *     exception it returned
+ *   - a broadcast is held back and handed to takeBroadcast()
+ *   - anything else is held back and dropped, as the library would drop it
+ * A held frame ends after the same T35 of silence the library waits for, and is only acted
+ * on if its CRC is good.
+ *
+ * The library also lets a write land anywhere in the register array, so checkRequest() only
+ * passes writes that stay within the holding registers, 47-49. The coil and discrete-input
+ * function codes would read and write the same array bit by bit, so they are refused too.
+ */
+static uint8_t checkRequest(const uint8_t *frame)
+{
+    uint16_t start = ((uint16_t)frame[2] << 8) | frame[3];
+    uint16_t count = ((uint16_t)frame[4] << 8) | frame[5];
+
+    switch (frame[1]) {
+    case MB_FC_READ_REGISTERS:
+    case MB_FC_READ_INPUT_REGISTER:
+        if (count == 0 || count > MODBUS_MAX_READ_COUNT) {
+            return EXC_REGS_QUANT;
+        }
+        if ((uint32_t)start + count > TOTAL_REG_COUNT) {
+            return EXC_ADDR_RANGE;
+        }
+        break;
+    case MB_FC_WRITE_REGISTER:
+        count = 1;
+        // fall through
+    case MB_FC_WRITE_MULTIPLE_REGISTERS:
+        if (count == 0 || count > HREG_COUNT) {
+            return EXC_REGS_QUANT;
+        }
+        if (start < HREG_DEADBAND_V_SET_ADDR || (uint32_t)start + count > HREG_DEADBAND_I_READ_ADDR + 1) {
+            return EXC_ADDR_RANGE;
+        }
+        break;
+    default:
+        return EXC_FUNC_CODE;
+    }
+
+    gate.function = frame[1];
+    gate.start = start;
+    gate.count = count;
+    return 0;
+}
+
+static bool frameCrcOk(const uint8_t *frame, uint8_t len)
+{
+    if (len < 4) {
+        return false;
+    }
+    uint16_t crc = 0xFFFF;
+    for (uint8_t i = 0; i < len - 2; i++) {
+        crc = _crc16_update(crc, frame[i]);
+    }
+    return crc == ((uint16_t)frame[len - 2] | ((uint16_t)frame[len - 1] << 8));
+}
+
+/**
+ * Answer a request with a Modbus exception, driving the RS-485 direction pin and discarding
+ * whatever the receiver picked up meanwhile, as the library does for its own replies.
+ */
+static void sendException(uint8_t function, uint8_t exception)
+{
+    uint8_t reply[5] = {ps_id, (uint8_t)(function | 0x80), exception, 0, 0};
+    uint16_t crc = 0xFFFF;
+    for (uint8_t i = 0; i < 3; i++) {
+        crc = _crc16_update(crc, reply[i]);
+    }
+    reply[3] = (uint8_t)crc;
+    reply[4] = (uint8_t)(crc >> 8);
+
+    digitalWrite(RS485_DIR_PIN, HIGH);
+    Serial1.write(reply, sizeof(reply));
+    Serial1.flush();
+    digitalWrite(RS485_DIR_PIN, LOW);
+    while (Serial1.read() >= 0) {
+    }
+}
+
+/**
+ * Broadcasts get no reply and do not count as a served read for clearPending. The only
+ * broadcast acted on is a Write Single Register to IREG_SNAPSHOT_TAG_ADDR.
+ */
+static void takeBroadcast(const uint8_t *frame, uint8_t len)
+{
+    uint16_t addr = ((uint16_t)frame[2] << 8) | frame[3];
+    if (len != 8 || frame[1] != MB_FC_WRITE_REGISTER || addr != IREG_SNAPSHOT_TAG_ADDR) {
+        return;
+    }
+    takeSnapshot(((uint16_t)frame[4] << 8) | frame[5], gate.edgeUs, gate.pair);
+}
+
+static inline void resetRequestGate()
+{
+    gate.len = gate.shown = gate.pos = 0;
+    gate.state = GATE_COLLECT;
+    gate.exception = 0;
+    gate.replied = false;
+    gate.function = 0;
+}
+
+/**
+ * Returns true while the library has a request to frame.
+ */
+static bool pollRequestGate()
+{
+    bool arrived = false;
+    while (Serial1.available()) {
+        uint8_t b = Serial1.read();
+        if (gate.len < sizeof(gate.buf)) {
+            gate.buf[gate.len] = b;
+        }
+        if (gate.len < 255) {
+            gate.len++;
+        }
+        arrived = true;
+    }
+    if (arrived) {
+        gate.rxMs = millis();
+        ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+            gate.edgeUs = modbusRxEdgeUs;
+            gate.pair.vmonRaw = modbusRxVmonRaw;
+            gate.pair.imonRaw = modbusRxImonRaw;
+            gate.pair.us = modbusRxPairUs;
+        }
+    }
+    if (gate.len == 0) {
+        return false;
+    }
+
+    if (gate.state == GATE_COLLECT) {
+        if (gate.buf[0] != ps_id) {
+            gate.state = GATE_HOLD;
+        } else if (gate.len >= MODBUS_HEADER_LEN) {
+            gate.exception = checkRequest(gate.buf);
+            gate.state = gate.exception ? GATE_HOLD : GATE_PASS;
+        }
+    }
+
+    if (gate.state == GATE_PASS) {
+        gate.shown = (gate.len < sizeof(gate.buf)) ? gate.len : sizeof(gate.buf);
+        return true;
+    }
+
+    if (arrived || (uint32_t)(millis() - gate.rxMs) < (uint32_t)T35) {
+        return false;
+    }
+    if (gate.len <= sizeof(gate.buf) && frameCrcOk(gate.buf, gate.len)) {
+        if (gate.buf[0] == MODBUS_BROADCAST_ID) {
+            takeBroadcast(gate.buf, gate.len);
+        } else if (gate.exception != 0) {
+            sendException(gate.buf[1], gate.exception);
+        }
+    }
+    resetRequestGate();
+    return false;
+}
+
+static inline bool readCovers(uint8_t first, uint8_t last)
+{
+    return gate.start <= first && (uint32_t)gate.start + gate.count > last;
+}
+
+/**
+ * After slave.poll(): once the library has taken the frame, start collecting the next one.
+ * If it replied, drop what Serial1 received meanwhile, as the library does for its port.
+ *
+ * A served read schedules a clear of each sticky block it carried, so the dashboard has seen
+ * everything that is cleared. The clear itself waits for the next 150 ms read_value() sample,
+ * which keeps sampling and second-tier latch rollover aligned. A served write only updates
+ * the deadbands.
+ */
+static void finishRequest(int8_t pollResult)
+{
+    if (gate.pos < gate.shown) {
+        return;
+    }
+    if (pollResult >= MODBUS_MIN_REPLY_LEN) {
+        if (gate.function == MB_FC_READ_REGISTERS || gate.function == MB_FC_READ_INPUT_REGISTER) {
+            if (readCovers(IREG_WINDOW_V_MIN_ADDR, IREG_WINDOW_COUNT_ADDR)) {
+                clearPending |= CLEAR_WINDOW;
+            }
+            if (readCovers(DINPUT_LATCHED_FLAGS_ADDR, DINPUT_LATCHED_FLAGS_ADDR)) {
+                clearPending |= CLEAR_LATCHED_FLAGS;
+            }
+            if (readCovers(IREG_CHANGE_MAP_ADDR, IREG_CHANGE_MAP_ADDR)) {
+                clearPending |= CLEAR_CHANGE_MAP;
+            }
+            if (readCovers(IREG_LOGIC_LOOP_MIN_HZ_ADDR, IREG_LOGIC_LOOP_MIN_HZ_ADDR)) {
+                clearPending |= CLEAR_LOOP_MIN;
+            }
+        } else {
+            syncHoldingRegisters();
+        }
+    }
+    if (gate.replied) {
+        while (Serial1.read() >= 0) {
+        }
+    }
+    resetRequestGate();
+}
+
+/**
+ * True if the window registers for a tracked register reach past its deadband.
+ */
+static inline bool windowLeftDeadband(uint8_t addr, uint8_t minAddr, uint8_t maxAddr)
+{
+    uint16_t ref = changeRef[addr];
+    uint16_t lo = modbus_regs[minAddr];
+    uint16_t hi = modbus_regs[maxAddr];
+    return (hi > ref && hi - ref > changeDeadband[addr]) || (lo < ref && ref - lo > changeDeadband[addr]);
+}
+
+/**
+ * Helper to maintain the change map for registers 0-5.
+ *
+ * A register's bit is set when the new sample differs from its reference by more than its
+ * deadband, and the reference then moves to the new value. References never move otherwise,
+ * so a slow drift is reported once it adds up to the deadband. V_READ and I_READ are also
+ * flagged when their window extremes leave the deadband, so a spike between samples is
+ * reported even if the sample itself is back. The bits restart on the sample after a read
+ * that carried register 46; as with register 5, a bit set after the reply is kept for the
+ * next one.
+ */
+static inline void updateChangeMap(bool restartWindow)
+{
+    if (restartWindow) {
+        changeMap = 0;
+    }
+
+    for (uint8_t i = 0; i < CHANGE_TRACKED_COUNT; i++) {
+        uint16_t value = modbus_regs[i];
+        uint16_t diff = (value > changeRef[i]) ? (value - changeRef[i]) : (changeRef[i] - value);
+        if (diff > changeDeadband[i]) {
+            changeRef[i] = value;
+            changeMap |= (uint16_t)(1u << i);
+        }
+    }
+    if (windowLeftDeadband(IREG_V_READ_ADDR, IREG_WINDOW_V_MIN_ADDR, IREG_WINDOW_V_MAX_ADDR)) {
+        changeMap |= (uint16_t)(1u << IREG_V_READ_ADDR);
+    }
+    if (windowLeftDeadband(IREG_I_READ_ADDR, IREG_WINDOW_I_MIN_ADDR, IREG_WINDOW_I_MAX_ADDR)) {
+        changeMap |= (uint16_t)(1u << IREG_I_READ_ADDR);
+    }
+
+    modbus_regs[IREG_CHANGE_MAP_ADDR] = changeMap;
+}
+
 /**
  * Read and scale monitored voltage and current, set voltage, and potentiometer thresholds.
  * 
@@ -336,28 +1258,23 @@ void update3KVResetCounter(bool nomop, bool timerEventLatched) {
  */
 bool read_value()
 {
+    uint32_t sampleMs = millis();
+
+    // Sticky blocks carried by a read served since the last sample restart below.
+    uint8_t clears = clearPending;
+    clearPending = 0;
+
     /*
     Calculate the voltage and current values, then store them in RS-485 input regs.
     */
     int16_t imonRaw = ads.readADC_SingleEnded(CH_IMON);
     int16_t vmonRaw = ads.readADC_SingleEnded(CH_VMON);
     int16_t vsetRaw = ads.readADC_SingleEnded(CH_VSET);
-    // Clamp raw readings to be in [0, 32760]
-    imonRaw = clamp_i16_positive(imonRaw);
-    vmonRaw = clamp_i16_positive(vmonRaw);
-    vsetRaw = clamp_i16_positive(vsetRaw);
-    // Convert from raw ADC counts to volts using ±6.144 V full-scale.
-    float imonVolts = imonRaw * VOLTS_PER_COUNT; 
-    float vmonVolts = vmonRaw * VOLTS_PER_COUNT;
-    float vsetVolts = vsetRaw * VOLTS_PER_COUNT; 
-    // Convert to full scale HV (assumed 0-5V input range to ADC)
-    measuredI_mA = (imonVolts / 5.0) * ratedI_mA;
-    measuredHV_V = (vmonVolts / 5.0) * ratedHV_V;
-    programmedHV_V = (vsetVolts / 5.0) * ratedHV_V;
-    // Store in input regs, rounding to the nearest volt and the nearest uA
-    modbus_regs[IREG_V_SET_ADDR] = round_clamp_u16(programmedHV_V);
-    modbus_regs[IREG_V_READ_ADDR] = round_clamp_u16(measuredHV_V);
-    modbus_regs[IREG_I_READ_ADDR] = round_clamp_u16(measuredI_mA * 1000.0f);
+    convertAdcReadings(imonRaw, vmonRaw, vsetRaw);
+    addWindowReading(windowSegment, vmonRaw, imonRaw);
+    setLatestPair(vmonRaw, imonRaw);
+    restartWindowSampler();
+    updateWindowRegisters((clears & CLEAR_WINDOW) != 0);
 
     /* 
     Calculate voltage and current thresholds. 
@@ -379,9 +1296,16 @@ bool read_value()
 
         uint16_t flags = readFlagsWord();
 
-        if (clearPending) {
+        if (clears & CLEAR_LATCHED_FLAGS) {
             latchedFlags = 0;
-            clearPending = false;
+        }
+
+        // Logic Arduino loop rate from the D41 heartbeat edge count.
+        updateLogicLoopRate((clears & CLEAR_LOOP_MIN) != 0);
+
+        // Status link freshness; the link registers themselves are updated per frame.
+        if (LOGIC_STATUS_LINK && (uint32_t)(millis() - linkLastFrameMs) > LOGIC_LINK_TIMEOUT_MS) {
+            setLinkRegister(IREG_LINK_STATUS_ADDR, modbus_regs[IREG_LINK_STATUS_ADDR] & 0x7FFF);
         }
 
         latchedFlags |= flags;
@@ -412,6 +1336,16 @@ bool read_value()
         modbus_regs[DINPUT_LATCHED_FLAGS_ADDR] = 0;
     }
 
+    updateChangeMap((clears & CLEAR_CHANGE_MAP) != 0);
+
+    // Sequence number and timestamp travel in the same bank as the sample they describe.
+    sampleSeq++;
+    modbus_regs[IREG_SAMPLE_SEQ_ADDR] = sampleSeq;
+    modbus_regs[IREG_SAMPLE_TIME_HI_ADDR] = (uint16_t)(sampleMs >> 16);
+    modbus_regs[IREG_SAMPLE_TIME_LO_ADDR] = (uint16_t)sampleMs;
+
+    publishRegisters();
+
     return true;
 }
 
@@ -656,14 +1590,35 @@ void setup()
             pinMode(CCS_POWER_ALLOW_SWITCH_PIN, INPUT_PULLUP);
             pinMode(ARM_80KV_SWITCH_PIN, INPUT_PULLUP);
 
+            // Timer5 counts Logic Arduino heartbeat edges on T5 (D47). init() leaves Timer5
+            // in 8-bit PWM mode, so switch it to normal mode clocked by rising edges on T5.
+            pinMode(LOGIC_LOOP_HEARTBEAT_PIN, INPUT);
+            TCCR5A = 0;
+            TCCR5B = _BV(CS52) | _BV(CS51) | _BV(CS50);
+            TCNT5 = 0;
+            prevLoopEdgeCount = 0;
+            prevLoopSampleMs = millis();
+
             break;
     }
 
     displayStartupInfo();
     delay(5000);                // Display firmware version info for 5 seconds
 
+    // Status link from the Logic Arduino on RX3 (D15), started only now so the receive
+    // ring does not overflow while nothing drains it.
+    if (ps_id == PS_3KV && LOGIC_STATUS_LINK) {
+        logicLinkInit();
+    }
+
+    setHoldingRegister(HREG_DEADBAND_V_SET_ADDR, DEFAULT_DEADBAND_V);
+    setHoldingRegister(HREG_DEADBAND_V_READ_ADDR, DEFAULT_DEADBAND_V);
+    setHoldingRegister(HREG_DEADBAND_I_READ_ADDR, DEFAULT_DEADBAND_I);
+    syncHoldingRegisters();
+
     Serial.println("Initializing Modbus RTU Server on Serial1...");
-    Serial1.begin(9600);
+    Serial1.begin(MODBUS_BAUD);
+    attachInterrupt(digitalPinToInterrupt(RS485_RX_PIN), onModbusRxEdge, FALLING);
     slave.start();
     Serial.println("Modbus RTU Server started.");
 
@@ -679,15 +1634,19 @@ void loop()
 {
   wdt_reset(); //Feed dog
 
-  int8_t pollResult = slave.poll(modbus_regs, TOTAL_REG_COUNT); // poll for requests from dashboard
+  int8_t pollResult = 0;
+  if (pollRequestGate()) {
+    pollResult = slave.poll(modbus_bank[modbus_live], TOTAL_REG_COUNT); // poll for requests from dashboard
+    finishRequest(pollResult);
+  }
 
-  // The dashboard currently reads the full 0-5 block in one request.
-  // A successful reply schedules a clear, but the clear itself is applied on the
-  // next 150 ms read_value() boundary so sampling and second-tier latch rollover
-  // stay aligned.
-  if (ps_id == PS_3KV && pollResult > 4) {
-    clearPending = true;
+  // Pick up any status frames the Logic Arduino streamed since the last pass.
+  if (ps_id == PS_3KV && LOGIC_STATUS_LINK) {
+    pollLogicLink();
   }
 
+  // Keep Vmon/Imon sampled between read_value() cycles for the window registers.
+  pollWindowSampler();
+
   timer.tick();
 }